@@ -30,6 +30,8 @@
 #include <otawa/ilp/Var.h>
 
 #include <string>
+#include <atomic>
+#include <unordered_map>
 
 namespace otawa
 {
@@ -39,19 +41,18 @@ namespace otawa
 		// definition propriete cftree
 
 		//--------------------
-		//	CLASS CFTREELEAF
+		//	CLASS CFTREE
 		//--------------------
 
-		CFTreeLeaf *CFTreeLeaf::toLeaf()
-		{
-			return (CFTreeLeaf *)this;
-		}
-		CFTreeAlt *CFTreeLeaf::toAlt() { return NULL; }	  /* abstract */
-		CFTreeLoop *CFTreeLeaf::toLoop() { return NULL; } /* abstract */
-		CFTreeSeq *CFTreeLeaf::toSeq() { return NULL; }	  /* abstract */
-		CFTreeConditionalAlt *CFTreeLeaf::toConditionalAlt() { return NULL; }
+		static std::atomic<unsigned> cftree_count(0);
+
+		CFTree::CFTree(kind_t k) : kind(k), id(cftree_count++) {}
+
+		//--------------------
+		//	CLASS CFTREELEAF
+		//--------------------
 
-		CFTreeLeaf::CFTreeLeaf(Block *b)
+		CFTreeLeaf::CFTreeLeaf(Block *b) : CFTree(LEAF_NODE)
 		{
 			block = b;
 		}
@@ -62,20 +63,11 @@ namespace otawa
 		//--------------------
 		//	CLASS CFTREEALT
 		//--------------------
-		CFTreeAlt::CFTreeAlt(std::vector<CFTree *> new_alts)
+		CFTreeAlt::CFTreeAlt(std::vector<CFTree *> new_alts) : CFTree(ALT_NODE)
 		{
 			alts = new_alts;
 		}
 
-		CFTreeAlt *CFTreeAlt::toAlt()
-		{
-			return (CFTreeAlt *)this;
-		}
-		CFTreeLeaf *CFTreeAlt::toLeaf() { return NULL; } /* abstract */
-		CFTreeLoop *CFTreeAlt::toLoop() { return NULL; } /* abstract */
-		CFTreeSeq *CFTreeAlt::toSeq() { return NULL; }	 /* abstract */
-		CFTreeConditionalAlt *CFTreeAlt::toConditionalAlt() { return NULL; }
-
 		void CFTreeAlt::addAlt(CFTree *s)
 		{
 			alts.push_back(s);
@@ -100,16 +92,7 @@ namespace otawa
 		//--------------------
 		// CLASS CFTREECONDITIONALALT
 		//--------------------
-		CFTreeLeaf *CFTreeConditionalAlt::toLeaf() { return NULL; }
-		CFTreeAlt *CFTreeConditionalAlt::toAlt() { return NULL; }
-		CFTreeSeq *CFTreeConditionalAlt::toSeq() { return NULL; }
-		CFTreeLoop *CFTreeConditionalAlt::toLoop() { return NULL; }
-		CFTreeConditionalAlt *CFTreeConditionalAlt::toConditionalAlt()
-		{
-			return (CFTreeConditionalAlt *)this;
-		}
-
-		CFTreeConditionalAlt::CFTreeConditionalAlt(std::vector<CFTree *> new_alts, std::map<int, std::string> new_conditions)
+		CFTreeConditionalAlt::CFTreeConditionalAlt(std::vector<CFTree *> new_alts, std::map<int, std::string> new_conditions) : CFTree(COND_ALT_NODE)
 		{
 			alts = new_alts;
 			conditions = new_conditions;
@@ -122,30 +105,27 @@ namespace otawa
 			conditions.emplace(id, condition);
 		}
 
-		std::vector<CFTree *> CFTreeConditionalAlt::getChildren()
+		const std::vector<CFTree *> &CFTreeConditionalAlt::getChildren()
 		{
 			return alts;
 		}
 
-		std::map<int, std::string> CFTreeConditionalAlt::getConditions()
+		const std::map<int, std::string> &CFTreeConditionalAlt::getConditions()
 		{
 			return conditions;
 		}
 
+		std::string CFTreeConditionalAlt::getCondition(size_t i)
+		{
+			auto it = conditions.find(i);
+			return it == conditions.end() ? std::string() : it->second;
+		}
+
 		//--------------------
 		//	CLASS CFTREESEQ
 		//--------------------
 
-		CFTreeSeq *CFTreeSeq::toSeq()
-		{
-			return (CFTreeSeq *)this;
-		}
-		CFTreeLeaf *CFTreeSeq::toLeaf() { return NULL; } /* abstract */
-		CFTreeLoop *CFTreeSeq::toLoop() { return NULL; } /* abstract */
-		CFTreeAlt *CFTreeSeq::toAlt() { return NULL; }	 /* abstract */
-		CFTreeConditionalAlt *CFTreeSeq::toConditionalAlt() { return NULL; }
-
-		CFTreeSeq::CFTreeSeq(std::vector<CFTree *> new_childs)
+		CFTreeSeq::CFTreeSeq(std::vector<CFTree *> new_childs) : CFTree(SEQ_NODE)
 		{
 			childs = new_childs;
 		}
@@ -175,16 +155,7 @@ namespace otawa
 		//	CLASS CFTREELOOP
 		//--------------------
 
-		CFTreeLoop *CFTreeLoop::toLoop()
-		{
-			return (CFTreeLoop *)this;
-		}
-		CFTreeLeaf *CFTreeLoop::toLeaf() { return NULL; } /* abstract */
-		CFTreeSeq *CFTreeLoop::toSeq() { return NULL; }	  /* abstract */
-		CFTreeAlt *CFTreeLoop::toAlt() { return NULL; }	  /* abstract */
-		CFTreeConditionalAlt *CFTreeLoop::toConditionalAlt() { return NULL; }
-
-		CFTreeLoop::CFTreeLoop(BasicBlock *h, int bound, CFTree *n_bd, CFTree *n_ex)
+		CFTreeLoop::CFTreeLoop(BasicBlock *h, int bound, CFTree *n_bd, CFTree *n_ex) : CFTree(LOOP_NODE)
 		{
 			header = h;
 			n = bound;
@@ -193,7 +164,7 @@ namespace otawa
 			ex = n_ex;
 		}
 
-		CFTreeLoop::CFTreeLoop(BasicBlock *h, std::string expression, CFTree *n_bd, CFTree *n_ex)
+		CFTreeLoop::CFTreeLoop(BasicBlock *h, std::string expression, CFTree *n_bd, CFTree *n_ex) : CFTree(LOOP_NODE)
 		{
 			header = h;
 			n = -1;
@@ -244,6 +215,7 @@ namespace otawa
 		}
 		void DAG::addNode(DAGNode *s)
 		{
+			s->owner = this;
 			all.push_back(s);
 		}
 
@@ -282,23 +254,149 @@ namespace otawa
 
 		void DAG::visit(std::function<void(DAGNode *)> &h, bool recursive)
 		{
-			for (std::vector<DAGNode *>::const_iterator it = all.begin(); it != all.end(); it++)
+			// the nodes of a sub-DAG are visited right after its superblock
+			std::vector<std::pair<DAG *, std::size_t>> stack(1, std::make_pair(this, 0));
+			while (!stack.empty())
 			{
-				DAGNode *n = *it;
+				DAG *d = stack.back().first;
+				if (stack.back().second == d->all.size())
+				{
+					stack.pop_back();
+					continue;
+				}
+				DAGNode *n = d->all[stack.back().second++];
 				h(n);
 				if ((n->toHNode() != nullptr) && recursive)
 				{
-					n->toHNode()->getDag()->visit(h, recursive);
+					stack.push_back(std::make_pair(n->toHNode()->getDag(), 0));
+				}
+			}
+		}
+
+		void DAG::pack()
+		{
+			std::vector<DAG *> todo(1, this);
+			while (!todo.empty())
+			{
+				DAG *d = todo.back();
+				todo.pop_back();
+
+				std::size_t count = 0;
+				for (auto it = d->all.begin(); it != d->all.end(); it++)
+					count += (*it)->succ.size() + (*it)->pred.size();
+				d->adjacency.resize(count);
+
+				DAGNode **p = d->adjacency.data();
+				for (auto it = d->all.begin(); it != d->all.end(); it++)
+				{
+					DAGNode *n = *it;
+					n->edges = p;
+					n->n_succ = n->succ.size();
+					n->n_pred = n->pred.size();
+					p = std::copy(n->succ.begin(), n->succ.end(), p);
+					p = std::copy(n->pred.begin(), n->pred.end(), p);
+					std::vector<DAGNode *>().swap(n->succ);
+					std::vector<DAGNode *>().swap(n->pred);
+					if (n->toHNode())
+						todo.push_back(n->toHNode()->getDag());
 				}
 			}
 		}
 
+		/*
+Construit l'arbre des dominateurs du DAG. Les noeuds sont parcourus dans
+l'ordre topologique (post-ordre inverse depuis le début) : tous les
+prédécesseurs d'un noeud sont alors placés dans l'arbre, et son dominateur
+immédiat est leur plus proche ancêtre commun.
+*/
+		void DAG::computeDominators()
+		{
+			std::vector<DAGNode *> order;
+			std::vector<std::pair<DAGNode *, DAGNode::iterator>> stack;
+			std::set<DAGNode *> seen;
+
+			dominators = true;
+			for (auto it = all.begin(); it != all.end(); it++)
+			{
+				(*it)->idom = nullptr;
+				(*it)->dom_depth = -1;
+			}
+			if (n_start == nullptr)
+				return;
+
+			// post-ordre itératif
+			seen.insert(n_start);
+			stack.push_back(std::make_pair(n_start, n_start->succIter()));
+			while (!stack.empty())
+			{
+				DAGNode *n = stack.back().first;
+				if (stack.back().second == n->succEnd())
+				{
+					order.push_back(n);
+					stack.pop_back();
+					continue;
+				}
+				DAGNode *s = *(stack.back().second++);
+				if (seen.insert(s).second)
+					stack.push_back(std::make_pair(s, s->succIter()));
+			}
+
+			n_start->dom_depth = 0;
+			for (auto it = order.rbegin(); it != order.rend(); it++)
+			{
+				DAGNode *n = *it;
+				if (n == n_start)
+					continue;
+				DAGNode *d = nullptr;
+				for (auto pred = n->predIter(); pred != n->predEnd(); pred++)
+				{
+					DAGNode *p = *pred;
+					if (p->dom_depth < 0)
+						continue; // inaccessible depuis le début
+					if (d == nullptr)
+					{
+						d = p;
+						continue;
+					}
+					while (d != p)
+					{
+						if (d->dom_depth >= p->dom_depth)
+							d = d->idom;
+						else
+							p = p->idom;
+					}
+				}
+				ASSERT(d != nullptr);
+				n->idom = d;
+				n->dom_depth = d->dom_depth + 1;
+			}
+		}
+
+		DAGNode *DAG::getIdom(DAGNode *n)
+		{
+			if (!dominators)
+				computeDominators();
+			return n->idom;
+		}
+
+		bool DAG::dominates(DAGNode *a, DAGNode *b)
+		{
+			if (!dominators)
+				computeDominators();
+			if (a->dom_depth < 0 || b->dom_depth < 0)
+				return a == b;
+			while (b->dom_depth > a->dom_depth)
+				b = b->idom;
+			return a == b;
+		}
+
 		//----------------------
 		//		CLASS DAGNODE
 		//----------------------
 
 		void DAGNode::addSucc(DAGNode *s)
 		{
+			ASSERT(edges == nullptr);
 			if (std::find(succ.begin(), succ.end(), s) == succ.end())
 			{
 				succ.push_back(s);
@@ -307,40 +405,56 @@ namespace otawa
 
 		void DAGNode::addPred(DAGNode *s)
 		{
+			ASSERT(edges == nullptr);
 			if (std::find(pred.begin(), pred.end(), s) == pred.end())
 			{
 				pred.push_back(s);
 			}
 		}
 
-		std::vector<DAGNode *>::const_iterator DAGNode::succIter()
+		DAGNode::iterator DAGNode::succIter()
+		{
+			return edges ? edges : succ.data();
+		}
+
+		DAGNode::iterator DAGNode::predIter()
+		{
+			return edges ? edges + n_succ : pred.data();
+		}
+
+		DAGNode::iterator DAGNode::succEnd()
 		{
-			return succ.begin();
+			return succIter() + succCount();
 		}
 
-		std::vector<DAGNode *>::const_iterator DAGNode::predIter()
+		DAGNode::iterator DAGNode::predEnd()
 		{
-			return pred.begin();
+			return predIter() + predCount();
 		}
 
-		std::vector<DAGNode *>::const_iterator DAGNode::succEnd()
+		std::size_t DAGNode::succCount()
 		{
-			return succ.end();
+			return edges ? n_succ : succ.size();
 		}
 
-		std::vector<DAGNode *>::const_iterator DAGNode::predEnd()
+		std::size_t DAGNode::predCount()
 		{
-			return pred.end();
+			return edges ? n_pred : pred.size();
 		}
 
 		std::vector<DAGNode *> DAGNode::getSucc()
 		{
-			return succ;
+			return std::vector<DAGNode *>(succIter(), succEnd());
 		}
 
 		std::vector<DAGNode *> DAGNode::getPred()
 		{
-			return pred;
+			return std::vector<DAGNode *>(predIter(), predEnd());
+		}
+
+		DAG *DAGNode::getOwner()
+		{
+			return owner;
 		}
 
 		//----------------------
@@ -357,7 +471,14 @@ namespace otawa
 		DAGHNode::DAGHNode(BasicBlock *b)
 		{
 			header = b;
-			DAG_HNODE(header) = this;
+			BlockTable::setHNode(header, this);
+		}
+
+		DAGHNode::~DAGHNode()
+		{
+			delete sub_dag;
+			if (BlockTable::hnode(header) == this)
+				BlockTable::setHNode(header, nullptr);
 		}
 
 		void DAGHNode::setDAG(DAG *dag)
@@ -401,7 +522,13 @@ namespace otawa
 			if (_synth)
 				callee = b->toSynth()->callee();
 
-			DAG_BNODE(block) = this;
+			BlockTable::setBNode(block, this);
+		}
+
+		DAGBNode::~DAGBNode()
+		{
+			if (BlockTable::bnode(block) == this)
+				BlockTable::setBNode(block, nullptr);
 		}
 
 		Block *DAGBNode::getBlock()
@@ -455,10 +582,14 @@ namespace otawa
 
 		CFTreeExtractor::CFTreeExtractor(p::declare &r) : Processor(r) {}
 
+		/* see FUNCTION_SUMMARIES */
+		static bool function_summaries = false;
+
 		void CFTreeExtractor::configure(const PropList &props)
 		{
 			// configure CFTreeExtractor avec la PropList
 			Processor::configure(props);
+			function_summaries = FUNCTION_SUMMARIES(props);
 		}
 
 		//---------------------------------------
@@ -577,88 +708,74 @@ namespace otawa
 			return o;
 		}
 
-		//---------------------------
-		//				DOT FOR CFT
-		//---------------------------
-		static std::string write_tree(CFTreeLoop &n, unsigned int *lab);
-		static std::string write_tree(CFTreeAlt &n, unsigned int *lab);
-		static std::string write_tree(CFTreeConditionalAlt &n, unsigned int *lab);
-		static std::string write_tree(CFTreeSeq &n, unsigned int *lab);
-		static std::string write_tree(CFTreeLeaf &n, unsigned int *lab);
-		static std::string write_tree(CFTree &n, unsigned int *lab);
-
-		static std::string write_tree(CFTreeLoop &n, unsigned int *lab)
-		{
-			std::stringstream ss;
-			unsigned int loop_lab = *lab;
-			ss << "l" << loop_lab << " [label = \"Loop(b" << n.getHeaderId() << ")\"]; \n";
-
-			// body
-			CFTree *ch = n.getBody();
-			unsigned int old_lab = ++(*lab);
-			ss << write_tree(*ch, lab);
-			ss << "l" << loop_lab << " -> { l" << old_lab << " }; \n";
-
-			unsigned int exit_lab = ++(*lab);
-			ss << "l" << exit_lab << " [label = \" Exit\"]; \n";
-			ss << "l" << loop_lab << " -> { l" << exit_lab << " }; \n";
-			// exit
-			ch = n.getExit();
-			old_lab = ++(*lab);
-			ss << write_tree(*ch, lab);
-			ss << "l" << exit_lab << " -> { l" << old_lab << " }; \n";
-			return ss.str();
-		}
+		//--------------------------
+		//	CLASS CFTREEVISITOR
+		//--------------------------
 
-		static std::string write_tree(CFTreeAlt &n, unsigned int *lab)
+		size_t CFTreeVisitor::childCount(CFTree *t)
 		{
-			std::stringstream ss;
-			unsigned int alt_lab = *lab;
-			ss << "l" << alt_lab << " [label = \" Alt\"]; \n";
-			for (auto it = n.childIter(); it != n.childEnd(); it++)
+			switch (t->getKind())
 			{
-				CFTree *ch = (*it);
-				unsigned int old_lab = ++(*lab);
-				ss << write_tree(*ch, lab);
-				ss << "l" << alt_lab << " -> { l" << old_lab << " }; \n";
+			case CFTree::ALT_NODE:
+				return t->toAlt()->size();
+			case CFTree::COND_ALT_NODE:
+				return t->toConditionalAlt()->getChildren().size();
+			case CFTree::SEQ_NODE:
+				return t->toSeq()->size();
+			case CFTree::LOOP_NODE:
+				return 2;
+			default:
+				return 0;
 			}
-			return ss.str();
 		}
 
-		static std::string write_tree(CFTreeConditionalAlt &n, unsigned int *lab)
+		CFTree *CFTreeVisitor::child(CFTree *t, size_t i)
 		{
-			std::stringstream ss;
-			unsigned int alt_lab = *lab;
-			std::vector<CFTree *> children = n.getChildren();
-			ss << "l" << alt_lab << " [label = \"CAlt\"]; \n";
-			for (long unsigned int i = 0; i != children.size(); i++)
-			{
-				CFTree *ch = children[i];
-				unsigned int old_lab = ++(*lab);
-				ss << write_tree(*ch, lab);
-				if(n.getConditions().at(i) != "")
-					ss << "l" << alt_lab << " -> { l" << old_lab << " } [label=\"" << n.getConditions().at(i) << "\"]; \n";
-				else
-					ss << "l" << alt_lab << " -> { l" << old_lab << " }; \n";
+			switch (t->getKind())
+			{
+			case CFTree::ALT_NODE:
+				return t->toAlt()->getI(i);
+			case CFTree::COND_ALT_NODE:
+				return t->toConditionalAlt()->getChildren()[i];
+			case CFTree::SEQ_NODE:
+				return t->toSeq()->getI(i);
+			case CFTree::LOOP_NODE:
+				return i == 0 ? t->toLoop()->getBody() : t->toLoop()->getExit();
+			default:
+				return nullptr;
 			}
-			return ss.str();
 		}
 
-		static std::string write_tree(CFTreeSeq &n, unsigned int *lab)
+		void CFTreeVisitor::visit(CFTree *root)
 		{
-			std::stringstream ss;
-			unsigned int seq_lab = *lab;
-			ss << "l" << seq_lab << " [label = \" Seq\"]; \n";
-			for (auto it = n.childIter(); it != n.childEnd(); it++)
+			// node and next child of each ancestor of the current node
+			std::vector<std::pair<CFTree *, size_t>> stack;
+			enter(root);
+			stack.push_back(std::make_pair(root, 0));
+			while (!stack.empty())
 			{
-				CFTree *ch = (*it);
-				unsigned int old_lab = ++(*lab);
-				ss << write_tree(*ch, lab);
-				ss << "l" << seq_lab << " -> { l" << old_lab << " }; \n";
+				CFTree *t = stack.back().first;
+				size_t i = stack.back().second;
+				if (i < childCount(t))
+				{
+					stack.back().second++;
+					if (!before(t, i))
+						continue;
+					CFTree *c = child(t, i);
+					enter(c);
+					stack.push_back(std::make_pair(c, 0));
+					continue;
+				}
+				stack.pop_back();
+				leave(t);
+				if (!stack.empty())
+					after(stack.back().first, stack.back().second - 1);
 			}
-			return ss.str();
 		}
 
+		//---------------------------
+		//				DOT FOR CFT
+		//---------------------------
 		static std::string write_tree(CFTreeLeaf &n, unsigned int *lab)
 		{
 			std::stringstream ss;
@@ -676,7 +793,7 @@ namespace otawa
 			{ // cache implement
 				// ss << "B_" << n.getBlockId();
 				Block *b = n.getBlock();
-				if (b->cfg() == nullptr && !IS_PIPELINE_EDGE(n.getBlock()))
+				if (b->cfg() == nullptr && !BlockTable::flag(n.getBlock(), BlockTable::PIPELINE_EDGE))
 				{
 					// infeasible paths implement
 #ifdef IP
@@ -695,12 +812,12 @@ namespace otawa
 				}
 				else
 				{
-					if(IS_PIPELINE_EDGE(n.getBlock()))
+					if(BlockTable::flag(n.getBlock(), BlockTable::PIPELINE_EDGE))
 						ss << "B_PIPELINE";
 					else{
-						if(IS_AFTER_ALT(n.getBlock()))
+						if(BlockTable::flag(n.getBlock(), BlockTable::AFTER_ALT))
 							ss << "(AA_)";
-						else if(IS_LAST_IN_ALT(n.getBlock()))
+						else if(BlockTable::flag(n.getBlock(), BlockTable::LAST_IN_ALT))
 							ss << "(LA_)";
 						ss << "B_" << n.getBlockId();
 					}
@@ -710,137 +827,75 @@ namespace otawa
 			return ss.str();
 		}
 
-		static std::string write_tree(CFTree &n, unsigned int *lab)
+		// Writes a CFT in the dot format, the nodes being numbered in pre-order
+		class DotWriter : public CFTreeVisitor
 		{
-			if (n.toLeaf())
-				return write_tree(*n.toLeaf(), lab);
-			if (n.toAlt())
-				return write_tree(*n.toAlt(), lab);
-			if (n.toLoop())
-				return write_tree(*n.toLoop(), lab);
-			if (n.toSeq())
-				return write_tree(*n.toSeq(), lab);
-			if (n.toConditionalAlt())
-				return write_tree(*n.toConditionalAlt(), lab);
-			return "";
-		}
-
-		static io::Output &write_code(io::Output &, CFTreeLoop &n, unsigned int indent);
-		static io::Output &write_code(io::Output &, CFTreeAlt &n, unsigned int indent);
-		static io::Output &write_code(io::Output &, CFTreeConditionalAlt &n, unsigned int indent);
-		static io::Output &write_code(io::Output &, CFTreeSeq &n, unsigned int indent);
-		static io::Output &write_code(io::Output &, CFTreeLeaf &n, unsigned int indent);
-		static io::Output &write_code(io::Output &, CFTree &n, unsigned int indent);
-
-		static io::Output &write_code(io::Output &o, CFTreeLoop &n, unsigned int indent)
-		{
-			unsigned int i;
-			for (i = 0; i < indent; i++)
-				o << " ";
-			o << "for (loop" << n.getHeader()->id() << ") {\n";
-			o = write_code(o, *n.getBody(), indent + 2);
-			for (i = 0; i < indent; i++)
-				o << " ";
-			o << "}\n";
-
-			o = write_code(o, *n.getExit(), indent);
-			return o;
-		}
+		public:
+			explicit DotWriter(std::ostream &out) : ss(out), lab(0), last(0) {}
 
-		static io::Output &write_code(io::Output &o, CFTreeAlt &n, unsigned int indent)
-		{
-			bool first = true;
-			bool has_none = false;
-			unsigned int count = 0;
-			unsigned int i;
-			for (auto it = n.childIter(); it != n.childEnd(); it++)
+		protected:
+			void enter(CFTree *t) override
 			{
-				CFTree *t = (*it);
-				if (t->toLeaf() && t->toLeaf()->getBlock() == nullptr)
-				{
-					has_none = true;
-					continue;
-				}
-				for (i = 0; i < indent; i++)
-					o << " ";
-				if (first)
-				{
-					o << "if (...) {\n";
-				}
-				else
+				labs.push_back(std::make_pair(lab, 0u));
+				switch (t->getKind())
 				{
-					if (has_none || count < (n.size() - 1))
-					{
-						o << "} else if (...) {\n";
-					}
-					else
-					{
-						o << "} else {\n";
-					}
+				case CFTree::LOOP_NODE:
+					ss << "l" << lab << " [label = \"Loop(b" << t->toLoop()->getHeaderId() << ")\"]; \n";
+					break;
+				case CFTree::ALT_NODE:
+					ss << "l" << lab << " [label = \" Alt\"]; \n";
+					break;
+				case CFTree::COND_ALT_NODE:
+					ss << "l" << lab << " [label = \"CAlt\"]; \n";
+					break;
+				case CFTree::SEQ_NODE:
+					ss << "l" << lab << " [label = \" Seq\"]; \n";
+					break;
+				case CFTree::LEAF_NODE:
+					ss << write_tree(*t->toLeaf(), &lab);
+					break;
 				}
-				o = write_code(o, *t, indent + 2);
-				first = false;
-				count++;
 			}
-			for (i = 0; i < indent; i++)
-				o << " ";
-			o << "}\n";
-			return o;
-		}
 
-		static io::Output &write_code(io::Output &o, CFTreeConditionalAlt &n, unsigned int indent)
-		{
-			bool first = true;
-			bool has_none = false;
-			unsigned int count = 0;
-			unsigned int i;
-			std::vector<CFTree *> children = n.getChildren();
-			auto childIter = children.begin();
-			auto childEnd = children.end();
-			for (auto it = childIter; it != childEnd; it++)
+			bool before(CFTree *t, size_t i) override
 			{
-				CFTree *t = (*it);
-				if (t->toLeaf() && t->toLeaf()->getBlock() == nullptr)
-				{
-					has_none = true;
-					continue;
-				}
-				for (i = 0; i < indent; i++)
-					o << " ";
-				if (first)
+				if (t->toLoop() && i == 1)
 				{
-					o << "if (...) {\n";
+					// exit
+					unsigned int exit_lab = ++lab;
+					labs.back().second = exit_lab;
+					ss << "l" << exit_lab << " [label = \" Exit\"]; \n";
+					ss << "l" << labs.back().first << " -> { l" << exit_lab << " }; \n";
 				}
+				++lab;
+				return true;
+			}
+
+			void after(CFTree *t, size_t i) override
+			{
+				unsigned int from = (t->toLoop() && i == 1) ? labs.back().second : labs.back().first;
+				CFTreeConditionalAlt *calt = t->toConditionalAlt();
+				if (calt && calt->getConditions().at(i) != "")
+					ss << "l" << from << " -> { l" << last << " } [label=\"" << calt->getConditions().at(i) << "\"]; \n";
 				else
-				{
-					if (has_none || count < (n.getChildren().size() - 1))
-					{
-						o << "} else if (...) {\n";
-					}
-					else
-					{
-						o << "} else {\n";
-					}
-				}
-				o = write_code(o, *t, indent + 2);
-				first = false;
-				count++;
+					ss << "l" << from << " -> { l" << last << " }; \n";
 			}
-			for (i = 0; i < indent; i++)
-				o << " ";
-			o << "}\n";
-			return o;
-		}
 
-		static io::Output &write_code(io::Output &o, CFTreeSeq &n, unsigned int indent)
-		{
-			for (auto it = n.childIter(); it != n.childEnd(); it++)
+			void leave(CFTree *) override
 			{
-				CFTree *t = (*it);
-				o = write_code(o, *t, indent);
+				last = labs.back().first;
+				labs.pop_back();
 			}
-			return o;
-		}
+
+		private:
+			std::ostream &ss;
+			unsigned int lab;
+			// label of the last node left
+			unsigned int last;
+			// labels of the ancestors of the current node, and of the exit of the loops
+			std::vector<std::pair<unsigned int, unsigned int>> labs;
+		};
+
 
 		static io::Output &write_code(io::Output &o, CFTreeLeaf &n, unsigned int indent)
 		{
@@ -860,14 +915,14 @@ namespace otawa
 				// cache implement
 				// o << "B" << n.getBlock()->toBasic()->id() << ";\n";
 				Block *b = n.getBlock();
-				if (b->cfg() == nullptr && !IS_PIPELINE_EDGE(b))
+				if (b->cfg() == nullptr && !BlockTable::flag(b, BlockTable::PIPELINE_EDGE))
 				{
 					BasicCacheBlock *bcb = static_cast<BasicCacheBlock *>(b);
 					o << "BCB" << bcb->id() << ";\n";
 				}
 				else
 				{
-					if(IS_PIPELINE_EDGE(n.getBlock()))
+					if(BlockTable::flag(n.getBlock(), BlockTable::PIPELINE_EDGE))
 						o << "BPIPE;\n";
 					else
 						o << "B" << n.getBlock()->toBasic()->id() << ";\n";
@@ -876,20 +931,101 @@ namespace otawa
 			return o;
 		}
 
-		static io::Output &write_code(io::Output &o, CFTree &n, unsigned int indent)
+		// Writes a CFT as pseudo-C code
+		class CodeWriter : public CFTreeVisitor
 		{
-			if (n.toLeaf())
-				return write_code(o, *n.toLeaf(), indent);
-			if (n.toAlt())
-				return write_code(o, *n.toAlt(), indent);
-			if (n.toLoop())
-				return write_code(o, *n.toLoop(), indent);
-			if (n.toSeq())
-				return write_code(o, *n.toSeq(), indent);
-			if (n.toConditionalAlt())
-				return write_code(o, *n.toConditionalAlt(), indent);
-			abort();
-		}
+		public:
+			CodeWriter(io::Output &out, unsigned int indent) : o(out), next_indent(indent) {}
+
+		protected:
+			void enter(CFTree *t) override
+			{
+				frames.push_back(Frame{next_indent, true, false, 0});
+				if (t->toLeaf())
+					write_code(o, *t->toLeaf(), next_indent);
+			}
+
+			bool before(CFTree *t, size_t i) override
+			{
+				Frame &fr = frames.back();
+				if (CFTreeLoop *n = t->toLoop())
+				{
+					indent(fr.indent);
+					if (i == 0)
+					{
+						o << "for (loop" << n->getHeader()->id() << ") {\n";
+						next_indent = fr.indent + 2;
+					}
+					else
+					{
+						o << "}\n";
+						next_indent = fr.indent;
+					}
+					return true;
+				}
+				if (t->toAlt() || t->toConditionalAlt())
+				{
+					CFTree *c = child(t, i);
+					if (c->toLeaf() && c->toLeaf()->getBlock() == nullptr)
+					{
+						fr.has_none = true;
+						return false;
+					}
+					indent(fr.indent);
+					if (fr.first)
+					{
+						o << "if (...) {\n";
+					}
+					else
+					{
+						if (fr.has_none || fr.count < (childCount(t) - 1))
+						{
+							o << "} else if (...) {\n";
+						}
+						else
+						{
+							o << "} else {\n";
+						}
+					}
+					fr.first = false;
+					fr.count++;
+					next_indent = fr.indent + 2;
+					return true;
+				}
+				next_indent = fr.indent;
+				return true;
+			}
+
+			void leave(CFTree *t) override
+			{
+				if (t->toAlt() || t->toConditionalAlt())
+				{
+					indent(frames.back().indent);
+					o << "}\n";
+				}
+				frames.pop_back();
+			}
+
+		private:
+			struct Frame
+			{
+				unsigned int indent;
+				// state of the alternatives
+				bool first;
+				bool has_none;
+				unsigned int count;
+			};
+
+			void indent(unsigned int n)
+			{
+				for (unsigned int i = 0; i < n; i++)
+					o << " ";
+			}
+
+			io::Output &o;
+			unsigned int next_indent;
+			std::vector<Frame> frames;
+		};
 
 		//=================================================
 
@@ -900,66 +1036,91 @@ namespace otawa
 		/*
 	Returns the list of blocks contained in the loop that has b as header
 */
-		void getAllBlocksLoop(DAG *dag, std::vector<DAGBNode *> *blocks, std::vector<DAGHNode *> *lh_blocks, CFG *cfg, BasicBlock *l_h)
+		void getAllBlocksLoop(DAG *dag, std::vector<DAGBNode *> *blocks, std::vector<DAGHNode *> *lh_blocks, const std::vector<Block *> &loop, BasicBlock *l_h)
 		{
-			for (CFG::BlockIter iter(cfg->blocks()); iter(); iter++)
+			for (auto iter = loop.begin(); iter != loop.end(); iter++)
 			{
-				Block *bb = *iter;						// bloc qu'on veut ajouter
-				Block *bb2 = ENCLOSING_LOOP_HEADER(bb); // pointeur
-				if ((bb2 == l_h) || (bb == l_h))
-				{ // on ajoute les blocs qui sont directement dans la boucle l_h
-					if (bb->isBasic() || bb->isSynth())
-					{
-						Block *b = bb;
-						if (LOOP_HEADER(bb) && b != l_h)
-						{ // si un autre loop_header
-							// cout << "Je rentre ici" << endl;
-
-							DAGHNode *n = new DAGHNode(b->toBasic()); // headers are always basic
-							dag->addNode(n);
-							lh_blocks->push_back(n);
-						}
-						else
-						{ // sinon on va l'ajouter au DAG
-							// cout << "cree dagnode pour bb: " << b << endl;
-							DAGBNode *n = DAG_BNODE(b);
-							if (n == NULL)
-							{ // Si il n'a jamais été ajouté
-								n = new DAGBNode(b);
-								dag->addNode(n);
-							}
-							for (Block::EdgeIter it2(b->outs()); it2(); it2++)
-							{ // on cherche les successeurs du bloc
-								Edge *edge = *it2;
-								if (LOOP_EXIT_EDGE(edge) == NULL)
-								{
-									if (edge->sink()->isBasic() || edge->sink()->isSynth())
-									{ // si pointe vers un autre bloc basic
+				Block *b = *iter; // bloc qu'on veut ajouter, directement dans la boucle l_h
+				if (LOOP_HEADER(b) && b != l_h)
+				{ // si un autre loop_header
+					// cout << "Je rentre ici" << endl;
+
+					DAGHNode *n = new DAGHNode(b->toBasic()); // headers are always basic
+					dag->addNode(n);
+					lh_blocks->push_back(n);
+				}
+				else
+				{ // sinon on va l'ajouter au DAG
+					// cout << "cree dagnode pour bb: " << b << endl;
+					DAGBNode *n = BlockTable::bnode(b);
+					if (n == NULL)
+					{ // Si il n'a jamais été ajouté
+						n = new DAGBNode(b);
+						dag->addNode(n);
+					}
+					for (Block::EdgeIter it2(b->outs()); it2(); it2++)
+					{ // on cherche les successeurs du bloc
+						Edge *edge = *it2;
+						if (LOOP_EXIT_EDGE(edge) == NULL)
+						{
+							if (edge->sink()->isBasic() || edge->sink()->isSynth())
+							{ // si pointe vers un autre bloc basic
 
-										Block *bbs = edge->sink();
-										// cout << "lien de b1 : " << b << "vers b2 : " << bbs << endl;
-										if (LOOP_HEADER(bbs) /*  && bbs != l_h */)
-											continue;
+								Block *bbs = edge->sink();
+								// cout << "lien de b1 : " << b << "vers b2 : " << bbs << endl;
+								if (LOOP_HEADER(bbs) /*  && bbs != l_h */)
+									continue;
 
-										DAGNode *ns = DAG_BNODE(bbs);
-										if (ns == NULL)
-										{
-											ns = new DAGBNode(bbs);
-											dag->addNode(ns);
-										}
-										n->addSucc(ns);
-										ns->addPred(n);
-									}
+								DAGNode *ns = BlockTable::bnode(bbs);
+								if (ns == NULL)
+								{
+									ns = new DAGBNode(bbs);
+									dag->addNode(ns);
 								}
+								n->addSucc(ns);
+								ns->addPred(n);
 							}
-							blocks->push_back(n);
 						}
 					}
+					blocks->push_back(n);
 				}
-				//		}
 			}
 		}
 
+		/*
+	Returns the basic blocks and loop headers of the CFG, bucketed by the loop
+	that directly contains them (nullptr for the CFG body); a loop header is
+	also in its own bucket. Each bucket keeps the CFG order.
+*/
+		void getLoopBlocks(CFG *cfg, std::map<Block *, std::vector<Block *>> &loop_blocks)
+		{
+			loop_blocks.clear();
+			for (CFG::BlockIter iter(cfg->blocks()); iter(); iter++)
+			{
+				Block *bb = *iter;
+				if (!bb->isBasic() && !bb->isSynth())
+					continue;
+				loop_blocks[ENCLOSING_LOOP_HEADER(bb)].push_back(bb);
+				if (LOOP_HEADER(bb))
+					loop_blocks[bb].push_back(bb);
+			}
+		}
+
+		/*
+	Returns the superblock of the DAG dag that directly contains the block b,
+	or nullptr if there is none
+*/
+		DAGHNode *getSuperblock(DAG *dag, Block *b)
+		{
+			DAGBNode *n = BlockTable::bnode(b);
+			if (n == nullptr || n->getOwner() == nullptr || n->getOwner() == dag)
+				return nullptr;
+			DAGHNode *h = BlockTable::hnode(n->getOwner()->getStart()->toBNode()->getBlock());
+			if (h == nullptr || h->getOwner() != dag)
+				return nullptr;
+			return h;
+		}
+
 		/*
 
 */
@@ -975,7 +1136,7 @@ namespace otawa
 						Edge *edge = *it;
 						Block *start = edge->target();
 						BasicBlock *b_start = *start->toBasic();
-						DAGBNode *n = DAG_BNODE(b_start);
+						DAGBNode *n = BlockTable::bnode(b_start);
 						dag->setStart(n);
 					}
 				}
@@ -1040,22 +1201,6 @@ namespace otawa
 			}
 		}
 
-		bool contains(DAG *d, Block *b, bool recursive = false)
-		{
-			bool res = false;
-			std::function<void(DAGNode *)> fn = [b, &res](DAGNode *n)
-			{
-				if (n->toBNode())
-				{
-					Block *bb = n->toBNode()->getBlock();
-					if (bb == b)
-						res = true;
-				}
-			};
-			d->visit(fn, recursive);
-			return res;
-		}
-
 		bool loop_contains(BasicBlock *h, Block *b)
 		{
 			if (b == h)
@@ -1070,31 +1215,57 @@ namespace otawa
 			return false;
 		}
 
-		DAG *CFTreeExtractor::toDAG(CFG *cfg /* CFG a dag-ifier */, BasicBlock *l_h /* boucle a dag-ifier, ou NULL si racine du CFG */)
+		/*
+	DAG of a loop (or of the CFG body when l_h is NULL) under construction,
+	kept on an explicit stack so that the depth of the loop nests is not
+	limited by the call stack
+*/
+		struct DAGFrame
 		{
-			// D'abord on cree un DAG vide avec juste les noeuds virtuels EXIT et NEXT
-			DAG *dag = new DAG();
-			DAGVNode *next = new DAGVNode(VNODE_NEXT); // noeud NEXT en cours de construction
-			DAGVNode *exit = new DAGVNode(VNODE_EXIT); // noeud EXIT
-			dag->addNode(next);
-			dag->addNode(exit);
-			dag->setVirtNext(next);
-			dag->setVirtExit(exit);
-
+			BasicBlock *l_h;
+			DAG *dag;
+			DAGVNode *next;
+			DAGVNode *exit;
 			// blocks : tous les blocs non-headers qui sont directement dans l_h
 			std::vector<DAGBNode *> blocks; // Bd moins les headers de boucle
-
 			// lh_blocks : tous les blocs headers qui sont directement dans l_h
 			std::vector<DAGHNode *> lh_blocks; // lh' tous les headers de boucle
+			// next sub-loop to build
+			size_t i = 0;
+		};
+
+		/*
+	Creates the nodes of the DAG of l_h, whose blocks are loop, and pushes its frame
+*/
+		static void beginDAG(std::vector<DAGFrame> &stack, const std::vector<Block *> &loop, BasicBlock *l_h)
+		{
+			stack.emplace_back();
+			DAGFrame &fr = stack.back();
+			fr.l_h = l_h;
 
-			// std::vector<DAG*> sub_cfg;
-			otawa::cftree::getAllBlocksLoop(dag, &blocks, &lh_blocks, cfg, l_h);
+			// D'abord on cree un DAG vide avec juste les noeuds virtuels EXIT et NEXT
+			fr.dag = new DAG();
+			fr.next = new DAGVNode(VNODE_NEXT); // noeud NEXT en cours de construction
+			fr.exit = new DAGVNode(VNODE_EXIT); // noeud EXIT
+			fr.dag->addNode(fr.next);
+			fr.dag->addNode(fr.exit);
+			fr.dag->setVirtNext(fr.next);
+			fr.dag->setVirtExit(fr.exit);
 
-			for (unsigned i = 0; i < lh_blocks.size(); i++)
-			{ // construit les dags des sous boucles directs
-				// sub_cfg.push_back(toDAG(cfg, lh_blocks[i]->getHeader()));
-				lh_blocks[i]->setDAG(toDAG(cfg, lh_blocks[i]->getHeader()));
-			}
+			otawa::cftree::getAllBlocksLoop(fr.dag, &fr.blocks, &fr.lh_blocks, loop, l_h);
+		}
+
+		/*
+	Adds the edges of the DAG of a frame, once the DAGs of its sub-loops are built
+*/
+		static DAG *endDAG(CFG *cfg, DAGFrame &fr)
+		{
+			BasicBlock *l_h = fr.l_h;
+			DAG *dag = fr.dag;
+			DAGVNode *next = fr.next;
+			DAGVNode *exit = fr.exit;
+			std::vector<DAGBNode *> &blocks = fr.blocks;
+			std::vector<DAGHNode *> &lh_blocks = fr.lh_blocks;
 
 			// Maintenant on a dans lh_blocks[i]->getDag() tous les sous-dags directs.
 
@@ -1156,7 +1327,7 @@ namespace otawa
 			for (unsigned i = 0; i < lh_blocks.size(); i++)
 			{
 				// Add edges that starts from lh_blocks[i]. Can start from any node in superblock
-				std::function<void(DAGNode *)> fn = [&lh_blocks, i, &blocks, &cfg](DAGNode *n)
+				std::function<void(DAGNode *)> fn = [&lh_blocks, i, dag, &cfg](DAGNode *n)
 				{
 					if (n->toBNode())
 					{
@@ -1166,30 +1337,26 @@ namespace otawa
 							Edge *e = *it;
 							Block *target = e->target();
 							// add edges that go to basic blocks
-							for (unsigned int j = 0; j < blocks.size(); j++)
+							DAGBNode *t = BlockTable::bnode(target);
+							if (t != nullptr && t->getOwner() == dag)
 							{
-								if (blocks[j]->getBlock() == target)
-								{
-									lh_blocks[i]->addSucc(blocks[j]);
-									blocks[j]->addPred(lh_blocks[i]);
-								}
+								lh_blocks[i]->addSucc(t);
+								t->addPred(lh_blocks[i]);
 							}
 							// add edges that go to super blocks. Can go only to header.
-							for (unsigned int j = 0; j < lh_blocks.size(); j++)
+							DAGHNode *h = getSuperblock(dag, target);
+							if (h != nullptr && h != lh_blocks[i])
 							{
-								if (i != j && contains(lh_blocks[j]->getDag(), target))
+								if (target != h->getHeader())
 								{
-									if (target != lh_blocks[j]->getHeader())
-									{
-										cerr << "CFG " << cfg->label()
-											 << " contains an irreducible loop, edge="
-											 << e->source()->id() << "->"
-											 << e->target()->id() << " header=" << lh_blocks[j]->getHeader()->id() << "\n";
-										ASSERT(false);
-									}
-									lh_blocks[i]->addSucc(lh_blocks[j]);
-									lh_blocks[j]->addPred(lh_blocks[i]);
+									cerr << "CFG " << cfg->label()
+										 << " contains an irreducible loop, edge="
+										 << e->source()->id() << "->"
+										 << e->target()->id() << " header=" << h->getHeader()->id() << "\n";
+									ASSERT(false);
 								}
+								lh_blocks[i]->addSucc(h);
+								h->addPred(lh_blocks[i]);
 							}
 						}
 					}
@@ -1204,122 +1371,342 @@ namespace otawa
 					Block *source = e->source();
 					// Since the CFG contains no irreducible loops, if l_h!=nullptr, then source is contained in l_h
 					// add edges that come from basic blocks
-					for (unsigned int j = 0; j < blocks.size(); j++)
+					DAGBNode *s = BlockTable::bnode(source);
+					if (s != nullptr && s->getOwner() == dag)
 					{
-						if (blocks[j]->getBlock() == source)
-						{
-							lh_blocks[i]->addPred(blocks[j]);
-							blocks[j]->addSucc(lh_blocks[i]);
-						}
+						lh_blocks[i]->addPred(s);
+						s->addSucc(lh_blocks[i]);
 					}
 					// add edges that come from super blocks. Can come from any block inside the superblock
-					for (unsigned int j = 0; j < lh_blocks.size(); j++)
+					DAGHNode *h = getSuperblock(dag, source);
+					if (h != nullptr && h != lh_blocks[i])
 					{
-						if (i != j && contains(lh_blocks[j]->getDag(), source))
-						{
-							lh_blocks[i]->addPred(lh_blocks[j]);
-							lh_blocks[j]->addSucc(lh_blocks[i]);
-						}
+						lh_blocks[i]->addPred(h);
+						h->addSucc(lh_blocks[i]);
 					}
 				}
 			}
 
 			if (l_h != NULL)
 			{
-				DAGBNode *n = DAG_BNODE(l_h);
+				DAGBNode *n = BlockTable::bnode(l_h);
 				ASSERT(n != nullptr);
 				dag->setStart(n);
 			}
 			else
 			{
 				setEntryDAG(cfg, dag);
+				dag->pack();
+			}
+			return dag;
+		}
+
+		DAG *CFTreeExtractor::toDAG(CFG *cfg /* CFG a dag-ifier */, BasicBlock *l_h /* boucle a dag-ifier, ou NULL si racine du CFG */)
+		{
+			std::vector<DAGFrame> stack;
+			DAG *dag = nullptr;
+
+			if (l_h == NULL)
+				otawa::cftree::getLoopBlocks(cfg, loop_blocks);
+
+			beginDAG(stack, loop_blocks[l_h], l_h);
+			while (!stack.empty())
+			{
+				DAGFrame &fr = stack.back();
+				if (fr.i < fr.lh_blocks.size())
+				{ // construit les dags des sous boucles directs
+					BasicBlock *h = fr.lh_blocks[fr.i++]->getHeader();
+					beginDAG(stack, loop_blocks[h], h);
+					continue;
+				}
+				dag = endDAG(cfg, fr);
+				stack.pop_back();
+				if (!stack.empty())
+					stack.back().lh_blocks[stack.back().i - 1]->setDAG(dag);
 			}
 			return dag;
 		}
 
 		/*
-Vérifie qu'un noeud est dominant à un autre
+Retourne les blocks qui sont présents dans tous les chemins entre start et end :
+ce sont les ancêtres de end dans l'arbre des dominateurs, jusqu'à start exclu.
+Ils sont rangés du plus dominé (end) au moins dominé.
 */
-		int DAGNodeDominate(DAGNode *b1, DAGNode *b2)
+		void forcedPassedNodes(DAG *dag, DAGNode *start, DAGNode *end, std::vector<DAGNode *> *fpn)
 		{
+			if (!dag->dominates(start, end))
+				return;
+			for (DAGNode *n = end; n != start; n = dag->getIdom(n))
+				fpn->push_back(n);
+		}
 
-			if (b1 == b2)
-				return 1;
-
-			if (b1->toVNode())
-				return 0;
+		void pouet()
+		{
+		}
 
-			Block *bb1 = b1->toBNode() ? b1->toBNode()->getBlock() : b1->toHNode()->getHeader();
+		/*
+	Flags the blocks that end a branch of an alternative ending at c, pred being
+	the predecessor of c at the end of the branch and ncd the start of the alternative
+*/
+		static void markLastInAlt(DAGNode *c, Block *cBlock, DAGNode *pred, DAGNode *ncd)
+		{
+			FParamManager fpm;
+			// pipeline annotation
+			if((cBlock != nullptr && pred != ncd && !fpm.isParam(cBlock)) || (c->toHNode() && pred != ncd)){
+				auto p = pred->toBNode();
+				// add an annotation on the block if the block is pred of alt exit node
+				// could be nullptr, be aware !
+				if(p != nullptr){
+					Block* pb = p->getBlock();
+					//cout << "BB " << pb->id() << " IS LAST IN BLOCK" << endl;
+					if(!pb->isSynth()){
+						// regular basic block
+						BlockTable::setFlag(pb, BlockTable::LAST_IN_ALT);
+					}
+					else{
+						// function call
+						// we need to get the last block of the function
+						SynthBlock* sb = pb->toSynth();
+						Block* exit = sb->callee()->exit(); // get the virtual exit node
+						auto edges = exit->inEdges();
+						std::set<Edge*> wl;
+						std::set<Edge*> nextWl;
+						// default list
+						for(auto e = edges.begin(); e != edges.end(); e++){
+							wl.insert(*e);
+						}
+						// process working list
+						//cout << "WL SIZE: " << wl.size() << endl;
+						while(wl.size() > 0){
+							for(auto edge = wl.begin(); edge != wl.end(); edge++){
+								Block* source = (*edge)->source();
+								if(source->isBasic()){
+									BlockTable::setFlag(source, BlockTable::LAST_IN_ALT);
+									//cout << source->id() << " IS LAST IN ALT" << endl;
+								}
+								else{
+									auto predEdges = source->inEdges();
+									for(auto e = predEdges.begin(); e != predEdges.end(); e++){
+										nextWl.insert(*e);
+									}
+								}
+							}
+							wl = nextWl;
+							//cout << "WL SIZE: " << wl.size() << endl;
+						}
+					}
+				}
+				else{
+					if(DAGHNode* hn = pred->toHNode()){
+						// set the loop header as the last element in an ALT node
+						Block* header = hn->getHeader();
+						BlockTable::setFlag(header, BlockTable::LAST_IN_ALT);
+						//cout << header->id() << endl;
+						// detect the correct edge to reduce pessimism
+						auto es = header->outEdges();
+						for(auto e = es.begin(); e != es .end(); e++){
+							if((*e)->sink() == cBlock){
+								BlockTable::setEdgeAlias(header, *e);
+								break;
+							}
+						}
+					}
+					else{
+						cout << "WARN: Unsupported DAGNode type used" << endl;
+					}
+				}
+			}
+		}
 
-			if (b2->toVNode())
-			{
-				for (auto pred = b2->predIter(); pred != b2->predEnd(); pred++)
-				{
-					if (!DAGNodeDominate(b1, *pred))
-						return 0;
+		/*
+	Appends to br the empty branch of an alternative ending at c, when its
+	predecessor number pred is the start of the alternative
+*/
+		static void emptyBranch(DAGNode *c, Block *cBlock, int pred, std::vector<CFTree *> &br, std::string &cdtNull)
+		{
+#ifdef PIPELINE
+			FParamManager fpm;
+			if((cBlock != nullptr && !fpm.isParam(cBlock)) || (!fpm.isParam(cBlock) && c->toHNode())){
+				Edge* edge;
+				if(DAGHNode* hn = c->toHNode()){
+					// need a special processing to account the alt before the loop
+					BlockTable::setFlag(hn->getHeader(), BlockTable::AFTER_ALT);
+					BlockTable::setFlag(hn->getHeader(), BlockTable::AA_LOOPEXIT);
+					// get the edge representing the entry of the loop
+					auto ies = hn->getHeader()->inEdges();
+					//cout << "BB |" << cBlock->id() << "|" << endl;
+					int pn = 0;
+					auto it = ies.begin();
+					while(pn != pred){
+						it++;
+						pn++;
+					}
+					edge = *it;
+				}
+				else{
+					// find the corresponding edge
+					auto ies = cBlock->inEdges();
+					//cout << "BB |" << cBlock->id() << "|" << endl;
+					int pn = 0;
+					auto it = ies.begin();
+					while(pn != pred){
+						it++;
+						pn++;
+					}
+					edge = *it;
 				}
-				return 1;
+				// create a fake basic block
+				// create fake instructions
+				NullInst nullInst;
+				NullInst nullInstArray[1];
+				nullInstArray[0] = nullInst;
+				Inst *buffer[1] = {nullInstArray};
+				Inst **bufferBis = buffer;
+				const Array<Inst *> insts(1, bufferBis);
+
+				BasicBlock* fb = new BasicBlock(insts);
+				ipet::TIME(fb) = 0;
+				BlockTable::setFlag(fb, BlockTable::LAST_IN_ALT);
+				// create a fake predecessor
+				BlockTable::setFlag(fb, BlockTable::PIPELINE_EDGE);
+				BlockTable::setEdgeAlias(fb, edge);
+				br.push_back(new CFTreeLeaf(fb));
 			}
-			else
-			{
+			else{
+				//cout << "POSSIBLE PESSIMISM BECAUSE CBLOCK IS NOT A BASIC BLOCK" << endl;
+				/*auto oes = (*pred)->toBNode()->getBlock()->outEdges();
+				for(auto oe = oes.begin(); oe != oes.end(); oe++){
+					auto edge = *oe;
+					// create a fake basic block
+					// create fake instructions
+					NullInst nullInst;
+					NullInst nullInstArray[1];
+					nullInstArray[0] = nullInst;
+					Inst *buffer[1] = {nullInstArray};
+					Inst **bufferBis = buffer;
+					const Array<Inst *> insts(1, bufferBis);
+
+					BasicBlock* fb = new BasicBlock(insts);
+					ipet::TIME(fb) = 0;
+					BlockTable::setFlag(fb, BlockTable::LAST_IN_ALT);
+					BlockTable::setFlag(fb, BlockTable::PIPELINE_EDGE);
+					BlockTable::setEdgeAlias(fb, edge);
+					br.push_back(new CFTreeLeaf(fb));
+				}*/
+				br.push_back(new CFTreeLeaf(nullptr));
+			}
+#else
+			(void)c;
+			(void)pred;
+			br.push_back(new CFTreeLeaf(nullptr));
+#endif
 
-				Block *bb2 = b2->toBNode() ? b2->toBNode()->getBlock() : b2->toHNode()->getHeader();
-				if (Dominance::dominates(bb1, bb2))
+			// try to retrieve condition when a null element exists
+			// Block* cBlock = c->toBNode()->getBlock();
+			if (cBlock != nullptr)
+			{
+				BranchCondition *bc = BlockTable::condition(cBlock);
+				if (bc != nullptr)
 				{
-					return 1;
+					cdtNull = bc->getConditions();
 				}
 			}
-			return 0;
 		}
 
 		/*
-Retourne les blocks qui sont présents dans tous les chemins entre start et end
+	Appends to ch the alternative ending at c, from its branches br
 */
-		void forcedPassedNodes(DAG *dag, DAGNode *start, DAGNode *end, std::vector<DAGNode *> *fpn)
+		static void endAlt(Block *cBlock, std::vector<CFTree *> &br, std::vector<CFTree *> &ch)
 		{
-			// std::vector<DAGNode*> *fpn;
-
-			// pour tous les noeuds du dag
-			for (auto it = dag->iter(); it != dag->end(); it++)
+			FParamManager fpm;
+			if(cBlock != nullptr && !fpm.isParam(cBlock)){
+				// annotation to make sure we know it is located at the end of an ALT node
+				BlockTable::setFlag(cBlock, BlockTable::AFTER_ALT);
+				//cout << cBlock->id() << " IS AFTER ALT" << endl;
+			}
+			if (br.size() == 1)
 			{
-				DAGNode *n = (*it);
-				if (start != n)
+				ch.push_back(br[0]);
+			}
+			else
+			{
+				// check if in an alt node we have a condition
+				ConditionParser parser;
+				std::map<int, std::string> cdts;
+				for (long unsigned int i = 0; i != br.size(); i++)
 				{
-					if (DAGNodeDominate(start, n) && DAGNodeDominate(n, end))
+					BranchCondition *cdt = parser.findConditionOfBranch(br[i]);
+					std::string cdtString;
+					if (cdt == nullptr)
+					{
+						// cdtNull contains the condition when the leaf is null
+						//cdtString = cdtNull;
+						// we can safely remove that since in practice the other branch will always be greater
+					}
+					else
 					{
-						fpn->push_back(n);
+						cdtString = cdt->getConditions();
+					}
+					if (cdtString != "<null>")
+					{
+						// emplace resulting condition
+						cdts.emplace(i, cdtString);
+					}
+					else{
+						// null condition
+						cdts.emplace(i, "");
 					}
 				}
+				// generate a CFTreeAlt if there is no condition
+				if (cdts.size() == 0)
+					ch.push_back(new CFTreeAlt(br));
+				// generate a CFTreeConditionalAlt otherwise
+				else
+					ch.push_back(new CFTreeConditionalAlt(br, cdts));
 			}
-		}
-
-		void pouet()
-		{
+			// save function params
+			// FUNCTION_PARAM_MAPPING(cfgEntry) = function_args;
 		}
 
 		/*
-Retourne le noeud qui est dominé par tous les autres
+	State of a toCFT() call, kept on an explicit stack so that the depth of the
+	nested alternatives and loops is not limited by the call stack
 */
-		DAGNode *getDominated(std::vector<DAGNode *> fpn)
+		struct CFTFrame
 		{
-			unsigned int i;
-
-			ASSERT(fpn.size() > 0);
-
-			DAGNode *last = fpn[0];
-			for (i = 1; i < fpn.size(); i++)
-				if (DAGNodeDominate(last, fpn[i]))
-					last = fpn[i];
-
-			for (i = 0; i < fpn.size(); i++)
-				ASSERT(DAGNodeDominate(fpn[i], last));
+			enum
+			{
+				NEXT,		// process fpn[i], or build the result
+				LOOP_EXIT,	// the body of the loop fpn[i] is built
+				LOOP_END,	// its exit is built
+				ALT,		// look for an alternative ending at fpn[i]
+				ALT_PRED,	// build the branch of predecessor pred
+				ALT_BRANCH	// that branch is built
+			};
 
-			return last;
-		}
+			DAG *dag;
+			DAGNode *start;
+			int all;
+			std::vector<DAGNode *> fpn;
+			// children of the result, in reverse order
+			std::vector<CFTree *> ch;
+			size_t i = 0;
+			int step = NEXT;
+			CFTree *body = nullptr;
+			// alternative ending at fpn[i]
+			DAGNode *ncd = nullptr;
+			Block *cBlock = nullptr;
+			std::vector<CFTree *> br;
+			std::string cdtNull;
+			unsigned pred = 0;
+		};
 
-		CFTree *toCFT(DAG *dag, DAGNode *start, DAGNode *end, int all)
+		/*
+	Starts the construction of the CFT between start and end: returns it if it
+	is a leaf, otherwise pushes its frame and returns nullptr
+*/
+		static CFTree *beginCFT(std::vector<CFTFrame> &stack, DAG *dag, DAGNode *start, DAGNode *end, int all)
 		{
-			std::vector<CFTree *> ch;
 			std::vector<DAGNode *> fpn;
 
 			forcedPassedNodes(dag, start, end, &fpn);
@@ -1333,293 +1720,172 @@ Retourne le noeud qui est dominé par tous les autres
 				}
 			}
 
-			while (fpn.size() > 0)
+			stack.emplace_back();
+			CFTFrame &fr = stack.back();
+			fr.dag = dag;
+			fr.start = start;
+			fr.all = all;
+			fr.fpn.swap(fpn);
+			return nullptr;
+		}
+
+		static CFTree *endCFT(CFTFrame &fr)
+		{
+			ASSERT(!fr.all || (fr.start->predCount() == 0));
+			if (fr.all)
+			{
+				Block *bb = fr.start->toBNode()->getBlock();
+				fr.ch.push_back(new CFTreeLeaf(bb));
+			}
+			std::reverse(fr.ch.begin(), fr.ch.end());
+
+			if (fr.ch.size() == 1)
+			{
+				return fr.ch[0];
+			}
+			else
+			{
+				CFTreeSeq *t_ch = new CFTreeSeq(fr.ch);
+				return t_ch;
+			}
+		}
+
+		CFTree *toCFT(DAG *dag, DAGNode *start, DAGNode *end, int all)
+		{
+			std::vector<CFTFrame> stack;
+			// result of the last finished call
+			CFTree *res = beginCFT(stack, dag, start, end, all);
+
+			while (!stack.empty())
 			{
-				DAGNode *c = getDominated(fpn);												// l'element dominé
-				std::vector<DAGNode *>::iterator it = std::find(fpn.begin(), fpn.end(), c); // retrouver l'index de l'élement dominé
-				fpn.erase(it);																// N <- N \ c
+				CFTFrame &fr = stack.back();
+				// sub-CFT needed by the current frame
+				DAG *sub = nullptr;
+				DAGNode *sub_start = nullptr, *sub_end = nullptr;
+				int sub_all = 0;
 
-				if (c->toBNode())
+				switch (fr.step)
 				{
-					Block *bb = c->toBNode()->getBlock();
-					ch.insert(ch.begin(), new CFTreeLeaf(bb));
-				}
-				// Si on a une loop interne, on construit le CFTree associé
-				else if (c->toHNode())
+				case CFTFrame::NEXT:
 				{
-					DAGHNode *lh = c->toHNode();
-					DAG *sub_dag = lh->getDag();
-					CFTree *bd = toCFT(lh->getDag(), sub_dag->getStart(), sub_dag->getVirtNext(), 1);
-					CFTree *ex = toCFT(lh->getDag(), sub_dag->getStart(), sub_dag->getVirtExit(), 1);
+					if (fr.i == fr.fpn.size())
+					{
+						res = endCFT(fr);
+						stack.pop_back();
+						continue;
+					}
+					DAGNode *c = fr.fpn[fr.i]; // l'element dominé, N <- N \ c
 
+					fr.step = CFTFrame::ALT;
+					if (c->toBNode())
+					{
+						Block *bb = c->toBNode()->getBlock();
+						fr.ch.push_back(new CFTreeLeaf(bb));
+					}
+					// Si on a une loop interne, on construit le CFTree associé
+					else if (c->toHNode())
+					{
+						sub = c->toHNode()->getDag();
+						sub_start = sub->getStart();
+						sub_end = sub->getVirtNext();
+						sub_all = 1;
+						fr.step = CFTFrame::LOOP_EXIT;
+					}
+					break;
+				}
+				case CFTFrame::LOOP_EXIT:
+				{
+					fr.body = res;
+					sub = fr.fpn[fr.i]->toHNode()->getDag();
+					sub_start = sub->getStart();
+					sub_end = sub->getVirtExit();
+					sub_all = 1;
+					fr.step = CFTFrame::LOOP_END;
+					break;
+				}
+				case CFTFrame::LOOP_END:
+				{
+					DAG *sub_dag = fr.fpn[fr.i]->toHNode()->getDag();
+					CFTree *bd = fr.body, *ex = res;
 					ASSERT(sub_dag->getStart()->toBNode());
 					if ((sub_dag->getStart())->toBNode())
 					{
 						// bb is a loop header, therefore it is always basic
 						BasicBlock *bb = ((sub_dag->getStart())->toBNode())->getBlock()->toBasic();
 						// check if the loop is parametric to change loop generation
-						LoopBound lb = LOOP_BOUND(bb);
+						LoopBound lb = BlockTable::loopBound(bb);
 						if(lb.isParametric())
-							ch.insert(ch.begin(), new CFTreeLoop(bb, lb.getExpression(), bd, ex));
+							fr.ch.push_back(new CFTreeLoop(bb, lb.getExpression(), bd, ex));
 						else
-							ch.insert(ch.begin(), new CFTreeLoop(bb, 0, bd, ex));
+							fr.ch.push_back(new CFTreeLoop(bb, 0, bd, ex));
 					}
+					fr.step = CFTFrame::ALT;
+					break;
 				}
-
-				// Si c a plusieurs prédécesseurs, càd qu'il y a un if avant
-				if (c->getPred().size() > 1)
+				case CFTFrame::ALT:
 				{
-					DAGNode *ncd;
-					if (fpn.size() > 0)
-						ncd = getDominated(fpn);
+					DAGNode *c = fr.fpn[fr.i];
+					// Si c a plusieurs prédécesseurs, càd qu'il y a un if avant
+					if (c->predCount() > 1)
+					{
+						// dominateur immédiat de c
+						fr.ncd = fr.i + 1 < fr.fpn.size() ? fr.fpn[fr.i + 1] : fr.start;
+						fr.cBlock = c->toBNode() != nullptr ? c->toBNode()->getBlock() : nullptr;
+						// On construit le CFTreeAlt
+						fr.br.clear();
+						// null condition
+						fr.cdtNull = "<null>";
+						fr.pred = 0;
+						fr.step = CFTFrame::ALT_PRED;
+					}
 					else
-						ncd = start;
-
-					// On ajoute à la suite le bloc dominé
-					/*
-			if (c->toBNode() && false){
-				Block *bb =  c->toBNode()->getBlock();
-				ch.insert(ch.begin(), new CFTreeLeaf(bb));
-			}
-			*/
-					Block *cBlock = c->toBNode() != nullptr ? c->toBNode()->getBlock() : nullptr;
-					// retrieve function params
-					// Block *cfgEntry = cBlock->cfg()->entry();
-					// std::map<int, int> function_args = FUNCTION_PARAM_MAPPING(cfgEntry);
-
-					std::vector<CFTree *> br;
-
-					// On construit le CFTreeAlt
-					// null condition
-					std::string cdtNull = "<null>";
-					int predNumber = 0;
-					FParamManager fpm;
-					for (auto pred = c->predIter(); pred != c->predEnd(); pred++)
-					{
-						// pipeline annotation
-						if((cBlock != nullptr && *pred != ncd && !fpm.isParam(cBlock)) || (c->toHNode() && *pred != ncd)){
-							auto p = (*pred)->toBNode();
-							// add an annotation on the block if the block is pred of alt exit node
-							// could be nullptr, be aware !
-							if(p != nullptr){
-								Block* pb = p->getBlock();
-								//cout << "BB " << pb->id() << " IS LAST IN BLOCK" << endl;
-								if(!pb->isSynth()){
-									// regular basic block
-									IS_LAST_IN_ALT(pb) = true;
-								}
-								else{
-									// function call
-									// we need to get the last block of the function
-									SynthBlock* sb = pb->toSynth();
-									Block* exit = sb->callee()->exit(); // get the virtual exit node
-									auto edges = exit->inEdges();
-									std::set<Edge*> wl;
-									std::set<Edge*> nextWl;
-									// default list
-									for(auto e = edges.begin(); e != edges.end(); e++){
-										wl.insert(*e);
-									}
-									// process working list
-									//cout << "WL SIZE: " << wl.size() << endl;
-									while(wl.size() > 0){
-										for(auto edge = wl.begin(); edge != wl.end(); edge++){
-											Block* source = (*edge)->source();
-											if(source->isBasic()){
-												IS_LAST_IN_ALT(source) = true;
-												//cout << source->id() << " IS LAST IN ALT" << endl;
-											}
-											else{
-												auto predEdges = source->inEdges();
-												for(auto e = predEdges.begin(); e != predEdges.end(); e++){
-													nextWl.insert(*e);
-												}
-											}
-										}
-										wl = nextWl;
-										//cout << "WL SIZE: " << wl.size() << endl;
-									}
-								}
-							}
-							else{
-								if(DAGHNode* hn = (*pred)->toHNode()){
-									// set the loop header as the last element in an ALT node
-									Block* header = hn->getHeader();
-									IS_LAST_IN_ALT(header) = true;
-									//cout << header->id() << endl;
-									// detect the correct edge to reduce pessimism
-									auto es = header->outEdges();
-									for(auto e = es.begin(); e != es .end(); e++){
-										if((*e)->sink() == cBlock){
-											EDGE_ALIAS(header) = *e;
-											break;
-										}
-									}
-								}
-								else{
-									cout << "WARN: Unsupported DAGNode type used" << endl;
-								}
-							}
-						}
-						if (*pred == ncd)
-						{	
-#ifdef PIPELINE
-							if((cBlock != nullptr && !fpm.isParam(cBlock)) || (!fpm.isParam(cBlock) && c->toHNode())){
-								Edge* edge;
-								if(DAGHNode* hn = c->toHNode()){
-									// need a special processing to account the alt before the loop
-									IS_AFTER_ALT(hn->getHeader()) = true;
-									IS_AA_LOOPEXIT(hn->getHeader()) = true;
-									// get the edge representing the entry of the loop
-									auto ies = hn->getHeader()->inEdges();
-									//cout << "BB |" << cBlock->id() << "|" << endl;
-									int pn = 0;
-									auto it = ies.begin();
-									while(pn != predNumber){
-										it++;
-										pn++;
-									}
-									edge = *it;
-								}
-								else{
-									// find the corresponding edge
-									auto ies = cBlock->inEdges();
-									//cout << "BB |" << cBlock->id() << "|" << endl;
-									int pn = 0;
-									auto it = ies.begin();
-									while(pn != predNumber){
-										it++;
-										pn++;
-									}
-									edge = *it;
-								}
-								// create a fake basic block
-								// create fake instructions
-								NullInst nullInst;
-								NullInst nullInstArray[1];
-								nullInstArray[0] = nullInst;
-								Inst *buffer[1] = {nullInstArray};
-								Inst **bufferBis = buffer;
-								const Array<Inst *> insts(1, bufferBis);
-
-								BasicBlock* fb = new BasicBlock(insts);
-								ipet::TIME(fb) = 0;
-								IS_LAST_IN_ALT(fb) = true;
-								// create a fake predecessor
-								IS_PIPELINE_EDGE(fb) = true;
-								EDGE_ALIAS(fb) = edge;
-								br.push_back(new CFTreeLeaf(fb));
-							}
-							else{
-								//cout << "POSSIBLE PESSIMISM BECAUSE CBLOCK IS NOT A BASIC BLOCK" << endl;
-								/*auto oes = (*pred)->toBNode()->getBlock()->outEdges();
-								for(auto oe = oes.begin(); oe != oes.end(); oe++){
-									auto edge = *oe;
-									// create a fake basic block
-									// create fake instructions
-									NullInst nullInst;
-									NullInst nullInstArray[1];
-									nullInstArray[0] = nullInst;
-									Inst *buffer[1] = {nullInstArray};
-									Inst **bufferBis = buffer;
-									const Array<Inst *> insts(1, bufferBis);
-
-									BasicBlock* fb = new BasicBlock(insts);
-									ipet::TIME(fb) = 0;
-									IS_LAST_IN_ALT(fb) = true;
-									IS_PIPELINE_EDGE(fb) = true;
-									EDGE_ALIAS(fb) = edge;
-									br.push_back(new CFTreeLeaf(fb));
-								}*/
-								br.push_back(new CFTreeLeaf(nullptr));
-							}
-#else
-							br.push_back(new CFTreeLeaf(nullptr));
-#endif
-
-							// try to retrieve condition when a null element exists
-							// Block* cBlock = c->toBNode()->getBlock();
-							if (cBlock != nullptr)
-							{
-								BranchCondition *bc = CONDITION(cBlock);
-								if (bc != nullptr)
-								{
-									cdtNull = bc->getConditions();
-								}
-							}
-						}
-						else
-						{
-							br.push_back(toCFT(dag, ncd, *pred, 0));
-						}
-						predNumber++;
+					{
+						fr.i++;
+						fr.step = CFTFrame::NEXT;
 					}
-					if(cBlock != nullptr && !fpm.isParam(cBlock)){
-						// annotation to make sure we know it is located at the end of an ALT node
-						IS_AFTER_ALT(cBlock) = true;
-						//cout << cBlock->id() << " IS AFTER ALT" << endl;
+					break;
+				}
+				case CFTFrame::ALT_PRED:
+				{
+					DAGNode *c = fr.fpn[fr.i];
+					if (fr.pred == c->predCount())
+					{
+						endAlt(fr.cBlock, fr.br, fr.ch);
+						fr.i++;
+						fr.step = CFTFrame::NEXT;
+						break;
 					}
-					if (br.size() == 1)
+					DAGNode *pred = c->predIter()[fr.pred];
+					markLastInAlt(c, fr.cBlock, pred, fr.ncd);
+					if (pred == fr.ncd)
 					{
-						ch.insert(ch.begin(), br[0]);
+						emptyBranch(c, fr.cBlock, fr.pred, fr.br, fr.cdtNull);
+						fr.pred++;
 					}
 					else
 					{
-						// check if in an alt node we have a condition
-						ConditionParser parser;
-						std::map<int, std::string> cdts;
-						for (long unsigned int i = 0; i != br.size(); i++)
-						{
-							BranchCondition *cdt = parser.findConditionOfBranch(br[i]);
-							std::string cdtString;
-							if (cdt == nullptr)
-							{
-								// cdtNull contains the condition when the leaf is null
-								//cdtString = cdtNull;
-								// we can safely remove that since in practice the other branch will always be greater
-							}
-							else
-							{
-								cdtString = cdt->getConditions();
-							}
-							if (cdtString != "<null>")
-							{
-								// emplace resulting condition
-								cdts.emplace(i, cdtString);
-							}
-							else{
-								// null condition
-								cdts.emplace(i, "");
-							}
-						}
-						// generate a CFTreeAlt if there is no condition
-						if (cdts.size() == 0)
-							ch.insert(ch.begin(), new CFTreeAlt(br));
-						// generate a CFTreeConditionalAlt otherwise
-						else
-							ch.insert(ch.begin(), new CFTreeConditionalAlt(br, cdts));
+						sub = fr.dag;
+						sub_start = fr.ncd;
+						sub_end = pred;
+						sub_all = 0;
+						fr.step = CFTFrame::ALT_BRANCH;
 					}
-					// save function params
-					// FUNCTION_PARAM_MAPPING(cfgEntry) = function_args;
+					break;
 				}
+				case CFTFrame::ALT_BRANCH:
+				{
+					fr.br.push_back(res);
+					fr.pred++;
+					fr.step = CFTFrame::ALT_PRED;
+					break;
+				}
+				}
+
+				// the frame may move when the sub-CFT is pushed
+				if (sub != nullptr)
+					res = beginCFT(stack, sub, sub_start, sub_end, sub_all);
 			}
-
-			ASSERT(!all || (start->getPred().size() == 0));
-			if (all)
-			{
-				Block *bb = start->toBNode()->getBlock();
-				ch.insert(ch.begin(), new CFTreeLeaf(bb));
-			}
-
-			if (ch.size() == 1)
-			{
-				return ch[0];
-			}
-			else
-			{
-				CFTreeSeq *t_ch = new CFTreeSeq(ch);
-				return t_ch;
-			}
+			return res;
 		}
 
 		// void printCurrentNode(CFTree* node){
@@ -1724,7 +1990,450 @@ Retourne le noeud qui est dominé par tous les autres
 			return toRemove;
 		}
 
-		void CFTree::exportToAWCET(formula_t *f, struct param_func *pfl, bool loopexit, bool lastBlock)
+		struct CFTree::ExportJob
+		{
+			CFTree *tree;
+			formula_t *f;
+			bool loopexit;
+			bool lastBlock;
+			CFG *callee; // set by the job that closes the export of a callee at f, whose tree is nullptr
+		};
+
+		/*
+		Formulas of the callees shared by their call sites. The first export of a
+		callee in a context is moved to a canonical node, owned by the export,
+		and every call site, including the first one, gets a copy of that node:
+		the copies share its children and eta values. The context of a callee is
+		its signature (see signatureOf()), loopexit and lastBlock: the signature
+		holds the name of the function and every property of its blocks read by
+		exportNode(), so that a virtualized clone finds the formula of a clone
+		of the same context before it is exported. The clones of different
+		signatures are exported, then compared to the canonical formulas of the
+		same hash, and a clone exporting to the same formula is replaced by a
+		copy of it. Callees whose root is an ALT are not shared,
+		formula_prune_alt() removing the children of ALT nodes in place; the
+		removed children are released by releasePruned(). The tables are not
+		locked: they belong to the thread that created the export.
+		*/
+		struct AWCETExport::Callees
+		{
+			std::thread::id thread;
+			// signature of each CFG, as an index in signatures
+			std::unordered_map<CFG *, int> signatureOf;
+			std::map<std::vector<long long>, int> signatures;
+			std::map<std::pair<int, int>, formula_t *> byCallee;
+			std::unordered_multimap<std::size_t, formula_t *> byHash;
+			std::unordered_map<formula_t *, std::size_t> hashes;
+			// canonical formula by the memory it owns (see ownedMemory())
+			std::unordered_map<void *, formula_t *> owners;
+		};
+
+		AWCETExport::AWCETExport() : callees(new Callees)
+		{
+			callees->thread = std::this_thread::get_id();
+		}
+
+		AWCETExport::~AWCETExport()
+		{
+			delete callees;
+		}
+
+		static AWCETExport::Callees &calleesOf(const AWCETExport &ex)
+		{
+			// the threads of dumpcft -d each export with their own tables
+			assert(ex.callees->thread == std::this_thread::get_id());
+			return *ex.callees;
+		}
+
+		static void pushString(std::vector<long long> &sig, const std::string &s)
+		{
+			sig.insert(sig.end(), s.begin(), s.end());
+			sig.push_back(0);
+		}
+
+#ifdef PIPELINE
+		// execution time of an edge, as computed by exportNode()
+		static long long edgeTime(Edge *edge)
+		{
+			long long wcet = etime::LTS_TIME(edge);
+			for (auto hts : etime::HTS_CONFIG.all(edge))
+				wcet += hts.fst;
+			return wcet;
+		}
+#endif
+
+		static int signatureOf(AWCETExport::Callees &c, CFG *cfg, struct param_func *pfl);
+
+		/* appends to sig the properties of a leaf read by exportNode() */
+		static void blockSignature(AWCETExport::Callees &c, CFTreeLeaf *n, struct param_func *pfl, std::vector<long long> &sig)
+		{
+			Block *b = n->getBlock();
+			if (b == nullptr)
+			{
+				sig.push_back(-1);
+				return;
+			}
+			sig.push_back(b->id());
+			if (b->isSynth())
+			{
+				CFG *callee = b->toSynth()->callee();
+				for (int i = 0; pfl && pfl[i].funcname != nullptr; i++)
+					if (!strcmp(pfl[i].funcname, callee->name().toCString()))
+					{
+						sig.push_back(-2);
+						sig.push_back(pfl[i].param_id);
+						return;
+					}
+				sig.push_back(signatureOf(c, callee, pfl));
+				return;
+			}
+			if (!b->isBasic())
+				return;
+#ifdef IP
+			if (b->cfg() == nullptr && finder.copies().find(n) == finder.copies().end())
+#else
+			if (b->cfg() == nullptr && !BlockTable::flag(b, BlockTable::PIPELINE_EDGE))
+#endif
+			{
+				BasicCacheBlock *bcb = static_cast<BasicCacheBlock *>(b);
+				sig.push_back(bcb->getBasicBlockId());
+				sig.push_back(bcb->getLoopId());
+				sig.push_back(bcb->getType());
+				sig.push_back(bcb->getContextCategory());
+				return;
+			}
+			BasicBlock *bb = b->toBasic();
+			sig.push_back(BlockTable::blockTime(bb));
+			sig.push_back(BlockTable::annCount(bb));
+			sig.push_back(BlockTable::annTime(bb));
+			sig.push_back(LOOP_HEADER(bb));
+			for (int i = 0; i < BlockTable::FLAG_COUNT; i++)
+				sig.push_back(BlockTable::flag(bb, (BlockTable::flag_t) i));
+#ifdef PIPELINE
+			FParamManager fpm;
+			auto edges = bb->inEdges();
+			for (auto i = edges.begin(); i != edges.end(); i++)
+			{
+				Edge *edge = *i;
+				sig.push_back(edgeTime(edge));
+				sig.push_back(edge->source()->isBasic());
+				if (LOOP_HEADER(bb))
+					sig.push_back(Dominance::dominates(edge->sink(), edge->source()));
+				Block *synth = edge->source();
+				if (synth->isBasic() || fpm.isParam(synth))
+					continue;
+				// the times of the calling context, read through the synthetic and virtual blocks
+				if (synth->isCall())
+				{
+					auto edges2 = synth->toSynth()->callee()->exit()->inEdges();
+					for (auto j = edges2.begin(); j != edges2.end(); j++)
+						sig.push_back(edgeTime(*j));
+				}
+				else if (synth->isVirtual())
+				{
+					auto callers = synth->cfg()->callers();
+					for (auto k = callers.begin(); k != callers.end(); k++)
+					{
+						auto edges2 = (*k)->inEdges();
+						for (auto j = edges2.begin(); j != edges2.end(); j++)
+							sig.push_back(edgeTime(*j));
+					}
+				}
+				sig.push_back(-3);
+			}
+			auto outs = bb->outEdges();
+			for (auto i = outs.begin(); i != outs.end(); i++)
+				sig.push_back(edgeTime(*i));
+			Edge *alias = BlockTable::edgeAlias(bb);
+			sig.push_back(alias == nullptr ? -1 : edgeTime(alias));
+#endif
+		}
+
+		/* index of the signature of a CFG, the same for the clones of a function exporting to the same formula */
+		static int signatureOf(AWCETExport::Callees &c, CFG *cfg, struct param_func *pfl)
+		{
+			auto known = c.signatureOf.find(cfg);
+			if (known != c.signatureOf.end())
+				return known->second;
+			std::vector<long long> sig;
+			pushString(sig, cfg->name().toCString().chars());
+			std::vector<CFTree *> todo(1, CFTREE(cfg));
+			while (!todo.empty())
+			{
+				CFTree *t = todo.back();
+				todo.pop_back();
+				std::size_t n = CFTreeVisitor::childCount(t);
+				sig.push_back(t->getKind());
+				sig.push_back(n);
+				if (CFTreeLeaf *leaf = t->toLeaf())
+					blockSignature(c, leaf, pfl, sig);
+				if (CFTreeConditionalAlt *alt = t->toConditionalAlt())
+					for (std::size_t i = 0; i < n; i++)
+						pushString(sig, alt->getCondition(i));
+				if (CFTreeLoop *loop = t->toLoop())
+				{
+					sig.push_back(loop->getHeader()->id());
+					sig.push_back(MAX_ITERATION(loop->getHeader()));
+					sig.push_back(loop->isParametric());
+					if (loop->isParametric())
+						pushString(sig, loop->getParametricBound());
+				}
+				for (std::size_t i = n; i > 0; i--)
+					todo.push_back(CFTreeVisitor::child(t, i - 1));
+			}
+			int index = c.signatures.insert(std::make_pair(sig, (int) c.signatures.size())).first->second;
+			c.signatureOf[cfg] = index;
+			return index;
+		}
+
+		static std::pair<int, int> calleeKey(AWCETExport::Callees &c, CFG *callee, struct param_func *pfl, bool loopexit, bool lastBlock)
+		{
+			return std::make_pair(signatureOf(c, callee, pfl), (loopexit ? 1 : 0) | (lastBlock ? 2 : 0));
+		}
+
+		static formula_t *exportedCallee(AWCETExport &ex, CFG *callee, struct param_func *pfl, bool loopexit, bool lastBlock)
+		{
+			AWCETExport::Callees &c = calleesOf(ex);
+			auto it = c.byCallee.find(calleeKey(c, callee, pfl, loopexit, lastBlock));
+			return it == c.byCallee.end() ? nullptr : it->second;
+		}
+
+		/* one of the buffers owned by a node, nullptr if it owns none */
+		static void *ownedMemory(formula_t *f)
+		{
+			if (f->children != nullptr)
+				return f->children;
+			if (f->aw.eta != nullptr)
+				return f->aw.eta;
+			return f->aw.eta_mult;
+		}
+
+		/* canonical formula shared by a node, nullptr if it shares none */
+		static formula_t *sharedCallee(AWCETExport::Callees &c, formula_t *f)
+		{
+			void *mem = ownedMemory(f);
+			if (mem == nullptr)
+				return nullptr;
+			auto it = c.owners.find(mem);
+			return it == c.owners.end() ? nullptr : it->second;
+		}
+
+		static void hashCombine(std::size_t &h, std::size_t v)
+		{
+			h ^= v + 0x9e3779b9 + (h << 6) + (h >> 2);
+		}
+
+		static std::size_t nodeHash(const AWCETExport &ex, formula_t *f)
+		{
+			std::size_t h = f->kind;
+			hashCombine(h, f->param_id);
+			hashCombine(h, f->opdata.ann.loop_id);
+			hashCombine(h, f->opdata.ann.count);
+			hashCombine(h, f->aw.loop_id);
+			hashCombine(h, f->aw.others);
+			for (int i = 0; i < f->aw.eta_count; i++)
+			{
+				hashCombine(h, f->aw.eta[i]);
+				if (f->aw.eta_mult != nullptr)
+					hashCombine(h, f->aw.eta_mult[i]);
+			}
+			for (const char *c = f->bool_expr; *c; c++)
+				hashCombine(h, *c);
+			Block *b = ex.originBlock(f->origin);
+			if (b != nullptr)
+				hashCombine(h, b->id());
+			return h;
+		}
+
+		/* blocks standing for the same program point in two clones of a function */
+		static bool sameOrigin(const AWCETExport &ex, int o1, int o2)
+		{
+			if (o1 == o2)
+				return true;
+			Block *b1 = ex.originBlock(o1);
+			Block *b2 = ex.originBlock(o2);
+			if (b1 == nullptr || b2 == nullptr || b1->id() != b2->id())
+				return false;
+			if (b1->cfg() != nullptr && b2->cfg() != nullptr)
+				return b1->cfg()->name() == b2->cfg()->name();
+			if (b1->cfg() != nullptr || b2->cfg() != nullptr
+				|| BlockTable::flag(b1, BlockTable::PIPELINE_EDGE) || BlockTable::flag(b2, BlockTable::PIPELINE_EDGE))
+				return false;
+			// blocks of the cache
+			BasicCacheBlock *c1 = static_cast<BasicCacheBlock *>(b1);
+			BasicCacheBlock *c2 = static_cast<BasicCacheBlock *>(b2);
+			return c1->getBasicBlockId() == c2->getBasicBlockId() && c1->getLoopId() == c2->getLoopId();
+		}
+
+		static bool sameNode(const AWCETExport &ex, formula_t *f1, formula_t *f2)
+		{
+			if (f1->kind != f2->kind || f1->param_id != f2->param_id
+				|| f1->opdata.ann.loop_id != f2->opdata.ann.loop_id || f1->opdata.ann.count != f2->opdata.ann.count
+				|| f1->aw.loop_id != f2->aw.loop_id || f1->aw.eta_count != f2->aw.eta_count || f1->aw.others != f2->aw.others
+				|| (f1->aw.eta_mult == nullptr) != (f2->aw.eta_mult == nullptr)
+				|| f1->condition != nullptr || f2->condition != nullptr
+				|| f1->eta_limit != f2->eta_limit || strcmp(f1->bool_expr, f2->bool_expr) != 0
+				|| !sameOrigin(ex, f1->origin, f2->origin))
+				return false;
+			if (f1->aw.eta_count > 0 && memcmp(f1->aw.eta, f2->aw.eta, sizeof(awcet_value_t) * f1->aw.eta_count) != 0)
+				return false;
+			if (f1->aw.eta_mult != nullptr && memcmp(f1->aw.eta_mult, f2->aw.eta_mult, sizeof(int) * f1->aw.eta_count) != 0)
+				return false;
+			return true;
+		}
+
+		/* hash of a formula, the shared callees being hashed once */
+		static std::size_t formulaHash(const AWCETExport &ex, formula_t *root)
+		{
+			// nodes and next child of the ancestors, hashes of the children left
+			std::vector<std::pair<formula_t *, int>> stack(1, std::make_pair(root, 0));
+			std::vector<std::size_t> done;
+			while (!stack.empty())
+			{
+				formula_t *f = stack.back().first;
+				int i = stack.back().second;
+				formula_t *shared = (i == 0) ? sharedCallee(*ex.callees, f) : nullptr;
+				if (shared != nullptr)
+				{
+					stack.pop_back();
+					done.push_back(ex.callees->hashes[shared]);
+					continue;
+				}
+				int n = formula_child_count(f);
+				if (i < n)
+				{
+					stack.back().second++;
+					stack.push_back(std::make_pair(&f->children[i], 0));
+					continue;
+				}
+				stack.pop_back();
+				std::size_t h = nodeHash(ex, f);
+				for (std::size_t k = done.size() - n; k < done.size(); k++)
+					hashCombine(h, done[k]);
+				done.resize(done.size() - n);
+				done.push_back(h);
+			}
+			return done.back();
+		}
+
+		static bool sameFormula(const AWCETExport &ex, formula_t *f1, formula_t *f2)
+		{
+			std::vector<std::pair<formula_t *, formula_t *>> todo(1, std::make_pair(f1, f2));
+			while (!todo.empty())
+			{
+				formula_t *n1 = todo.back().first;
+				formula_t *n2 = todo.back().second;
+				todo.pop_back();
+				if (!sameNode(ex, n1, n2))
+					return false;
+				// copies of the same callee
+				if (n1->children == n2->children)
+					continue;
+				for (int i = 0; i < formula_child_count(n1); i++)
+					todo.push_back(std::make_pair(&n1->children[i], &n2->children[i]));
+			}
+			return true;
+		}
+
+		/* the call sites below root forget the formula they share, formula_free() then releases only what root owns */
+		static void detachShared(AWCETExport::Callees &c, formula_t *root)
+		{
+			std::vector<formula_t *> todo(1, root);
+			while (!todo.empty())
+			{
+				formula_t *f = todo.back();
+				todo.pop_back();
+				formula_t *shared = sharedCallee(c, f);
+				if (shared != nullptr && shared != f)
+				{
+					memset(f, 0, sizeof(formula_t));
+					continue;
+				}
+				for (int i = 0; i < formula_child_count(f); i++)
+					todo.push_back(&f->children[i]);
+			}
+		}
+
+		/* the callee exported at f is shared by its next call sites */
+		static void shareCallee(AWCETExport &ex, formula_t *f, CFG *callee, struct param_func *pfl, bool loopexit, bool lastBlock)
+		{
+			AWCETExport::Callees &c = calleesOf(ex);
+			// the root of the callee may be the call of another one, already shared
+			formula_t *canonical = sharedCallee(c, f);
+			if (canonical == nullptr)
+			{
+				if (f->kind == KIND_ALT)
+					return;
+				std::size_t h = formulaHash(ex, f);
+				auto range = c.byHash.equal_range(h);
+				for (auto it = range.first; canonical == nullptr && it != range.second; it++)
+					if (sameFormula(ex, it->second, f))
+						canonical = it->second;
+				if (canonical != nullptr)
+				{
+					// an isomorphic clone
+					detachShared(c, f);
+					formula_free(f);
+				}
+				else
+				{
+					canonical = new formula_t(*f);
+					c.byHash.insert(std::make_pair(h, canonical));
+					c.hashes[canonical] = h;
+					if (ownedMemory(canonical) != nullptr)
+						c.owners[ownedMemory(canonical)] = canonical;
+				}
+				*f = *canonical;
+			}
+			c.byCallee.insert(std::make_pair(calleeKey(c, callee, pfl, loopexit, lastBlock), canonical));
+		}
+
+		void CFTree::releaseAWCET(formula_t *f, AWCETExport &ex)
+		{
+			AWCETExport::Callees &c = calleesOf(ex);
+			detachShared(c, f);
+			formula_free(f);
+			for (auto it = c.hashes.begin(); it != c.hashes.end(); it++)
+			{
+				detachShared(c, it->first);
+				formula_free(it->first);
+				delete it->first;
+			}
+			c.byCallee.clear();
+			c.byHash.clear();
+			c.hashes.clear();
+			c.owners.clear();
+		}
+
+		void CFTree::releasePruned(formula_t *f, void *ex)
+		{
+			detachShared(calleesOf(*(AWCETExport *) ex), f);
+			formula_free(f);
+		}
+
+		void CFTree::exportToAWCET(formula_t *f, struct param_func *pfl, AWCETExport &ex, bool loopexit, bool lastBlock)
+		{
+			// the nodes are exported in pre-order, with an explicit stack
+			std::vector<ExportJob> jobs;
+			jobs.push_back(ExportJob{this, f, loopexit, lastBlock});
+			while (!jobs.empty())
+			{
+				ExportJob job = jobs.back();
+				jobs.pop_back();
+				if (job.callee != nullptr)
+				{
+					// every node of the callee exported at job.f is done
+					shareCallee(ex, job.f, job.callee, pfl, job.loopexit, job.lastBlock);
+					continue;
+				}
+				std::size_t mark = jobs.size();
+				job.tree->exportNode(job.f, pfl, ex, job.loopexit, job.lastBlock, jobs);
+				// the children were pushed in order, they must be popped in order
+				std::reverse(jobs.begin() + mark, jobs.end());
+			}
+		}
+
+		void CFTree::exportNode(formula_t *f, struct param_func *pfl, AWCETExport &ex, bool loopexit, bool lastBlock, std::vector<ExportJob> &jobs)
 		{
 #ifdef IP
 			Timer timer;
@@ -1764,6 +2473,7 @@ Retourne le noeud qui est dominé par tous les autres
 			}
 			// si sur le CFT courant des contraintes sont attachées
 			// printCurrentNode(this);
+			std::set<Constraint> *constraints = getConstraints();
 			if (IP == 1 && constraints->size() > 0)
 			{
 				// constrained tree
@@ -1796,7 +2506,7 @@ Retourne le noeud qui est dominé par tous les autres
 				// cout << "number of nodes: " << nodeList.size() << endl;
 				// cout << "number of constraints (after heuristic): " << constraints.size() << endl;
 				if (constraints->size() == 0)
-					exportToAWCET(f, pfl, loopexit);
+					exportToAWCET(f, pfl, ex, loopexit);
 				// end of heuristic
 
 				PseudoPathsBuilder pseudoPathsBuilder;
@@ -1873,7 +2583,7 @@ Retourne le noeud qui est dominé par tous les autres
 
 				cout << "5. Exporting the feasible tree... ";
 				timer.start();
-				exportToFeasibleWCET(f, pfl);
+				exportToFeasibleWCET(f, pfl, ex);
 				timer.stop();
 				timer.printDuration();
 				cout << endl;
@@ -1905,14 +2615,23 @@ Retourne le noeud qui est dominé par tous les autres
 								parametric = true;
 								f->kind = KIND_AWCET;
 								f->param_id = pfl[i].param_id;
+								f->origin = ex.formulaOrigin(b);
 								break;
 							}
 							i++;
 						}
 						if (!parametric)
 						{
-							CFTree *ch = CFTREE(callee);
-							ch->exportToAWCET(f, pfl, loopexit, true);
+							// a callee is exported once for each context, the other call sites share its formula
+							formula_t *shared = exportedCallee(ex, callee, pfl, loopexit, true);
+							if (shared != nullptr)
+								*f = *shared;
+							else
+							{
+								CFTree *ch = CFTREE(callee);
+								jobs.push_back(ExportJob{ch, f, loopexit, true, nullptr});
+								jobs.push_back(ExportJob{nullptr, f, loopexit, true, callee});
+							}
 						}
 					}
 					else if (b->isBasic())
@@ -1921,12 +2640,13 @@ Retourne le noeud qui est dominé par tous les autres
 #ifdef IP
 						if (b->cfg() == nullptr && finder.copies().find(n) == finder.copies().end())
 #else
-						if(b->cfg() == nullptr && !IS_PIPELINE_EDGE(b))
+						if(b->cfg() == nullptr && !BlockTable::flag(b, BlockTable::PIPELINE_EDGE))
 #endif
 						{ // nullptr means that it's a new block, associated with cache
 							BasicCacheBlock *bcb = static_cast<BasicCacheBlock *>(b);
 							f->kind = KIND_CONST;
 							f->aw.loop_id = bcb->getLoopId();
+							f->origin = ex.formulaOrigin(b);
 
 							// manage annotations
 							if (bcb->getType() == HIT)
@@ -1964,7 +2684,7 @@ Retourne le noeud qui est dominé par tous les autres
 
 								case FIRST_MISS:
 									f->aw.eta_count = 1;
-									f->aw.eta = (long long *)malloc(sizeof(long long) * f->aw.eta_count);
+									f->aw.eta = (awcet_value_t *)malloc(sizeof(awcet_value_t) * f->aw.eta_count);
 									f->aw.others = 0; // all other times
 									for (int i = 0; i < f->aw.eta_count; i++)
 										f->aw.eta[i] = BasicCacheBlock::getPenalty(); // first time
@@ -1981,6 +2701,7 @@ Retourne le noeud qui est dominé par tous les autres
 							BasicBlock *bb = b->toBasic();
 							f->kind = KIND_CONST;
 							f->aw.loop_id = -1;
+							f->origin = ex.formulaOrigin(b);
 #ifdef PIPELINE
 							// get the execution time of edges (execution context)
 							int max_wcet = 0;
@@ -1989,7 +2710,7 @@ Retourne le noeud qui est dominé par tous les autres
 							std::map<bool,int> loopExecutionTimes; //< special treatment to reduce loop pessimism (if entry ---(x)--> header > back_edge ---(y)--> header only)
 							
 							// only if not an ALT successor, to remove pipeline pessimism
-							if(!IS_AFTER_ALT(bb) || (IS_AFTER_ALT(bb) && LOOP_HEADER(bb))){
+							if(!BlockTable::flag(bb, BlockTable::AFTER_ALT) || (BlockTable::flag(bb, BlockTable::AFTER_ALT) && LOOP_HEADER(bb))){
 								FParamManager fpm;
 								for(auto i = edges.begin(); i != edges.end(); i++){
 									Edge* edge = *i;
@@ -2090,7 +2811,7 @@ Retourne le noeud qui est dominé par tous les autres
 							// debug to see if we only add the last BB edge one time !
 							// if(bb != nullptr && bb->cfg() != nullptr)
 							// 	cout << bb->id() << endl;
-							if(IS_LAST_IN_ALT(bb) && !LOOP_HEADER(bb) && lastBlock){
+							if(BlockTable::flag(bb, BlockTable::LAST_IN_ALT) && !LOOP_HEADER(bb) && lastBlock){
 								// same debug as before
 								// if(LOOP_HEADER(bb))
 								// 	cout << "Loop " << bb->id() << " has a reduced pessimism" << endl;
@@ -2111,9 +2832,9 @@ Retourne le noeud qui est dominé par tous les autres
 								}
 								max_wcet += max_wcet_loc;
 								//cout << "found WCET for BB " << ": " << max_wcet_loc << "(" << max_wcet << ")" << endl;	
-								if(IS_PIPELINE_EDGE(bb)){
+								if(BlockTable::flag(bb, BlockTable::PIPELINE_EDGE)){
 									// manage blocks representing pipeline effect (replacing nullptr in non existing else blocks)
-									auto real_edge = EDGE_ALIAS(bb);
+									auto real_edge = BlockTable::edgeAlias(bb);
 									int wcet = etime::LTS_TIME(real_edge);
 									//cout << "LTS_TIME (BB " << bb->id() <<"): " << etime::LTS_TIME(edge) << endl;
 									for(auto hts : etime::HTS_CONFIG.all(real_edge)){
@@ -2124,17 +2845,17 @@ Retourne le noeud qui est dominé par tous les autres
 									//cout << "FOUND WCET FOR PIPELINE BLOCK: " << max_wcet << "(" << wcet << ")" << endl;
 								}
 							}
-							f->aw.others = ipet::TIME(bb) >= 0 ? ipet::TIME(bb) + max_wcet : max_wcet; // without the cache, ipet::TIME(bb) = -1, but with, it is not, thus we need this to get the right WCET
+							f->aw.others = BlockTable::blockTime(bb) >= 0 ? BlockTable::blockTime(bb) + max_wcet : max_wcet; // without the cache, ipet::TIME(bb) = -1, but with, it is not, thus we need this to get the right WCET
 #else
-							f->aw.others = ipet::TIME(bb);
+							f->aw.others = BlockTable::blockTime(bb);
 #endif							
 
-							if (ANN_COUNT(bb) == 0)
+							if (BlockTable::annCount(bb) == 0)
 							{
-								f->aw.eta_count = ANN_COUNT(bb);
-								f->aw.eta = (long long *)malloc(sizeof(long long) * f->aw.eta_count);
+								f->aw.eta_count = BlockTable::annCount(bb);
+								f->aw.eta = (awcet_value_t *)malloc(sizeof(awcet_value_t) * f->aw.eta_count);
 								for (int i = 0; i < f->aw.eta_count; i++)
-									f->aw.eta[i] = ANN_TIME(bb);
+									f->aw.eta[i] = BlockTable::annTime(bb);
 							}
 							else
 							{
@@ -2155,8 +2876,8 @@ Retourne le noeud qui est dominé par tous les autres
 
 										// add the effect of the pipeline if the loop header is the last node in an ALT
 										long long max_wcet_loc = 0;
-										if(IS_LAST_IN_ALT(bb)){
-											Edge* edge = EDGE_ALIAS(bb);
+										if(BlockTable::flag(bb, BlockTable::LAST_IN_ALT)){
+											Edge* edge = BlockTable::edgeAlias(bb);
 											// the next formula should look like the one in sources rergarding WCET in presence of pipeline, see otawa/src/etime/EdgeTimeBuilder.cpp
 											// if the header is not the last node of the alt (possible in some cases)
 											// then it does not represent any edge
@@ -2174,15 +2895,15 @@ Retourne le noeud qui est dominé par tous les autres
 										// this ensures that at least one time we execute the test with the entry and the exit pipeline effects
 										// cout << "In loop exit" << endl;
 										// The if is used to remove the entry edge time from the header time in the exit node when loop header is the successor of an alt
-										if(IS_AA_LOOPEXIT(bb))
+										if(BlockTable::flag(bb, BlockTable::AA_LOOPEXIT))
 											entry = 0;
 										entry += max_wcet_loc;
-										f->aw.others = ipet::TIME(bb) >= 0 ? ipet::TIME(bb) + entry : entry;
+										f->aw.others = BlockTable::blockTime(bb) >= 0 ? BlockTable::blockTime(bb) + entry : entry;
 									}
 									else{
 										// The loop backedges WCET
 										// cout << "Not in loop exit" << endl;
-										f->aw.others = ipet::TIME(bb) >= 0 ? ipet::TIME(bb) + back_edge : back_edge;
+										f->aw.others = BlockTable::blockTime(bb) >= 0 ? BlockTable::blockTime(bb) + back_edge : back_edge;
 									}
 								}
 							}
@@ -2213,21 +2934,21 @@ Retourne le noeud qui est dominé par tous les autres
 						CFTree *ch = (*it);
 						if (ch->toLeaf() && ch->toLeaf()->getBlock() == nullptr)
 							continue;
-						ch->exportToAWCET(f->children + i, pfl, loopexit, true);
+						jobs.push_back(ExportJob{ch, f->children + i, loopexit, true});
 						i++;
 					}
 				}
 				if (CFTreeConditionalAlt *n = toConditionalAlt())
 				{
 					f->kind = KIND_ALT;
-					std::vector<CFTree *> children = n->getChildren();
+					const std::vector<CFTree *> &children = n->getChildren();
 					int nchild = children.size();
 					f->opdata.children_count = nchild;
 					f->children = (formula_t *)calloc(sizeof(formula_t), nchild);
 					for (long unsigned int i = 0; i != children.size(); i++)
 					{
 						CFTree *ch = children[i];
-						std::string condition = n->getConditions()[i];
+						std::string condition = n->getCondition(i);
 						if (ch->toLeaf() && ch->toLeaf()->getBlock() == nullptr)
 								continue;
 						if(condition != ""){
@@ -2243,10 +2964,10 @@ Retourne le noeud qui est dominé par tous les autres
 							strcpy(boolean_expr->bool_expr, condition.c_str()); // TODO : process the string to change the id to a unique id
 
 							// second child of the boolean product is the WCET formula of the tree
-							ch->exportToAWCET(fchild->children + 1, pfl, loopexit, true); //< +1 = the second child
+							jobs.push_back(ExportJob{ch, fchild->children + 1, loopexit, true}); //< +1 = the second child
 						}
 						else{
-							ch->exportToAWCET(f->children + i, pfl, loopexit, true); //< export as a regular tree without condition
+							jobs.push_back(ExportJob{ch, f->children + i, loopexit, true}); //< export as a regular tree without condition
 						}
 					}
 				}
@@ -2258,9 +2979,10 @@ Retourne le noeud qui est dominé par tous les autres
 					f->children = (formula_t *)calloc(sizeof(formula_t), 2);
 					f->children[0].kind = KIND_LOOP;
 					f->children[0].opdata.loop_id = n->getHeader()->id();
+					f->children[0].origin = ex.formulaOrigin(n->getHeader());
 					f->children[0].children = (formula_t *)calloc(sizeof(formula_t), 1);
-					b->exportToAWCET(f->children[0].children, pfl, loopexit);
-					e->exportToAWCET(f->children + 1, pfl, true);
+					jobs.push_back(ExportJob{b, f->children[0].children, loopexit, false});
+					jobs.push_back(ExportJob{e, f->children + 1, true, false});
 					f->opdata.children_count = 2;
 
 					// default value for a non parametric loop
@@ -2293,9 +3015,9 @@ Retourne le noeud qui est dominé par tous les autres
 					{
 						CFTree *ch = (*it);
 						if(i == nchild-1) // explicit last child information
-							ch->exportToAWCET(f->children + i, pfl, loopexit, true);
+							jobs.push_back(ExportJob{ch, f->children + i, loopexit, true});
 						else
-							ch->exportToAWCET(f->children + i, pfl, loopexit);
+							jobs.push_back(ExportJob{ch, f->children + i, loopexit, false});
 						i++;
 					}
 				}
@@ -2308,17 +3030,17 @@ Retourne le noeud qui est dominé par tous les autres
 		{
 			std::ofstream myfile;
 			myfile.open(str.toCString());
-			unsigned int lab = 0;
-			std::stringstream ss;
-			ss << "digraph BST { \n"
-			   << write_tree(*this, &lab) << "}";
-			myfile << ss.str();
+			myfile << "digraph BST { \n";
+			DotWriter writer(myfile);
+			writer.visit(this);
+			myfile << "}";
 			myfile.close();
 		}
 		void CFTree::exportToC(io::Output &out)
 		{
 			unsigned int indent = 2;
-			write_code(out, *this, indent);
+			CodeWriter writer(out, indent);
+			writer.visit(this);
 		}
 
 		CFTree *CFTreeExtractor::processCFG(CFG *cfg)
@@ -2340,12 +3062,17 @@ Retourne le noeud qui est dominé par tous les autres
 			/*	cout << "Processing CFG: " << cfg->label() << "\n"; */
 			DAG *dag = toDAG(cfg, NULL);
 			CFTree *tree = toCFT(dag, dag->getStart(), dag->getVirtExit(), 1);
+			// the CFT does not refer to the DAG, which is only needed to build it
+			delete dag;
+			loop_blocks.clear();
 
 #ifdef ICACHE
 			// cache implement
 			//cout << "Instruction cache activated" << endl;
 			CFTCacheMutator cacheMutator;
-			tree = cacheMutator.transform(tree);
+			CFTree *mutated = cacheMutator.transform(tree);
+			cacheMutator.release(tree);
+			tree = mutated;
 #endif
 
 			CFTREE(cfg) = tree;
@@ -2361,11 +3088,13 @@ Retourne le noeud qui est dominé par tous les autres
 		void CFTreeExtractor::processWorkSpace(WorkSpace *ws)
 		{
 			const CFGCollection *coll = INVOLVED_CFGS(ws);
+			BlockTable::load(coll);
 			for (CFGCollection::Iter iter(*coll); iter(); iter++)
 			{
 				CFG *currentCFG = *iter;
 				processCFG(currentCFG);
 			}
+			BlockTable::clear();
 		}
 
 		Identifier<DAGHNode *> DAG_HNODE("otawa::cftree:DAG_HNODE");
@@ -2373,6 +3102,7 @@ Retourne le noeud qui est dominé par tous les autres
 		Identifier<CFTree *> CFTREE("otawa::cftree:CFTREE");
 		Identifier<int> ANN_TIME("otawa::cftree:ANN_TIME", 0);
 		Identifier<int> ANN_COUNT("otawa::cftree:ANN_COUNT", 0);
+		Identifier<bool> FUNCTION_SUMMARIES("otawa::cftree::FUNCTION_SUMMARIES", false);
 
 		/// *******************
 		/// CACHE MUTATOR CLASS
@@ -2387,74 +3117,78 @@ Retourne le noeud qui est dominé par tous les autres
 		///
 		CFTree *CFTCacheMutator::transform(CFTree *tree)
 		{
-			// si leaf, on appelle transofmLeaf (condition d'arrêt)
-			// LEAF
-			if (CFTreeLeaf *leaf = tree->toLeaf())
+			// les sous-arbres sont transformés avant leur parent
+			struct Transformer : public CFTreeVisitor
 			{
-				return transformLeaf(leaf);
-			}
-			// sinon appel récurcif sur les sous-arbres
-			// ALT
-			if (CFTreeAlt *alt = tree->toAlt())
-			{
-				std::vector<CFTree *> alts;
-				for (unsigned i = 0; i < alt->size(); i++)
-				{
-					CFTree *subTree = alt->getI(i);
-					alts.push_back(transform(subTree));
-				}
-				CFTreeAlt *newAlt = new CFTreeAlt(alts);
-				return newAlt;
-			}
-			// CONDITIONAL ALT
-			if (CFTreeConditionalAlt *alt = tree->toConditionalAlt())
-			{
-				std::vector<CFTree *> alts;
-				for (unsigned i = 0; i < alt->getChildren().size(); i++)
+				CFTCacheMutator *mutator;
+				// transformed subtrees, the children of the node being left on top
+				std::vector<CFTree *> done;
+
+				explicit Transformer(CFTCacheMutator *m) : mutator(m) {}
+
+				void leave(CFTree *t) override
 				{
-					CFTree *subTree = alt->getChildren()[i];
-					alts.push_back(transform(subTree));
+					size_t n = childCount(t);
+					std::vector<CFTree *> children(done.end() - n, done.end());
+					done.resize(done.size() - n);
+
+					// si leaf, on appelle transofmLeaf (condition d'arrêt)
+					// LEAF
+					if (CFTreeLeaf *leaf = t->toLeaf())
+						done.push_back(mutator->transformLeaf(leaf));
+					// ALT
+					else if (t->toAlt())
+						done.push_back(new CFTreeAlt(children));
+					// CONDITIONAL ALT
+					else if (CFTreeConditionalAlt *alt = t->toConditionalAlt())
+					{
+						std::map<int,std::string> cdts = std::map<int,std::string>(alt->getConditions());
+						done.push_back(new CFTreeConditionalAlt(children, cdts));
+					}
+					// LOOPS
+					else if (CFTreeLoop *loop = t->toLoop())
+					{
+						BasicBlock *bb = loop->getHeader();
+						if(!loop->isParametric())
+							done.push_back(new CFTreeLoop(bb, loop->getBound(), children[0], children[1]));
+						else
+							done.push_back(new CFTreeLoop(bb, loop->getParametricBound(), children[0], children[1]));
+					}
+					// SEQ
+					else if (t->toSeq())
+						done.push_back(new CFTreeSeq(children));
+					else
+					{
+						cerr << "Error : A problem occured while finding the type of the tree" << endl;
+						abort();
+					}
 				}
-				std::map<int,std::string> cdts = std::map<int,std::string>(alt->getConditions());
-				CFTreeConditionalAlt *newAlt = new CFTreeConditionalAlt(alts,cdts);
-				return newAlt;
-			}
-			// LOOPS
-			if (CFTreeLoop *loop = tree->toLoop())
-			{
-				BasicBlock *bb = loop->getHeader();
-				CFTree *body = loop->getBody();
-				CFTree *exit = loop->getExit();
+			};
 
-				body = transform(body);
-				exit = transform(exit);
+			Transformer transformer(this);
+			transformer.visit(tree);
+			return transformer.done.back();
+		}
 
-				CFTreeLoop *newLoop;
-				if(!loop->isParametric()){
-					int bound = loop->getBound();
-					newLoop = new CFTreeLoop(bb, bound, body, exit);
-				}
-				else{
-					std::string bound = loop->getParametricBound();
-					newLoop = new CFTreeLoop(bb, bound, body, exit);
-				}
-				return newLoop;
-			}
-			// SEQ
-			if (CFTreeSeq *sequence = tree->toSeq())
+		///
+		/// Deletes the Alt, ConditionalAlt, Loop and Seq nodes of a tree once transform() has
+		/// built its copy, the leaves being moved to the copy
+		/// @param tree the tree given to transform()
+		///
+		void CFTCacheMutator::release(CFTree *tree)
+		{
+			// children are left before their parent
+			struct Releaser : public CFTreeVisitor
 			{
-				std::vector<CFTree *> childs;
-
-				for (unsigned i = 0; i < sequence->size(); i++)
+				void leave(CFTree *t) override
 				{
-					childs.push_back(transform(sequence->getI(i)));
+					if (!t->toLeaf())
+						delete t;
 				}
+			};
 
-				CFTreeSeq *newSequence = new CFTreeSeq(childs);
-				return newSequence;
-			}
-			cerr << "Error : A problem occured while finding the type of the tree" << endl;
-			abort();
+			Releaser releaser;
+			releaser.visit(tree);
 		}
 
 		///
@@ -2520,6 +3254,9 @@ Retourne le noeud qui est dominé par tous les autres
 				//else
 				//	cout << ", using BB " << header->id() << " instead" << endl;
 			}
+			// the formula of a function is shared by all its calls, the loop of a caller cannot be used
+			if(function_summaries && header != nullptr && (cat == FIRST_MISS || cat == FIRST_HIT) && header->cfg() != block->cfg())
+				cat = ALWAYS_MISS;
 			int loop_id = header != nullptr ? header->id() : -1;
 			// cout << "Loop id : " << loop_id << endl;
 
@@ -2557,10 +3294,10 @@ Retourne le noeud qui est dominé par tous les autres
 				BasicCacheBlock *blockMiss = new BasicCacheBlock(instsMiss, lBlock->id(), basicBlockId, MISS, cat, loop_id);
 				CFTreeLeaf *leafMiss = new CFTreeLeaf(blockMiss);
 
-				std::vector<CFTree *> *alts = new std::vector<CFTree *>();
-				alts->push_back(leafHit);
-				alts->push_back(leafMiss);
-				CFTreeAlt *alt = new CFTreeAlt(*alts);
+				std::vector<CFTree *> alts;
+				alts.push_back(leafHit);
+				alts.push_back(leafMiss);
+				CFTreeAlt *alt = new CFTreeAlt(alts);
 				return alt;
 				break;
 			}
@@ -2605,13 +3342,78 @@ Retourne le noeud qui est dominé par tous les autres
 			this->parent = parent;
 		}
 
-		std::set<PseudoPath> CFTree::getPseudoPaths()
+		/* infeasible paths data of a node, only created in IP mode */
+		struct IPData
 		{
-			return ppaths;
+			std::map<PseudoPath, CFTree *> pseudoTrees;
+			std::set<Constraint> constraints;
+			std::set<PseudoPath> ppaths;
+			CFTreeLeaf *original = nullptr;
+			std::vector<CFTreeLeaf *> avatars;
+		};
+
+		/* side table of the infeasible paths data, by node id */
+		static std::unordered_map<unsigned, IPData> ip_data;
+		static std::mutex ip_mutex;
+
+		static IPData &ipData(CFTree *t)
+		{
+			std::lock_guard<std::mutex> lock(ip_mutex);
+			return ip_data[t->getId()];
+		}
+
+		static IPData *findIPData(CFTree *t)
+		{
+			std::lock_guard<std::mutex> lock(ip_mutex);
+			auto it = ip_data.find(t->getId());
+			return it == ip_data.end() ? nullptr : &it->second;
+		}
+
+		CFTree::~CFTree()
+		{
+			std::lock_guard<std::mutex> lock(ip_mutex);
+			ip_data.erase(id);
+		}
+
+		const std::set<PseudoPath> &CFTree::getPseudoPaths()
+		{
+			return ipData(this).ppaths;
 		}
 		void CFTree::setPseudoPaths(std::set<PseudoPath> pseudoPaths)
 		{
-			this->ppaths = pseudoPaths;
+			ipData(this).ppaths = pseudoPaths;
+		}
+
+		std::set<Constraint> *CFTree::getConstraints()
+		{
+			return &ipData(this).constraints;
+		}
+
+		void CFTreeLeaf::addAvatar(CFTreeLeaf *avatar)
+		{
+			ipData(this).avatars.push_back(avatar);
+		}
+
+		const std::vector<CFTreeLeaf *> &CFTreeLeaf::getAvatars()
+		{
+			return ipData(this).avatars;
+		}
+
+		void CFTreeLeaf::freeAvatars()
+		{
+			if (IPData *d = findIPData(this))
+				d->avatars.clear();
+		}
+
+		void CFTreeLeaf::setOriginal(CFTreeLeaf *leaf)
+		{
+			ipData(this).original = leaf;
+		}
+
+		CFTreeLeaf *CFTreeLeaf::getOriginal()
+		{
+			IPData *d = findIPData(this);
+			return d ? d->original : nullptr;
 		}
 
 		///
@@ -3295,25 +4097,26 @@ Retourne le noeud qui est dominé par tous les autres
 		///
 		void CFTree::putPPath(PseudoPath pseudoPath, CFTree *pseudoTree)
 		{
-			mtx.lock();
-			pseudoTrees.emplace(pseudoPath, pseudoTree);
-			mtx.unlock();
+			IPData &d = ipData(this);
+			std::lock_guard<std::mutex> lock(ip_mutex);
+			d.pseudoTrees.emplace(pseudoPath, pseudoTree);
 		}
 
 		///
 		/// get the pseudo paths and the corresponding pseudo trees
 		///
-		std::map<PseudoPath, CFTree *> CFTree::getPPaths()
+		const std::map<PseudoPath, CFTree *> &CFTree::getPPaths()
 		{
-			return pseudoTrees;
+			return ipData(this).pseudoTrees;
 		}
 
 		///
 		/// Computes the WCET of a tree using the WCET of all possible pseudo  paths
 		///
-		void CFTree::exportToFeasibleWCET(formula_t *f, struct param_func *pfl)
+		void CFTree::exportToFeasibleWCET(formula_t *f, struct param_func *pfl, AWCETExport &ex)
 		{
 			std::vector<CFTree *> childs;
+			const std::map<PseudoPath, CFTree *> &pseudoTrees = getPPaths();
 			for (auto i = pseudoTrees.begin(); i != pseudoTrees.end(); i++)
 			{
 				childs.push_back((*i).second);
@@ -3343,7 +4146,7 @@ Retourne le noeud qui est dominé par tous les autres
 			}
 
 			feasibleTree->exportToDot(buf.toString());
-			feasibleTree->exportToAWCET(f, pfl);
+			feasibleTree->exportToAWCET(f, pfl, ex);
 		}
 
 		/// **************************
@@ -3703,14 +4506,14 @@ Retourne le noeud qui est dominé par tous les autres
 			if (CFTreeLeaf *leaf = branch->toLeaf())
 			{
 				if (leaf->getBlock() != nullptr)
-					return CONDITION(leaf->getBlock());
+					return BlockTable::condition(leaf->getBlock());
 				else
 					return nullptr;
 			}
 			// take last condition found
 			if (CFTreeSeq *seq = branch->toSeq())
 			{
-				std::vector<CFTree *> children = seq->getChilds();
+				const std::vector<CFTree *> &children = seq->getChilds();
 				BranchCondition *lastCondition = nullptr;
 				for (long unsigned int i = 0; i != children.size(); i++)
 				{
@@ -3832,6 +4635,168 @@ Retourne le noeud qui est dominé par tous les autres
 		return false;
 	}
 
+	int AWCETExport::formulaOrigin(Block *b){
+		origins.push_back(b);
+		return origins.size();
+	}
+
+	Block *AWCETExport::originBlock(int origin) const{
+		if(origin <= 0 || origin > (int) origins.size())
+			return nullptr;
+		return origins[origin - 1];
+	}
+
+	/* properties of the blocks of one CFG, indexed by block id */
+	struct CFGTable {
+		CFG *cfg;
+		std::vector<DAGBNode *> bnode;
+		std::vector<DAGHNode *> hnode;
+		std::vector<BranchCondition *> condition;
+		std::vector<LoopBound> loop_bound;
+		std::vector<ot::time> time;
+		std::vector<int> ann_count;
+		std::vector<int> ann_time;
+		std::vector<Edge *> edge_alias;
+		std::vector<bool> flags[BlockTable::FLAG_COUNT];
+	};
+
+	/* tables[i] is the table of the CFG of index i */
+	static std::vector<CFGTable> tables;
+
+	static Identifier<bool> *flag_ids[BlockTable::FLAG_COUNT] = { &IS_AFTER_ALT, &IS_LAST_IN_ALT, &IS_PIPELINE_EDGE, &IS_AA_LOOPEXIT };
+
+	static CFGTable *tableOf(Block *b){
+		CFG *cfg = b->cfg();
+		if(cfg == nullptr || cfg->index() < 0 || cfg->index() >= (int) tables.size())
+			return nullptr;
+		CFGTable *t = &tables[cfg->index()];
+		if(t->cfg != cfg || b->id() < 0 || b->id() >= (int) t->bnode.size())
+			return nullptr;
+		return t;
+	}
+
+	void BlockTable::load(const CFGCollection *coll){
+		tables.clear();
+		tables.resize(coll->count());
+		for(CFGCollection::Iter iter(*coll); iter(); iter++){
+			CFG *cfg = *iter;
+			if(cfg->index() < 0 || cfg->index() >= (int) tables.size())
+				continue;
+			CFGTable &t = tables[cfg->index()];
+			int n = 0;
+			for(CFG::BlockIter b(cfg->blocks()); b(); b++)
+				if((*b)->id() >= n)
+					n = (*b)->id() + 1;
+			t.cfg = cfg;
+			t.bnode.resize(n);
+			t.hnode.resize(n);
+			t.condition.resize(n);
+			t.loop_bound.resize(n);
+			t.time.resize(n);
+			t.ann_count.resize(n);
+			t.ann_time.resize(n);
+			t.edge_alias.resize(n);
+			for(int f = 0; f < FLAG_COUNT; f++)
+				t.flags[f].resize(n);
+			for(CFG::BlockIter iter2(cfg->blocks()); iter2(); iter2++){
+				Block *b = *iter2;
+				int id = b->id();
+				t.bnode[id] = DAG_BNODE(b);
+				t.hnode[id] = DAG_HNODE(b);
+				t.condition[id] = CONDITION(b);
+				t.loop_bound[id] = LOOP_BOUND(b);
+				t.time[id] = ipet::TIME(b);
+				t.ann_count[id] = ANN_COUNT(b);
+				t.ann_time[id] = ANN_TIME(b);
+				t.edge_alias[id] = EDGE_ALIAS(b);
+				for(int f = 0; f < FLAG_COUNT; f++)
+					t.flags[f][id] = (*flag_ids[f])(b);
+			}
+		}
+	}
+
+	void BlockTable::clear(){
+		std::vector<CFGTable>().swap(tables);
+	}
+
+	DAGBNode *BlockTable::bnode(Block *b){
+		if(CFGTable *t = tableOf(b))
+			return t->bnode[b->id()];
+		return DAG_BNODE(b);
+	}
+
+	void BlockTable::setBNode(Block *b, DAGBNode *n){
+		if(CFGTable *t = tableOf(b))
+			t->bnode[b->id()] = n;
+		DAG_BNODE(b) = n;
+	}
+
+	DAGHNode *BlockTable::hnode(Block *b){
+		if(CFGTable *t = tableOf(b))
+			return t->hnode[b->id()];
+		return DAG_HNODE(b);
+	}
+
+	void BlockTable::setHNode(Block *b, DAGHNode *n){
+		if(CFGTable *t = tableOf(b))
+			t->hnode[b->id()] = n;
+		DAG_HNODE(b) = n;
+	}
+
+	BranchCondition *BlockTable::condition(Block *b){
+		if(CFGTable *t = tableOf(b))
+			return t->condition[b->id()];
+		return CONDITION(b);
+	}
+
+	LoopBound BlockTable::loopBound(Block *b){
+		if(CFGTable *t = tableOf(b))
+			return t->loop_bound[b->id()];
+		return LOOP_BOUND(b);
+	}
+
+	ot::time BlockTable::blockTime(Block *b){
+		if(CFGTable *t = tableOf(b))
+			return t->time[b->id()];
+		return ipet::TIME(b);
+	}
+
+	int BlockTable::annCount(Block *b){
+		if(CFGTable *t = tableOf(b))
+			return t->ann_count[b->id()];
+		return ANN_COUNT(b);
+	}
+
+	int BlockTable::annTime(Block *b){
+		if(CFGTable *t = tableOf(b))
+			return t->ann_time[b->id()];
+		return ANN_TIME(b);
+	}
+
+	Edge *BlockTable::edgeAlias(Block *b){
+		if(CFGTable *t = tableOf(b))
+			return t->edge_alias[b->id()];
+		return EDGE_ALIAS(b);
+	}
+
+	void BlockTable::setEdgeAlias(Block *b, Edge *e){
+		if(CFGTable *t = tableOf(b))
+			t->edge_alias[b->id()] = e;
+		EDGE_ALIAS(b) = e;
+	}
+
+	bool BlockTable::flag(Block *b, flag_t f){
+		if(CFGTable *t = tableOf(b))
+			return t->flags[f][b->id()];
+		return (*flag_ids[f])(b);
+	}
+
+	void BlockTable::setFlag(Block *b, flag_t f){
+		if(CFGTable *t = tableOf(b))
+			t->flags[f][b->id()] = true;
+		(*flag_ids[f])(b) = true;
+	}
+
 	Identifier<LoopBound> LOOP_BOUND("otawa::cftree::LOOP_BOUND", LoopBound());
 	Identifier<bool> IS_AFTER_ALT("otawa::cftree::IS_AFTER_ALT", false);
 	Identifier<bool> IS_LAST_IN_ALT("otawa::cftree::IS_LAST_IN_ALT", false);
@@ -19,6 +19,7 @@
    USA
    ---------------------------------------------------------------------------- */
 
+#include <limits.h>
 #include <string.h>
 #include <stdlib.h>
 
@@ -28,60 +29,107 @@
 
 #include <stdio.h>
 
-void compute_node(evalctx_t * ctx, formula_t * f)
+/*
+ * Explicit stack for the depth-first traversals (see include/PWCET.h)
+ */
+walk_frame_t *walk_push(walk_t *w, formula_t *f)
+{
+	walk_frame_t *frames;
+	if (w->size == w->capacity) {
+		if (w->frames == w->local) {
+			frames = (walk_frame_t *) malloc(sizeof(walk_frame_t) * w->capacity * 2);
+			if (frames != NULL)
+				memcpy(frames, w->local, sizeof(walk_frame_t) * w->size);
+		} else
+			frames = (walk_frame_t *) realloc(w->frames, sizeof(walk_frame_t) * w->capacity * 2);
+		if (frames == NULL) {
+			fprintf(stderr, "formula traversal: out of memory\n");
+			abort();
+		}
+		w->frames = frames;
+		w->capacity *= 2;
+	}
+	memset(&w->frames[w->size], 0, sizeof(walk_frame_t));
+	w->frames[w->size].f = f;
+	return &w->frames[w->size++];
+}
+
+void walk_init(walk_t *w, formula_t *root)
+{
+	w->frames = w->local;
+	w->size = 0;
+	w->capacity = WALK_FRAMES;
+	walk_push(w, root);
+}
+
+walk_frame_t *walk_top(walk_t *w)
+{
+	return (w->size > 0) ? &w->frames[w->size - 1] : NULL;
+}
+
+void walk_pop(walk_t *w)
+{
+	w->size--;
+}
+
+void walk_release(walk_t *w)
+{
+	if (w->frames != w->local)
+		free(w->frames);
+}
+
+/* Number of children of f evaluated before f itself (see awcet_boolmult() for BOOLMULT) */
+static int compute_arity(formula_t *f)
 {
-	int i;
 	switch (f->kind) {
 		case KIND_SEQ:
+		case KIND_ALT:
+			return f->opdata.children_count;
+		case KIND_LOOP:
+		case KIND_ANN:
+		case KIND_INTMULT:
+		case KIND_PARAM_LOOP:
+			return 1;
+		default:
+			return 0;
+	}
+}
+
+/* Compute the abstract WCET of f, those of its children being computed */
+void compute_combine(evalctx_t * ctx, formula_t * f)
+{
 #ifdef DEBUG
-			printf("compute_node: start processing SEQ node\n");
+	int i;
 #endif
-			for (i = 0; i < f->opdata.children_count; i++)
-				compute_node(ctx, &f->children[i]);
-			awcet_seq(ctx, f->opdata.children_count, f->children, &f->aw);
+	switch (f->kind) {
+		case KIND_SEQ:
+			awcet_seq(ctx, f->opdata.children_count, f->children, &f->aw, f->eta_limit);
 #ifdef DEBUG
 			printf("compute_node: end processing SEQ node\n");
 #endif
 			break;
 		case KIND_ALT:
-#ifdef DEBUG
-			printf("compute_node: start processing ALT node\n");
-#endif
-			for (i = 0; i < f->opdata.children_count; i++)
-				compute_node(ctx, &f->children[i]);
-			awcet_alt(ctx, f->opdata.children_count, f->children, &f->aw);
+			awcet_alt(ctx, f->opdata.children_count, f->children, &f->aw, f->eta_limit);
 #ifdef DEBUG
 			printf("compute_node: end processing ALT node\n");
 #endif
 			break;
 		case KIND_LOOP:
-#ifdef DEBUG
-			printf("compute_node: start processing LOOP node\n");
-#endif
-			compute_node(ctx, &f->children[0]);
 			awcet_loop(ctx, &f->children->aw, f);
 #ifdef DEBUG
 			printf("compute_node: end processing LOOP node\n");
 #endif
 			break;
 		case KIND_ANN:
-#ifdef DEBUG
-			printf("compute_node: start processing ANN node\n");
-#endif
-			compute_node(ctx, &f->children[0]);
 			awcet_ann(ctx, &f->children->aw, f);
 #ifdef DEBUG
 			printf("compute_node: end processing ANN node\n");
 #endif
 			break;
 		case KIND_INTMULT:
-#ifdef DEBUG
-			printf("compute_node: start processing INTMULT node\n");
-#endif
-			compute_node(ctx, &f->children[0]);
 			awcet_intmult(ctx, &f->children->aw, f);
 #ifdef DEBUG
-			printf("compute_node: end processing ANN node\n");
+			printf("compute_node: end processing INTMULT node\n");
 #endif
 			break;
 		case KIND_AWCET:
@@ -105,7 +153,6 @@ void compute_node(evalctx_t * ctx, formula_t * f)
 #ifdef DEBUG
 			printf("compute_node: processing PARAM_LOOP node\n");
 #endif
-			compute_node(ctx, &f->children[0]);
 			awcet_paramloop(ctx, &f->children->aw, f);
 			break;
 //#ifdef DEBUG
@@ -117,12 +164,32 @@ void compute_node(evalctx_t * ctx, formula_t * f)
 #ifdef DEBUG
 	printf("compute_node: loop=%d, eta[]={", f->aw.loop_id);
 	for (i = 0; i < f->aw.eta_count; i++)
-		printf("%lld, ", f->aw.eta[i]);
-	printf("}, others=%lld\n", f->aw.others);
+		printf("%lldx%d, ", (long long) f->aw.eta[i], (f->aw.eta_mult != NULL) ? f->aw.eta_mult[i] : 1);
+	printf("}, others=%lld\n", (long long) f->aw.others);
 
 #endif
 }
 
+/*
+ * Compute the abstract WCET of every node of f, children first
+ * The traversal uses an explicit stack, only the subtrees guarded by BOOLMULT
+ * nodes are computed by nested calls.
+ */
+void compute_node(evalctx_t * ctx, formula_t * f)
+{
+	walk_t w;
+	walk_frame_t *top;
+	walk_init(&w, f);
+	while ((top = walk_top(&w)) != NULL) {
+		if (top->next < compute_arity(top->f)) {
+			walk_push(&w, &top->f->children[top->next++]);
+			continue;
+		}
+		compute_combine(ctx, top->f);
+		walk_pop(&w);
+	}
+	walk_release(&w);
+}
 
 static int loop_inner(loopinfo_t * li, int inner_id, int outer_id)
 {
@@ -138,39 +205,118 @@ static int loop_bound(loopinfo_t * li, int loop_id)
 	return (li->bnd) (loop_id);
 }
 
+/* Multiplicity of the i-th eta value of aw */
+static inline int eta_run(awcet_t * aw, int i)
+{
+	return (aw->eta_mult != NULL) ? aw->eta_mult[i] : 1;
+}
+
+int awcet_length(awcet_t * aw)
+{
+	int i, len = 0;
+	if (aw->eta_mult == NULL)
+		return aw->eta_count;
+	for (i = 0; i < aw->eta_count; i++)
+		len += aw->eta_mult[i];
+	return len;
+}
+
+/*
+ * Append count copies of value to the eta values of dest. Run-length encoded
+ * destinations (eta_mult != NULL) store them as a single run, merged with the
+ * last one when the values are equal, so they never hold more runs than values.
+ */
+static void eta_push(awcet_t * dest, awcet_value_t value, int count)
+{
+	if (count <= 0)
+		return;
+	if (dest->eta_mult == NULL) {
+		while (count-- > 0)
+			dest->eta[dest->eta_count++] = value;
+		return;
+	}
+	if ((dest->eta_count > 0) && (dest->eta[dest->eta_count - 1] == value)) {
+		dest->eta_mult[dest->eta_count - 1] += count;
+		return;
+	}
+	dest->eta[dest->eta_count] = value;
+	dest->eta_mult[dest->eta_count] = count;
+	dest->eta_count++;
+}
+
+/* Number of eta values a node may produce, see compute_eta_demand() */
+static inline int eta_room(int limit)
+{
+	return (limit > 0) ? limit : INT_MAX;
+}
+
 void awcet_seq(evalctx_t * ctx, int source_count, formula_t * source,
-			   awcet_t * dest)
+			   awcet_t * dest, int limit)
 {
 	int inner_loop = -1;
-	int i, j;
+	int i, step, room = eta_room(limit);
+	int cursors[2 * SEQ_CURSORS];
+	int *run, *left;
+	awcet_value_t value;
 	dest->others = 0;
 	for (i = 0; i < source_count; i++) {
 		if ((inner_loop == -1)
 			|| loop_inner(ctx->li, source[i].aw.loop_id, inner_loop))
 			inner_loop = source[i].aw.loop_id;
 		dest->others += source[i].aw.others;
-		if (dest->eta_count < source[i].aw.eta_count)
-			dest->eta_count = source[i].aw.eta_count;
 	}
 	dest->loop_id = inner_loop;
-	memset(dest->eta, 0, sizeof(int) * dest->eta_count);
-	for (j = 0; j < dest->eta_count; j++) {
-		long long *ptr = &dest->eta[j];
+	dest->eta_count = 0;
+
+	if (source_count <= SEQ_CURSORS)
+		run = cursors;
+	else if ((run = (int *) malloc(sizeof(int) * 2 * source_count)) == NULL) {
+		fprintf(stderr, "awcet_seq: out of memory\n");
+		abort();
+	}
+	left = run + source_count;
+	for (i = 0; i < source_count; i++) {
+		run[i] = 0;
+		left[i] = (source[i].aw.eta_count > 0) ? eta_run(&source[i].aw, 0) : 0;
+	}
+	/* Each step covers the longest range over which no source changes value */
+	while (1) {
+		step = INT_MAX;
+		value = 0;
 		for (i = 0; i < source_count; i++) {
-			*ptr +=
-				(source[i].aw.eta_count >
-				 j) ? source[i].aw.eta[j] : source[i].aw.others;
+			if (left[i] == 0) {
+				value += source[i].aw.others;
+				continue;
+			}
+			value += source[i].aw.eta[run[i]];
+			if (left[i] < step)
+				step = left[i];
+		}
+		if ((step == INT_MAX) || (room == 0))
+			break;
+		if (step > room)
+			step = room;
+		eta_push(dest, value, step);
+		room -= step;
+		for (i = 0; i < source_count; i++) {
+			if (left[i] == 0)
+				continue;
+			left[i] -= step;
+			if ((left[i] == 0) && (++run[i] < source[i].aw.eta_count))
+				left[i] = eta_run(&source[i].aw, run[i]);
 		}
 	}
+	if (run != cursors)
+		free(run);
 }
 
 void awcet_alt(evalctx_t * ctx, int source_count, formula_t * source,
-			   awcet_t * dest)
+			   awcet_t * dest, int limit)
 {
-	int i, temp_max_source, dest_idx;
-	long long temp_max;
+	int i, n, temp_max_source, room = eta_room(limit);
+	awcet_value_t temp_max;
 	int inner_loop = -1;
-	static int tab[ALT_MAX];
+	int tab[ALT_MAX];
 	dest->others = -1;
 	dest->eta_count = 0;
 	for (i = 0; i < source_count; i++) {
@@ -182,15 +328,13 @@ void awcet_alt(evalctx_t * ctx, int source_count, formula_t * source,
 	}
 	dest->loop_id = inner_loop;
 
-	dest_idx = 0;
-	memset(tab, 0, sizeof(tab));
-
 	if (source_count > ALT_MAX) {
 		fprintf(stderr, "Increase ALT_MAX\n");
 		abort();
 	}
+	memset(tab, 0, sizeof(int) * source_count);
 	/* Loop iteration count bounded by sum[i=1..source_count](source[i].eta_count) */
-	while (1) {
+	while (room > 0) {
 		temp_max = -1;
 		for (i = 0; i < source_count; i++) {
 			if (tab[i] == source[i].aw.eta_count)
@@ -205,18 +349,65 @@ void awcet_alt(evalctx_t * ctx, int source_count, formula_t * source,
 		}
 		if (temp_max == -1)
 			break;
-		dest->eta[dest_idx] = temp_max;
-		dest_idx++;
+		/* the whole run goes at once, equal runs of other sources are merged by eta_push */
+		n = eta_run(&source[temp_max_source].aw, tab[temp_max_source]);
+		if (n > room)
+			n = room;
+		eta_push(dest, temp_max, n);
+		room -= n;
 		tab[temp_max_source]++;
-		dest->eta_count++;
+	}
+}
+
+/* Shared by awcet_loop() and awcet_paramloop(), once the bound is known (bound > 0) */
+static void awcet_iterate(awcet_t * source, formula_t * dest, int bound)
+{
+	int i, k, n, fill, room = eta_room(dest->eta_limit);
+	awcet_value_t loop_wcet = 0;
+	if (source->loop_id == dest->opdata.loop_id) {
+		/* sum of the bound greatest values, others for the remaining iterations */
+		for (i = 0; (bound > 0) && (i < source->eta_count); i++) {
+			n = eta_run(source, i) < bound ? eta_run(source, i) : bound;
+			loop_wcet += n * source->eta[i];
+			bound -= n;
+		}
+		loop_wcet += bound * source->others;
+		dest->aw.others = loop_wcet;
+		dest->aw.eta_count = 0;
+		dest->aw.loop_id = LOOP_TOP;
+	} else {
+		/* values are summed by groups of bound, a run yields at most one partial group */
+		dest->aw.loop_id = source->loop_id;
+		dest->aw.others = source->others * bound;
+		dest->aw.eta_count = 0;
+		fill = 0;
+		for (i = 0; (room > 0) && (i < source->eta_count); i++) {
+			n = eta_run(source, i);
+			if (fill > 0) {
+				k = (n < bound - fill) ? n : bound - fill;
+				loop_wcet += k * source->eta[i];
+				fill += k;
+				n -= k;
+				if (fill < bound)
+					continue;
+				eta_push(&dest->aw, loop_wcet, 1);
+				if (--room == 0)
+					break;
+			}
+			k = (n / bound < room) ? n / bound : room;
+			eta_push(&dest->aw, source->eta[i] * bound, k);
+			room -= k;
+			fill = n % bound;
+			loop_wcet = fill * source->eta[i];
+		}
+		if ((fill > 0) && (room > 0))
+			eta_push(&dest->aw, loop_wcet + (bound - fill) * source->others, 1);
 	}
 }
 
 void awcet_loop(evalctx_t * ctx, awcet_t * source, formula_t * dest)
 {
-	int i, j;
 	int bound;
-	long long loop_wcet = 0;
 	param_value_t pv;
 	if (dest->param_id != IDENT_NONE) {
 		ctx->param_valuation(dest->param_id, &pv, ctx->pv_data);
@@ -225,46 +416,41 @@ void awcet_loop(evalctx_t * ctx, awcet_t * source, formula_t * dest)
 		bound = loop_bound(ctx->li, dest->opdata.loop_id);
 	}
 	if (bound == 0) {
+		/* the eta buffers are kept for the next evaluation */
 		dest->aw.loop_id = LOOP_TOP;
 		dest->aw.eta_count = 0;
-		dest->aw.eta = NULL;
 		dest->aw.others = 0;
 		return;
 	}
-	if (source->loop_id == dest->opdata.loop_id) {
-		for (i = 0; (i < bound) && (i < source->eta_count); i++)
-			loop_wcet += source->eta[i];
-		if (i < bound)
-			loop_wcet += (bound - i) * source->others;
-		dest->aw.others = loop_wcet;
-		dest->aw.eta_count = 0;
-		dest->aw.loop_id = LOOP_TOP;
-	} else {
-		dest->aw.loop_id = source->loop_id;
-		dest->aw.eta_count = source->eta_count / bound;
-		dest->aw.others = source->others * bound;
-		if (source->eta_count % bound)
-			dest->aw.eta_count++;
-
-		for (i = 0; i < dest->aw.eta_count; i++) {
-			loop_wcet = 0;
-			for (j = 0; j < bound; j++) {
-				if ((j + i * bound) < source->eta_count) {
-					loop_wcet += source->eta[j + i * bound];
-				} else
-					loop_wcet += source->others;
-			}
-			dest->aw.eta[i] = loop_wcet;
-		}
+	awcet_iterate(source, dest, bound);
+}
 
+/*
+ * The bound of a parametric loop is only known during the evaluation, so are
+ * the sizes of its eta buffers: they are allocated by the evaluation, kept for
+ * the next ones and grown when needed (formula_t.eta_capacity).
+ */
+static void paramloop_reserve(formula_t * dest, int runs)
+{
+	if (runs <= dest->eta_capacity)
+		return;
+	if (dest->eta_capacity == 0) {
+		/* copies of buffers allocated for another node */
+		dest->aw.eta = NULL;
+		dest->aw.eta_mult = NULL;
+	}
+	dest->aw.eta = (awcet_value_t *) realloc(dest->aw.eta, sizeof(awcet_value_t) * runs);
+	dest->aw.eta_mult = (int *) realloc(dest->aw.eta_mult, sizeof(int) * runs);
+	if ((dest->aw.eta == NULL) || (dest->aw.eta_mult == NULL)) {
+		fprintf(stderr, "awcet_paramloop: out of memory\n");
+		abort();
 	}
+	dest->eta_capacity = runs;
 }
 
 void awcet_paramloop(evalctx_t * ctx, awcet_t * source, formula_t * dest)
 {
-	int i, j;
 	int bound = compute_loop_bound(ctx, dest->condition);
-	long long loop_wcet = 0;
 
 #ifdef DEBUG
 	printf("Computed loop bound: %d\n", bound);
@@ -272,48 +458,27 @@ void awcet_paramloop(evalctx_t * ctx, awcet_t * source, formula_t * dest)
 
 	// same as a regular loop
 	if (bound == 0) {
+		/* the eta buffers are kept for the next evaluation */
 		dest->aw.loop_id = LOOP_TOP;
 		dest->aw.eta_count = 0;
-		dest->aw.eta = NULL;
 		dest->aw.others = 0;
 		return;
 	}
-	if (source->loop_id == dest->opdata.loop_id) {
-		for (i = 0; (i < bound) && (i < source->eta_count); i++)
-			loop_wcet += source->eta[i];
-		if (i < bound)
-			loop_wcet += (bound - i) * source->others;
-		dest->aw.others = loop_wcet;
-		dest->aw.eta_count = 0;
-		dest->aw.loop_id = LOOP_TOP;
-	} else {
-		dest->aw.loop_id = source->loop_id;
-		dest->aw.eta_count = source->eta_count / bound;
-		dest->aw.others = source->others * bound;
-		if (source->eta_count % bound)
-			dest->aw.eta_count++;
-		// should correct problem crash when eta_count > 0
-		dest->aw.eta = (long long int*) malloc(dest->aw.eta_count * sizeof(long long));
-		for (i = 0; i < dest->aw.eta_count; i++) {
-			loop_wcet = 0;
-			for (j = 0; j < bound; j++) {
-				if ((j + i * bound) < source->eta_count) {
-					loop_wcet += source->eta[j + i * bound];
-				} else
-					loop_wcet += source->others;
-			}
-			dest->aw.eta[i] = loop_wcet;
-		}
-
-	}
+	/* each source run yields at most two runs, plus the last partial group */
+	if (source->loop_id != dest->opdata.loop_id)
+		paramloop_reserve(dest, 2 * source->eta_count + 1);
+	awcet_iterate(source, dest, bound);
 }
 
 void awcet_intmult(evalctx_t * ctx, awcet_t * source, formula_t * dest)
 {
-	int i;
+	int i, n, room = eta_room(dest->eta_limit);
 	(void)(ctx);
-	for (i = 0; i < source->eta_count; i++) {
-		dest->aw.eta[i] = source->eta[i] * dest->opdata.coef;
+	dest->aw.eta_count = 0;
+	for (i = 0; (room > 0) && (i < source->eta_count); i++) {
+		n = eta_run(source, i) < room ? eta_run(source, i) : room;
+		eta_push(&dest->aw, source->eta[i] * dest->opdata.coef, n);
+		room -= n;
 	}
 	dest->aw.others = source->others * dest->opdata.coef;	
 }
@@ -398,19 +563,21 @@ void awcet_boolmult(evalctx_t* ctx, formula_t* source, awcet_t* dest){
 	int result = check_condition(ctx, cdts, condition_size);
 	// if condition is true then WCET of formula
 	if(result == 1){
-		formula_t fchild = source->children[1];
-		compute_node(ctx, &fchild);
-		// copy child formula WCET
-		dest->eta_count = fchild.aw.eta_count;
-		dest->eta = fchild.aw.eta;
-		dest->others = fchild.aw.others;
-		dest->loop_id = fchild.aw.loop_id;
+		formula_t *fchild = &source->children[1];
+		compute_node(ctx, fchild);
+		// share the child formula WCET, a BOOLMULT owns no buffer
+		dest->eta_count = fchild->aw.eta_count;
+		dest->eta = fchild->aw.eta;
+		dest->eta_mult = fchild->aw.eta_mult;
+		dest->others = fchild->aw.others;
+		dest->loop_id = fchild->aw.loop_id;
 	}
 	// else theta
 	else{
 		// bot WCET == {0}
 		dest->eta_count = 0;
 		dest->eta = NULL;
+		dest->eta_mult = NULL;
 		dest->others = 0;
 		dest->loop_id = LOOP_TOP;
 	}
@@ -418,7 +585,7 @@ void awcet_boolmult(evalctx_t* ctx, formula_t* source, awcet_t* dest){
 
 void awcet_ann(evalctx_t * ctx, awcet_t * source, formula_t * dest)
 {
-	int i;
+	int i, n, left;
 	int inner_ann_takeover = 0;
 	param_value_t pv;
 	annotation_t *ann;
@@ -438,7 +605,7 @@ void awcet_ann(evalctx_t * ctx, awcet_t * source, formula_t * dest)
 	if ((source->eta_count != 0)
 		&& loop_inner(ctx->li, ann->loop_id, source->loop_id)) {
 		if ((ANN_CONFLICT_PRIORITY == ANN_INNER)
-			&& (ann->count < source->eta_count)) {
+			&& (ann->count < awcet_length(source))) {
 			inner_ann_takeover = 1;
 		} else {
 			memcpy(&dest->aw, source, sizeof(awcet_t));
@@ -446,14 +613,15 @@ void awcet_ann(evalctx_t * ctx, awcet_t * source, formula_t * dest)
 		}
 	}
 
-	dest->aw.eta_count = ann->count;
-	for (i = 0; i < dest->aw.eta_count; i++) {
-		if (i < source->eta_count) {
-			dest->aw.eta[i] = source->eta[i];
-		} else {
-			dest->aw.eta[i] = source->others;
-		}
+	/* the ann->count first values of source, padded with source->others */
+	left = (ann->count < eta_room(dest->eta_limit)) ? ann->count : eta_room(dest->eta_limit);
+	dest->aw.eta_count = 0;
+	for (i = 0; (left > 0) && (i < source->eta_count); i++) {
+		n = eta_run(source, i) < left ? eta_run(source, i) : left;
+		eta_push(&dest->aw, source->eta[i], n);
+		left -= n;
 	}
+	eta_push(&dest->aw, source->others, left);
 	dest->aw.others = 0;
 	if ((source->eta_count == 0) || (inner_ann_takeover == 1)) {
 		dest->aw.loop_id = ann->loop_id;
@@ -463,16 +631,27 @@ void awcet_ann(evalctx_t * ctx, awcet_t * source, formula_t * dest)
 
 int awcet_is_equal(awcet_t * s1, awcet_t * s2)
 {
-	int i;
+	int i, j, n, n1, n2;
 
-	if (s1->eta_count != s2->eta_count)
-		return 0;
 	if (s1->loop_id != s2->loop_id)
 		return 0;
-	for (i = 0; i < s1->eta_count; i++) {
-		if (s1->eta[i] != s2->eta[i])
+	/* compare the values, whatever the run-length encoding of each side */
+	i = j = 0;
+	n1 = (s1->eta_count > 0) ? eta_run(s1, 0) : 0;
+	n2 = (s2->eta_count > 0) ? eta_run(s2, 0) : 0;
+	while ((i < s1->eta_count) && (j < s2->eta_count)) {
+		if (s1->eta[i] != s2->eta[j])
 			return 0;
+		n = (n1 < n2) ? n1 : n2;
+		n1 -= n;
+		n2 -= n;
+		if ((n1 == 0) && (++i < s1->eta_count))
+			n1 = eta_run(s1, i);
+		if ((n2 == 0) && (++j < s2->eta_count))
+			n2 = eta_run(s2, j);
 	}
+	if ((i < s1->eta_count) || (j < s2->eta_count))
+		return 0;
 	return s1->others == s2->others;
 
 }
@@ -492,87 +671,1033 @@ long long evaluate(formula_t *f, loopinfo_t *li, param_valuation_t pv, bparam_va
 	}
 }
 
+/*
+ * Budget check
+ *
+ * The WCET of a node is its first value (eta[0], or others when eta is
+ * empty). With non-negative values, the WCET of a SEQ is the sum of the WCETs
+ * of its children, and the WCET of an ALT, of a loop iterated at least once,
+ * of an annotation with a non-zero count or of a positive multiple is at least
+ * the WCET of its child. Each node thus gets a threshold above which the
+ * root WCET is known to exceed the budget, and the traversal stops as soon as
+ * one is crossed.
+ */
+#define NO_BUDGET LLONG_MAX
+
+static long long awcet_first(awcet_t *aw)
+{
+	return (aw->eta_count == 0) ? aw->others : aw->eta[0];
+}
+
+/* Threshold of the next child of f, whose threshold is budget, partial being the sum of the WCETs of the previous children */
+static long long child_budget(evalctx_t * ctx, formula_t * f, long long budget, long long partial)
+{
+	param_value_t pv;
+
+	if (budget == NO_BUDGET)
+		return NO_BUDGET;
+	switch (f->kind) {
+		case KIND_SEQ:
+			return budget - partial;
+		case KIND_ALT:
+			return budget;
+		case KIND_LOOP:
+			if (f->param_id != IDENT_NONE)
+				ctx->param_valuation(f->param_id, &pv, ctx->pv_data);
+			else
+				pv.bound = loop_bound(ctx->li, f->opdata.loop_id);
+			return (pv.bound > 0) ? budget : NO_BUDGET;
+		case KIND_PARAM_LOOP:
+			return (compute_loop_bound(ctx, f->condition) > 0) ? budget : NO_BUDGET;
+		case KIND_ANN:
+			if (f->param_id != IDENT_NONE)
+				ctx->param_valuation(f->param_id, &pv, ctx->pv_data);
+			else
+				pv.ann = f->opdata.ann;
+			return (pv.ann.count != 0) ? budget : NO_BUDGET;
+		case KIND_INTMULT:
+			return (f->opdata.coef > 0) ? budget / f->opdata.coef : NO_BUDGET;
+		default:
+			return NO_BUDGET;
+	}
+}
+
+/*
+ * Returns 1 as soon as the WCET of f is known to exceed budget, 0 once f is fully computed
+ * Same traversal as compute_node(), the threshold of each node in value[0] of
+ * its frame and the partial sum of a SEQ in value[1].
+ */
+static int compute_node_budget(evalctx_t * ctx, formula_t * f, long long budget)
+{
+	walk_t w;
+	walk_frame_t *top;
+	long long first, threshold;
+	int res = 0;
+
+	walk_init(&w, f);
+	walk_top(&w)->value[0] = budget;
+	while ((top = walk_top(&w)) != NULL) {
+		if (top->next < compute_arity(top->f)) {
+			threshold = child_budget(ctx, top->f, top->value[0], top->value[1]);
+			walk_push(&w, &top->f->children[top->next++])->value[0] = threshold;
+			continue;
+		}
+		compute_combine(ctx, top->f);
+		first = awcet_first(&top->f->aw);
+		if (first > top->value[0]) {
+			res = 1;
+			break;
+		}
+		walk_pop(&w);
+		top = walk_top(&w);
+		if ((top != NULL) && (top->f->kind == KIND_SEQ)) {
+			top->value[1] += first;
+			if (top->value[1] > top->value[0]) {
+				res = 1;
+				break;
+			}
+		}
+	}
+	walk_release(&w);
+	return res;
+}
+
+int wcet_exceeds(formula_t *f, loopinfo_t *li, param_valuation_t pv, bparam_valuation_t bpv, void *data, long long budget)
+{
+	evalctx_t ctx;
+	ctx.li = li;
+	ctx.param_valuation = pv;
+	ctx.bparam_valuation = bpv;
+	ctx.pv_data = data;
+	return compute_node_budget(&ctx, f, budget);
+}
+
 void compute_eta_count(formula_t *f) {
-	switch(f->kind) {
+	walk_t w;
+	walk_frame_t *top;
+	formula_t *n;
+	int i;
+	walk_init(&w, f);
+	while ((top = walk_top(&w)) != NULL) {
+		n = top->f;
+		if (top->next < compute_arity(n)) {
+			walk_push(&w, &n->children[top->next++]);
+			continue;
+		}
+		switch(n->kind) {
+			case KIND_INTMULT:
+			case KIND_LOOP:
+				n->aw.eta_count = n->children[0].aw.eta_count;
+				break;
+			case KIND_ANN:
+				n->aw.eta_count = n->opdata.ann.count;
+				break;
+			case KIND_ALT:
+				n->aw.eta_count = 0;
+				for (i = 0; i < n->opdata.children_count; i++)
+					n->aw.eta_count += n->children[i].aw.eta_count;
+				break;
+			case KIND_SEQ:
+				n->aw.eta_count = 0;
+				for (i = 0; i < n->opdata.children_count; i++) {
+					if (n->aw.eta_count < n->children[i].aw.eta_count)
+						n->aw.eta_count = n->children[i].aw.eta_count;
+				}
+				break;
+			case KIND_CONST:
+				break;
+			default:
+				printf("error : unrecognized formula kind (compute_eta_count) : %d\n", n->kind);
+		}
+		walk_pop(&w);
+	}
+	walk_release(&w);
+}
+
+/*
+ * Eta demand
+ *
+ * Consumers only look at a prefix of the eta values of their children: the
+ * root only needs eta[0], a loop iterated bound times on the same loop sums
+ * bound values, and bound * n values give n groups otherwise. Operators stop
+ * once they have produced the prefix their parent can observe.
+ */
+#define DEMAND_ALL INT_MAX
+
+/* eta_limit of the children of f, that of f being set */
+static int eta_demand(formula_t *f, loopinfo_t *li)
+{
+	long long d = DEMAND_ALL;
+	int demand = (f->eta_limit > 0) ? f->eta_limit : DEMAND_ALL;
+	switch (f->kind) {
+		case KIND_SEQ:
+		case KIND_ALT:
 		case KIND_INTMULT:
-			compute_eta_count(f->children);
-			f->aw.eta_count = f->children[0].aw.eta_count;
+		case KIND_BOOLMULT:
+			d = demand;
+			break;
+		case KIND_LOOP:
+			if ((f->param_id == IDENT_NONE) && (li != NULL) && (demand != DEMAND_ALL)) {
+				/* the same loop needs bound values, an outer one bound values per group */
+				d = (long long) loop_bound(li, f->opdata.loop_id) * (demand > 1 ? demand : 1);
+				if ((d <= 0) || (d >= DEMAND_ALL))
+					d = DEMAND_ALL;
+			}
 			break;
 		case KIND_ANN:
-			compute_eta_count(f->children);
-			f->aw.eta_count = f->opdata.ann.count;
+			/* awcet_ann() compares the annotation count with the length of its source */
+			if ((f->param_id == IDENT_NONE) && (demand != DEMAND_ALL)) {
+				d = (f->opdata.ann.count >= demand) ? (long long) f->opdata.ann.count + 1 : demand;
+				if (d >= DEMAND_ALL)
+					d = DEMAND_ALL;
+			}
+			break;
+		default:
 			break;
+	}
+	return (d == DEMAND_ALL) ? 0 : (int) d;
+}
+
+void compute_eta_demand(formula_t *f, loopinfo_t *li)
+{
+	walk_t w;
+	walk_frame_t *top;
+	formula_t *child;
+	f->eta_limit = 1;
+	walk_init(&w, f);
+	while ((top = walk_top(&w)) != NULL) {
+		if (top->next < formula_child_count(top->f)) {
+			child = &top->f->children[top->next++];
+			/* the condition of a BOOLMULT has no abstract WCET */
+			if ((top->f->kind == KIND_BOOLMULT) && (child == top->f->children))
+				continue;
+			child->eta_limit = eta_demand(top->f, li);
+			walk_push(&w, child);
+			continue;
+		}
+		walk_pop(&w);
+	}
+	walk_release(&w);
+}
+
+int formula_child_count(formula_t *f)
+{
+	switch (f->kind) {
+		case KIND_ALT:
+		case KIND_SEQ:
+			return f->opdata.children_count;
 		case KIND_LOOP:
-			{
-				compute_eta_count(f->children);
-				f->aw.eta_count = f->children[0].aw.eta_count;
+		case KIND_ANN:
+		case KIND_INTMULT:
+		case KIND_PARAM_LOOP:
+			return 1;
+		case KIND_BOOLMULT:
+			return 2;
+		default:
+			return 0;
+	}
+}
+
+static int formula_condition_count(formula_t *f)
+{
+	if (f->condition == NULL)
+		return 0;
+	if (f->kind == BOOL_CONDITIONS)
+		return f->opdata.children_count;
+	return 1;
+}
+
+/* Blocks carved by formula_clone() keep the alignment of pointers and long long */
+#define CLONE_ALIGN(n) (((n) + sizeof(long long) - 1) & ~(sizeof(long long) - 1))
+
+/*
+ * Buffers allocated by the evaluation (parametric loops) are not copied: the
+ * copy allocates its own when it is evaluated
+ */
+static int clone_eta(formula_t *f)
+{
+	return f->eta_capacity == 0;
+}
+
+/* Drop the buffers of src that clone_eta() does not copy */
+static void clone_drop_eta(formula_t *dest, formula_t *src)
+{
+	if (clone_eta(src))
+		return;
+	dest->aw.eta = NULL;
+	dest->aw.eta_mult = NULL;
+	dest->aw.eta_count = 0;
+	dest->eta_capacity = 0;
+}
+
+/* A node passing the buffers of its child through (BOOLMULT, ANN) does not own them */
+static int formula_shares_eta(formula_t *f)
+{
+	int n = formula_child_count(f);
+	return (n > 0) && (f->aw.eta != NULL) && (f->aw.eta == f->children[n - 1].aw.eta);
+}
+
+/**
+ * Release the memory owned by a formula built node by node, as done by dumpcft
+ * Every children array, eta buffer, eta_mult buffer, condition array and term
+ * array of the subtree is released with free(); f itself is not, so that it
+ * can live on the stack or in an array of children. The formula may have been
+ * evaluated: buffers shared by a node with its child are released once.
+ * Formulas from formula_clone() or formula_layout() are single blocks, released
+ * with free() instead.
+ * @param f the formula to release
+ */
+void formula_free(formula_t *f)
+{
+	walk_t w;
+	walk_frame_t *top;
+	formula_t *n;
+	int i;
+	walk_init(&w, f);
+	while ((top = walk_top(&w)) != NULL) {
+		n = top->f;
+		if ((top->next == 0) && formula_shares_eta(n)) {
+			n->aw.eta = NULL;
+			n->aw.eta_mult = NULL;
+		}
+		if (top->next < formula_child_count(n)) {
+			walk_push(&w, &n->children[top->next++]);
+			continue;
+		}
+		for (i = 0; i < formula_condition_count(n); i++)
+			free(n->condition[i].terms);
+		free(n->children);
+		free(n->condition);
+		free(n->aw.eta);
+		free(n->aw.eta_mult);
+		n->children = NULL;
+		n->condition = NULL;
+		n->aw.eta = NULL;
+		n->aw.eta_mult = NULL;
+		n->aw.eta_count = 0;
+		walk_pop(&w);
+	}
+	walk_release(&w);
+}
+
+/**
+ * Release the eta buffers allocated by the evaluation of f (parametric loops)
+ * f stays usable. Evaluated copies from formula_clone() or formula_layout()
+ * need it before being released with free().
+ * @param f the formula
+ */
+void formula_release_buffers(formula_t *f)
+{
+	walk_t w;
+	walk_frame_t *top;
+	formula_t *n;
+	walk_init(&w, f);
+	while ((top = walk_top(&w)) != NULL) {
+		n = top->f;
+		if ((top->next == 0) && (n->eta_capacity > 0)) {
+			free(n->aw.eta);
+			free(n->aw.eta_mult);
+			n->aw.eta = NULL;
+			n->aw.eta_mult = NULL;
+			n->aw.eta_count = 0;
+			n->eta_capacity = 0;
+		}
+		if (top->next < formula_child_count(n))
+			walk_push(&w, &n->children[top->next++]);
+		else
+			walk_pop(&w);
+	}
+	walk_release(&w);
+}
+
+/*
+ * Hot/cold layout
+ *
+ * The subtree guarded by a BOOLMULT is only evaluated when its condition
+ * holds, which for procedure arguments is often rare. formula_layout() copies
+ * a formula into a single block like formula_clone(), but the nodes that are
+ * evaluated often come first and contiguously, in pre-order, and the data of
+ * the other nodes (children, eta buffers and conditions) is moved after them.
+ * Nodes are hot either by structure (not guarded by any BOOLMULT) or from a
+ * profile recorded by formula_profile(). The structures of the children of a
+ * node stay in one array, placed with their parent.
+ */
+#define LAYOUT_HOT 0
+#define LAYOUT_COLD 1
+
+struct layout_s {
+	char *base[2];				/* NULL while measuring */
+	size_t used[2];
+	const unsigned *hits;			/* NULL for the static layout */
+	unsigned min_hits;
+	int split;				/* without hits, the subtrees guarded by BOOLMULT nodes are cold */
+	int node;				/* pre-order index of the next node */
+};
+typedef struct layout_s layout_t;
+
+static void *layout_alloc(layout_t *l, int region, size_t size)
+{
+	void *p = (l->base[region] != NULL) ? l->base[region] + l->used[region] : NULL;
+	l->used[region] += size;
+	return p;
+}
+
+/* Copy src into dest (NULL while measuring), the data of src going to its region, returns whether src is hot */
+static int layout_node(layout_t *l, formula_t *dest, formula_t *src, int hot)
+{
+	int i, n, region;
+	int id = l->node++;
+	formula_t *children;
+	condition_t *cdts;
+	void *p;
+
+	if ((l->hits != NULL) && (l->hits[id] < l->min_hits))
+		hot = 0;
+	region = hot ? LAYOUT_HOT : LAYOUT_COLD;
+	if (dest != NULL) {
+		memcpy(dest, src, sizeof(formula_t));
+		clone_drop_eta(dest, src);
+	}
+	if (clone_eta(src) && (src->aw.eta != NULL)) {
+		p = layout_alloc(l, region, CLONE_ALIGN(sizeof(awcet_value_t) * src->aw.eta_count));
+		if (dest != NULL) {
+			dest->aw.eta = (awcet_value_t *) p;
+			memcpy(dest->aw.eta, src->aw.eta, sizeof(awcet_value_t) * src->aw.eta_count);
+		}
+	}
+	if (clone_eta(src) && (src->aw.eta_mult != NULL)) {
+		p = layout_alloc(l, region, CLONE_ALIGN(sizeof(int) * src->aw.eta_count));
+		if (dest != NULL) {
+			dest->aw.eta_mult = (int *) p;
+			memcpy(dest->aw.eta_mult, src->aw.eta_mult, sizeof(int) * src->aw.eta_count);
+		}
+	}
+	n = formula_condition_count(src);
+	if (n > 0) {
+		cdts = (condition_t *) layout_alloc(l, region, sizeof(condition_t) * n);
+		if (dest != NULL)
+			dest->condition = cdts;
+		for (i = 0; i < n; i++) {
+			p = layout_alloc(l, region, CLONE_ALIGN(sizeof(term_t) * src->condition[i].terms_number));
+			if (dest != NULL) {
+				cdts[i] = src->condition[i];
+				cdts[i].terms = (term_t *) p;
+				memcpy(p, src->condition[i].terms, sizeof(term_t) * src->condition[i].terms_number);
 			}
+		}
+	}
+	n = formula_child_count(src);
+	if (n > 0) {
+		children = (formula_t *) layout_alloc(l, region, sizeof(formula_t) * n);
+		if (dest != NULL)
+			dest->children = children;
+	}
+	return hot;
+}
+
+/* Copy the subtree src into dest (NULL while measuring), in pre-order; frames hold the copy of their node in data, whether it is hot in flags */
+static void layout_walk(layout_t *l, formula_t *dest, formula_t *src)
+{
+	walk_t w;
+	walk_frame_t *top;
+	formula_t *d, *s;
+	int i, hot;
+
+	walk_init(&w, src);
+	walk_top(&w)->data = dest;
+	walk_top(&w)->flags = 1;
+	while ((top = walk_top(&w)) != NULL) {
+		s = top->f;
+		d = (formula_t *) top->data;
+		if (top->next == 0)
+			top->flags = layout_node(l, d, s, top->flags);
+		if (top->next == formula_child_count(s)) {
+			walk_pop(&w);
+			continue;
+		}
+		i = top->next++;
+		hot = top->flags && (!l->split || (l->hits != NULL) || (s->kind != KIND_BOOLMULT) || (i == 0));
+		top = walk_push(&w, &s->children[i]);
+		top->data = (d != NULL) ? &d->children[i] : NULL;
+		top->flags = hot;
+	}
+	walk_release(&w);
+}
+
+static formula_t *layout_copy(layout_t *l, formula_t *f)
+{
+	formula_t *res;
+
+	l->used[LAYOUT_HOT] = sizeof(formula_t);
+	layout_walk(l, NULL, f);
+	res = (formula_t *) malloc(l->used[LAYOUT_HOT] + l->used[LAYOUT_COLD]);
+	if (res == NULL)
+		return NULL;
+	l->base[LAYOUT_HOT] = (char *) res;
+	l->base[LAYOUT_COLD] = (char *) res + l->used[LAYOUT_HOT];
+	l->used[LAYOUT_HOT] = sizeof(formula_t);
+	l->used[LAYOUT_COLD] = 0;
+	l->node = 0;
+	layout_walk(l, res, f);
+	return res;
+}
+
+formula_t *formula_layout(formula_t *f, const unsigned *hits, unsigned min_hits)
+{
+	layout_t l = { { NULL, NULL }, { 0, 0 }, hits, min_hits, 1, 0 };
+	return layout_copy(&l, f);
+}
+
+/**
+ * Deep copy of a formula into a single memory block
+ * The copy owns its own eta buffers, so it can be evaluated independently from the original.
+ * Buffers are sized by the current eta_count: f should not have been evaluated yet.
+ * @param f the formula to copy
+ * @return the copy, to be released with free(), after formula_release_buffers()
+ * if it has been evaluated
+ */
+formula_t *formula_clone(formula_t *f)
+{
+	/* a single hot region */
+	layout_t l = { { NULL, NULL }, { 0, 0 }, NULL, 0, 0, 0 };
+	return layout_copy(&l, f);
+}
+
+int formula_node_count(formula_t *f)
+{
+	walk_t w;
+	walk_frame_t *top;
+	int n = 1;
+	walk_init(&w, f);
+	while ((top = walk_top(&w)) != NULL) {
+		if (top->next < formula_child_count(top->f)) {
+			walk_push(&w, &top->f->children[top->next++]);
+			n++;
+		} else
+			walk_pop(&w);
+	}
+	walk_release(&w);
+	return n;
+}
+
+void formula_profile(formula_t *f, loopinfo_t *li, param_valuation_t pv, bparam_valuation_t bpv, void *data, unsigned *hits)
+{
+	evalctx_t ctx;
+	walk_t w;
+	walk_frame_t *top;
+	formula_t *n;
+	int visited, node = 0;
+	ctx.li = li;
+	ctx.param_valuation = pv;
+	ctx.bparam_valuation = bpv;
+	ctx.pv_data = data;
+	/* flags tells whether the node is evaluated, the children of a BOOLMULT after its condition */
+	walk_init(&w, f);
+	walk_top(&w)->flags = 1;
+	while ((top = walk_top(&w)) != NULL) {
+		n = top->f;
+		if (top->next == 0)
+			hits[node++] += top->flags;
+		if (top->next == formula_child_count(n)) {
+			walk_pop(&w);
+			continue;
+		}
+		visited = top->flags;
+		if ((n->kind == KIND_BOOLMULT) && (top->next == 1) && visited)
+			visited = check_condition(&ctx, n->children[0].condition, n->children[0].opdata.children_count);
+		walk_push(&w, &n->children[top->next++])->flags = visited;
+	}
+	walk_release(&w);
+}
+
+/*
+ * Value ranges, ALT pruning and overflow checks
+ *
+ * awcet_alt() merges the eta values of its children that exceed the greatest
+ * others, so a child whose values can never exceed the others of a sibling
+ * contributes nothing. Value ranges are computed bottom-up and hold for every
+ * parameter value: parameters, unknown loop bounds and boolean conditions
+ * only widen them. Ranges saturate at RANGE_INF, which stands for values that
+ * may not fit in 64 bits.
+ */
+#define RANGE_INF LLONG_MAX
+#define LOOP_UNKNOWN -2
+
+struct value_range_s {
+	long long lo;				/* lower bound of every eta value and of others */
+	long long hi;				/* upper bound of every eta value and of others */
+	int loop_id;				/* loop_id of the result, LOOP_UNKNOWN if it depends on parameters */
+};
+typedef struct value_range_s value_range_t;
+
+struct range_ctx_s {
+	long long *bounds;			/* loop bounds indexed by loop identifiers, or NULL */
+	loopinfo_t *li;				/* loop bounds when bounds is NULL, may be NULL */
+	long long max_param;			/* greatest parameter value, negative if unknown */
+	int prune;				/* remove the useless ALT children */
+	void (*release)(formula_t *, void *);	/* releases a removed child, NULL if not owned */
+	void *release_data;			/* last argument of release */
+	long long lo;				/* lowest value of every node */
+	long long hi;				/* greatest value of every node */
+};
+typedef struct range_ctx_s range_ctx_t;
+
+static long long range_add(long long a, long long b)
+{
+	if ((a == RANGE_INF) || (b == RANGE_INF))
+		return RANGE_INF;
+	if ((a == -RANGE_INF) || (b == -RANGE_INF))
+		return -RANGE_INF;
+	if ((b > 0) && (a > RANGE_INF - b))
+		return RANGE_INF;
+	if ((b < 0) && (a < -RANGE_INF - b))
+		return -RANGE_INF;
+	return a + b;
+}
+
+/* k >= 0 */
+static long long range_mul(long long a, long long k)
+{
+	if ((a == 0) || (k == 0))
+		return 0;
+	if ((a == RANGE_INF) || (a == -RANGE_INF) || (k == RANGE_INF) || ((a > 0 ? a : -a) > RANGE_INF / k))
+		return (a > 0) ? RANGE_INF : -RANGE_INF;
+	return a * k;
+}
+
+/* Upper bound of a loop bound, exact is set if it is the bound itself, -1 if unknown */
+static long long range_loop_bound(range_ctx_t *ctx, formula_t *f, int *exact)
+{
+	long long bound = 0;
+	int i;
+
+	*exact = 0;
+	if (f->kind == KIND_PARAM_LOOP) {
+		if (f->condition == NULL)
+			return -1;
+		/* compute_loop_bound() with the greatest value of every parameter */
+		for (i = 0; i < f->condition->terms_number; i++) {
+			term_t *term = f->condition->terms + i;
+			if (term->coef <= 0)
+				continue;
+			if (term->kind != BOOL_PARAM)
+				bound = range_add(bound, range_mul(term->value > 0 ? term->value : 0, term->coef));
+			else if (ctx->max_param >= 0)
+				bound = range_add(bound, range_mul(ctx->max_param, term->coef));
+			else
+				return -1;
+		}
+		return bound;
+	}
+	/* bool_expr holds the bound expression of parametric loops built by dumpcft */
+	if ((f->param_id == IDENT_NONE) && ((f->bool_expr[0] == 0) || (strcmp(f->bool_expr, "-1") == 0))) {
+		if (ctx->bounds != NULL)
+			bound = ctx->bounds[f->opdata.loop_id];
+		else if (ctx->li != NULL)
+			bound = loop_bound(ctx->li, f->opdata.loop_id);
+		else
+			bound = -1;
+		*exact = (bound >= 0);
+		return bound;
+	}
+	return ctx->max_param;
+}
+
+/* Common loop_id of SEQ and ALT results, LOOP_TOP children never win */
+static int range_common_loop(int acc, int loop_id)
+{
+	if ((acc == LOOP_UNKNOWN) || (loop_id == LOOP_UNKNOWN))
+		return LOOP_UNKNOWN;
+	if (loop_id == LOOP_TOP)
+		return acc;
+	if ((acc == LOOP_TOP) || (acc == loop_id))
+		return loop_id;
+	return LOOP_UNKNOWN;		/* depends on the loop hierarchy */
+}
+
+/* Number of children whose ranges give that of f */
+static int range_arity(formula_t *f)
+{
+	switch (f->kind) {
+		case KIND_SEQ:
+		case KIND_ALT:
+			return f->opdata.children_count;
+		case KIND_LOOP:
+		case KIND_PARAM_LOOP:
+		case KIND_ANN:
+		case KIND_INTMULT:
+		case KIND_BOOLMULT:
+			return 1;
+		default:
+			return 0;
+	}
+}
+
+/* i-th of these children, a BOOLMULT only depends on its guarded child */
+static formula_t *range_child(formula_t *f, int i)
+{
+	return (f->kind == KIND_BOOLMULT) ? &f->children[1] : &f->children[i];
+}
+
+/* Range of f from the ranges crs of its range_arity(f) children, returns the number of removed children */
+static int range_node(formula_t *f, range_ctx_t *ctx, value_range_t *crs, value_range_t *r)
+{
+	long long bound;
+	int i, j, n, common, exact, pruned = 0;
+
+	switch (f->kind) {
+		case KIND_CONST:
+			r->lo = r->hi = f->aw.others;
+			for (i = 0; i < f->aw.eta_count; i++) {
+				if (f->aw.eta[i] < r->lo)
+					r->lo = f->aw.eta[i];
+				if (f->aw.eta[i] > r->hi)
+					r->hi = f->aw.eta[i];
+			}
+			r->loop_id = f->aw.loop_id;
 			break;
+		case KIND_SEQ:
 		case KIND_ALT:
-			{
-				f->aw.eta_count = 0;
-				for (int i = 0; i < f->opdata.children_count; i++) {
-					compute_eta_count(f->children + i);
-					f->aw.eta_count += f->children[i].aw.eta_count;
+			n = f->opdata.children_count;
+			common = LOOP_TOP;
+			for (i = 0; i < n; i++)
+				common = range_common_loop(common, crs[i].loop_id);
+			if ((f->kind == KIND_ALT) && ctx->prune) {
+				/* removing a child must not change the loop_id of the result either */
+				for (i = 0; (n > 1) && (i < n); i++) {
+					if (crs[i].loop_id != LOOP_TOP) {
+						if (common == LOOP_UNKNOWN)
+							continue;
+						for (j = 0; j < n; j++) {
+							if ((j != i) && (crs[j].loop_id == crs[i].loop_id))
+								break;
+						}
+						if (j == n)
+							continue;
+					}
+					for (j = 0; j < n; j++) {
+						if ((j != i) && (crs[j].lo >= crs[i].hi))
+							break;
+					}
+					if (j == n)
+						continue;
+					if (ctx->release != NULL)
+						ctx->release(&f->children[i], ctx->release_data);
+					memmove(&f->children[i], &f->children[i + 1], sizeof(formula_t) * (n - i - 1));
+					memmove(&crs[i], &crs[i + 1], sizeof(value_range_t) * (n - i - 1));
+					n--;
+					i--;
+					pruned++;
 				}
+				f->opdata.children_count = n;
 			}
+			r->lo = (f->kind == KIND_SEQ) ? 0 : -RANGE_INF;
+			r->hi = 0;
+			for (i = 0; i < n; i++) {
+				if (f->kind == KIND_SEQ) {
+					r->lo = range_add(r->lo, crs[i].lo);
+					r->hi = range_add(r->hi, crs[i].hi);
+				} else {
+					if (crs[i].lo > r->lo)
+						r->lo = crs[i].lo;
+					if (crs[i].hi > r->hi)
+						r->hi = crs[i].hi;
+				}
+			}
+			if (r->lo == -RANGE_INF)
+				r->lo = -1;		/* empty ALT, others is -1 */
+			r->loop_id = common;
 			break;
-		case KIND_SEQ:
-			{
-				f->aw.eta_count = 0;
-				for (int i = 0; i < f->opdata.children_count; i++) {
-					compute_eta_count(f->children + i);
-					if (f->aw.eta_count < f->children[i].aw.eta_count)
-						f->aw.eta_count = f->children[i].aw.eta_count;
+		case KIND_LOOP:
+		case KIND_PARAM_LOOP:
+			bound = range_loop_bound(ctx, f, &exact);
+			if (bound >= 0) {
+				r->lo = range_mul(crs[0].lo, bound);
+				r->hi = range_mul(crs[0].hi, bound);
+				if (!exact) {
+					/* the loop may not iterate at all */
+					r->lo = (r->lo < 0) ? r->lo : 0;
+					r->hi = (r->hi > 0) ? r->hi : 0;
 				}
+			} else {
+				r->lo = (crs[0].lo < 0) ? -RANGE_INF : 0;
+				r->hi = (crs[0].hi <= 0) ? 0 : RANGE_INF;
 			}
+			if ((exact && (bound == 0)) || (crs[0].loop_id == f->opdata.loop_id))
+				r->loop_id = LOOP_TOP;
+			else if (exact && (bound > 0))
+				r->loop_id = crs[0].loop_id;
+			else
+				r->loop_id = LOOP_UNKNOWN;
 			break;
-		case KIND_CONST:
+		case KIND_ANN:
+			/* annotated values are copies of the child values, others becomes 0 */
+			r->lo = (crs[0].lo < 0) ? crs[0].lo : 0;
+			r->hi = crs[0].hi;
+			if ((f->param_id == IDENT_NONE) && (crs[0].loop_id == f->opdata.ann.loop_id))
+				r->loop_id = crs[0].loop_id;
+			else
+				r->loop_id = LOOP_UNKNOWN;
+			break;
+		case KIND_INTMULT:
+			if (f->opdata.coef >= 0) {
+				r->lo = range_mul(crs[0].lo, f->opdata.coef);
+				r->hi = range_mul(crs[0].hi, f->opdata.coef);
+			} else {
+				r->lo = -RANGE_INF;
+				r->hi = RANGE_INF;
+			}
+			r->loop_id = LOOP_UNKNOWN;	/* awcet_intmult() keeps the placeholder loop_id */
+			break;
+		case KIND_BOOLMULT:
+			/* either the child or the bottom WCET */
+			r->lo = (crs[0].lo < 0) ? crs[0].lo : 0;
+			r->hi = (crs[0].hi > 0) ? crs[0].hi : 0;
+			r->loop_id = (crs[0].loop_id == LOOP_TOP) ? LOOP_TOP : LOOP_UNKNOWN;
 			break;
 		default:
-			printf("error : unrecognized formula kind (compute_eta_count) : %d\n", f->kind);
+			/* KIND_AWCET and anything unknown */
+			r->lo = 0;
+			r->hi = ((f->kind == KIND_AWCET) && (ctx->max_param >= 0)) ? ctx->max_param : RANGE_INF;
+			r->loop_id = LOOP_UNKNOWN;
+			break;
 	}
+	if (r->lo < ctx->lo)
+		ctx->lo = r->lo;
+	if (r->hi > ctx->hi)
+		ctx->hi = r->hi;
+	return pruned;
 }
 
-void writePWF(formula_t *f, FILE *out, long long *bounds) { 
+/*
+ * Nodes sharing their children array are copies of one node, as the calls of
+ * a callee shared by dumpcft: the range of the first copy is kept in a hash
+ * table keyed by the children array, so that a shared subtree is visited,
+ * and pruned, once.
+ */
+struct range_memo_s {
+	formula_t **keys;			/* children arrays, NULL for free slots */
+	value_range_t *ranges;
+	int size;				/* power of 2 */
+	int count;
+};
+typedef struct range_memo_s range_memo_t;
+
+static int memo_slot(range_memo_t *m, formula_t *key)
+{
+	size_t h = ((size_t) key >> 4) * 0x9e3779b9u;
+	int i = (int) (h & (m->size - 1));
+	while ((m->keys[i] != NULL) && (m->keys[i] != key))
+		i = (i + 1) & (m->size - 1);
+	return i;
+}
+
+static value_range_t *memo_find(range_memo_t *m, formula_t *key)
+{
+	int i;
+	if (m->size == 0)
+		return NULL;
+	i = memo_slot(m, key);
+	return (m->keys[i] != NULL) ? &m->ranges[i] : NULL;
+}
+
+static void memo_add(range_memo_t *m, formula_t *key, value_range_t *r)
+{
+	range_memo_t grown;
+	int i;
+
+	if (2 * (m->count + 1) > m->size) {
+		grown.size = (m->size > 0) ? 2 * m->size : 64;
+		grown.count = 0;
+		grown.keys = (formula_t **) calloc(grown.size, sizeof(formula_t *));
+		grown.ranges = (value_range_t *) malloc(sizeof(value_range_t) * grown.size);
+		if ((grown.keys == NULL) || (grown.ranges == NULL)) {
+			fprintf(stderr, "formula ranges: out of memory\n");
+			abort();
+		}
+		for (i = 0; i < m->size; i++)
+			if (m->keys[i] != NULL)
+				memo_add(&grown, m->keys[i], &m->ranges[i]);
+		free(m->keys);
+		free(m->ranges);
+		*m = grown;
+	}
+	i = memo_slot(m, key);
+	m->count += (m->keys[i] == NULL);
+	m->keys[i] = key;
+	m->ranges[i] = *r;
+}
+
+/*
+ * Ranges are computed bottom-up with an explicit stack: the ranges of the
+ * children of a node are on top of the range stack when its frame is done
+ */
+static int prune_walk(formula_t *f, range_ctx_t *ctx, value_range_t *res)
+{
+	walk_t w;
+	walk_frame_t *top;
+	range_memo_t memo = { NULL, NULL, 0, 0 };
+	value_range_t r, *stack, *known, local[WALK_FRAMES];
+	int n, size = 0, capacity = WALK_FRAMES, pruned = 0;
+
+	stack = local;
+	walk_init(&w, f);
+	while ((top = walk_top(&w)) != NULL) {
+		known = NULL;
+		if ((top->next == 0) && (top->f->children != NULL))
+			known = memo_find(&memo, top->f->children);
+		if (known != NULL)
+			r = *known;
+		else if (top->next < range_arity(top->f)) {
+			walk_push(&w, range_child(top->f, top->next++));
+			continue;
+		} else {
+			n = range_arity(top->f);
+			pruned += range_node(top->f, ctx, stack + size - n, &r);
+			size -= n;
+			if (top->f->children != NULL)
+				memo_add(&memo, top->f->children, &r);
+		}
+		if (size == capacity) {
+			value_range_t *grown = (value_range_t *) malloc(sizeof(value_range_t) * capacity * 2);
+			if (grown == NULL) {
+				fprintf(stderr, "formula ranges: out of memory\n");
+				abort();
+			}
+			memcpy(grown, stack, sizeof(value_range_t) * size);
+			if (stack != local)
+				free(stack);
+			stack = grown;
+			capacity *= 2;
+		}
+		stack[size++] = r;
+		walk_pop(&w);
+	}
+	walk_release(&w);
+	*res = stack[0];
+	if (stack != local)
+		free(stack);
+	free(memo.keys);
+	free(memo.ranges);
+	return pruned;
+}
+
+/**
+ * Remove the children of ALT nodes that can never contribute to the result
+ * Nodes sharing their children array are pruned once (see range_memo_t).
+ * @param bounds loop bounds indexed by loop identifiers (negative if unknown), may be NULL
+ * @param release called on each removed child, with data, before it is dropped,
+ * NULL if the children are not owned by f
+ * @return the number of removed children
+ */
+int formula_prune_alt(formula_t *f, long long *bounds, void (*release)(formula_t *, void *), void *data)
+{
+	value_range_t r;
+	range_ctx_t ctx = { bounds, NULL, -1, 1, release, data, 0, 0 };
+	return prune_walk(f, &ctx, &r);
+}
+
+/**
+ * Compute the lowest and greatest values of every node of f
+ * @param bounds loop bounds indexed by loop identifiers (negative if unknown), may be NULL
+ * @param max_param greatest value of the parameters, negative if unknown
+ * @return 1 if both values fit in 64 bits, 0 otherwise
+ */
+int formula_value_range(formula_t *f, long long *bounds, long long max_param, long long *lo, long long *hi)
+{
+	value_range_t r;
+	range_ctx_t ctx = { bounds, NULL, max_param, 0, NULL, NULL, 0, 0 };
+	prune_walk(f, &ctx, &r);
+	*lo = ctx.lo;
+	*hi = ctx.hi;
+	return (ctx.lo != -RANGE_INF) && (ctx.hi != RANGE_INF);
+}
+
+int formula_check_range(formula_t *f, loopinfo_t *li, long long max_param)
+{
+	value_range_t r;
+	range_ctx_t ctx = { NULL, li, max_param, 0, NULL, NULL, 0, 0 };
+	prune_walk(f, &ctx, &r);
+	return (ctx.lo != -RANGE_INF) && (ctx.hi != RANGE_INF)
+		&& (ctx.lo >= AWCET_VALUE_MIN) && (ctx.hi <= AWCET_VALUE_MAX);
+}
+
+/* Number of children of f written by writePWF() */
+static int pwf_arity(formula_t *f)
+{
+	switch (f->kind) {
+		case KIND_SEQ:
+		case KIND_ALT:
+			return f->opdata.children_count;
+		case KIND_LOOP:
+		case KIND_ANN:
+			return 1;
+		case KIND_BOOLMULT:
+			return 2;
+		default:
+			return 0;
+	}
+}
+
+/* Text of f written before its children */
+static void pwf_open(formula_t *f, FILE *out)
+{
 	switch (f->kind) {
 		case KIND_CONST:
 			fprintf(out, "(l:%d;{", f->aw.loop_id < 0 ? 0 : f->aw.loop_id);
 			for (int i = 0; i < f->aw.eta_count; i++) {
-				fprintf(out, "%lld", f->aw.eta[i]);
+				fprintf(out, "%lld", (long long) f->aw.eta[i]);
 				fprintf(out, ",");
 			}
-			fprintf(out, "%lld", f->aw.others);
+			fprintf(out, "%lld", (long long) f->aw.others);
 			fprintf(out, "}) ");
 			break;
 		case KIND_AWCET:
 			fprintf(out, "p:%d", f->param_id);
 			break;
 		case KIND_SEQ:
+		case KIND_ALT:
+		case KIND_LOOP:
+		case KIND_ANN:
+		case KIND_BOOLMULT:
 			fprintf(out, "(");
-			for (int i = 0; i < f->opdata.children_count; i++) {
-				if (i > 0) fprintf(out, " + ");
-				writePWF(f->children + i, out, bounds);
-				
-			}
-			if (f->opdata.children_count == 0)
-				fprintf(out, "__top;{0}");
-			fprintf(out, ")");
+			break;
+		case KIND_STR:
+			fprintf(out, "(%s)",f->bool_expr);
+			break;
+		default:
+			printf("error : unrecognized formula kind (writePWF) : %d\n", f->kind);
+	}
+}
+
+/* Text of f written between its children i - 1 and i */
+static void pwf_separate(formula_t *f, FILE *out)
+{
+	switch (f->kind) {
+		case KIND_SEQ:
+			fprintf(out, " + ");
 			break;
 		case KIND_ALT:
-			fprintf(out, "(");
-			for (int i = 0; i < f->opdata.children_count; i++) {
-				if (i > 0) fprintf(out, " U ");
-				writePWF(f->children + i, out, bounds);
-			}
+			fprintf(out, " U ");
+			break;
+		case KIND_BOOLMULT:
+			fprintf(out, " * ");
+			break;
+	}
+}
+
+/* Text of f written after its children */
+static void pwf_close(formula_t *f, FILE *out, long long *bounds)
+{
+	switch (f->kind) {
+		case KIND_SEQ:
+		case KIND_ALT:
 			if (f->opdata.children_count == 0)
 				fprintf(out, "__top;{0}");
 			fprintf(out, ")");
 			break;
 		case KIND_LOOP:
 			{
-				fprintf(out, "(");
-				writePWF(f->children, out, bounds);
 				long long bound = bounds[f->opdata.loop_id];
 				if (bound < 0) {
 					fprintf(stderr, "warning: loop %d is unbounded\n", f->opdata.loop_id);
@@ -590,41 +1715,50 @@ void writePWF(formula_t *f, FILE *out, long long *bounds) {
 				}
 			}
 			break;
-			
 		case KIND_ANN:
-			fprintf(out, "(");
-			writePWF(f->children, out, bounds);
 			fprintf(out, "|(l:%d,%d))", f->opdata.ann.loop_id, f->opdata.ann.count);
 			break;
-
 		case KIND_BOOLMULT:
-			fprintf(out, "(");
-			writePWF(f->children, out, bounds);
-			fprintf(out, " * ");
-			writePWF(f->children+1, out, bounds);
 			fprintf(out, ")");
 			break;
-		case KIND_STR:
-			fprintf(out, "(%s)",f->bool_expr);
-			break;
-		default:
-			printf("error : unrecognized formula kind (writePWF) : %d\n", f->kind);
 	}
 }
 
+void writePWF(formula_t *f, FILE *out, long long *bounds) {
+	walk_t w;
+	walk_frame_t *top;
+	walk_init(&w, f);
+	while ((top = walk_top(&w)) != NULL) {
+		if (top->next == 0)
+			pwf_open(top->f, out);
+		if (top->next < pwf_arity(top->f)) {
+			if (top->next > 0)
+				pwf_separate(top->f, out);
+			walk_push(&w, &top->f->children[top->next++]);
+			continue;
+		}
+		pwf_close(top->f, out, bounds);
+		walk_pop(&w);
+	}
+	walk_release(&w);
+}
+
 
 void writeC(formula_t *f, FILE *out, int indent) {
 	static unsigned int uuid = 0;
 	uuid += 1;
 	char eta_str[64] = "NULL";
+	char mult_str[64] = "NULL";
 	if (f->aw.eta_count > 0) {
-		snprintf(eta_str, sizeof(eta_str), "(long long[%d]) {0}", f->aw.eta_count);
+		snprintf(eta_str, sizeof(eta_str), "(awcet_value_t[%d]) {0}", f->aw.eta_count);
 		eta_str[sizeof(eta_str) - 1] = 0;
+		snprintf(mult_str, sizeof(mult_str), "(int[%d]) {0}", f->aw.eta_count);
+		mult_str[sizeof(mult_str) - 1] = 0;
 	}
 	switch(f->kind) {
 		case KIND_ANN: /* NOT TESTED TODO FIXME */
 			for (int i = 0; i < indent; i++) fprintf(out, " ");
-			fprintf(out, "{KIND_ANN, %d, .ann={{%d,%d}}, {%d, %d, %s, 0}, (formula_t[%d]) {\n", f->param_id, f->opdata.ann.loop_id, f->opdata.ann.count, -1, f->aw.eta_count, eta_str, 1);
+			fprintf(out, "{KIND_ANN, %d, .ann={{%d,%d}}, {%d, %d, %s, 0, %s}, (formula_t[%d]) {\n", f->param_id, f->opdata.ann.loop_id, f->opdata.ann.count, -1, f->aw.eta_count, eta_str, mult_str, 1);
 			writeC(f->children, out, indent + 2);
 			fprintf(out, "\n");
 			for (int i = 0; i < indent; i++) fprintf(out, " ");
@@ -633,7 +1767,7 @@ void writeC(formula_t *f, FILE *out, int indent) {
 		case KIND_LOOP:
 			{
 				for (int i = 0; i < indent; i++) fprintf(out, " ");
-				fprintf(out, "{KIND_LOOP, %d, {%d}, {%d, %d, %s, 0}, (formula_t[%d]) {\n", f->param_id, f->opdata.loop_id, -1, f->aw.eta_count, eta_str, 1);
+				fprintf(out, "{KIND_LOOP, %d, {%d}, {%d, %d, %s, 0, %s}, (formula_t[%d]) {\n", f->param_id, f->opdata.loop_id, -1, f->aw.eta_count, eta_str, mult_str, 1);
 
 				writeC(f->children, out, indent + 2);
 				fprintf(out, "\n");
@@ -644,7 +1778,7 @@ void writeC(formula_t *f, FILE *out, int indent) {
 		case KIND_ALT:
 			{
 				for (int i = 0; i < indent; i++) fprintf(out, " ");
-				fprintf(out, "{KIND_ALT, %d, {%d}, {%d, %d, %s, 0}, (formula_t[%d]) {\n", f->param_id, f->opdata.children_count, -1, f->aw.eta_count, eta_str, f->opdata.children_count);
+				fprintf(out, "{KIND_ALT, %d, {%d}, {%d, %d, %s, 0, %s}, (formula_t[%d]) {\n", f->param_id, f->opdata.children_count, -1, f->aw.eta_count, eta_str, mult_str, f->opdata.children_count);
 				for (int i = 0; i < f->opdata.children_count; i++) {
 					writeC(f->children + i, out, indent + 2);
 					if (i < f->opdata.children_count - 1) fprintf(out, ", ");
@@ -660,18 +1794,18 @@ void writeC(formula_t *f, FILE *out, int indent) {
 				for (int i = 0; i < indent; i++) fprintf(out, " ");
 				fprintf(out, "{KIND_CONST, %d, {0}, {%d, %d, ", f->param_id, f->aw.loop_id, f->aw.eta_count);
 				if (f->aw.eta_count > 0) {
-					fprintf(out, "(long long[%d]) {", f->aw.eta_count);
+					fprintf(out, "(awcet_value_t[%d]) {", f->aw.eta_count);
 					for (int i = 0; i < f->aw.eta_count; i++) {
-						fprintf(out, "%lld, ", f->aw.eta[i]);
+						fprintf(out, "%lld, ", (long long) f->aw.eta[i]);
 					}
 				} else fprintf(out, "NULL");
-				fprintf(out, ", %lld }, NULL}", f->aw.others);
+				fprintf(out, ", %lld }, NULL}", (long long) f->aw.others);
 				break;
 			}
 		case KIND_SEQ:
 			{
 				for (int i = 0; i < indent; i++) fprintf(out, " ");
-				fprintf(out, "{KIND_SEQ, %d, {%d}, {%d, %d, %s, 0}, (formula_t[%d]) {\n", f->param_id, f->opdata.children_count, -1, f->aw.eta_count, eta_str, f->opdata.children_count);
+				fprintf(out, "{KIND_SEQ, %d, {%d}, {%d, %d, %s, 0, %s}, (formula_t[%d]) {\n", f->param_id, f->opdata.children_count, -1, f->aw.eta_count, eta_str, mult_str, f->opdata.children_count);
 				for (int i = 0; i < f->opdata.children_count; i++) {
 					writeC(f->children + i, out, indent + 2);
 					if (i < f->opdata.children_count - 1) fprintf(out, ", ");
@@ -0,0 +1,727 @@
+/* ----------------------------------------------------------------------------
+   Copyright (C) 2020, Université de Lille, Lille, FRANCE
+
+   This file is part of WSymb.
+
+   WSymb is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation ; either version 2 of
+   the License, or (at your option) any later version.
+
+   WSymb is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY ; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program ; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+   ---------------------------------------------------------------------------- */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "include/PWCET.h"
+#include "pwcet/include/pwcet-closed.h"
+
+/* Value a + b * p, p being the parameter */
+struct lin_s {
+	long long a;
+	long long b;
+};
+typedef struct lin_s lin_t;
+
+/* Abstract WCET linear in p for lo <= p <= hi, runs expanded */
+struct piece_s {
+	long long lo;
+	long long hi;
+	int loop_id;
+	int count;
+	lin_t *eta;
+	lin_t others;
+};
+typedef struct piece_s piece_t;
+
+/* Pieces of a node, sorted and covering the whole range of p */
+struct pieces_s {
+	int n;
+	int cap;
+	piece_t *p;
+};
+typedef struct pieces_s pieces_t;
+
+struct closed_ctx_s {
+	evalctx_t ev;
+	int param_id;
+	int failed;				/* the WCET is not piecewise linear in p */
+};
+typedef struct closed_ctx_s closed_ctx_t;
+
+static void *closed_alloc(size_t size)
+{
+	void *res = malloc(size > 0 ? size : 1);
+	if (res == NULL) {
+		fprintf(stderr, "pwcet_closed_form: out of memory\n");
+		abort();
+	}
+	return res;
+}
+
+static inline long long lin_at(lin_t l, long long p)
+{
+	return l.a + l.b * p;
+}
+
+static inline lin_t lin_add(lin_t l1, lin_t l2)
+{
+	lin_t res = { l1.a + l2.a, l1.b + l2.b };
+	return res;
+}
+
+static inline lin_t lin_mul(lin_t l, long long k)
+{
+	lin_t res = { l.a * k, l.b * k };
+	return res;
+}
+
+static inline lin_t piece_at(piece_t *pc, int i)
+{
+	return (i < pc->count) ? pc->eta[i] : pc->others;
+}
+
+static void piece_init(piece_t *pc, long long lo, long long hi, int loop_id, int count)
+{
+	pc->lo = lo;
+	pc->hi = hi;
+	pc->loop_id = loop_id;
+	pc->count = count;
+	pc->eta = (lin_t *) closed_alloc(sizeof(lin_t) * count);
+	pc->others.a = pc->others.b = 0;
+}
+
+static int piece_same(piece_t *p1, piece_t *p2)
+{
+	if ((p1->loop_id != p2->loop_id) || (p1->count != p2->count)
+		|| (p1->others.a != p2->others.a) || (p1->others.b != p2->others.b))
+		return 0;
+	return memcmp(p1->eta, p2->eta, sizeof(lin_t) * p1->count) == 0;
+}
+
+/* Append pc, which is merged with the last piece when they are equal */
+static void pieces_push(pieces_t *ps, piece_t *pc)
+{
+	piece_t *last = (ps->n > 0) ? &ps->p[ps->n - 1] : NULL;
+	if ((last != NULL) && (last->hi + 1 == pc->lo) && piece_same(last, pc)) {
+		last->hi = pc->hi;
+		free(pc->eta);
+		return;
+	}
+	if (ps->n == ps->cap) {
+		ps->cap = (ps->cap > 0) ? 2 * ps->cap : 4;
+		ps->p = (piece_t *) realloc(ps->p, sizeof(piece_t) * ps->cap);
+		if (ps->p == NULL) {
+			fprintf(stderr, "pwcet_closed_form: out of memory\n");
+			abort();
+		}
+	}
+	ps->p[ps->n++] = *pc;
+}
+
+static void pieces_free(pieces_t *ps)
+{
+	int i;
+	for (i = 0; i < ps->n; i++)
+		free(ps->p[i].eta);
+	free(ps->p);
+	ps->n = ps->cap = 0;
+	ps->p = NULL;
+}
+
+static void push_bottom(pieces_t *out, long long lo, long long hi)
+{
+	piece_t pc;
+	piece_init(&pc, lo, hi, LOOP_TOP, 0);
+	pieces_push(out, &pc);
+}
+
+/* Same as the runtime */
+static int loop_inner(loopinfo_t *li, int inner_id, int outer_id)
+{
+	if ((inner_id == outer_id) || (inner_id == LOOP_TOP))
+		return 0;
+	if (outer_id == LOOP_TOP)
+		return 1;
+	return (li->hier) (inner_id, outer_id);
+}
+
+/* Constant abstract WCET, from a formula or a parameter */
+static void push_awcet(pieces_t *out, awcet_t *aw, long long lo, long long hi)
+{
+	piece_t pc;
+	int i, j, n = 0;
+	for (i = 0; i < aw->eta_count; i++)
+		n += (aw->eta_mult != NULL) ? aw->eta_mult[i] : 1;
+	piece_init(&pc, lo, hi, aw->loop_id, n);
+	for (i = n = 0; i < aw->eta_count; i++) {
+		for (j = (aw->eta_mult != NULL) ? aw->eta_mult[i] : 1; j > 0; j--) {
+			pc.eta[n].a = aw->eta[i];
+			pc.eta[n++].b = 0;
+		}
+	}
+	pc.others.a = aw->others;
+	pieces_push(out, &pc);
+}
+
+static void op_seq(closed_ctx_t *ctx, piece_t **src, int n, long long lo, long long hi, pieces_t *out)
+{
+	piece_t pc;
+	int i, j, length = 0, inner_loop = LOOP_TOP;
+	for (i = 0; i < n; i++) {
+		if ((inner_loop == LOOP_TOP) || loop_inner(ctx->ev.li, src[i]->loop_id, inner_loop))
+			inner_loop = src[i]->loop_id;
+		if (src[i]->count > length)
+			length = src[i]->count;
+	}
+	piece_init(&pc, lo, hi, inner_loop, length);
+	for (i = 0; i < n; i++)
+		pc.others = lin_add(pc.others, src[i]->others);
+	for (j = 0; j < length; j++) {
+		pc.eta[j].a = pc.eta[j].b = 0;
+		for (i = 0; i < n; i++)
+			pc.eta[j] = lin_add(pc.eta[j], piece_at(src[i], j));
+	}
+	pieces_push(out, &pc);
+}
+
+static long long floor_div(long long num, long long den)
+{
+	long long q = num / den;
+	return ((num % den != 0) && ((num < 0) != (den < 0))) ? q - 1 : q;
+}
+
+static int cmp_ll(const void *a, const void *b)
+{
+	long long x = *(const long long *) a, y = *(const long long *) b;
+	return (x > y) - (x < y);
+}
+
+/*
+ * First values of p of the intervals of ]lo, hi] over which no pair of lines
+ * changes order. An integer crossing point gets an interval of its own, where
+ * the lines are equal.
+ */
+static int alt_splits(lin_t *lines, int n, long long lo, long long hi, long long **splits)
+{
+	long long *pts = NULL, c, num, den;
+	int i, j, k, count = 0, cap = 0;
+
+	for (i = 0; i < n; i++) {
+		for (j = i + 1; j < n; j++) {
+			if (lines[i].b == lines[j].b)
+				continue;
+			num = lines[j].a - lines[i].a;
+			den = lines[i].b - lines[j].b;
+			c = floor_div(num, den);
+			if (count + 2 > cap) {
+				cap = (cap > 0) ? 2 * cap : 16;
+				pts = (long long *) realloc(pts, sizeof(long long) * cap);
+				if (pts == NULL) {
+					fprintf(stderr, "pwcet_closed_form: out of memory\n");
+					abort();
+				}
+			}
+			if ((c * den == num) && (c > lo) && (c <= hi))
+				pts[count++] = c;
+			if ((c + 1 > lo) && (c + 1 <= hi))
+				pts[count++] = c + 1;
+		}
+	}
+	if (count > 1)
+		qsort(pts, count, sizeof(long long), cmp_ll);
+	for (i = k = 0; i < count; i++) {
+		if ((k == 0) || (pts[k - 1] != pts[i]))
+			pts[k++] = pts[i];
+	}
+	*splits = pts;
+	return k;
+}
+
+/* awcet_alt() on [lo, hi], where the order of the values is the same for every p */
+static void alt_interval(closed_ctx_t *ctx, piece_t **src, int n, long long lo, long long hi, int *tab, pieces_t *out)
+{
+	piece_t pc;
+	lin_t others = { -1, 0 };
+	int i, length = 0, max_source, inner_loop = LOOP_TOP;
+	long long max;
+
+	for (i = 0; i < n; i++) {
+		if ((inner_loop == LOOP_TOP) || loop_inner(ctx->ev.li, src[i]->loop_id, inner_loop))
+			inner_loop = src[i]->loop_id;
+		if (lin_at(others, lo) < lin_at(src[i]->others, lo))
+			others = src[i]->others;
+		length += src[i]->count;
+		tab[i] = 0;
+	}
+	piece_init(&pc, lo, hi, inner_loop, length);
+	pc.others = others;
+	pc.count = 0;
+	for (;;) {
+		max = -1;
+		max_source = 0;
+		for (i = 0; i < n; i++) {
+			if ((tab[i] < src[i]->count) && (lin_at(src[i]->eta[tab[i]], lo) > lin_at(others, lo))
+				&& (lin_at(src[i]->eta[tab[i]], lo) > max)) {
+				max = lin_at(src[i]->eta[tab[i]], lo);
+				max_source = i;
+			}
+		}
+		if (max == -1)
+			break;
+		pc.eta[pc.count++] = src[max_source]->eta[tab[max_source]++];
+	}
+	pieces_push(out, &pc);
+}
+
+static void op_alt(closed_ctx_t *ctx, piece_t **src, int n, long long lo, long long hi, pieces_t *out)
+{
+	lin_t *lines;
+	long long *splits, start;
+	int i, j, count = 1, slopes = 0;
+	int *tab = (int *) closed_alloc(sizeof(int) * n);
+
+	for (i = 0; i < n; i++) {
+		count += src[i]->count + 1;
+		slopes |= (src[i]->others.b != 0);
+		for (j = 0; j < src[i]->count; j++)
+			slopes |= (src[i]->eta[j].b != 0);
+	}
+	if (!slopes || (lo == hi)) {
+		alt_interval(ctx, src, n, lo, hi, tab, out);
+		free(tab);
+		return;
+	}
+	/* every value, and the -1 that awcet_alt() compares them to */
+	lines = (lin_t *) closed_alloc(sizeof(lin_t) * count);
+	lines[0].a = -1;
+	lines[0].b = 0;
+	for (i = 0, count = 1; i < n; i++) {
+		lines[count++] = src[i]->others;
+		for (j = 0; j < src[i]->count; j++)
+			lines[count++] = src[i]->eta[j];
+	}
+	count = alt_splits(lines, count, lo, hi, &splits);
+	start = lo;
+	for (i = 0; i <= count; i++) {
+		alt_interval(ctx, src, n, start, (i < count) ? splits[i] - 1 : hi, tab, out);
+		if (i < count)
+			start = splits[i];
+	}
+	free(splits);
+	free(lines);
+	free(tab);
+}
+
+/* awcet_loop() with a bound that does not depend on p */
+static void op_loop(piece_t *src, int loop_id, long long bound, long long lo, long long hi, pieces_t *out)
+{
+	piece_t pc;
+	long long i, j, end;
+
+	if (bound <= 0) {
+		push_bottom(out, lo, hi);
+		return;
+	}
+	if (src->loop_id == loop_id) {
+		/* sum of the bound greatest values */
+		piece_init(&pc, lo, hi, LOOP_TOP, 0);
+		end = (src->count < bound) ? src->count : bound;
+		for (i = 0; i < end; i++)
+			pc.others = lin_add(pc.others, src->eta[i]);
+		pc.others = lin_add(pc.others, lin_mul(src->others, bound - end));
+		pieces_push(out, &pc);
+		return;
+	}
+	/* values are summed by groups of bound */
+	piece_init(&pc, lo, hi, src->loop_id, (int) ((src->count + bound - 1) / bound));
+	pc.others = lin_mul(src->others, bound);
+	for (i = 0; i < pc.count; i++) {
+		pc.eta[i].a = pc.eta[i].b = 0;
+		end = (i + 1) * bound;
+		for (j = i * bound; (j < end) && (j < src->count); j++)
+			pc.eta[i] = lin_add(pc.eta[i], src->eta[j]);
+		if (end > src->count)
+			pc.eta[i] = lin_add(pc.eta[i], lin_mul(src->others, end - src->count));
+	}
+	pieces_push(out, &pc);
+}
+
+/* awcet_loop() bounded by p, linear once p is greater than the number of values */
+static void op_loop_param(closed_ctx_t *ctx, piece_t *src, int loop_id, long long lo, long long hi, pieces_t *out)
+{
+	piece_t pc;
+	lin_t sum = { 0, 0 };
+	long long p, start;
+	int i;
+
+	for (i = 0; i < src->count; i++) {
+		if (src->eta[i].b != 0)
+			ctx->failed = 1;
+		sum = lin_add(sum, src->eta[i]);
+	}
+	if (src->others.b != 0)
+		ctx->failed = 1;
+	if (ctx->failed)
+		return;
+	if (lo <= 0)
+		push_bottom(out, lo, (hi < 0) ? hi : 0);
+	for (p = (lo > 1) ? lo : 1; (p <= hi) && (p < src->count); p++)
+		op_loop(src, loop_id, p, p, p, out);
+	start = (lo > src->count) ? lo : src->count;
+	if (start < 1)
+		start = 1;
+	if (start > hi)
+		return;
+	/* sum + (p - count) * others */
+	sum.a -= src->count * src->others.a;
+	sum.b = src->others.a;
+	if (src->loop_id == loop_id) {
+		piece_init(&pc, start, hi, LOOP_TOP, 0);
+		pc.others = sum;
+	} else {
+		piece_init(&pc, start, hi, src->loop_id, (src->count > 0) ? 1 : 0);
+		if (src->count > 0)
+			pc.eta[0] = sum;
+		pc.others.b = src->others.a;
+	}
+	pieces_push(out, &pc);
+}
+
+static void op_ann(closed_ctx_t *ctx, piece_t *src, annotation_t *ann, long long lo, long long hi, pieces_t *out)
+{
+	piece_t pc;
+	int i, takeover = 0;
+
+	if ((ann->count == -1)
+		|| ((src->count != 0) && loop_inner(ctx->ev.li, ann->loop_id, src->loop_id) && (ann->count >= src->count))) {
+		piece_init(&pc, lo, hi, src->loop_id, src->count);
+		memcpy(pc.eta, src->eta, sizeof(lin_t) * src->count);
+		pc.others = src->others;
+		pieces_push(out, &pc);
+		return;
+	}
+	if ((src->count != 0) && loop_inner(ctx->ev.li, ann->loop_id, src->loop_id))
+		takeover = 1;
+	piece_init(&pc, lo, hi, ((src->count == 0) || takeover) ? ann->loop_id : src->loop_id, ann->count);
+	for (i = 0; i < ann->count; i++)
+		pc.eta[i] = piece_at(src, i);
+	pieces_push(out, &pc);
+}
+
+static void op_intmult(piece_t *src, int coef, long long lo, long long hi, pieces_t *out)
+{
+	piece_t pc;
+	int i;
+	/* like the runtime, the result is not attached to a loop */
+	piece_init(&pc, lo, hi, LOOP_TOP, src->count);
+	for (i = 0; i < src->count; i++)
+		pc.eta[i] = lin_mul(src->eta[i], coef);
+	pc.others = lin_mul(src->others, coef);
+	pieces_push(out, &pc);
+}
+
+/* Apply the operator of f on every interval over which all its children are linear */
+static void closed_operator(closed_ctx_t *ctx, formula_t *f, pieces_t *children, int n, pieces_t *out)
+{
+	piece_t **src = (piece_t **) closed_alloc(sizeof(piece_t *) * n);
+	int *cur = (int *) closed_alloc(sizeof(int) * n);
+	long long lo, hi;
+	param_value_t pv;
+	int i;
+
+	for (i = 0; i < n; i++)
+		cur[i] = 0;
+	lo = children[0].p[0].lo;
+	while (!ctx->failed) {
+		hi = children[0].p[cur[0]].hi;
+		for (i = 0; i < n; i++) {
+			src[i] = &children[i].p[cur[i]];
+			if (src[i]->hi < hi)
+				hi = src[i]->hi;
+		}
+		switch (f->kind) {
+			case KIND_SEQ:
+				op_seq(ctx, src, n, lo, hi, out);
+				break;
+			case KIND_ALT:
+				op_alt(ctx, src, n, lo, hi, out);
+				break;
+			case KIND_LOOP:
+				if (f->param_id == ctx->param_id) {
+					op_loop_param(ctx, src[0], f->opdata.loop_id, lo, hi, out);
+				} else if (f->param_id != IDENT_NONE) {
+					ctx->ev.param_valuation(f->param_id, &pv, ctx->ev.pv_data);
+					op_loop(src[0], f->opdata.loop_id, pv.bound, lo, hi, out);
+				} else
+					op_loop(src[0], f->opdata.loop_id, (ctx->ev.li->bnd) (f->opdata.loop_id), lo, hi, out);
+				break;
+			case KIND_PARAM_LOOP:
+				op_loop(src[0], f->opdata.loop_id, compute_loop_bound(&ctx->ev, f->condition), lo, hi, out);
+				break;
+			case KIND_ANN:
+				if (f->param_id != IDENT_NONE) {
+					ctx->ev.param_valuation(f->param_id, &pv, ctx->ev.pv_data);
+					op_ann(ctx, src[0], &pv.ann, lo, hi, out);
+				} else
+					op_ann(ctx, src[0], &f->opdata.ann, lo, hi, out);
+				break;
+			case KIND_INTMULT:
+				op_intmult(src[0], f->opdata.coef, lo, hi, out);
+				break;
+		}
+		if (hi == children[0].p[children[0].n - 1].hi)
+			break;
+		for (i = 0; i < n; i++) {
+			if (children[i].p[cur[i]].hi == hi)
+				cur[i]++;
+		}
+		lo = hi + 1;
+	}
+	free(cur);
+	free(src);
+}
+
+/* Pieces of the nodes whose children are being computed, those of the children on top */
+struct closed_stack_s {
+	int n;
+	int cap;
+	pieces_t *p;
+};
+typedef struct closed_stack_s closed_stack_t;
+
+static pieces_t *stack_push(closed_stack_t *st)
+{
+	if (st->n == st->cap) {
+		st->cap = (st->cap > 0) ? 2 * st->cap : 16;
+		st->p = (pieces_t *) realloc(st->p, sizeof(pieces_t) * st->cap);
+		if (st->p == NULL) {
+			fprintf(stderr, "pwcet_closed_form: out of memory\n");
+			abort();
+		}
+	}
+	st->p[st->n] = (pieces_t) { 0, 0, NULL };
+	return &st->p[st->n++];
+}
+
+/*
+ * Number of children whose pieces give those of f, the pieces of leaves
+ * being pushed at once: -1 in that case, or if the closed form fails
+ */
+static int closed_enter(closed_ctx_t *ctx, formula_t *f, long long lo, long long hi, closed_stack_t *st)
+{
+	param_value_t pv;
+	int n;
+
+	switch (f->kind) {
+		case KIND_CONST:
+			push_awcet(stack_push(st), &f->aw, lo, hi);
+			return -1;
+		case KIND_AWCET:
+			if (f->param_id == ctx->param_id) {
+				ctx->failed = 1;
+				return -1;
+			}
+			/* the parameter may be written in the buffers of f, as with evaluate() */
+			pv.aw = f->aw;
+			ctx->ev.param_valuation(f->param_id, &pv, ctx->ev.pv_data);
+			push_awcet(stack_push(st), &pv.aw, lo, hi);
+			return -1;
+		case KIND_BOOLMULT:
+			if (check_condition(&ctx->ev, f->children[0].condition, f->children[0].opdata.children_count))
+				return 1;
+			push_bottom(stack_push(st), lo, hi);
+			return -1;
+		case KIND_SEQ:
+		case KIND_ALT:
+			n = f->opdata.children_count;
+			break;
+		case KIND_ANN:
+			if (f->param_id == ctx->param_id) {
+				ctx->failed = 1;
+				return -1;
+			}
+			n = 1;
+			break;
+		case KIND_LOOP:
+		case KIND_PARAM_LOOP:
+		case KIND_INTMULT:
+			n = 1;
+			break;
+		default:
+			fprintf(stderr, "pwcet_closed_form: unknown node type %d\n", f->kind);
+			exit(1);
+	}
+	if (n == 0) {
+		/* empty SEQ or ALT */
+		push_awcet(stack_push(st), &(awcet_t) { LOOP_TOP, 0, NULL, (f->kind == KIND_ALT) ? -1 : 0, NULL }, lo, hi);
+		return -1;
+	}
+	return n;
+}
+
+/*
+ * Pieces of f, children first: flags holds the number of children of a node
+ * plus one once it is entered. The pieces of a BOOLMULT whose condition holds
+ * are those of its guarded child.
+ */
+static void closed_node(closed_ctx_t *ctx, formula_t *f, long long lo, long long hi, pieces_t *out)
+{
+	closed_stack_t st = { 0, 0, NULL };
+	walk_t w;
+	walk_frame_t *top;
+	formula_t *n;
+	pieces_t res;
+	int i, arity;
+
+	walk_init(&w, f);
+	while (((top = walk_top(&w)) != NULL) && !ctx->failed) {
+		n = top->f;
+		if (top->flags == 0) {
+			arity = closed_enter(ctx, n, lo, hi, &st);
+			if (arity < 0) {
+				walk_pop(&w);
+				continue;
+			}
+			top->flags = arity + 1;
+		}
+		if (top->next < top->flags - 1) {
+			i = top->next++;
+			walk_push(&w, &n->children[(n->kind == KIND_BOOLMULT) ? 1 : i]);
+			continue;
+		}
+		arity = top->flags - 1;
+		if (n->kind != KIND_BOOLMULT) {
+			res = (pieces_t) { 0, 0, NULL };
+			closed_operator(ctx, n, st.p + st.n - arity, arity, &res);
+			for (i = 0; i < arity; i++)
+				pieces_free(&st.p[--st.n]);
+			*stack_push(&st) = res;
+		}
+		walk_pop(&w);
+	}
+	walk_release(&w);
+	if (ctx->failed) {
+		while (st.n > 0)
+			pieces_free(&st.p[--st.n]);
+	} else
+		*out = st.p[0];
+	free(st.p);
+}
+
+int pwcet_closed_form(pwcet_closed_t *c, formula_t *f, loopinfo_t *li, param_valuation_t pv, bparam_valuation_t bpv, void *data, int param_id, long long lo, long long hi)
+{
+	closed_ctx_t ctx;
+	pieces_t res = { 0, 0, NULL };
+	pwcet_segment_t *seg;
+	lin_t w;
+	long long end = 0;
+	int i;
+
+	ctx.ev.li = li;
+	ctx.ev.param_valuation = pv;
+	ctx.ev.bparam_valuation = bpv;
+	ctx.ev.pv_data = data;
+	ctx.param_id = param_id;
+	ctx.failed = 0;
+	c->param_id = param_id;
+	c->lo = (lo > 0) ? lo : 0;
+	c->hi = hi;
+	c->count = 0;
+	c->segments = NULL;
+	if (c->lo > hi)
+		return 0;
+	closed_node(&ctx, f, c->lo, hi, &res);
+	if (ctx.failed) {
+		pieces_free(&res);
+		return -1;
+	}
+	/* WCET of each piece, collinear neighbours are merged */
+	c->segments = (pwcet_segment_t *) closed_alloc(sizeof(pwcet_segment_t) * res.n);
+	for (i = 0; i < res.n; i++) {
+		w = (res.p[i].count > 0) ? res.p[i].eta[0] : res.p[i].others;
+		if (c->count > 0) {
+			seg = &c->segments[c->count - 1];
+			if ((seg->a == w.a) && (seg->b == w.b)) {
+				end = res.p[i].hi;
+				continue;
+			}
+			if ((end == seg->lo) && (res.p[i].lo < res.p[i].hi) && (lin_at(w, seg->lo) == seg->a + seg->b * seg->lo)) {
+				/* a single point on the next line */
+				seg->a = w.a;
+				seg->b = w.b;
+				end = res.p[i].hi;
+				continue;
+			}
+			if ((end == seg->lo) && (res.p[i].lo == res.p[i].hi)) {
+				/* two single points */
+				seg->b = lin_at(w, res.p[i].lo) - (seg->a + seg->b * seg->lo);
+				seg->a = lin_at(w, res.p[i].lo) - seg->b * res.p[i].lo;
+				end = res.p[i].hi;
+				continue;
+			}
+			if ((res.p[i].lo == res.p[i].hi) && (lin_at(w, res.p[i].lo) == seg->a + seg->b * res.p[i].lo)) {
+				end = res.p[i].hi;
+				continue;
+			}
+		}
+		seg = &c->segments[c->count++];
+		seg->lo = res.p[i].lo;
+		seg->a = w.a;
+		seg->b = w.b;
+		end = res.p[i].hi;
+	}
+	pieces_free(&res);
+	return 0;
+}
+
+long long pwcet_closed_wcet(const pwcet_closed_t *c, long long p)
+{
+	int l = 0, h = c->count - 1, m;
+	if ((p < c->lo) || (p > c->hi) || (c->count == 0))
+		return -1;
+	while (l < h) {
+		m = (l + h + 1) / 2;
+		if (c->segments[m].lo <= p)
+			l = m;
+		else
+			h = m - 1;
+	}
+	return c->segments[l].a + c->segments[l].b * p;
+}
+
+void pwcet_closed_writeC(const pwcet_closed_t *c, FILE *out, const char *name)
+{
+	int i;
+	fprintf(out, "/* WCET for %lld <= p <= %lld, p being parameter %d */\n", c->lo, c->hi, c->param_id);
+	fprintf(out, "long long %s(long long p)\n{\n", name);
+	fprintf(out, "\tstatic const long long seg[][3] = {\n");
+	for (i = 0; i < c->count; i++)
+		fprintf(out, "\t\t{%lldLL, %lldLL, %lldLL},\n", c->segments[i].lo, c->segments[i].a, c->segments[i].b);
+	if (c->count == 0)
+		fprintf(out, "\t\t{0, -1, 0},\n");
+	fprintf(out, "\t};\n");
+	fprintf(out, "\tint l = 0, h = %d, m;\n", (c->count > 0) ? c->count - 1 : 0);
+	fprintf(out, "\tif ((p < %lldLL) || (p > %lldLL))\n\t\treturn -1;\n", c->lo, c->hi);
+	fprintf(out, "\twhile (l < h) {\n");
+	fprintf(out, "\t\tm = (l + h + 1) / 2;\n");
+	fprintf(out, "\t\tif (seg[m][0] <= p)\n\t\t\tl = m;\n\t\telse\n\t\t\th = m - 1;\n");
+	fprintf(out, "\t}\n");
+	fprintf(out, "\treturn seg[l][1] + seg[l][2] * p;\n}\n");
+}
+
+void pwcet_closed_free(pwcet_closed_t *c)
+{
+	free(c->segments);
+	c->segments = NULL;
+	c->count = 0;
+}
@@ -0,0 +1,197 @@
+/* ----------------------------------------------------------------------------
+   Copyright (C) 2020, Université de Lille, Lille, FRANCE
+
+   This file is part of WSymb.
+
+   WSymb is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation ; either version 2 of
+   the License, or (at your option) any later version.
+
+   WSymb is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY ; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program ; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+   ---------------------------------------------------------------------------- */
+
+#include <stdlib.h>
+
+#include "include/PWCET.h"
+#include "pwcet/include/pwcet-explain.h"
+
+struct explain_ctx_s {
+	pwcet_explain_t *report;
+	int count, capacity;
+	int node;				/* next pre-order index */
+};
+typedef struct explain_ctx_s explain_ctx_t;
+
+static long long head(awcet_t *aw)
+{
+	long long v = (aw->eta_count > 0) ? aw->eta[0] : aw->others;
+	return (v > 0) ? v : 0;
+}
+
+static void report_push(explain_ctx_t *ctx, pwcet_explain_t *e)
+{
+	if (ctx->count == ctx->capacity) {
+		ctx->capacity = ctx->capacity ? 2 * ctx->capacity : 64;
+		ctx->report = (pwcet_explain_t *) realloc(ctx->report, sizeof(pwcet_explain_t) * ctx->capacity);
+		if (ctx->report == NULL) {
+			fprintf(stderr, "evaluate_explain: out of memory\n");
+			abort();
+		}
+	}
+	ctx->report[ctx->count++] = *e;
+}
+
+/*
+ * Give the share of the WCET of f to f and its children, in pre-order
+ * Each frame holds the share of its node and, in data, its result: the
+ * BOOLMULT operator passes the result of its child through, so the result of
+ * the child is the one of its parent. The subtrees that are not on the
+ * critical path are skipped. A SEQ keeps the sum of the WCETs of its children
+ * in value[0], an ALT its child on the critical path in flags.
+ */
+static void explain_walk(explain_ctx_t *ctx, formula_t *f, double c)
+{
+	pwcet_explain_t e;
+	walk_t w;
+	walk_frame_t *top;
+	formula_t *n;
+	awcet_t *aw;
+	long long h, best;
+	double share;
+	int i;
+
+	walk_init(&w, f);
+	walk_top(&w)->share = c;
+	walk_top(&w)->data = &f->aw;
+	while ((top = walk_top(&w)) != NULL) {
+		n = top->f;
+		aw = (awcet_t *) top->data;
+		if (top->next == 0) {
+			if (top->share <= 0) {
+				ctx->node += formula_node_count(n);
+				walk_pop(&w);
+				continue;
+			}
+			e.node = ctx->node++;
+			e.kind = n->kind;
+			e.loop_id = aw->loop_id;
+			e.param_id = n->param_id;
+			e.origin = n->origin;
+			e.alt_child = -1;
+			e.wcet = head(aw);
+			e.contribution = top->share;
+			if (n->kind == KIND_ALT) {
+				best = -1;
+				for (i = 0; i < n->opdata.children_count; i++) {
+					h = head(&n->children[i].aw);
+					if (h > best) {
+						best = h;
+						e.alt_child = i;
+					}
+				}
+			}
+			if (n->kind == KIND_SEQ)
+				for (i = 0; i < n->opdata.children_count; i++)
+					top->value[0] += head(&n->children[i].aw);
+			top->flags = e.alt_child;
+			report_push(ctx, &e);
+		}
+		if (top->next == formula_child_count(n)) {
+			walk_pop(&w);
+			continue;
+		}
+		i = top->next++;
+		switch (n->kind) {
+			case KIND_SEQ:
+				/* inside a loop, the first values of the children may all be 0 */
+				if (top->value[0] > 0)
+					share = top->share * head(&n->children[i].aw) / top->value[0];
+				else
+					share = top->share / n->opdata.children_count;
+				break;
+			case KIND_ALT:
+				share = (i == top->flags) ? top->share : 0;
+				break;
+			case KIND_BOOLMULT:
+				/* a positive WCET means that the condition holds */
+				share = (i == 1) ? top->share : 0;
+				break;
+			default:
+				/* LOOP, PARAM_LOOP, ANN and INTMULT */
+				share = top->share;
+				break;
+		}
+		top = walk_push(&w, &n->children[i]);
+		top->share = share;
+		top->data = (n->kind == KIND_BOOLMULT) ? aw : &n->children[i].aw;
+	}
+	walk_release(&w);
+}
+
+static int contribution_cmp(const void *a, const void *b)
+{
+	const pwcet_explain_t *ea = (const pwcet_explain_t *) a, *eb = (const pwcet_explain_t *) b;
+	if (ea->contribution != eb->contribution)
+		return (ea->contribution < eb->contribution) ? 1 : -1;
+	return ea->node - eb->node;
+}
+
+long long evaluate_explain(formula_t *f, loopinfo_t *li, param_valuation_t pv, bparam_valuation_t bpv, void *data, pwcet_explain_t **report, int *count)
+{
+	explain_ctx_t ctx = { NULL, 0, 0, 0 };
+	long long wcet = evaluate(f, li, pv, bpv, data);
+
+	explain_walk(&ctx, f, (double) wcet);
+	if (ctx.count > 0)
+		qsort(ctx.report, ctx.count, sizeof(pwcet_explain_t), contribution_cmp);
+	*report = ctx.report;
+	*count = ctx.count;
+	return wcet;
+}
+
+static const char *kind_name(int kind)
+{
+	switch (kind) {
+		case KIND_ALT: return "alt";
+		case KIND_SEQ: return "seq";
+		case KIND_LOOP: return "loop";
+		case KIND_ANN: return "ann";
+		case KIND_CONST: return "const";
+		case KIND_AWCET: return "awcet";
+		case KIND_INTMULT: return "intmult";
+		case KIND_BOOLMULT: return "boolmult";
+		case KIND_PARAM_LOOP: return "paramloop";
+		default: return "?";
+	}
+}
+
+void pwcet_explain_print(const pwcet_explain_t *report, int count, int max, FILE *out)
+{
+	double total = 0;
+	int i;
+
+	for (i = 0; i < count; i++)
+		if (report[i].node == 0)
+			total = report[i].contribution;
+	if ((max > 0) && (max < count))
+		count = max;
+	fprintf(out, "%6s %6s %-10s %6s %6s %6s %12s %14s %7s\n", "rank", "node", "kind", "loop", "param", "origin", "wcet",
+		"contribution", "%");
+	for (i = 0; i < count; i++) {
+		fprintf(out, "%6d %6d %-10s %6d %6d %6d %12lld %14.1f %6.2f%%", i + 1, report[i].node, kind_name(report[i].kind),
+			report[i].loop_id, report[i].param_id, report[i].origin, report[i].wcet, report[i].contribution,
+			(total > 0) ? 100.0 * report[i].contribution / total : 0.0);
+		if (report[i].alt_child >= 0)
+			fprintf(out, " (child %d)", report[i].alt_child);
+		fprintf(out, "\n");
+	}
+}
@@ -0,0 +1,643 @@
+/* ----------------------------------------------------------------------------
+   Copyright (C) 2020, Université de Lille, Lille, FRANCE
+
+   This file is part of WSymb.
+
+   WSymb is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation ; either version 2 of
+   the License, or (at your option) any later version.
+
+   WSymb is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY ; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program ; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+   ---------------------------------------------------------------------------- */
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <spawn.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "include/PWCET.h"
+#include "pwcet/include/pwcet-jit.h"
+
+extern char **environ;
+
+/* scratch buffers up to this size are allocated on the stack */
+#define NATIVE_SCRATCH 256
+
+/*
+ * Interface of the generated code, which does not depend on the layout of
+ * the runtime structures: the same declaration is compiled here and pasted
+ * into the generated source.
+ */
+#define NATIVE_ENV struct native_env { \
+	void *data; \
+	int (*hier) (int inner, int outer); \
+	int (*bnd) (int loop_id); \
+	int (*bound) (void *data, int param_id); \
+	int (*bparam) (int bparam_id); \
+}
+#define NATIVE_STRING(x) #x
+#define NATIVE_SOURCE(x) NATIVE_STRING(x)
+
+NATIVE_ENV;
+typedef long long (native_fn_t) (const struct native_env *e, long long *scratch);
+
+/*
+ * Operators on expanded abstract WCETs, same results as the runtime. Values
+ * are always 64 bits wide, whatever awcet_value_t is.
+ */
+static const char native_prelude[] =
+	NATIVE_SOURCE(NATIVE_ENV) ";\n"
+	"typedef struct { int loop_id; int count; long long *eta; long long others; } aw_t;\n"
+	"\n"
+	"static inline int inner(const struct native_env *e, int i, int o)\n"
+	"{\n"
+	"\tif ((i == o) || (i == -1))\n"
+	"\t\treturn 0;\n"
+	"\tif (o == -1)\n"
+	"\t\treturn 1;\n"
+	"\treturn e->hier(i, o);\n"
+	"}\n"
+	"\n"
+	"static inline long long at(const aw_t *a, long long i)\n"
+	"{\n"
+	"\treturn (i < a->count) ? a->eta[i] : a->others;\n"
+	"}\n"
+	"\n"
+	"static inline void copy(aw_t *d, const aw_t *s)\n"
+	"{\n"
+	"\tint i;\n"
+	"\tfor (i = 0; i < s->count; i++)\n"
+	"\t\td->eta[i] = s->eta[i];\n"
+	"\td->loop_id = s->loop_id;\n"
+	"\td->count = s->count;\n"
+	"\td->others = s->others;\n"
+	"}\n"
+	"\n"
+	"static inline void bottom(aw_t *d)\n"
+	"{\n"
+	"\td->loop_id = -1;\n"
+	"\td->count = 0;\n"
+	"\td->others = 0;\n"
+	"}\n"
+	"\n"
+	"static inline void seq(const struct native_env *e, aw_t *d, const aw_t *const *s, int n)\n"
+	"{\n"
+	"\tint i, j, length = 0;\n"
+	"\tlong long v;\n"
+	"\td->loop_id = -1;\n"
+	"\td->others = 0;\n"
+	"\tfor (i = 0; i < n; i++) {\n"
+	"\t\tif ((d->loop_id == -1) || inner(e, s[i]->loop_id, d->loop_id))\n"
+	"\t\t\td->loop_id = s[i]->loop_id;\n"
+	"\t\td->others += s[i]->others;\n"
+	"\t\tif (s[i]->count > length)\n"
+	"\t\t\tlength = s[i]->count;\n"
+	"\t}\n"
+	"\tfor (j = 0; j < length; j++) {\n"
+	"\t\tfor (v = 0, i = 0; i < n; i++)\n"
+	"\t\t\tv += at(s[i], j);\n"
+	"\t\td->eta[j] = v;\n"
+	"\t}\n"
+	"\td->count = length;\n"
+	"}\n"
+	"\n"
+	"/* d has room for the values of all the sources, the limit first ones are computed (all of them if limit is 0) */\n"
+	"static inline void alt(const struct native_env *e, aw_t *d, const aw_t *const *s, int n, int limit)\n"
+	"{\n"
+	"\tint i, max_source, next[n > 0 ? n : 1];\n"
+	"\tlong long max;\n"
+	"\td->loop_id = -1;\n"
+	"\td->count = 0;\n"
+	"\td->others = -1;\n"
+	"\tfor (i = 0; i < n; i++) {\n"
+	"\t\tif ((d->loop_id == -1) || inner(e, s[i]->loop_id, d->loop_id))\n"
+	"\t\t\td->loop_id = s[i]->loop_id;\n"
+	"\t\tif (d->others < s[i]->others)\n"
+	"\t\t\td->others = s[i]->others;\n"
+	"\t\tnext[i] = 0;\n"
+	"\t}\n"
+	"\twhile ((limit <= 0) || (d->count < limit)) {\n"
+	"\t\tmax = -1;\n"
+	"\t\tmax_source = 0;\n"
+	"\t\tfor (i = 0; i < n; i++) {\n"
+	"\t\t\tif ((next[i] < s[i]->count) && (s[i]->eta[next[i]] > d->others) && (s[i]->eta[next[i]] > max)) {\n"
+	"\t\t\t\tmax = s[i]->eta[next[i]];\n"
+	"\t\t\t\tmax_source = i;\n"
+	"\t\t\t}\n"
+	"\t\t}\n"
+	"\t\tif (max == -1)\n"
+	"\t\t\tbreak;\n"
+	"\t\td->eta[d->count++] = max;\n"
+	"\t\tnext[max_source]++;\n"
+	"\t}\n"
+	"}\n"
+	"\n"
+	"static inline void loop(aw_t *d, const aw_t *s, int loop_id, int bound)\n"
+	"{\n"
+	"\tlong long i, j, v;\n"
+	"\tbottom(d);\n"
+	"\tif (bound <= 0)\n"
+	"\t\treturn;\n"
+	"\tif (s->loop_id == loop_id) {\n"
+	"\t\tfor (i = 0; (i < bound) && (i < s->count); i++)\n"
+	"\t\t\td->others += s->eta[i];\n"
+	"\t\td->others += (bound - i) * s->others;\n"
+	"\t\treturn;\n"
+	"\t}\n"
+	"\td->loop_id = s->loop_id;\n"
+	"\td->others = s->others * bound;\n"
+	"\tfor (i = 0; i < s->count; i += bound) {\n"
+	"\t\tfor (v = 0, j = i; (j < i + bound) && (j < s->count); j++)\n"
+	"\t\t\tv += s->eta[j];\n"
+	"\t\tif (i + bound > s->count)\n"
+	"\t\t\tv += (i + bound - s->count) * s->others;\n"
+	"\t\td->eta[d->count++] = v;\n"
+	"\t}\n"
+	"}\n"
+	"\n"
+	"static inline void ann(const struct native_env *e, aw_t *d, const aw_t *s, int loop_id, int count)\n"
+	"{\n"
+	"\tint i, takeover = (s->count != 0) && inner(e, loop_id, s->loop_id);\n"
+	"\tif ((count == -1) || (takeover && (count >= s->count))) {\n"
+	"\t\tcopy(d, s);\n"
+	"\t\treturn;\n"
+	"\t}\n"
+	"\tfor (i = 0; i < count; i++)\n"
+	"\t\td->eta[i] = at(s, i);\n"
+	"\td->count = count;\n"
+	"\td->others = 0;\n"
+	"\td->loop_id = ((s->count == 0) || takeover) ? loop_id : s->loop_id;\n"
+	"}\n"
+	"\n"
+	"/* like the runtime, the result is not attached to a loop */\n"
+	"static inline void intmult(aw_t *d, const aw_t *s, int coef)\n"
+	"{\n"
+	"\tint i;\n"
+	"\tfor (i = 0; i < s->count; i++)\n"
+	"\t\td->eta[i] = s->eta[i] * coef;\n"
+	"\td->loop_id = -1;\n"
+	"\td->count = s->count;\n"
+	"\td->others = s->others * coef;\n"
+	"}\n"
+	"\n";
+
+struct pwcet_jit_s {
+	char *cache_dir;
+	char *cc;
+};
+
+struct pwcet_native_s {
+	pwcet_jit_t *jit;
+	formula_t *f;
+	char *source;				/* NULL if f cannot be compiled */
+	size_t source_size;
+	unsigned long long hash;
+	pthread_t thread;
+	int joined;
+	void *handle;
+	long scratch;				/* size of the scratch buffer of the native code */
+	_Atomic(native_fn_t *) fn;
+};
+
+/* State of the evaluation, seen by the native code */
+struct native_ctx {
+	param_valuation_t *pv;
+	void *data;
+};
+
+/*
+ * Code generation
+ */
+
+struct native_gen_s {
+	FILE *out;
+	int next;				/* next node number */
+	long scratch;				/* size of the scratch buffer */
+};
+
+static void gen_terms(struct native_gen_s *g, term_t *terms, int count)
+{
+	int i;
+	fprintf(g->out, "(0");
+	for (i = 0; i < count; i++) {
+		if (terms[i].kind == BOOL_PARAM)
+			fprintf(g->out, " + %d * e->bparam(%d)", terms[i].coef, terms[i].value);
+		else
+			fprintf(g->out, " + %d * %d", terms[i].coef, terms[i].value);
+	}
+	fprintf(g->out, ")");
+}
+
+/*
+ * Emit the code computing f into a new node
+ * @param cap receives the greatest number of eta values of the node
+ * @return the node number, -1 if f cannot be compiled
+ */
+static int gen_node(struct native_gen_s *g, formula_t *f, long *cap)
+{
+	int i, id, child = 0, *ids;
+	long c, size = 0;
+
+	switch (f->kind) {
+		case KIND_CONST:
+			id = g->next++;
+			for (i = 0; i < f->aw.eta_count; i++)
+				size += (f->aw.eta_mult != NULL) ? f->aw.eta_mult[i] : 1;
+			if (size > 0) {
+				fprintf(g->out, "\tstatic const long long c%d[] = {", id);
+				for (i = 0; i < f->aw.eta_count; i++) {
+					for (c = (f->aw.eta_mult != NULL) ? f->aw.eta_mult[i] : 1; c > 0; c--)
+						fprintf(g->out, "%lldLL, ", (long long) f->aw.eta[i]);
+				}
+				fprintf(g->out, "};\n");
+				fprintf(g->out, "\taw_t n%d = {%d, %ld, (long long *) c%d, %lldLL};\n",
+						id, f->aw.loop_id, size, id, (long long) f->aw.others);
+			} else
+				fprintf(g->out, "\taw_t n%d = {%d, 0, 0, %lldLL};\n", id, f->aw.loop_id, (long long) f->aw.others);
+			*cap = size;
+			return id;
+		case KIND_SEQ:
+		case KIND_ALT:
+			ids = (int *) malloc(sizeof(int) * (f->opdata.children_count + 1));
+			if (ids == NULL)
+				return -1;
+			for (i = 0; i < f->opdata.children_count; i++) {
+				ids[i] = gen_node(g, &f->children[i], &c);
+				if (ids[i] < 0) {
+					free(ids);
+					return -1;
+				}
+				size = (f->kind == KIND_SEQ) ? ((c > size) ? c : size) : size + c;
+			}
+			id = g->next++;
+			fprintf(g->out, "\taw_t n%d = {0, 0, s + %ld, 0};\n", id, g->scratch);
+			fprintf(g->out, "\t%s(e, &n%d, (const aw_t *const []) {", (f->kind == KIND_SEQ) ? "seq" : "alt", id);
+			for (i = 0; i < f->opdata.children_count; i++)
+				fprintf(g->out, "&n%d, ", ids[i]);
+			fprintf(g->out, "0}, %d", f->opdata.children_count);
+			if (f->kind == KIND_ALT)
+				fprintf(g->out, ", %d", f->eta_limit);
+			fprintf(g->out, ");\n");
+			free(ids);
+			break;
+		case KIND_LOOP:
+		case KIND_PARAM_LOOP:
+		case KIND_INTMULT:
+			if ((child = gen_node(g, &f->children[0], &size)) < 0)
+				return -1;
+			id = g->next++;
+			fprintf(g->out, "\taw_t n%d = {0, 0, s + %ld, 0};\n", id, g->scratch);
+			if (f->kind == KIND_INTMULT) {
+				fprintf(g->out, "\tintmult(&n%d, &n%d, %d);\n", id, child, f->opdata.coef);
+				break;
+			}
+			fprintf(g->out, "\tloop(&n%d, &n%d, %d, ", id, child, f->opdata.loop_id);
+			if (f->kind == KIND_PARAM_LOOP)
+				gen_terms(g, f->condition->terms, f->condition->terms_number);
+			else if (f->param_id != IDENT_NONE)
+				fprintf(g->out, "e->bound(e->data, %d)", f->param_id);
+			else
+				fprintf(g->out, "e->bnd(%d)", f->opdata.loop_id);
+			fprintf(g->out, ");\n");
+			break;
+		case KIND_ANN:
+			/* the size of the result would depend on the parameter */
+			if (f->param_id != IDENT_NONE)
+				return -1;
+			if ((child = gen_node(g, &f->children[0], &size)) < 0)
+				return -1;
+			if (f->opdata.ann.count > size)
+				size = f->opdata.ann.count;
+			id = g->next++;
+			fprintf(g->out, "\taw_t n%d = {0, 0, s + %ld, 0};\n", id, g->scratch);
+			fprintf(g->out, "\tann(e, &n%d, &n%d, %d, %d);\n", id, child,
+					f->opdata.ann.loop_id, f->opdata.ann.count);
+			break;
+		case KIND_BOOLMULT:
+			/* the operand is only computed when the conditions hold */
+			id = g->next++;
+			fprintf(g->out, "\taw_t n%d = {0, 0, 0, 0};\n", id);
+			fprintf(g->out, "\tif (1");
+			for (i = 0; i < f->children[0].opdata.children_count; i++) {
+				condition_t *cdt = &f->children[0].condition[i];
+				fprintf(g->out, " && (%d %s ", cdt->int_value, (cdt->kind == BOOL_EQ) ? "==" : "<=");
+				gen_terms(g, cdt->terms, cdt->terms_number);
+				fprintf(g->out, ")");
+			}
+			fprintf(g->out, ") {\n");
+			if ((child = gen_node(g, &f->children[1], &size)) < 0)
+				return -1;
+			fprintf(g->out, "\tn%d.eta = s + %ld;\n", id, g->scratch);
+			fprintf(g->out, "\tcopy(&n%d, &n%d);\n", id, child);
+			fprintf(g->out, "\t} else\n\tbottom(&n%d);\n", id);
+			break;
+		default:
+			/* KIND_AWCET: the size of the parameter is unknown */
+			return -1;
+	}
+	g->scratch += size;
+	*cap = size;
+	return id;
+}
+
+/* Source of the native code of f, NULL if f cannot be compiled */
+static char *gen_source(formula_t *f, size_t *source_size)
+{
+	struct native_gen_s g;
+	char *body = NULL, *source = NULL;
+	size_t body_size;
+	FILE *out;
+	long cap;
+	int root;
+
+	g.out = open_memstream(&body, &body_size);
+	if (g.out == NULL)
+		return NULL;
+	g.next = 0;
+	g.scratch = 0;
+	root = gen_node(&g, f, &cap);
+	fclose(g.out);
+	if (root >= 0) {
+		out = open_memstream(&source, source_size);
+		if (out != NULL) {
+			fprintf(out, "%s", native_prelude);
+			fprintf(out, "const long pwcet_native_scratch = %ld;\n\n", g.scratch);
+			fprintf(out, "long long pwcet_native(const struct native_env *e, long long *s)\n{\n");
+			fprintf(out, "%s", body);
+			fprintf(out, "\treturn (n%d.count == 0) ? n%d.others : n%d.eta[0];\n}\n", root, root, root);
+			fclose(out);
+		}
+	}
+	free(body);
+	return source;
+}
+
+/* FNV-1a */
+static unsigned long long gen_hash(const char *s, size_t size)
+{
+	unsigned long long h = 0xcbf29ce484222325ULL;
+	size_t i;
+	for (i = 0; i < size; i++) {
+		h ^= (unsigned char) s[i];
+		h *= 0x100000001b3ULL;
+	}
+	return h;
+}
+
+/*
+ * Compilation
+ */
+
+static int run_compiler(pwcet_jit_t *jit, const char *source, const char *object)
+{
+	char *argv[] = {jit->cc, "-O2", "-w", "-shared", "-fPIC", "-o", (char *) object, (char *) source, NULL};
+	int status;
+	pid_t pid;
+
+	if (posix_spawnp(&pid, jit->cc, NULL, NULL, argv, environ) != 0)
+		return -1;
+	if (waitpid(pid, &status, 0) != pid)
+		return -1;
+	return (WIFEXITED(status) && (WEXITSTATUS(status) == 0)) ? 0 : -1;
+}
+
+/*
+ * The cache directory must be ours and writable by us only, otherwise
+ * another user could plant the objects we load.
+ */
+static int private_dir(const char *dir)
+{
+	struct stat st;
+	int fd, ok;
+
+	fd = open(dir, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+	if (fd < 0)
+		return 0;
+	ok = (fstat(fd, &st) == 0) && S_ISDIR(st.st_mode) && (st.st_uid == geteuid())
+		&& ((st.st_mode & (S_IWGRP | S_IWOTH)) == 0);
+	close(fd);
+	return ok;
+}
+
+/*
+ * Open a cached object, with the same checks as the directory
+ * @return the descriptor, -1 if there is no object (errno is ENOENT) or it cannot be trusted
+ */
+static int open_object(const char *object)
+{
+	struct stat st;
+	int fd;
+
+	fd = open(object, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+	if (fd < 0)
+		return -1;
+	if ((fstat(fd, &st) != 0) || !S_ISREG(st.st_mode) || (st.st_uid != geteuid())
+			|| ((st.st_mode & (S_IWGRP | S_IWOTH)) != 0)) {
+		close(fd);
+		errno = EPERM;
+		return -1;
+	}
+	return fd;
+}
+
+static void *native_compile(void *arg)
+{
+	pwcet_native_t *n = (pwcet_native_t *) arg;
+	pwcet_jit_t *jit = n->jit;
+	size_t len = strlen(jit->cache_dir) + 64;
+	char *object, *source, *tmp;
+	const long *scratch;
+	native_fn_t *fn;
+	FILE *out;
+	int fd;
+
+	object = (char *) malloc(3 * len);
+	if (object == NULL)
+		return NULL;
+	source = object + len;
+	tmp = source + len;
+	snprintf(object, len, "%s/pwcet-%016llx.so", jit->cache_dir, n->hash);
+	fd = open_object(object);
+	if ((fd < 0) && (errno == ENOENT)) {
+		/* several processes and threads may share the cache: build under a private name */
+		snprintf(source, len, "%s/pwcet-%016llx-XXXXXX.c", jit->cache_dir, n->hash);
+		snprintf(tmp, len, "%s/pwcet-%016llx-XXXXXX.so", jit->cache_dir, n->hash);
+		if ((fd = mkstemps(tmp, 3)) < 0)
+			goto end;
+		close(fd);
+		if ((fd = mkstemps(source, 2)) < 0) {
+			unlink(tmp);
+			goto end;
+		}
+		out = fdopen(fd, "w");
+		if (out == NULL) {
+			close(fd);
+			unlink(source);
+			unlink(tmp);
+			goto end;
+		}
+		fwrite(n->source, 1, n->source_size, out);
+		if ((fclose(out) != 0) || (run_compiler(jit, source, tmp) != 0) || (rename(tmp, object) != 0)) {
+			fprintf(stderr, "pwcet jit: cannot compile %s, the formula is interpreted\n", source);
+			unlink(tmp);
+			goto end;
+		}
+		unlink(source);
+		fd = open_object(object);
+	}
+	if (fd < 0) {
+		fprintf(stderr, "pwcet jit: cannot use %s, the formula is interpreted\n", object);
+		goto end;
+	}
+	/* nobody else can write the directory, the checked file is the one loaded */
+	n->handle = dlopen(object, RTLD_NOW | RTLD_LOCAL);
+	close(fd);
+	if (n->handle == NULL) {
+		fprintf(stderr, "pwcet jit: %s\n", dlerror());
+		goto end;
+	}
+	fn = (native_fn_t *) dlsym(n->handle, "pwcet_native");
+	scratch = (const long *) dlsym(n->handle, "pwcet_native_scratch");
+	if ((fn == NULL) || (scratch == NULL))
+		goto end;
+	n->scratch = (*scratch > 0) ? *scratch : 1;
+	atomic_store_explicit(&n->fn, fn, memory_order_release);
+end:
+	free(object);
+	return NULL;
+}
+
+static int native_bound(void *data, int param_id)
+{
+	struct native_ctx *c = (struct native_ctx *) data;
+	param_value_t pv;
+	c->pv(param_id, &pv, c->data);
+	return pv.bound;
+}
+
+/*
+ * Interface
+ */
+
+pwcet_jit_t *pwcet_jit_new(const char *cache_dir)
+{
+	pwcet_jit_t *jit = (pwcet_jit_t *) calloc(1, sizeof(pwcet_jit_t));
+	const char *cc = getenv("PWCET_CC");
+	const char *tmp = getenv("TMPDIR");
+	size_t len;
+
+	if (jit == NULL)
+		return NULL;
+	if (cache_dir != NULL)
+		jit->cache_dir = strdup(cache_dir);
+	else {
+		/* /tmp is shared: use a directory of our own */
+		if (tmp == NULL)
+			tmp = "/tmp";
+		len = strlen(tmp) + 32;
+		jit->cache_dir = (char *) malloc(len);
+		if (jit->cache_dir != NULL)
+			snprintf(jit->cache_dir, len, "%s/pwcet-%ld", tmp, (long) geteuid());
+	}
+	jit->cc = strdup((cc != NULL) ? cc : "cc");
+	if ((jit->cache_dir == NULL) || (jit->cc == NULL)) {
+		pwcet_jit_free(jit);
+		return NULL;
+	}
+	mkdir(jit->cache_dir, 0700);
+	if (!private_dir(jit->cache_dir)) {
+		fprintf(stderr, "pwcet jit: %s must be a directory owned and only writable by the user\n", jit->cache_dir);
+		pwcet_jit_free(jit);
+		return NULL;
+	}
+	return jit;
+}
+
+void pwcet_jit_free(pwcet_jit_t *jit)
+{
+	free(jit->cache_dir);
+	free(jit->cc);
+	free(jit);
+}
+
+pwcet_native_t *pwcet_jit_load(pwcet_jit_t *jit, formula_t *f)
+{
+	pwcet_native_t *n = (pwcet_native_t *) calloc(1, sizeof(pwcet_native_t));
+	if (n == NULL)
+		return NULL;
+	n->jit = jit;
+	n->f = f;
+	n->joined = 1;
+	atomic_init(&n->fn, NULL);
+	n->source = gen_source(f, &n->source_size);
+	if (n->source == NULL)
+		return n;
+	n->hash = gen_hash(n->source, n->source_size);
+	if (pthread_create(&n->thread, NULL, native_compile, n) == 0)
+		n->joined = 0;
+	return n;
+}
+
+long long pwcet_native_evaluate(pwcet_native_t *n, loopinfo_t *li, param_valuation_t pv, bparam_valuation_t bpv, void *data)
+{
+	native_fn_t *fn = atomic_load_explicit(&n->fn, memory_order_acquire);
+	long long local[NATIVE_SCRATCH], *scratch = local, wcet;
+	struct native_ctx ctx;
+	struct native_env env;
+
+	if (fn == NULL)
+		return evaluate(n->f, li, pv, bpv, data);
+	/* one buffer per call, so that threads can share the handle */
+	if (n->scratch > NATIVE_SCRATCH) {
+		scratch = (long long *) malloc(sizeof(long long) * n->scratch);
+		if (scratch == NULL)
+			return evaluate(n->f, li, pv, bpv, data);
+	}
+	ctx.pv = pv;
+	ctx.data = data;
+	env.data = &ctx;
+	env.hier = li->hier;
+	env.bnd = li->bnd;
+	env.bound = native_bound;
+	env.bparam = bpv;
+	wcet = fn(&env, scratch);
+	if (scratch != local)
+		free(scratch);
+	return wcet;
+}
+
+int pwcet_native_ready(pwcet_native_t *n, int wait)
+{
+	if (wait && !n->joined) {
+		pthread_join(n->thread, NULL);
+		n->joined = 1;
+	}
+	return atomic_load(&n->fn) != NULL;
+}
+
+void pwcet_native_free(pwcet_native_t *n)
+{
+	if (!n->joined)
+		pthread_join(n->thread, NULL);
+	if (n->handle != NULL)
+		dlclose(n->handle);
+	free(n->source);
+	free(n);
+}
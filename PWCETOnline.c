@@ -0,0 +1,532 @@
+/* ----------------------------------------------------------------------------
+   Copyright (C) 2020, Université de Lille, Lille, FRANCE
+
+   This file is part of WSymb.
+
+   WSymb is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation ; either version 2 of
+   the License, or (at your option) any later version.
+
+   WSymb is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY ; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program ; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+   ---------------------------------------------------------------------------- */
+
+#ifdef __linux__
+#define _GNU_SOURCE		/* pthread_setaffinity_np */
+#endif
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "include/PWCET.h"
+#include "pwcet/include/pwcet-online.h"
+
+/* A node that must be computed again when a parameter changes */
+struct online_use_s {
+	int node;
+	int next;				/* next use of the same parameter, -1 if none */
+};
+
+/* Bounded multi-producer queue, each cell carries the position it is ready for */
+struct pwcet_update_s {
+	atomic_size_t seq;
+	int param_id;
+	int value;
+};
+
+struct pwcet_online_s {
+	formula_t *f;
+	loopinfo_t *li;
+	param_valuation_t *pv;
+	void *data;
+
+	/* evaluator thread only */
+	int max_param;
+	int *values;
+	char *used;				/* parameters the formula depends on */
+	unsigned long version;
+	evalctx_t ctx;
+
+	/* incremental evaluation, see plan() */
+	formula_t **nodes;			/* in pre-order, without the subtrees of BOOLMULT nodes */
+	int *parent;				/* index of the parent in nodes, -1 for the root */
+	char *dirty;
+	int node_count;
+	int *first_use;				/* first use of each parameter, -1 if none */
+	struct online_use_s *uses;
+	int use_count;
+
+	struct pwcet_update_s *queue;
+	size_t mask;
+	atomic_size_t enqueue_pos;
+	size_t dequeue_pos;
+
+	/* sleeping evaluator */
+	pthread_mutex_t lock;
+	pthread_cond_t wakeup;
+	atomic_int sleeping;
+	atomic_int stop;
+	pthread_t thread;
+	int started;
+	int cpu;
+
+	/* published result */
+	atomic_uint seq;
+	_Atomic long long wcet;
+	atomic_ulong pub_version;
+	_Atomic unsigned long long applied;
+};
+
+/* bparam_valuation_t has no user data, the evaluator thread finds its state here */
+static _Thread_local pwcet_online_t *online_self;
+
+/*
+ * Valuation functions
+ */
+
+static void online_valuation(int param_id, param_value_t *param_val, void *data)
+{
+	pwcet_online_t *o = (pwcet_online_t *) data;
+	if ((param_id >= 0) && (param_id <= o->max_param) && o->used[param_id] == 1) {
+		param_val->bound = o->values[param_id];
+		return;
+	}
+	if (o->pv == NULL) {
+		fprintf(stderr, "pwcet online: no valuation for parameter %d\n", param_id);
+		abort();
+	}
+	o->pv(param_id, param_val, o->data);
+}
+
+static bparam_value_t online_bparam(int bparam_id)
+{
+	pwcet_online_t *o = online_self;
+	if ((bparam_id < 0) || (bparam_id > o->max_param)) {
+		fprintf(stderr, "pwcet online: boolean parameter %d out of range\n", bparam_id);
+		abort();
+	}
+	return o->values[bparam_id];
+}
+
+/*
+ * Parameters the formula depends on: 1 for loop bounds and boolean
+ * parameters, which the evaluator owns, 2 for the others
+ */
+static void mark_condition(pwcet_online_t *o, condition_t *cdt)
+{
+	int i;
+	for (i = 0; i < cdt->terms_number; i++) {
+		int id = cdt->terms[i].value;
+		if ((cdt->terms[i].kind == BOOL_PARAM) && (id >= 0) && (id <= o->max_param))
+			o->used[id] = 1;
+	}
+}
+
+static void mark_node(pwcet_online_t *o, formula_t *f)
+{
+	int i;
+	switch (f->kind) {
+		case KIND_LOOP:
+			if ((f->param_id > IDENT_NONE) && (f->param_id <= o->max_param))
+				o->used[f->param_id] = 1;
+			break;
+		case KIND_ANN:
+		case KIND_AWCET:
+			if ((f->param_id > IDENT_NONE) && (f->param_id <= o->max_param) && (o->used[f->param_id] == 0))
+				o->used[f->param_id] = 2;
+			break;
+		case KIND_PARAM_LOOP:
+			mark_condition(o, f->condition);
+			break;
+		case BOOL_CONDITIONS:
+			for (i = 0; i < f->opdata.children_count; i++)
+				mark_condition(o, &f->condition[i]);
+			break;
+	}
+}
+
+static void mark_params(pwcet_online_t *o, formula_t *f)
+{
+	walk_t w;
+	walk_frame_t *top;
+	walk_init(&w, f);
+	while ((top = walk_top(&w)) != NULL) {
+		if (top->next == 0)
+			mark_node(o, top->f);
+		if (top->next < formula_child_count(top->f))
+			walk_push(&w, &top->f->children[top->next++]);
+		else
+			walk_pop(&w);
+	}
+	walk_release(&w);
+}
+
+/*
+ * Incremental evaluation
+ *
+ * Operators only read the abstract WCETs of their children, which stay in the
+ * formula between evaluations. After an update, only the nodes that use a
+ * changed parameter and their ancestors are computed again, children first.
+ * The subtree guarded by a BOOLMULT node is computed by the BOOLMULT itself:
+ * it is one node here, which uses every parameter of the subtree.
+ */
+static int plan_use(pwcet_online_t *o, int param_id, int node)
+{
+	struct online_use_s *uses;
+	if ((param_id < 0) || (param_id > o->max_param) || (o->used[param_id] != 1))
+		return 0;
+	if ((o->use_count & (o->use_count - 1)) == 0) {
+		uses = (struct online_use_s *) realloc(o->uses, sizeof(struct online_use_s) * (o->use_count > 0 ? 2 * o->use_count : 1));
+		if (uses == NULL)
+			return -1;
+		o->uses = uses;
+	}
+	o->uses[o->use_count].node = node;
+	o->uses[o->use_count].next = o->first_use[param_id];
+	o->first_use[param_id] = o->use_count++;
+	return 0;
+}
+
+/* Record the parameters f uses itself, not through its children */
+static int plan_params(pwcet_online_t *o, formula_t *f, int node)
+{
+	condition_t *cdt;
+	int i, j, n;
+	switch (f->kind) {
+		case KIND_LOOP:
+			return (f->param_id != IDENT_NONE) ? plan_use(o, f->param_id, node) : 0;
+		case KIND_PARAM_LOOP:
+			cdt = f->condition;
+			n = 1;
+			break;
+		case BOOL_CONDITIONS:
+			cdt = f->condition;
+			n = f->opdata.children_count;
+			break;
+		default:
+			return 0;
+	}
+	for (i = 0; i < n; i++)
+		for (j = 0; j < cdt[i].terms_number; j++)
+			if ((cdt[i].terms[j].kind == BOOL_PARAM) && (plan_use(o, cdt[i].terms[j].value, node) != 0))
+				return -1;
+	return 0;
+}
+
+/*
+ * List the nodes of o->f and the parameters they use
+ * @return 0, -1 if out of memory
+ */
+static int plan(pwcet_online_t *o)
+{
+	int total = formula_node_count(o->f), top = 0, sub, i, id, res = -1;
+	formula_t **stack, *f, *g;
+	int *parents;
+
+	o->nodes = (formula_t **) malloc(sizeof(formula_t *) * total);
+	o->parent = (int *) malloc(sizeof(int) * total);
+	o->dirty = (char *) calloc(total, 1);
+	o->first_use = (int *) malloc(sizeof(int) * (o->max_param + 1));
+	stack = (formula_t **) malloc(sizeof(formula_t *) * total);
+	parents = (int *) malloc(sizeof(int) * total);
+	if ((o->nodes == NULL) || (o->parent == NULL) || (o->dirty == NULL) || (o->first_use == NULL)
+			|| (stack == NULL) || (parents == NULL))
+		goto end;
+	for (i = 0; i <= o->max_param; i++)
+		o->first_use[i] = -1;
+	stack[top] = o->f;
+	parents[top++] = -1;
+	while (top > 0) {
+		f = stack[--top];
+		id = o->node_count++;
+		o->nodes[id] = f;
+		o->parent[id] = parents[top];
+		if (f->kind == KIND_BOOLMULT) {
+			/* the whole subtree, on the free part of the stack */
+			stack[top] = f;
+			sub = top + 1;
+			while (sub > top) {
+				g = stack[--sub];
+				if (plan_params(o, g, id) != 0)
+					goto end;
+				for (i = 0; i < formula_child_count(g); i++)
+					stack[sub++] = &g->children[i];
+			}
+			continue;
+		}
+		if (plan_params(o, f, id) != 0)
+			goto end;
+		for (i = formula_child_count(f) - 1; i >= 0; i--) {
+			stack[top] = &f->children[i];
+			parents[top++] = id;
+		}
+	}
+	res = 0;
+end:
+	free(stack);
+	free(parents);
+	return res;
+}
+
+/* Mark the nodes using param_id, and their ancestors */
+static void plan_dirty(pwcet_online_t *o, int param_id)
+{
+	int u, n;
+	for (u = o->first_use[param_id]; u >= 0; u = o->uses[u].next)
+		for (n = o->uses[u].node; (n >= 0) && !o->dirty[n]; n = o->parent[n])
+			o->dirty[n] = 1;
+}
+
+/* Compute the marked nodes again, children (greater indices) first */
+static long long plan_evaluate(pwcet_online_t *o)
+{
+	formula_t *f = o->f;
+	int i;
+	for (i = o->node_count - 1; i >= 0; i--) {
+		if (o->dirty[i]) {
+			compute_combine(&o->ctx, o->nodes[i]);
+			o->dirty[i] = 0;
+		}
+	}
+	return (f->aw.eta_count == 0) ? f->aw.others : f->aw.eta[0];
+}
+
+/*
+ * Publication
+ */
+
+static void publish(pwcet_online_t *o, long long wcet, unsigned long long applied)
+{
+	unsigned s = atomic_load_explicit(&o->seq, memory_order_relaxed);
+	atomic_store_explicit(&o->seq, s + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	atomic_store_explicit(&o->wcet, wcet, memory_order_relaxed);
+	atomic_store_explicit(&o->pub_version, o->version, memory_order_relaxed);
+	atomic_store_explicit(&o->applied, applied, memory_order_relaxed);
+	atomic_store_explicit(&o->seq, s + 2, memory_order_release);
+}
+
+void pwcet_online_read(pwcet_online_t *o, pwcet_online_result_t *res)
+{
+	unsigned s1, s2;
+	do {
+		s1 = atomic_load_explicit(&o->seq, memory_order_acquire);
+		res->wcet = atomic_load_explicit(&o->wcet, memory_order_relaxed);
+		res->version = atomic_load_explicit(&o->pub_version, memory_order_relaxed);
+		res->applied = atomic_load_explicit(&o->applied, memory_order_relaxed);
+		atomic_thread_fence(memory_order_acquire);
+		s2 = atomic_load_explicit(&o->seq, memory_order_relaxed);
+	} while ((s1 & 1) || (s1 != s2));
+}
+
+/*
+ * Update queue
+ */
+
+int pwcet_online_set(pwcet_online_t *o, int param_id, int value, unsigned long long *ticket)
+{
+	struct pwcet_update_s *cell;
+	size_t pos, seq;
+
+	if ((param_id < 0) || (param_id > o->max_param))
+		return -1;
+	pos = atomic_load_explicit(&o->enqueue_pos, memory_order_relaxed);
+	for (;;) {
+		cell = &o->queue[pos & o->mask];
+		seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+		if (seq == pos) {
+			if (atomic_compare_exchange_weak_explicit(&o->enqueue_pos, &pos, pos + 1,
+					memory_order_relaxed, memory_order_relaxed))
+				break;
+		} else if (seq < pos)
+			return -1;	/* full */
+		else
+			pos = atomic_load_explicit(&o->enqueue_pos, memory_order_relaxed);
+	}
+	cell->param_id = param_id;
+	cell->value = value;
+	atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+	if (ticket != NULL)
+		*ticket = pos + 1;
+
+	/*
+	 * Either the evaluator sees the update when it checks the queue after
+	 * setting sleeping, or we see sleeping set: both sides need a full fence
+	 * between their store and their load.
+	 */
+	atomic_thread_fence(memory_order_seq_cst);
+	if (atomic_load(&o->sleeping)) {
+		pthread_mutex_lock(&o->lock);
+		atomic_store(&o->sleeping, 0);
+		pthread_cond_signal(&o->wakeup);
+		pthread_mutex_unlock(&o->lock);
+	}
+	return 0;
+}
+
+static int queue_empty(pwcet_online_t *o)
+{
+	struct pwcet_update_s *cell = &o->queue[o->dequeue_pos & o->mask];
+	return atomic_load_explicit(&cell->seq, memory_order_acquire) != o->dequeue_pos + 1;
+}
+
+/*
+ * Apply every pending update, a burst on the same parameter only keeps the last value
+ * @return 1 if the formula must be evaluated again, the nodes to compute being marked
+ */
+static int drain(pwcet_online_t *o, unsigned long long *applied)
+{
+	struct pwcet_update_s *cell;
+	int dirty = 0;
+
+	while (!queue_empty(o)) {
+		cell = &o->queue[o->dequeue_pos & o->mask];
+		if ((o->values[cell->param_id] != cell->value) && (o->used[cell->param_id] == 1)) {
+			plan_dirty(o, cell->param_id);
+			dirty = 1;
+		}
+		o->values[cell->param_id] = cell->value;
+		*applied = o->dequeue_pos + 1;
+		atomic_store_explicit(&cell->seq, o->dequeue_pos + o->mask + 1, memory_order_release);
+		o->dequeue_pos++;
+	}
+	return dirty;
+}
+
+/*
+ * Evaluator thread
+ */
+
+static void *online_main(void *arg)
+{
+	pwcet_online_t *o = (pwcet_online_t *) arg;
+	unsigned long long applied = 0, published;
+	long long wcet;
+
+#ifdef __linux__
+	if (o->cpu >= 0) {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(o->cpu, &set);
+		if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+			fprintf(stderr, "pwcet online: cannot pin the evaluator to cpu %d\n", o->cpu);
+	}
+#endif
+	online_self = o;
+	drain(o, &applied);
+	wcet = evaluate(o->f, o->li, online_valuation, online_bparam, o);
+	memset(o->dirty, 0, o->node_count);
+	o->version++;
+	publish(o, wcet, applied);
+	published = applied;
+
+	while (!atomic_load(&o->stop)) {
+		if (drain(o, &applied)) {
+			wcet = plan_evaluate(o);
+			o->version++;
+		}
+		if (applied != published) {
+			publish(o, wcet, applied);
+			published = applied;
+			continue;
+		}
+		pthread_mutex_lock(&o->lock);
+		atomic_store(&o->sleeping, 1);
+		atomic_thread_fence(memory_order_seq_cst);	/* see pwcet_online_set() */
+		while (atomic_load(&o->sleeping) && queue_empty(o) && !atomic_load(&o->stop))
+			pthread_cond_wait(&o->wakeup, &o->lock);
+		atomic_store(&o->sleeping, 0);
+		pthread_mutex_unlock(&o->lock);
+	}
+	return NULL;
+}
+
+static void online_release(pwcet_online_t *o)
+{
+	free(o->values);
+	free(o->used);
+	free(o->queue);
+	free(o->nodes);
+	free(o->parent);
+	free(o->dirty);
+	free(o->first_use);
+	free(o->uses);
+	free(o);
+}
+
+pwcet_online_t *pwcet_online_new(formula_t *f, loopinfo_t *li, int max_param, int queue_size, param_valuation_t pv, void *data)
+{
+	pwcet_online_t *o;
+	size_t i, size = 1;
+
+	if (max_param < 0)
+		return NULL;
+	while ((int) size < queue_size)
+		size <<= 1;
+	o = (pwcet_online_t *) calloc(1, sizeof(pwcet_online_t));
+	if (o == NULL)
+		return NULL;
+	o->values = (int *) calloc(max_param + 1, sizeof(int));
+	o->used = (char *) calloc(max_param + 1, 1);
+	o->queue = (struct pwcet_update_s *) calloc(size, sizeof(struct pwcet_update_s));
+	if ((o->values == NULL) || (o->used == NULL) || (o->queue == NULL)) {
+		online_release(o);
+		return NULL;
+	}
+	for (i = 0; i < size; i++)
+		atomic_init(&o->queue[i].seq, i);
+	o->mask = size - 1;
+	o->f = f;
+	o->li = li;
+	o->pv = pv;
+	o->data = data;
+	o->max_param = max_param;
+	o->ctx.li = li;
+	o->ctx.param_valuation = online_valuation;
+	o->ctx.bparam_valuation = online_bparam;
+	o->ctx.pv_data = o;
+	mark_params(o, f);
+	/* the evaluator owns f, which is never a sub-formula */
+	compute_eta_demand(f, li);
+	if (plan(o) != 0) {
+		online_release(o);
+		return NULL;
+	}
+	pthread_mutex_init(&o->lock, NULL);
+	pthread_cond_init(&o->wakeup, NULL);
+	return o;
+}
+
+int pwcet_online_start(pwcet_online_t *o, int cpu)
+{
+	o->cpu = cpu;
+	if (pthread_create(&o->thread, NULL, online_main, o) != 0)
+		return -1;
+	o->started = 1;
+	return 0;
+}
+
+void pwcet_online_free(pwcet_online_t *o)
+{
+	if (o->started) {
+		pthread_mutex_lock(&o->lock);
+		atomic_store(&o->stop, 1);
+		pthread_cond_signal(&o->wakeup);
+		pthread_mutex_unlock(&o->lock);
+		pthread_join(o->thread, NULL);
+	}
+	pthread_mutex_destroy(&o->lock);
+	pthread_cond_destroy(&o->wakeup);
+	online_release(o);
+}
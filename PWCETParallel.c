@@ -0,0 +1,396 @@
+/* ----------------------------------------------------------------------------
+   Copyright (C) 2020, Université de Lille, Lille, FRANCE
+
+   This file is part of WSymb.
+
+   WSymb is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation ; either version 2 of
+   the License, or (at your option) any later version.
+
+   WSymb is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY ; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program ; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+   ---------------------------------------------------------------------------- */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "include/PWCET.h"
+#include "pwcet/include/pwcet-parallel.h"
+
+struct pwcet_task_s {
+	formula_t *f;
+	int index;				/* pre-order index of f, to find its size */
+	atomic_int *pending;			/* tasks the parent still waits for */
+};
+typedef struct pwcet_task_s pwcet_task_t;
+
+/* Owners push and pop at the bottom, thieves steal at the top */
+struct pwcet_deque_s {
+	pthread_mutex_t lock;
+	pwcet_task_t *tasks;
+	int top, bottom, capacity;
+};
+typedef struct pwcet_deque_s pwcet_deque_t;
+
+struct pwcet_worker_s {
+	struct pwcet_pool_s *pool;
+	unsigned seed;				/* victim selection */
+	pwcet_deque_t deque;
+	pthread_t thread;
+};
+typedef struct pwcet_worker_s pwcet_worker_t;
+
+struct pwcet_pool_s {
+	int nworkers;				/* worker threads, plus one slot for the caller */
+	pwcet_worker_t *workers;
+	pthread_mutex_t lock;			/* sleeping workers */
+	pthread_cond_t work;
+	atomic_int queued;
+	int stop;
+	pthread_mutex_t job;			/* one evaluation at a time */
+	evalctx_t ctx;
+	int *sizes;
+	int threshold;
+};
+
+/*
+ * Deques
+ */
+
+static void deque_push(pwcet_deque_t *d, pwcet_task_t *t)
+{
+	pthread_mutex_lock(&d->lock);
+	if (d->bottom == d->capacity) {
+		int n = d->bottom - d->top;
+		if ((d->top > 0) && (n < d->capacity / 2)) {
+			memmove(d->tasks, d->tasks + d->top, sizeof(pwcet_task_t) * n);
+		} else {
+			d->capacity = (d->capacity == 0) ? 64 : 2 * d->capacity;
+			d->tasks = (pwcet_task_t *) realloc(d->tasks, sizeof(pwcet_task_t) * d->capacity);
+			if (d->tasks == NULL) {
+				fprintf(stderr, "evaluate_parallel: out of memory\n");
+				abort();
+			}
+			memmove(d->tasks, d->tasks + d->top, sizeof(pwcet_task_t) * n);
+		}
+		d->top = 0;
+		d->bottom = n;
+	}
+	d->tasks[d->bottom++] = *t;
+	pthread_mutex_unlock(&d->lock);
+}
+
+static int deque_pop(pwcet_deque_t *d, pwcet_task_t *t)
+{
+	int res = 0;
+	pthread_mutex_lock(&d->lock);
+	if (d->bottom > d->top) {
+		*t = d->tasks[--d->bottom];
+		res = 1;
+	}
+	pthread_mutex_unlock(&d->lock);
+	return res;
+}
+
+static int deque_steal(pwcet_deque_t *d, pwcet_task_t *t)
+{
+	int res = 0;
+	pthread_mutex_lock(&d->lock);
+	if (d->bottom > d->top) {
+		*t = d->tasks[d->top++];
+		res = 1;
+	}
+	pthread_mutex_unlock(&d->lock);
+	return res;
+}
+
+/*
+ * Scheduling
+ */
+
+static void push_task(pwcet_worker_t *w, pwcet_task_t *t)
+{
+	pwcet_pool_t *pool = w->pool;
+	deque_push(&w->deque, t);
+	atomic_fetch_add(&pool->queued, 1);
+	pthread_mutex_lock(&pool->lock);
+	pthread_cond_signal(&pool->work);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+static int get_task(pwcet_worker_t *w, pwcet_task_t *t)
+{
+	pwcet_pool_t *pool = w->pool;
+	int i, victim;
+
+	if (deque_pop(&w->deque, t))
+		goto found;
+	if (atomic_load(&pool->queued) == 0)
+		return 0;
+	victim = rand_r(&w->seed) % pool->nworkers;
+	for (i = 0; i < pool->nworkers; i++) {
+		pwcet_worker_t *v = &pool->workers[(victim + i) % pool->nworkers];
+		if ((v != w) && deque_steal(&v->deque, t))
+			goto found;
+	}
+	return 0;
+found:
+	atomic_fetch_sub(&pool->queued, 1);
+	return 1;
+}
+
+static void run_task(pwcet_worker_t *w, pwcet_task_t *t);
+
+/* Run other tasks until the children of the current node are done */
+static void help_until(pwcet_worker_t *w, atomic_int *pending)
+{
+	pwcet_task_t t;
+	while (atomic_load(pending) > 0) {
+		if (get_task(w, &t))
+			run_task(w, &t);
+		else
+			sched_yield();
+	}
+}
+
+#define RUN_CHAIN 1			/* the single child of the node is big */
+#define RUN_SPLIT 2			/* some children of the node are tasks, data is their counter */
+
+/*
+ * Compute f, whose pre-order index is index: big single children are computed
+ * by this worker, big children of SEQ and ALT nodes become tasks except the
+ * last one, which this worker keeps. The frames of the walker hold the index
+ * of their node in value[0].
+ */
+static void run_node(pwcet_worker_t *w, formula_t *f, int index)
+{
+	pwcet_pool_t *pool = w->pool;
+	atomic_int *pending;
+	pwcet_task_t t;
+	walk_t walk;
+	walk_frame_t *top;
+	formula_t *n;
+	int i, child, last, last_index;
+
+	walk_init(&walk, f);
+	walk_top(&walk)->value[0] = index;
+	while ((top = walk_top(&walk)) != NULL) {
+		n = top->f;
+		index = top->value[0];
+		if (top->flags == RUN_CHAIN) {
+			compute_combine(&pool->ctx, n);
+			walk_pop(&walk);
+			continue;
+		}
+		if (top->flags == RUN_SPLIT) {
+			pending = (atomic_int *) top->data;
+			help_until(w, pending);
+			free(pending);
+			compute_combine(&pool->ctx, n);
+			walk_pop(&walk);
+			continue;
+		}
+		if (pool->sizes[index] < pool->threshold) {
+			compute_node(&pool->ctx, n);
+			walk_pop(&walk);
+			continue;
+		}
+		switch (n->kind) {
+			case KIND_SEQ:
+			case KIND_ALT:
+				break;
+			case KIND_LOOP:
+			case KIND_ANN:
+			case KIND_INTMULT:
+			case KIND_PARAM_LOOP:
+				top->flags = RUN_CHAIN;
+				walk_push(&walk, &n->children[0])->value[0] = index + 1;
+				continue;
+			default:
+				compute_node(&pool->ctx, n);
+				walk_pop(&walk);
+				continue;
+		}
+
+		pending = (atomic_int *) malloc(sizeof(atomic_int));
+		if (pending == NULL) {
+			fprintf(stderr, "evaluate_parallel: out of memory\n");
+			abort();
+		}
+		atomic_init(pending, 0);
+		top->flags = RUN_SPLIT;
+		top->data = pending;
+		last = -1;
+		last_index = 0;
+		child = index + 1;
+		for (i = 0; i < n->opdata.children_count; i++) {
+			if (pool->sizes[child] >= pool->threshold) {
+				if (last >= 0) {
+					t.f = &n->children[last];
+					t.index = last_index;
+					t.pending = pending;
+					atomic_fetch_add(pending, 1);
+					push_task(w, &t);
+				}
+				last = i;
+				last_index = child;
+			} else
+				compute_node(&pool->ctx, &n->children[i]);
+			child += pool->sizes[child];
+		}
+		if (last >= 0)
+			walk_push(&walk, &n->children[last])->value[0] = last_index;
+	}
+	walk_release(&walk);
+}
+
+static void run_task(pwcet_worker_t *w, pwcet_task_t *t)
+{
+	run_node(w, t->f, t->index);
+	atomic_fetch_sub(t->pending, 1);
+}
+
+static void *worker_main(void *arg)
+{
+	pwcet_worker_t *w = (pwcet_worker_t *) arg;
+	pwcet_pool_t *pool = w->pool;
+	pwcet_task_t t;
+
+	for (;;) {
+		if (get_task(w, &t)) {
+			run_task(w, &t);
+			continue;
+		}
+		pthread_mutex_lock(&pool->lock);
+		while (!pool->stop && (atomic_load(&pool->queued) == 0))
+			pthread_cond_wait(&pool->work, &pool->lock);
+		if (pool->stop) {
+			pthread_mutex_unlock(&pool->lock);
+			return NULL;
+		}
+		pthread_mutex_unlock(&pool->lock);
+	}
+}
+
+/*
+ * Subtree sizes, in pre-order
+ */
+
+/* Frames hold the pre-order index of their node in value[0] */
+static void fill_sizes(formula_t *f, int *sizes)
+{
+	walk_t w;
+	walk_frame_t *top;
+	int next = 1;
+
+	walk_init(&w, f);
+	while ((top = walk_top(&w)) != NULL) {
+		if (top->next < formula_child_count(top->f)) {
+			walk_push(&w, &top->f->children[top->next++])->value[0] = next++;
+			continue;
+		}
+		sizes[top->value[0]] = next - top->value[0];
+		walk_pop(&w);
+	}
+	walk_release(&w);
+}
+
+/*
+ * Pool
+ */
+
+pwcet_pool_t *pwcet_pool_new(int nthreads)
+{
+	pwcet_pool_t *pool;
+	int i;
+
+	if (nthreads < 0)
+		return NULL;
+	pool = (pwcet_pool_t *) calloc(1, sizeof(pwcet_pool_t));
+	if (pool == NULL)
+		return NULL;
+	pool->nworkers = nthreads + 1;
+	pool->workers = (pwcet_worker_t *) calloc(pool->nworkers, sizeof(pwcet_worker_t));
+	if (pool->workers == NULL) {
+		free(pool);
+		return NULL;
+	}
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->work, NULL);
+	pthread_mutex_init(&pool->job, NULL);
+	atomic_init(&pool->queued, 0);
+	for (i = 0; i < pool->nworkers; i++) {
+		pool->workers[i].pool = pool;
+		pool->workers[i].seed = i + 1;
+		pthread_mutex_init(&pool->workers[i].deque.lock, NULL);
+	}
+	/* the last slot is used by the thread calling evaluate_parallel() */
+	for (i = 0; i < nthreads; i++) {
+		if (pthread_create(&pool->workers[i].thread, NULL, worker_main, &pool->workers[i]) != 0) {
+			pool->nworkers = i + 1;
+			pwcet_pool_free(pool);
+			return NULL;
+		}
+	}
+	return pool;
+}
+
+void pwcet_pool_free(pwcet_pool_t *pool)
+{
+	int i;
+	pthread_mutex_lock(&pool->lock);
+	pool->stop = 1;
+	pthread_cond_broadcast(&pool->work);
+	pthread_mutex_unlock(&pool->lock);
+	for (i = 0; i < pool->nworkers - 1; i++)
+		pthread_join(pool->workers[i].thread, NULL);
+	for (i = 0; i < pool->nworkers; i++) {
+		pthread_mutex_destroy(&pool->workers[i].deque.lock);
+		free(pool->workers[i].deque.tasks);
+	}
+	pthread_mutex_destroy(&pool->lock);
+	pthread_cond_destroy(&pool->work);
+	pthread_mutex_destroy(&pool->job);
+	free(pool->workers);
+	free(pool);
+}
+
+long long evaluate_parallel(pwcet_pool_t *pool, formula_t *f, loopinfo_t *li, param_valuation_t pv, bparam_valuation_t bpv, void *data, int threshold)
+{
+	pwcet_worker_t *self = &pool->workers[pool->nworkers - 1];
+	int *sizes;
+
+	sizes = (int *) malloc(sizeof(int) * formula_node_count(f));
+	if (sizes == NULL)
+		return evaluate(f, li, pv, bpv, data);
+	fill_sizes(f, sizes);
+
+	pthread_mutex_lock(&pool->job);
+	pool->ctx.li = li;
+	pool->ctx.param_valuation = pv;
+	pool->ctx.bparam_valuation = bpv;
+	pool->ctx.pv_data = data;
+	pool->sizes = sizes;
+	pool->threshold = (threshold > 0) ? threshold : PWCET_PARALLEL_THRESHOLD;
+	run_node(self, f, 0);
+	pool->sizes = NULL;
+	pthread_mutex_unlock(&pool->job);
+
+	free(sizes);
+	if (f->aw.eta_count == 0) {
+		return f->aw.others;
+	} else {
+		return f->aw.eta[0];
+	}
+}
@@ -0,0 +1,511 @@
+/* ----------------------------------------------------------------------------
+   Copyright (C) 2020, Université de Lille, Lille, FRANCE
+
+   This file is part of WSymb.
+
+   WSymb is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation ; either version 2 of
+   the License, or (at your option) any later version.
+
+   WSymb is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY ; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program ; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+   ---------------------------------------------------------------------------- */
+
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "include/PWCET.h"
+#include "pwcet/include/pwcet-registry.h"
+
+/* A published formula. Never evaluated, only copied by the readers. */
+struct pwcet_version_s {
+	formula_t *f;
+	unsigned long serial;			/* unique among all the versions of the registry */
+	int *deps;				/* identifiers of the KIND_AWCET leaves of f, each once */
+	int dep_count;
+	unsigned long retired;			/* epoch at which the version was replaced */
+	struct pwcet_version_s *next_retired;
+};
+typedef struct pwcet_version_s pwcet_version_t;
+
+/* Identifiers whose binding uses a given identifier */
+struct pwcet_users_s {
+	int *ids;
+	int count;
+	int size;
+};
+
+struct pwcet_registry_s {
+	int max_id;
+	_Atomic(pwcet_version_t *) *slots;
+	atomic_ulong *gen;			/* bumped when a binding, or one of its dependencies, changes */
+	struct pwcet_users_s *users;		/* reverse of the deps of the bindings, writers only */
+	atomic_ulong epoch;
+	unsigned long serial;
+	pthread_mutex_t lock;			/* serializes writers, protects readers and retired */
+	struct pwcet_reader_s *readers;
+	pwcet_version_t *retired;
+};
+
+#define LOCAL_IDLE 0
+#define LOCAL_BUSY 1
+
+/* Private copy of a binding, owned by a reader */
+struct pwcet_local_s {
+	formula_t *f;
+	unsigned long serial;
+	unsigned long gen;
+	unsigned long valuation;
+	int cached;
+	int state;
+};
+
+struct pwcet_reader_s {
+	pwcet_registry_t *reg;
+	atomic_ulong epoch;			/* 0 when the reader does not access published versions */
+	unsigned long valuation;		/* bumped by pwcet_reader_invalidate() */
+	struct pwcet_local_s *local;
+	loopinfo_t *li;
+	param_valuation_t *pv;
+	bparam_valuation_t *bpv;
+	void *data;
+	int depth;				/* nesting of pwcet_reader_evaluate() */
+	formula_t **replaced;			/* private copies released when depth drops to 0 */
+	int replaced_count;
+	int replaced_size;
+	struct pwcet_reader_s *next;
+};
+
+/*
+ * Writer side
+ */
+
+/*
+ * Collect the identifiers of the KIND_AWCET leaves of f that can be bound
+ * @param seen max_id + 1 zeroed flags, zeroed again on return
+ * @return 0, -1 if out of memory
+ */
+static int collect_deps(pwcet_version_t *v, formula_t *f, int max_id, char *seen)
+{
+	formula_t **stack = NULL, **grown;
+	int top = 0, size = 0, i, id, res = 0;
+
+	v->dep_count = 0;
+	for (;;) {
+		if ((f->kind == KIND_AWCET) && (f->param_id >= 0) && (f->param_id <= max_id) && !seen[f->param_id]) {
+			seen[f->param_id] = 1;
+			v->dep_count++;
+		}
+		/* children are pushed in reverse, so that they are visited in order */
+		for (i = formula_child_count(f) - 1; i >= 0; i--) {
+			if (top == size) {
+				size = (size > 0) ? 2 * size : 64;
+				grown = (formula_t **) realloc(stack, sizeof(formula_t *) * size);
+				if (grown == NULL) {
+					res = -1;
+					goto end;
+				}
+				stack = grown;
+			}
+			stack[top++] = &f->children[i];
+		}
+		if (top == 0)
+			break;
+		f = stack[--top];
+	}
+	if (v->dep_count > 0) {
+		v->deps = (int *) malloc(sizeof(int) * v->dep_count);
+		if (v->deps == NULL)
+			res = -1;
+	}
+end:
+	v->dep_count = 0;
+	for (id = 0; id <= max_id; id++) {
+		if (seen[id] && (res == 0))
+			v->deps[v->dep_count++] = id;
+		seen[id] = 0;
+	}
+	free(stack);
+	return res;
+}
+
+static void version_free(pwcet_version_t *v)
+{
+	free(v->f);
+	free(v->deps);
+	free(v);
+}
+
+static pwcet_version_t *version_new(pwcet_registry_t *reg, formula_t *f, char *seen)
+{
+	pwcet_version_t *v = (pwcet_version_t *) calloc(1, sizeof(pwcet_version_t));
+	if (v == NULL)
+		return NULL;
+	v->f = formula_clone(f);
+	if ((v->f == NULL) || (collect_deps(v, f, reg->max_id, seen) != 0)) {
+		version_free(v);
+		return NULL;
+	}
+	v->serial = ++reg->serial;
+	return v;
+}
+
+/* Free the retired versions no reader can see anymore, lock held */
+static void reclaim(pwcet_registry_t *reg)
+{
+	unsigned long min = ULONG_MAX;
+	struct pwcet_reader_s *r;
+	pwcet_version_t **pv;
+
+	for (r = reg->readers; r != NULL; r = r->next) {
+		unsigned long e = atomic_load(&r->epoch);
+		if ((e != 0) && (e < min))
+			min = e;
+	}
+	pv = &reg->retired;
+	while (*pv != NULL) {
+		pwcet_version_t *v = *pv;
+		if (v->retired <= min) {
+			*pv = v->next_retired;
+			version_free(v);
+		} else
+			pv = &v->next_retired;
+	}
+}
+
+static int users_add(pwcet_registry_t *reg, int dep, int id)
+{
+	struct pwcet_users_s *u = &reg->users[dep];
+	int *grown;
+	if (u->count == u->size) {
+		grown = (int *) realloc(u->ids, sizeof(int) * ((u->size > 0) ? 2 * u->size : 4));
+		if (grown == NULL)
+			return -1;
+		u->ids = grown;
+		u->size = (u->size > 0) ? 2 * u->size : 4;
+	}
+	u->ids[u->count++] = id;
+	return 0;
+}
+
+static void users_remove(pwcet_registry_t *reg, int dep, int id)
+{
+	struct pwcet_users_s *u = &reg->users[dep];
+	int i;
+	for (i = 0; i < u->count; i++) {
+		if (u->ids[i] == id) {
+			u->ids[i] = u->ids[--u->count];
+			return;
+		}
+	}
+}
+
+/*
+ * Invalidate the cached results of id and of every binding using it, lock held
+ * @param queue max_id + 1 free entries
+ * @param seen max_id + 1 zeroed flags, zeroed again on return
+ */
+static void bump_dependents(pwcet_registry_t *reg, int id, int *queue, char *seen)
+{
+	struct pwcet_users_s *u;
+	int head = 0, tail = 0, i;
+
+	seen[id] = 1;
+	queue[tail++] = id;
+	while (head < tail) {
+		id = queue[head++];
+		atomic_fetch_add(&reg->gen[id], 1);
+		u = &reg->users[id];
+		for (i = 0; i < u->count; i++) {
+			if (!seen[u->ids[i]]) {
+				seen[u->ids[i]] = 1;
+				queue[tail++] = u->ids[i];
+			}
+		}
+	}
+	for (i = 0; i < tail; i++)
+		seen[queue[i]] = 0;
+}
+
+pwcet_registry_t *pwcet_registry_new(int max_id)
+{
+	pwcet_registry_t *reg = (pwcet_registry_t *) calloc(1, sizeof(pwcet_registry_t));
+	int i;
+	if (reg == NULL)
+		return NULL;
+	reg->max_id = max_id;
+	reg->slots = calloc(max_id + 1, sizeof(*reg->slots));
+	reg->gen = calloc(max_id + 1, sizeof(*reg->gen));
+	reg->users = (struct pwcet_users_s *) calloc(max_id + 1, sizeof(*reg->users));
+	if ((reg->slots == NULL) || (reg->gen == NULL) || (reg->users == NULL)) {
+		free(reg->slots);
+		free(reg->gen);
+		free(reg->users);
+		free(reg);
+		return NULL;
+	}
+	for (i = 0; i <= max_id; i++) {
+		atomic_init(&reg->slots[i], NULL);
+		atomic_init(&reg->gen[i], 1);
+	}
+	atomic_init(&reg->epoch, 1);
+	pthread_mutex_init(&reg->lock, NULL);
+	return reg;
+}
+
+void pwcet_registry_free(pwcet_registry_t *reg)
+{
+	int i;
+	for (i = 0; i <= reg->max_id; i++) {
+		pwcet_version_t *v = atomic_load(&reg->slots[i]);
+		if (v != NULL)
+			version_free(v);
+		free(reg->users[i].ids);
+	}
+	while (reg->retired != NULL) {
+		pwcet_version_t *v = reg->retired;
+		reg->retired = v->next_retired;
+		version_free(v);
+	}
+	pthread_mutex_destroy(&reg->lock);
+	free(reg->slots);
+	free(reg->gen);
+	free(reg->users);
+	free(reg);
+}
+
+int pwcet_registry_bind(pwcet_registry_t *reg, int id, formula_t *f)
+{
+	pwcet_version_t *v = NULL, *old;
+	int *queue, i;
+	char *seen;
+
+	if ((id < 0) || (id > reg->max_id))
+		return -1;
+	queue = (int *) malloc(sizeof(int) * (reg->max_id + 1));
+	seen = (char *) calloc(reg->max_id + 1, 1);
+	if ((queue == NULL) || (seen == NULL)) {
+		free(queue);
+		free(seen);
+		return -1;
+	}
+	pthread_mutex_lock(&reg->lock);
+	if (f != NULL) {
+		v = version_new(reg, f, seen);
+		for (i = 0; (v != NULL) && (i < v->dep_count); i++) {
+			if (users_add(reg, v->deps[i], id) != 0) {
+				while (--i >= 0)
+					users_remove(reg, v->deps[i], id);
+				version_free(v);
+				v = NULL;
+			}
+		}
+		if (v == NULL) {
+			pthread_mutex_unlock(&reg->lock);
+			free(queue);
+			free(seen);
+			return -1;
+		}
+	}
+	old = atomic_exchange(&reg->slots[id], v);
+	if (old != NULL) {
+		for (i = 0; i < old->dep_count; i++)
+			users_remove(reg, old->deps[i], id);
+		old->retired = atomic_fetch_add(&reg->epoch, 1) + 1;
+		old->next_retired = reg->retired;
+		reg->retired = old;
+	}
+	bump_dependents(reg, id, queue, seen);
+	reclaim(reg);
+	pthread_mutex_unlock(&reg->lock);
+	free(queue);
+	free(seen);
+	return 0;
+}
+
+void pwcet_registry_synchronize(pwcet_registry_t *reg)
+{
+	for (;;) {
+		pthread_mutex_lock(&reg->lock);
+		reclaim(reg);
+		if (reg->retired == NULL) {
+			pthread_mutex_unlock(&reg->lock);
+			return;
+		}
+		pthread_mutex_unlock(&reg->lock);
+		sched_yield();
+	}
+}
+
+/*
+ * Reader side
+ */
+
+pwcet_reader_t *pwcet_reader_new(pwcet_registry_t *reg)
+{
+	pwcet_reader_t *r = (pwcet_reader_t *) calloc(1, sizeof(pwcet_reader_t));
+	if (r == NULL)
+		return NULL;
+	r->local = (struct pwcet_local_s *) calloc(reg->max_id + 1, sizeof(struct pwcet_local_s));
+	if (r->local == NULL) {
+		free(r);
+		return NULL;
+	}
+	r->reg = reg;
+	atomic_init(&r->epoch, 0);
+	pthread_mutex_lock(&reg->lock);
+	r->next = reg->readers;
+	reg->readers = r;
+	pthread_mutex_unlock(&reg->lock);
+	return r;
+}
+
+/* Release a private copy, whose parametric loops allocate buffers when evaluated */
+static void local_free(formula_t *f)
+{
+	if (f == NULL)
+		return;
+	formula_release_buffers(f);
+	free(f);
+}
+
+void pwcet_reader_free(pwcet_reader_t *r)
+{
+	pwcet_registry_t *reg = r->reg;
+	struct pwcet_reader_s **pr;
+	int i;
+
+	pthread_mutex_lock(&reg->lock);
+	for (pr = &reg->readers; *pr != NULL; pr = &(*pr)->next) {
+		if (*pr == r) {
+			*pr = r->next;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&reg->lock);
+	for (i = 0; i <= reg->max_id; i++)
+		local_free(r->local[i].f);
+	free(r->local);
+	free(r->replaced);
+	free(r);
+}
+
+void pwcet_reader_invalidate(pwcet_reader_t *r)
+{
+	r->valuation++;
+}
+
+static void registry_valuation(int param_id, param_value_t *param_val, void *data);
+
+/*
+ * Replace the private copy of a binding
+ * Leaves evaluated earlier in the same pwcet_reader_evaluate() may still point
+ * to the eta values of the old copy: it is released when the outermost call
+ * returns.
+ * @return 0, -1 if out of memory, in which case the old copy is kept
+ */
+static int reader_replace(pwcet_reader_t *r, struct pwcet_local_s *local, pwcet_version_t *v)
+{
+	formula_t **grown, *f;
+
+	/* evaluated many times by this reader: keep the guarded subtrees out of the way */
+	f = formula_layout(v->f, NULL, 0);
+	if (f == NULL)
+		return -1;
+	if ((local->f != NULL) && (r->replaced_count == r->replaced_size)) {
+		grown = (formula_t **) realloc(r->replaced, sizeof(formula_t *) * ((r->replaced_size > 0) ? 2 * r->replaced_size : 8));
+		if (grown == NULL) {
+			free(f);
+			return -1;
+		}
+		r->replaced = grown;
+		r->replaced_size = (r->replaced_size > 0) ? 2 * r->replaced_size : 8;
+	}
+	if (local->f != NULL)
+		r->replaced[r->replaced_count++] = local->f;
+	local->f = f;
+	local->serial = v->serial;
+	return 0;
+}
+
+/* Abstract WCET of the formula bound to id, NULL if id is not bound */
+static awcet_t *reader_compute(pwcet_reader_t *r, int id)
+{
+	pwcet_registry_t *reg = r->reg;
+	struct pwcet_local_s *local;
+	pwcet_version_t *v;
+	unsigned long gen;
+
+	if ((id < 0) || (id > reg->max_id))
+		return NULL;
+	local = &r->local[id];
+	if (local->state == LOCAL_BUSY) {
+		fprintf(stderr, "pwcet registry: formula %d depends on itself\n", id);
+		abort();
+	}
+	/* read gen first, a concurrent change then only makes us recompute next time */
+	gen = atomic_load(&reg->gen[id]);
+	if (local->cached && (local->gen == gen) && (local->valuation == r->valuation))
+		return &local->f->aw;
+
+	/* only the access to the published version needs to be protected */
+	atomic_store(&r->epoch, atomic_load(&reg->epoch));
+	v = atomic_load(&reg->slots[id]);
+	if ((v != NULL) && ((local->f == NULL) || (local->serial != v->serial)))
+		reader_replace(r, local, v);
+	atomic_store(&r->epoch, 0);
+	if ((v == NULL) || (local->f == NULL)) {
+		local->cached = 0;
+		return NULL;
+	}
+
+	local->state = LOCAL_BUSY;
+	evaluate(local->f, r->li, registry_valuation, r->bpv, r);
+	local->state = LOCAL_IDLE;
+	local->gen = gen;
+	local->valuation = r->valuation;
+	local->cached = 1;
+	return &local->f->aw;
+}
+
+static void registry_valuation(int param_id, param_value_t *param_val, void *data)
+{
+	pwcet_reader_t *r = (pwcet_reader_t *) data;
+	awcet_t *aw = reader_compute(r, param_id);
+	if (aw == NULL) {
+		r->pv(param_id, param_val, r->data);
+		return;
+	}
+	param_val->aw = *aw;
+}
+
+long long pwcet_reader_evaluate(pwcet_reader_t *r, int id, loopinfo_t *li, param_valuation_t pv, bparam_valuation_t bpv, void *data)
+{
+	long long wcet = -1;
+	awcet_t *aw;
+	r->li = li;
+	r->pv = pv;
+	r->bpv = bpv;
+	r->data = data;
+	r->depth++;
+	aw = reader_compute(r, id);
+	if (aw != NULL)
+		wcet = (aw->eta_count == 0) ? aw->others : aw->eta[0];
+	if (--r->depth == 0) {
+		while (r->replaced_count > 0)
+			local_free(r->replaced[--r->replaced_count]);
+	}
+	return wcet;
+}
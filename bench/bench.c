@@ -0,0 +1,162 @@
+/* ----------------------------------------------------------------------------
+   Copyright (C) 2020, Université de Lille, Lille, FRANCE
+
+   This file is part of WSymb.
+
+   WSymb is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation ; either version 2 of
+   the License, or (at your option) any later version.
+
+   WSymb is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY ; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program ; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+   ---------------------------------------------------------------------------- */
+
+/*
+ * Evaluation benchmark
+ *
+ * Compiled once per formula and backend (see the Makefile), with one of:
+ * - BENCH_RUNTIME: the header of swymplify -c, evaluated by evaluate();
+ * - BENCH_LIBPWCET: the code of swymplify -i, built on the libpwcet operators;
+ * - BENCH_COMPILER: the code produced by compiler/compiler.py from swymplify -p.
+ *
+ * Usage: <binary> <formula name> <samples> <batch> <parameter values...>
+ * For each parameter value, given to every loop bound parameter and boolean
+ * argument, the WCET is computed samples times batch times. A sample is the
+ * time of batch consecutive calls, divided by batch. The program prints one
+ * CSV line per parameter value:
+ * formula,backend,param,wcet,samples,p50_ns,p90_ns,p99_ns,max_ns,calls_per_s,maxrss_kb
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
+static int bench_param;
+
+#if defined(BENCH_RUNTIME)
+#include "../pwcet/include/pwcet-runtime.h"
+#include BENCH_FORMULA
+
+#define BENCH_BACKEND "runtime"
+
+/* Loop bounds only: parametric procedure WCETs (.pfl files) are not benchmarked */
+static void param_valuation(int param_id, param_value_t *param_val, void *data)
+{
+	(void) param_id;
+	(void) data;
+	memset(param_val, 0, sizeof(param_value_t));
+	param_val->bound = bench_param;
+}
+
+static int bparam_valuation(int bparam_id)
+{
+	(void) bparam_id;
+	return bench_param;
+}
+
+static loopinfo_t li = { loop_hierarchy, loop_bounds };
+
+static long long bench_eval(void)
+{
+	return evaluate(&f, &li, param_valuation, bparam_valuation, NULL);
+}
+
+#elif defined(BENCH_LIBPWCET)
+#define BENCH_BACKEND "libpwcet"
+
+long long wcet(int b0, int b1, int b2, int b3);
+
+static long long bench_eval(void)
+{
+	return wcet(bench_param, bench_param, bench_param, bench_param);
+}
+
+#elif defined(BENCH_COMPILER)
+/* prototype of eval() and BENCH_ARGS, extracted from the generated code */
+#include BENCH_FORMULA
+
+#define BENCH_BACKEND "compiler"
+
+static long long bench_eval(void)
+{
+	return eval(BENCH_ARGS);
+}
+
+#else
+#error "define BENCH_RUNTIME, BENCH_LIBPWCET or BENCH_COMPILER"
+#endif
+
+static long long elapsed_ns(struct timespec *t1, struct timespec *t2)
+{
+	return (t2->tv_sec - t1->tv_sec) * 1000000000LL + (t2->tv_nsec - t1->tv_nsec);
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+	double da = *(const double *) a, db = *(const double *) b;
+	return (da > db) - (da < db);
+}
+
+static double percentile(double *sorted, int count, int p)
+{
+	int i = (int) ((long long) (count - 1) * p / 100);
+	return sorted[i];
+}
+
+int main(int argc, char **argv)
+{
+	volatile long long sink;
+	struct timespec t1, t2;
+	struct rusage usage;
+	long long total;
+	double *samples;
+	int nsamples, batch, i, j, k;
+
+	if (argc < 5) {
+		fprintf(stderr, "usage: %s <formula name> <samples> <batch> <parameter values...>\n", argv[0]);
+		return 1;
+	}
+	nsamples = atoi(argv[2]);
+	batch = atoi(argv[3]);
+	if ((nsamples <= 0) || (batch <= 0)) {
+		fprintf(stderr, "%s: samples and batch must be positive\n", argv[0]);
+		return 1;
+	}
+	samples = (double *) malloc(sizeof(double) * nsamples);
+	if (samples == NULL) {
+		fprintf(stderr, "%s: out of memory\n", argv[0]);
+		return 1;
+	}
+
+	for (k = 4; k < argc; k++) {
+		bench_param = atoi(argv[k]);
+		sink = bench_eval();		/* warm up */
+		total = 0;
+		for (i = 0; i < nsamples; i++) {
+			clock_gettime(CLOCK_MONOTONIC, &t1);
+			for (j = 0; j < batch; j++)
+				sink = bench_eval();
+			clock_gettime(CLOCK_MONOTONIC, &t2);
+			total += elapsed_ns(&t1, &t2);
+			samples[i] = (double) elapsed_ns(&t1, &t2) / batch;
+		}
+		qsort(samples, nsamples, sizeof(double), cmp_double);
+		getrusage(RUSAGE_SELF, &usage);
+		printf("%s,%s,%d,%lld,%d,%.1f,%.1f,%.1f,%.1f,%.0f,%ld\n", argv[1], BENCH_BACKEND, bench_param, (long long) sink,
+		       nsamples, percentile(samples, nsamples, 50), percentile(samples, nsamples, 90),
+		       percentile(samples, nsamples, 99), samples[nsamples - 1],
+		       (total > 0) ? 1e9 * nsamples * batch / total : 0.0, usage.ru_maxrss);
+	}
+	free(samples);
+	return 0;
+}
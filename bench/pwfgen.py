@@ -0,0 +1,251 @@
+#!/usr/bin/env python3
+
+# Random WCET formulas for scaling studies
+#
+# Writes <name>.pwf, to be read by swymplify, and <name>.h, the same formula
+# as a formula_t tree in the format of "swymplify -c" (loop_bounds,
+# loop_hierarchy and f), to be evaluated by evaluate() without simplification.
+# The formulas are well-formed: abstract WCETs are non-increasing, their loop
+# identifiers and the loops of annotations are enclosing loops, and the loop
+# hierarchy lists all of them.
+
+import argparse
+import random
+
+KIND_ALT = "ALT"
+KIND_SEQ = "SEQ"
+KIND_LOOP = "LOOP"
+KIND_PARAM_LOOP = "PARAM_LOOP"
+KIND_ANN = "ANN"
+KIND_CONST = "CONST"
+KIND_INTMULT = "INTMULT"
+KIND_BOOLMULT = "BOOLMULT"
+
+class Node(object):
+    def __init__(self, kind, children=None):
+        self.kind = kind
+        self.children = children or []
+        self.loop_id = 0       # LOOP, PARAM_LOOP, ANN and CONST (0 for __top)
+        self.bound = 0         # LOOP: constant bound
+        self.param_id = 0      # LOOP: parametric bound p:param_id
+        self.terms = None      # PARAM_LOOP: linear bound
+        self.count = 0         # ANN
+        self.coef = 0          # INTMULT
+        self.conditions = None # BOOLMULT: list of (op, constant, terms)
+        self.eta = []          # CONST
+        self.others = 0
+
+class Generator(object):
+    def __init__(self, args):
+        self.args = args
+        self.rnd = random.Random(args.seed)
+        self.next_loop = 1
+        self.bounds = {}       # constant loop bounds
+        self.outers = {}       # enclosing loops of each loop
+        self.nodes = 0
+
+    # linear expression of the boolean parameters b:0 to b:params-1
+    def terms(self):
+        ts = []
+        for _ in range(self.rnd.randint(1, 2)):
+            ts.append((self.rnd.choice([-2, -1, 1, 2, 3]), self.rnd.randrange(self.args.params)))
+        ts.append((self.rnd.choice([-1, 1]), self.rnd.randint(0, self.args.bound_max)))
+        return ts
+
+    def const(self, loops):
+        n = Node(KIND_CONST)
+        if loops and self.rnd.random() < 0.8:
+            n.loop_id = loops[-1] if self.rnd.random() < 0.7 else self.rnd.choice(loops)
+        v = self.rnd.randint(10, 1000)
+        for _ in range(self.rnd.randint(0, self.args.eta_max)):
+            n.eta.append(v)
+            v = self.rnd.randint(1, v)
+        n.others = self.rnd.randint(0, n.eta[-1] - 1 if n.eta else v) if self.rnd.random() < 0.7 else 0
+        return n
+
+    def gen(self, depth, loops):
+        self.nodes += 1
+        a = self.args
+        if depth <= 0:
+            return self.const(loops)
+        r = self.rnd.random()
+        if (a.params > 0) and (r < a.bool_density):
+            n = Node(KIND_BOOLMULT, [self.gen(depth - 1, loops)])
+            n.conditions = [(self.rnd.choice(["<=", "="]), self.rnd.randint(0, a.bound_max), self.terms())
+                            for _ in range(self.rnd.randint(1, 2))]
+            return n
+        r = self.rnd.random()
+        if (len(loops) < a.loop_depth) and (r < a.loop_density):
+            lid = self.next_loop
+            self.next_loop += 1
+            self.outers[lid] = list(loops)
+            body = self.gen(depth - 1, loops + [lid])
+            if (a.params > 0) and (self.rnd.random() < a.param_density):
+                if self.rnd.random() < 0.5:
+                    n = Node(KIND_LOOP, [body])
+                    n.param_id = self.rnd.randint(1, a.params)
+                else:
+                    n = Node(KIND_PARAM_LOOP, [body])
+                    n.terms = self.terms()
+            else:
+                n = Node(KIND_LOOP, [body])
+                n.bound = self.rnd.randint(0, a.bound_max)
+                self.bounds[lid] = n.bound
+            n.loop_id = lid
+            return n
+        r = self.rnd.random()
+        if loops and (r < a.ann_density):
+            n = Node(KIND_ANN, [self.gen(depth - 1, loops)])
+            n.loop_id = self.rnd.choice(loops)
+            n.count = self.rnd.randint(0, a.ann_max)
+            return n
+        if r < a.ann_density + 0.05:
+            n = Node(KIND_INTMULT, [self.gen(depth - 1, loops)])
+            n.coef = self.rnd.randint(1, 4)
+            return n
+        kind = KIND_SEQ if self.rnd.random() < 0.5 else KIND_ALT
+        return Node(kind, [self.gen(depth - 1, loops) for _ in range(self.rnd.randint(2, a.fanout))])
+
+# .pwf output
+
+def pwf_lid(lid):
+    return "l:%d" % lid if lid > 0 else "__top"
+
+def pwf_terms(ts):
+    s = ""
+    for (i, (coef, v)) in enumerate(ts):
+        last = (i == len(ts) - 1)
+        # the last term is the constant, its sign being the coefficient
+        t = ("%d" % v) if last else ("b:%d" % v if abs(coef) == 1 else "%d*b:%d" % (abs(coef), v))
+        neg = coef < 0
+        if i == 0:
+            s += ("- " if neg else "") + t
+        else:
+            s += (" - " if neg else " + ") + t
+    return s
+
+def pwf(n):
+    if n.kind == KIND_CONST:
+        return "(%s;{%s})" % (pwf_lid(n.loop_id), ",".join(str(v) for v in n.eta + [n.others]))
+    if n.kind in (KIND_SEQ, KIND_ALT):
+        op = " + " if n.kind == KIND_SEQ else " U "
+        return "(" + op.join(pwf(c) for c in n.children) + ")"
+    if n.kind == KIND_LOOP:
+        b = ("p:%d" % n.param_id) if n.param_id else str(n.bound)
+        return "((%s, (__top;{0}), l:%d)^%s)" % (pwf(n.children[0]), n.loop_id, b)
+    if n.kind == KIND_PARAM_LOOP:
+        return "((%s, (__top;{0}), l:%d)^(%s))" % (pwf(n.children[0]), n.loop_id, pwf_terms(n.terms))
+    if n.kind == KIND_ANN:
+        return "(%s|(l:%d,%d))" % (pwf(n.children[0]), n.loop_id, n.count)
+    if n.kind == KIND_INTMULT:
+        return "(%d.%s)" % (n.coef, pwf(n.children[0]))
+    conds = " & ".join("%d %s %s" % (c, "≤" if op == "<=" else "=", pwf_terms(ts)) for (op, c, ts) in n.conditions)
+    return "((%s) * %s)" % (conds, pwf(n.children[0]))
+
+def pwf_hierarchy(g):
+    s = "loops:"
+    for (lid, outers) in sorted(g.outers.items()):
+        if outers:
+            s += " l:%d _C %s;" % (lid, " ".join("l:%d" % o for o in outers))
+    return s + " endl"
+
+# formula_t output
+
+# Size of the eta buffer of a node, following compute_eta_count()
+def eta_size(n):
+    if n.kind == KIND_CONST:
+        return len(n.eta)
+    if n.kind == KIND_SEQ:
+        return max(eta_size(c) for c in n.children)
+    if n.kind == KIND_ALT:
+        return sum(eta_size(c) for c in n.children)
+    if n.kind == KIND_ANN:
+        return n.count
+    if n.kind == KIND_PARAM_LOOP:
+        return 2 * eta_size(n.children[0]) + 1
+    return eta_size(n.children[0])
+
+def c_placeholder(n):
+    k = max(eta_size(n), 1)
+    return "{-1, %d, (awcet_value_t[%d]){0}, 0, (int[%d]){0}}" % (k, k, k)
+
+def c_terms(ts):
+    l = []
+    for (i, (coef, v)) in enumerate(ts):
+        if i == len(ts) - 1:
+            l.append("{BOOL_CONST, %d, %d}" % (coef, v))
+        else:
+            l.append("{BOOL_PARAM, %d, %d}" % (coef, v))
+    return "(term_t[%d]){%s}" % (len(l), ", ".join(l))
+
+def c_formula(n, out, indent):
+    p = "\t" * indent
+    if n.kind == KIND_CONST:
+        eta = "(awcet_value_t[%d]){%s}" % (len(n.eta), ", ".join(str(v) for v in n.eta)) if n.eta else "NULL"
+        out.append("%s{.kind = KIND_CONST, .aw = {%d, %d, %s, %d}}" % (p, n.loop_id if n.loop_id > 0 else -1, len(n.eta), eta, n.others))
+        return
+    if n.kind in (KIND_SEQ, KIND_ALT):
+        head = "%s{.kind = KIND_%s, .opdata = {.children_count = %d}, .aw = %s," % (p, n.kind, len(n.children), c_placeholder(n))
+    elif n.kind == KIND_LOOP:
+        head = "%s{.kind = KIND_LOOP, .param_id = %d, .opdata = {.loop_id = %d}, .aw = %s," % (p, n.param_id, n.loop_id, c_placeholder(n))
+    elif n.kind == KIND_PARAM_LOOP:
+        head = "%s{.kind = KIND_PARAM_LOOP, .opdata = {.loop_id = %d}, .condition = (condition_t[1]){{BOOL_BOUND, 0, %d, %s}}," % (p, n.loop_id, len(n.terms), c_terms(n.terms))
+    elif n.kind == KIND_ANN:
+        head = "%s{.kind = KIND_ANN, .opdata = {.ann = {%d, %d}}, .aw = %s," % (p, n.loop_id, n.count, c_placeholder(n))
+    elif n.kind == KIND_INTMULT:
+        head = "%s{.kind = KIND_INTMULT, .opdata = {.coef = %d}, .aw = %s," % (p, n.coef, c_placeholder(n))
+    else:
+        conds = ", ".join("{%s, %d, %d, %s}" % ("BOOL_LEQ" if op == "<=" else "BOOL_EQ", c, len(ts), c_terms(ts)) for (op, c, ts) in n.conditions)
+        out.append("%s{.kind = KIND_BOOLMULT, .opdata = {.children_count = 2}, .children = (formula_t[2]){" % p)
+        out.append("%s\t{.kind = BOOL_CONDITIONS, .opdata = {.children_count = %d}, .condition = (condition_t[%d]){%s}}," % (p, len(n.conditions), len(n.conditions), conds))
+        c_formula(n.children[0], out, indent + 1)
+        out.append("%s}}" % p)
+        return
+    out.append(head)
+    out.append("%s .children = (formula_t[%d]){" % (p, len(n.children)))
+    for (i, c) in enumerate(n.children):
+        c_formula(c, out, indent + 1)
+        if i < len(n.children) - 1:
+            out[-1] += ","
+    out.append("%s}}" % p)
+
+def c_header(g, root):
+    out = ["int loop_bounds(int loop_id) {", "\tswitch(loop_id) {"]
+    for (lid, b) in sorted(g.bounds.items()):
+        out.append("\tcase %d: return %d;" % (lid, b))
+    out += ["\tdefault: abort();", "\t}", "}", "", "int loop_hierarchy(int inner, int outer) {"]
+    for (lid, outers) in sorted(g.outers.items()):
+        for o in outers:
+            out.append("\tif((inner == %d) && (outer == %d)) return 1;" % (lid, o))
+    out += ["\treturn 0;", "}", "", "formula_t f ="]
+    c_formula(root, out, 0)
+    out[-1] += ";"
+    return "\n".join(out) + "\n"
+
+def main():
+    ap = argparse.ArgumentParser(description="Generate a random WCET formula as <name>.pwf and <name>.h")
+    ap.add_argument("name")
+    ap.add_argument("--seed", type=int, default=0)
+    ap.add_argument("--depth", type=int, default=6, help="depth of the formula tree")
+    ap.add_argument("--fanout", type=int, default=4, help="greatest number of operands of SEQ and ALT nodes")
+    ap.add_argument("--loop-depth", type=int, default=3, help="greatest loop nesting")
+    ap.add_argument("--loop-density", type=float, default=0.2, help="probability of a loop node")
+    ap.add_argument("--bound-max", type=int, default=20, help="greatest constant loop bound")
+    ap.add_argument("--eta-max", type=int, default=4, help="greatest number of eta values of a constant")
+    ap.add_argument("--ann-max", type=int, default=5, help="greatest annotation count")
+    ap.add_argument("--ann-density", type=float, default=0.05, help="probability of an annotation inside a loop")
+    ap.add_argument("--params", type=int, default=2, help="number of loop bound parameters p:1.. and boolean parameters b:0..")
+    ap.add_argument("--param-density", type=float, default=0.2, help="probability of a parametric loop bound")
+    ap.add_argument("--bool-density", type=float, default=0.05, help="probability of a boolean product")
+    args = ap.parse_args()
+
+    g = Generator(args)
+    root = g.gen(args.depth, [])
+    with open(args.name + ".pwf", "w", encoding="utf-8") as f:
+        f.write(pwf(root) + " " + pwf_hierarchy(g) + "\n")
+    with open(args.name + ".h", "w") as f:
+        f.write(c_header(g, root))
+    print(g.nodes)
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,112 @@
+#!/usr/bin/env python3
+
+# Scaling study of evaluation and simplification
+#
+# Generates formulas of growing depth with pwfgen.py, times evaluate() on
+# each of them (bench.c, runtime backend, unsimplified formula) and the
+# simplification by swymplify, writes the results as CSV and plots both times
+# against the number of nodes. The exponent k of a fit time ~ nodes^k is
+# printed for each, a k well above 1 showing a superlinear behaviour.
+
+import argparse
+import math
+import os
+import subprocess
+import sys
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+def run(cmd, **kw):
+    return subprocess.run(cmd, check=True, stdout=subprocess.PIPE, universal_newlines=True, **kw).stdout
+
+def fit_exponent(points):
+    pts = [(math.log(n), math.log(t)) for (n, t) in points if n > 0 and t > 0]
+    if len(pts) < 2:
+        return None
+    mx = sum(x for (x, _) in pts) / len(pts)
+    my = sum(y for (_, y) in pts) / len(pts)
+    sxx = sum((x - mx) ** 2 for (x, _) in pts)
+    if sxx == 0:
+        return None
+    return sum((x - mx) * (y - my) for (x, y) in pts) / sxx
+
+def main():
+    ap = argparse.ArgumentParser(description="Evaluation and simplification time of random formulas against their size")
+    ap.add_argument("--min-depth", type=int, default=2)
+    ap.add_argument("--max-depth", type=int, default=9)
+    ap.add_argument("--seeds", type=int, default=3, help="formulas per depth")
+    ap.add_argument("--samples", type=int, default=200)
+    ap.add_argument("--batch", type=int, default=4)
+    ap.add_argument("--sweep", default="0 1 4 16", help="parameter values")
+    ap.add_argument("--gen", default="", help="other options of pwfgen.py")
+    ap.add_argument("--swymplify", default=os.path.join(HERE, "..", "simplify", "swymplify"))
+    ap.add_argument("--work", default="scaling", help="directory of the generated files")
+    ap.add_argument("--out", default="scaling.csv")
+    ap.add_argument("--plot", default="scaling.png")
+    args = ap.parse_args()
+
+    cc = os.environ.get("CC", "cc")
+    os.makedirs(args.work, exist_ok=True)
+    simplify = os.access(args.swymplify, os.X_OK)
+    if not simplify:
+        print("%s not found, simplification is not timed" % args.swymplify, file=sys.stderr)
+
+    rows = []
+    for depth in range(args.min_depth, args.max_depth + 1):
+        for seed in range(args.seeds):
+            name = os.path.join(args.work, "d%d_s%d" % (depth, seed))
+            nodes = int(run([sys.executable, os.path.join(HERE, "pwfgen.py"), name,
+                             "--depth", str(depth), "--seed", str(seed)] + args.gen.split()))
+
+            # evaluation: median over the parameter values of the median latency
+            binary = name + "-runtime"
+            run([cc, "-O2", "-I" + args.work, "-DBENCH_RUNTIME", "-DBENCH_FORMULA=\"%s.h\"" % os.path.basename(name),
+                 "-o", binary, os.path.join(HERE, "bench.c"), os.path.join(HERE, "..", "PWCET.c")])
+            out = run([binary, name, str(args.samples), str(args.batch)] + args.sweep.split())
+            p50 = sorted(float(l.split(",")[5]) for l in out.splitlines())
+            eval_ns = p50[len(p50) // 2]
+
+            simplify_s = None
+            if simplify:
+                t = time.monotonic()
+                run([args.swymplify, "-c", "-o", name + "-c.h", name + ".pwf"])
+                simplify_s = time.monotonic() - t
+
+            rows.append((depth, seed, nodes, eval_ns, simplify_s))
+            print("depth %d seed %d: %d nodes, evaluation %.0f ns%s" % (depth, seed, nodes, eval_ns,
+                  "" if simplify_s is None else ", simplification %.3f s" % simplify_s))
+
+    with open(args.out, "w") as f:
+        f.write("depth,seed,nodes,eval_ns,simplify_s\n")
+        for (depth, seed, nodes, eval_ns, simplify_s) in rows:
+            f.write("%d,%d,%d,%.1f,%s\n" % (depth, seed, nodes, eval_ns, "" if simplify_s is None else "%.6f" % simplify_s))
+
+    series = [("evaluation", [(r[2], r[3]) for r in rows])]
+    if simplify:
+        series.append(("simplification", [(r[2], r[4]) for r in rows]))
+    for (label, points) in series:
+        k = fit_exponent(points)
+        if k is not None:
+            print("%s: time ~ nodes^%.2f%s" % (label, k, "  (superlinear)" if k > 1.2 else ""))
+
+    try:
+        import matplotlib
+        matplotlib.use("Agg")
+        import matplotlib.pyplot as plt
+    except ImportError:
+        print("matplotlib not available, no plot", file=sys.stderr)
+        return
+    fig, axes = plt.subplots(1, len(series), figsize=(6 * len(series), 4.5), squeeze=False)
+    for (ax, (label, points)) in zip(axes[0], series):
+        ax.loglog([n for (n, _) in points], [t for (_, t) in points], "o")
+        ax.set_xlabel("nodes")
+        ax.set_ylabel("ns per evaluation" if label == "evaluation" else "seconds")
+        ax.set_title(label)
+        ax.grid(True, which="both", alpha=0.3)
+    fig.tight_layout()
+    fig.savefig(args.plot)
+    print("plot written to %s" % args.plot)
+
+if __name__ == "__main__":
+    main()
@@ -20,6 +20,10 @@
    ---------------------------------------------------------------------------- */
 
 #include <stdio.h>
+#include <errno.h>
+#include <ctype.h>
+#include <sys/stat.h>
+#include <atomic>
 
 #include <otawa/app/Application.h>
 #include <otawa/cfg/features.h>
@@ -49,15 +53,123 @@ using namespace otawa::cftree;
 #define CONDITIONS_FILE "constraints.csv"
 #define LOOP_BOUNDS_FILE "loop_bounds.csv"
 
+/*
+ * The blocks of a called CFG that are in no loop of their own are in the loop
+ * of the call. The calls are followed with an explicit stack, in the order of
+ * a recursive traversal; a CFG is only walked again for another loop, since
+ * walking it for the same loop changes nothing.
+ */
 void fix_virtualized_loopinfo(CFG *entryCFG, Block *loop = nullptr) {
-	for (CFG::BlockIter iter(entryCFG->blocks()); iter(); iter++) {
-		if (ENCLOSING_LOOP_HEADER(*iter) == nullptr)
-			ENCLOSING_LOOP_HEADER(*iter) = loop;
+	std::vector<std::pair<CFG *, Block *> > todo(1, std::make_pair(entryCFG, loop));
+	std::set<std::pair<CFG *, Block *> > done;
+	while (!todo.empty()) {
+		CFG *cfg = todo.back().first;
+		loop = todo.back().second;
+		todo.pop_back();
+		if (!done.insert(std::make_pair(cfg, loop)).second)
+			continue;
+
+		std::vector<std::pair<CFG *, Block *> > calls;
+		for (CFG::BlockIter iter(cfg->blocks()); iter(); iter++) {
+			if (ENCLOSING_LOOP_HEADER(*iter) == nullptr)
+				ENCLOSING_LOOP_HEADER(*iter) = loop;
+
+			if ((*iter)->isSynth()) {
+				CFG *callee = (*iter)->toSynth()->callee();
+				calls.push_back(std::make_pair(callee, ENCLOSING_LOOP_HEADER(*iter)));
+			}
+		}
+		// the first call is followed first
+		todo.insert(todo.end(), calls.rbegin(), calls.rend());
+	}
+}
+
+/*
+ * Side table of the formula: one line for each node that comes from a block,
+ * nodes being numbered in pre-order as in the .pwf file
+ */
+static void write_origins(FILE *out, formula_t *root, const AWCETExport &ex, int *node) {
+	std::vector<formula_t *> todo(1, root);
+	while (!todo.empty()) {
+		formula_t *f = todo.back();
+		todo.pop_back();
+		int id = (*node)++;
+		Block *b = ex.originBlock(f->origin);
+		if (b != nullptr) {
+			const char *kind = (f->kind == KIND_LOOP) ? "loop" : (f->kind == KIND_AWCET) ? "call" : "block";
+			int block = b->id();
+			int loop = -1;
+			if (b->cfg() == nullptr && !IS_PIPELINE_EDGE(b)) {
+				// cache block, standing for the memory accesses of a basic block
+				BasicCacheBlock *bcb = static_cast<BasicCacheBlock *>(b);
+				block = bcb->getBasicBlockId();
+				loop = bcb->getLoopId();
+			} else if (LOOP_HEADER(b))
+				loop = b->id();
+			else if (ENCLOSING_LOOP_HEADER(b) != nullptr)
+				loop = ENCLOSING_LOOP_HEADER(b)->id();
+			fprintf(out, "%d %s ", id, kind);
+			if (f->kind == KIND_AWCET)
+				fprintf(out, "%s ", b->toSynth()->callee()->name().toCString().chars());
+			else if (b->cfg() != nullptr)
+				fprintf(out, "%s ", b->cfg()->name().toCString().chars());
+			else
+				fprintf(out, "- ");
+			fprintf(out, "%d ", block);
+			if (b->cfg() != nullptr && b->isBasic() && b->toBasic()->count() > 0)
+				fprintf(out, "0x%08lx-0x%08lx ", (unsigned long) b->toBasic()->address().offset(), (unsigned long) b->toBasic()->topAddress().offset());
+			else
+				fprintf(out, "- ");
+			fprintf(out, "%d %d\n", loop, f->origin);
+		}
+		// children in pre-order
+		for (int i = formula_child_count(f) - 1; i >= 0; i--)
+			todo.push_back(&f->children[i]);
+	}
+}
 
-		if ((*iter)->isSynth()) {
-			CFG *callee = (*iter)->toSynth()->callee();
-			fix_virtualized_loopinfo(callee, ENCLOSING_LOOP_HEADER(*iter));
+/*
+ * Without virtualization, the formula of a function is shared by all its
+ * calls: a recursive call would make it infinite. Returns a function calling
+ * itself, directly or not, from the entry, nullptr if there is none. The
+ * functions whose WCET is a parameter are not followed.
+ */
+static CFG *find_recursion(CFG *entry, struct param_func *pfl) {
+	// 1 while the calls of the function are followed, 2 once they all are
+	std::map<CFG *, int> state;
+	std::vector<std::pair<CFG *, std::vector<CFG *> > > stack;
+	std::vector<CFG *> calls;
+	CFG *cfg = entry;
+	while (true) {
+		if (cfg != nullptr) {
+			state[cfg] = 1;
+			calls.clear();
+			for (CFG::BlockIter iter(cfg->blocks()); iter(); iter++) {
+				if (!(*iter)->isSynth() || (*iter)->toSynth()->callee() == nullptr)
+					continue;
+				CFG *callee = (*iter)->toSynth()->callee();
+				bool parametric = false;
+				for (int i = 0; pfl && pfl[i].funcname != nullptr; i++)
+					if (!strcmp(pfl[i].funcname, callee->name().toCString()))
+						parametric = true;
+				if (!parametric)
+					calls.push_back(callee);
+			}
+			stack.push_back(std::make_pair(cfg, calls));
+		}
+		if (stack.empty())
+			return nullptr;
+		if (stack.back().second.empty()) {
+			state[stack.back().first] = 2;
+			stack.pop_back();
+			cfg = nullptr;
+			continue;
 		}
+		CFG *callee = stack.back().second.back();
+		stack.back().second.pop_back();
+		if (state[callee] == 1)
+			return callee;
+		cfg = (state[callee] == 0) ? callee : nullptr;
 	}
 }
 
@@ -73,6 +185,240 @@ static bool is_strictly_in(Block *inner, Block *outer) {
 	return false;
 }
 
+/*
+ * Loop bounds by loop identifier, -1 for the identifiers of no loop
+ */
+static long long *read_loop_bounds(const CFGCollection *coll) {
+	int max_loop_id = 0;
+	for (CFGCollection::Iter iter(*coll); iter(); iter ++)
+		for (CFG::BlockIter iter2((*iter)->blocks()); iter2(); iter2++)
+			if (LOOP_HEADER(*iter2))
+				if ((*iter2)->id() > max_loop_id)
+					max_loop_id = (*iter2)->id();
+
+	long long *loop_bounds = (long long*) malloc(sizeof(long long)*(max_loop_id + 1));
+	for (int i = 0; i <= max_loop_id; i++)
+		loop_bounds[i] = -1;
+
+	for (CFGCollection::Iter iter(*coll); iter(); iter ++) {
+		for (CFG::BlockIter iter2((*iter)->blocks()); iter2(); iter2++) {
+			if (LOOP_HEADER(*iter2)) {
+				loop_bounds[(*iter2)->id()] = MAX_ITERATION((*iter2));
+			}
+		}
+	}
+	return loop_bounds;
+}
+
+/* messages of the threads of export_functions() */
+static std::mutex message_mutex;
+
+/*
+ * Writes f in path, followed by the hierarchy of the loops of cfg (of every
+ * CFG if cfg is nullptr), and its side table in path.map, ex being the
+ * export that built f. Returns false if path cannot be written.
+ */
+static bool write_formula(formula_t *f, AWCETExport &ex, const std::string &path, const CFGCollection *coll, CFG *cfg, long long *loop_bounds) {
+	FILE *pwf_file = fopen(path.c_str(), "w");
+	if (pwf_file == nullptr)
+		return false;
+
+	// drop the ALT children that can never contribute to the WCET, shared callees are visited once
+	formula_prune_alt(f, loop_bounds, CFTree::releasePruned, &ex);
+	// parametric values are unknown here, only warn when the known ones overflow
+	long long range_lo, range_hi;
+	if (formula_value_range(f, loop_bounds, -1, &range_lo, &range_hi)
+		&& ((range_lo < -2147483648LL) || (range_hi > 2147483647LL))) {
+		std::lock_guard<std::mutex> lock(message_mutex);
+		cerr << "warning: ";
+		if (cfg != nullptr)
+			cerr << cfg->name() << ": ";
+		cerr << "WCET values up to " << range_hi << " do not fit in 32 bits, do not evaluate this formula with PWCET_VALUE_32" << endl;
+	}
+	writePWF(f, pwf_file, loop_bounds);
+	fprintf(pwf_file, " loops: ");
+	for (CFGCollection::Iter iter(*coll); iter(); iter ++) {
+		if ((cfg != nullptr) && (*iter != cfg))
+			continue;
+		for (CFG::BlockIter iter2((*iter)->blocks()); iter2(); iter2++) {
+			if (LOOP_HEADER(*iter2)) {
+//				printf("bounding loop %d with %d\n", (*iter2)->id(), loop_bounds[(*iter2)->id()]);
+				
+				for (CFGCollection::Iter iter3(*coll); iter3(); iter3 ++) {
+					if ((cfg != nullptr) && (*iter3 != cfg))
+						continue;
+					for (CFG::BlockIter iter4((*iter3)->blocks()); iter4(); iter4++) {
+						if (LOOP_HEADER(*iter4)) {
+							if (is_strictly_in(*iter2, *iter4)) {
+								fprintf(pwf_file, "l:%u _C l:%u; ", (*iter2)->id(), (*iter4)->id());
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+	fprintf(pwf_file, " endl\n");
+
+	fclose(pwf_file);
+
+	// blocks behind the formula nodes, to trace a WCET back to the program
+	std::string map_name = path + ".map";
+	FILE *map_file = fopen(map_name.c_str(), "w");
+	if (map_file != nullptr) {
+		int node = 0;
+		fprintf(map_file, "# node kind function block addresses loop\n");
+		write_origins(map_file, f, ex, &node);
+		fclose(map_file);
+	}
+	return true;
+}
+
+/*
+ * Greatest identifier of the integer ("p:<id>") and boolean ("b:<id>")
+ * parameters of a condition or a parametric loop bound, max if none is greater
+ */
+static int max_param_id(const std::string &expr, int max) {
+	for (std::size_t i = 0; i + 2 < expr.size(); i++)
+		if ((expr[i] == 'p' || expr[i] == 'b') && expr[i + 1] == ':' && isdigit((unsigned char) expr[i + 2])
+			&& (i == 0 || !isalnum((unsigned char) expr[i - 1])))
+			max = std::max(max, atoi(expr.c_str() + i + 2));
+	return max;
+}
+
+/*
+ * Writes the formula of each selected function, of every function if none
+ * is, in dir/<function>.pwf. The calls are references to the formulas of
+ * the callees: the WCET of every function is a parameter, as for the
+ * functions of the .pfl file, whose identifiers are kept. dir/index gives
+ * the parameter of each function and its formula. The functions are
+ * exported by parallel threads. Returns the number of failures.
+ */
+static int export_functions(const CFGCollection *coll, const char *dir, const std::vector<std::string> &selected, struct param_func *pfl, long long *loop_bounds) {
+	if ((mkdir(dir, 0777) != 0) && (errno != EEXIST)) {
+		cerr << "cannot create directory " << dir << ": " << strerror(errno) << endl;
+		return 1;
+	}
+
+	// the new identifiers follow those of the .pfl file, of the loop bounds
+	// and of the conditions: a valuation answers both kinds of parameters
+	int next_id = 0;
+	for (int i = 0; pfl && pfl[i].funcname != nullptr; i++)
+		if (pfl[i].param_id > next_id)
+			next_id = pfl[i].param_id;
+	for (CFGCollection::Iter iter(*coll); iter(); iter ++) {
+		for (CFG::BlockIter iter2((*iter)->blocks()); iter2(); iter2++)
+			if (LOOP_HEADER(*iter2) && (MAX_ITERATION(*iter2) & PARAM_FLAG))
+				if ((MAX_ITERATION(*iter2) & ~PARAM_FLAG) > next_id)
+					next_id = MAX_ITERATION(*iter2) & ~PARAM_FLAG;
+		std::vector<CFTree *> trees;
+		if (CFTREE(*iter))
+			trees.push_back(CFTREE(*iter));
+		while (!trees.empty()) {
+			CFTree *t = trees.back();
+			trees.pop_back();
+			if (CFTreeConditionalAlt *alt = t->toConditionalAlt())
+				for (std::size_t i = 0; i < alt->getChildren().size(); i++)
+					next_id = max_param_id(alt->getCondition(i), next_id);
+			if (CFTreeLoop *loop = t->toLoop())
+				if (loop->isParametric())
+					next_id = max_param_id(loop->getParametricBound(), next_id);
+			for (std::size_t i = 0; i < CFTreeVisitor::childCount(t); i++)
+				trees.push_back(CFTreeVisitor::child(t, i));
+		}
+	}
+	next_id++;
+
+	std::vector<struct param_func> refs;
+	std::vector<CFG *> cfgs, todo;
+	int failed = 0;
+	for (CFGCollection::Iter iter(*coll); iter(); iter ++) {
+		struct param_func ref;
+		ref.funcname = strdup((*iter)->name().toCString().chars());
+		ref.param_id = -1;
+		for (int i = 0; pfl && pfl[i].funcname != nullptr; i++)
+			if (!strcmp(pfl[i].funcname, ref.funcname))
+				ref.param_id = pfl[i].param_id;
+		if (ref.param_id < 0)
+			ref.param_id = next_id++;
+		refs.push_back(ref);
+		cfgs.push_back(*iter);
+		if (selected.empty() || (std::find(selected.begin(), selected.end(), ref.funcname) != selected.end()))
+			todo.push_back(*iter);
+	}
+	for (auto name = selected.begin(); name != selected.end(); name++) {
+		auto ref = refs.begin();
+		while ((ref != refs.end()) && (*name != ref->funcname))
+			ref++;
+		if (ref == refs.end()) {
+			cerr << "function " << name->c_str() << " not found" << endl;
+			failed++;
+		}
+	}
+	struct param_func end = { nullptr, 0 };
+	refs.push_back(end);
+	// the pipeline effects of the calls are those of parametric functions
+	PFL = &refs[0];
+
+	std::vector<char> written(todo.size(), false);
+	std::atomic<std::size_t> next(0);
+	auto worker = [&]() {
+		for (std::size_t i = next++; i < todo.size(); i = next++) {
+			CFG *cfg = todo[i];
+			if (!CFTREE(cfg))
+				continue;
+			formula_t f;
+			memset(&f, 0, sizeof(f));
+			// the origins are numbered in each function, by its thread only
+			AWCETExport exported;
+			CFTREE(cfg)->exportToAWCET(&f, &refs[0], exported);
+			std::string path = std::string(dir) + "/" + cfg->name().toCString().chars() + ".pwf";
+			written[i] = write_formula(&f, exported, path, coll, cfg, loop_bounds);
+			// every call is a reference, no formula is shared
+			formula_free(&f);
+		}
+	};
+	unsigned nb_threads = std::thread::hardware_concurrency();
+#ifdef IP
+	// the infeasible paths are attached to the trees during the export
+	nb_threads = 1;
+#endif
+	if (nb_threads < 1)
+		nb_threads = 1;
+	if (nb_threads > todo.size())
+		nb_threads = todo.size();
+	std::vector<std::thread> threads;
+	for (unsigned i = 1; i < nb_threads; i++)
+		threads.push_back(std::thread(worker));
+	worker();
+	for (auto i = threads.begin(); i != threads.end(); i++)
+		i->join();
+
+	// one line by function: its parameter, its name and its formula
+	std::string index_name = std::string(dir) + "/index";
+	FILE *index = fopen(index_name.c_str(), "w");
+	if (index == nullptr) {
+		cerr << "cannot write " << index_name.c_str() << endl;
+		failed++;
+	} else
+		fprintf(index, "# parameter function formula\n");
+	for (std::size_t i = 0; i < cfgs.size(); i++) {
+		std::size_t j = std::find(todo.begin(), todo.end(), cfgs[i]) - todo.begin();
+		bool done = (j < todo.size()) && written[j];
+		if ((j < todo.size()) && !done && CFTREE(todo[j])) {
+			cerr << "cannot write the formula of " << refs[i].funcname << endl;
+			failed++;
+		}
+		if (index != nullptr)
+			fprintf(index, "%d %s %s%s\n", refs[i].param_id, refs[i].funcname, done ? refs[i].funcname : "-", done ? ".pwf" : "");
+		free(refs[i].funcname);
+	}
+	if (index != nullptr)
+		fclose(index);
+	PFL = pfl;
+	return failed;
+}
+
 struct param_func *read_pfl(char *binary) {
 	char filename[256];
 	strncpy(filename, binary, sizeof(filename) - 4);
@@ -144,8 +490,20 @@ int main(int argc, char **argv) {
 
 	try{
 
-	if ((argc < 3) || (argc > 4)) {
-		fprintf(stderr, "usage: %s <ARM binary> <formula file> [<entry fct (by default main)>]\n", argv[0]);
+	// -s: each function is analyzed once, instead of once for each call
+	// -d: same, with one formula for each function (see export_functions())
+	bool summaries = false;
+	bool per_function = false;
+	if ((argc > 1) && (!strcmp(argv[1], "-s") || !strcmp(argv[1], "-d"))) {
+		summaries = true;
+		per_function = !strcmp(argv[1], "-d");
+		argv[1] = argv[0];
+		argv++;
+		argc--;
+	}
+	if ((argc < 3) || (!per_function && (argc > 4))) {
+		fprintf(stderr, "usage: %s [-s] <ARM binary> <formula file> [<entry fct (by default main)>]\n", argv[0]);
+		fprintf(stderr, "       %s -d <ARM binary> <directory> [<fct>...]\n", argv[0]);
 		exit(1);
 	}
 	struct param_func *pfl = read_pfl(argv[1]);
@@ -156,7 +514,7 @@ int main(int argc, char **argv) {
 	
 	NO_SYSTEM(conf) = true;
 	//TASK_ENTRY(conf) = "main";
-	TASK_ENTRY(conf) = (argc >= 4) ? argv[3] : "main";
+	TASK_ENTRY(conf) = (argc >= 4) && !per_function ? argv[3] : "main";
 
 	// add the processor model
 #ifdef PIPELINE
@@ -179,13 +537,17 @@ int main(int argc, char **argv) {
 
 	ws = manager.load(argv[1], conf);
 
-	ws->require(otawa::VIRTUALIZED_CFG_FEATURE, conf);
+	if (summaries)
+		ws->require(otawa::COLLECTED_CFG_FEATURE, conf);
+	else
+		ws->require(otawa::VIRTUALIZED_CFG_FEATURE, conf);
+	FUNCTION_SUMMARIES(conf) = summaries;
 
 	const CFGCollection *coll = INVOLVED_CFGS(ws);
 
 	// set the entry of the task
 	CFG *entry = nullptr;
-	const char *entryname = (argc >= 4) ? argv[3] : "main";
+	const char *entryname = (argc >= 4) && !per_function ? argv[3] : "main";
 	elm::String entryname_s(entryname);
 	for (CFGCollection::Iter iter(*coll); iter(); iter ++) {
 		if (entryname_s == (*iter)->name()) {
@@ -197,6 +559,13 @@ int main(int argc, char **argv) {
 		cerr << "entry point " << entryname_s << " not found" << endl;
 		exit(1);
 	}
+	if (summaries && !per_function) {
+		CFG *recursive = find_recursion(entry, pfl);
+		if (recursive != nullptr) {
+			cerr << "function " << recursive->name() << " is recursive, it cannot be analyzed with -s" << endl;
+			exit(1);
+		}
+	}
 
 	// push conditions on the CFG to make it easier to know if we generate ALT or CONDITIONAL_ALT
 	ConditionParser parser;
@@ -264,70 +633,44 @@ int main(int argc, char **argv) {
 	ws->require(ipet::FLOW_FACTS_FEATURE, conf);
 	ws->require(ipet::BB_TIME_FEATURE, conf);
 /*	cout << "Exporting to AWCET..."; */
-	formula_t f;
-	memset(&f, 0, sizeof(f));
-	/* infeasible paths implement */
-	CFTREE(entry)->exportToAWCET(&f, pfl);
+	if (per_function) {
+		// the selected functions, called from the entry, calling each other by reference
+		long long *loop_bounds = read_loop_bounds(coll);
+		BlockTable::load(coll);
+		int failed = export_functions(coll, argv[2], std::vector<std::string>(argv + 3, argv + argc), pfl, loop_bounds);
+		BlockTable::clear();
+		free(loop_bounds);
+		if (failed > 0)
+			cerr << failed << " function(s) could not be exported" << endl;
+	} else {
+		formula_t f;
+		memset(&f, 0, sizeof(f));
+		AWCETExport exported;
+		/* infeasible paths implement */
+		BlockTable::load(coll);
+		CFTREE(entry)->exportToAWCET(&f, pfl, exported);
+		BlockTable::clear();
 /*	cout << "done." << endl; */
 
 #ifdef IP
-	if(allConstraints.size() > 0){
-		cout << "Some constraints could not be attached to a node: " ;
-		printPseudoPaths(allConstraints);
-		throw InvalidConstraintException("Error : could not attach all constraints to tree nodes");
-	}
+		if(allConstraints.size() > 0){
+			cout << "Some constraints could not be attached to a node: " ;
+			printPseudoPaths(allConstraints);
+			throw InvalidConstraintException("Error : could not attach all constraints to tree nodes");
+		}
 #endif
-	
-	int max_loop_id = 0;
 
-	fix_virtualized_loopinfo(entry);
-	
-	FILE *pwf_file = fopen(argv[2], "w");
-	
-	for (CFGCollection::Iter iter(*coll); iter(); iter ++)
-		for (CFG::BlockIter iter2((*iter)->blocks()); iter2(); iter2++)
-			if (LOOP_HEADER(*iter2))
-				if ((*iter2)->id() > max_loop_id)
-					max_loop_id = (*iter2)->id();
-			
+		// the loops of a function called from several loops are in none of them
+		if (!summaries)
+			fix_virtualized_loopinfo(entry);
 
-	long long *loop_bounds = (long long*) malloc(sizeof(long long)*(max_loop_id + 1));
-	for (int i = 0; i <= max_loop_id; i++)
-		loop_bounds[i] = -1;
-		
-		
-	for (CFGCollection::Iter iter(*coll); iter(); iter ++) {
-		for (CFG::BlockIter iter2((*iter)->blocks()); iter2(); iter2++) {
-			if (LOOP_HEADER(*iter2)) {
-				loop_bounds[(*iter2)->id()] = MAX_ITERATION((*iter2));
-			}
-		}
-	}
-	
-	writePWF(&f, pwf_file, loop_bounds);
-	fprintf(pwf_file, " loops: ");
-	for (CFGCollection::Iter iter(*coll); iter(); iter ++) {
-		for (CFG::BlockIter iter2((*iter)->blocks()); iter2(); iter2++) {
-			if (LOOP_HEADER(*iter2)) {
-				loop_bounds[(*iter2)->id()] = MAX_ITERATION((*iter2));
-//				printf("bounding loop %d with %d\n", (*iter2)->id(), loop_bounds[(*iter2)->id()]);
-				
-				for (CFGCollection::Iter iter3(*coll); iter3(); iter3 ++) {
-					for (CFG::BlockIter iter4((*iter3)->blocks()); iter4(); iter4++) {
-						if (LOOP_HEADER(*iter4)) {
-							if (is_strictly_in(*iter2, *iter4)) {
-								fprintf(pwf_file, "l:%u _C l:%u; ", (*iter2)->id(), (*iter4)->id());
-							}
-						}
-					}
-				}
-			}
-		}
+		long long *loop_bounds = read_loop_bounds(coll);
+		if (!write_formula(&f, exported, argv[2], coll, nullptr, loop_bounds))
+			cerr << "cannot write " << argv[2] << endl;
+		free(loop_bounds);
+		// the formula is written, release it before the workspace
+		CFTree::releaseAWCET(&f, exported);
 	}
-	fprintf(pwf_file, " endl\n");
-
-	fclose(pwf_file);
-	free(loop_bounds);
 
 	// avoid double free of pointers
 	finder.empty();
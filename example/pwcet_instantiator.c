@@ -30,6 +30,9 @@ void param_valuation(int param_id, param_value_t * param_val, void *data) {
 int main(void) {
     loopinfo_t li = {.hier = loop_hierarchy, .bnd = loop_bounds};
     
+    /* f is only evaluated as a whole: operators can stop at the values their parent uses */
+    compute_eta_demand(&f, &li);
+
     for (int i = 0; i < 20; i++) {
       b = i;
       long long wcet = evaluate(&f, &li, param_valuation, NULL);
@@ -176,6 +176,36 @@ namespace otawa
 			void clear();
 		};
 
+		/**
+		 * State of the export of one formula, given to exportToAWCET(): the
+		 * blocks its nodes come from (see formula_t::origin) and the formulas
+		 * of the callees shared by their call sites. Each written formula has
+		 * its own, so that the origins are numbered from 1 in every formula
+		 * and the threads exporting functions share nothing. It is used by
+		 * the thread that created it only.
+		 */
+		class AWCETExport
+		{
+		private:
+			// origins[i - 1] is the block of origin i
+			std::vector<Block *> origins;
+
+		public:
+			// shared callee formulas, defined with the export (see CFTree.cpp)
+			struct Callees;
+			Callees *callees;
+
+			AWCETExport();
+			~AWCETExport();
+			AWCETExport(const AWCETExport &) = delete;
+			AWCETExport &operator=(const AWCETExport &) = delete;
+
+			// registers a block and returns the value of the origin field
+			int formulaOrigin(Block *b);
+			// block of an origin, nullptr for 0
+			Block *originBlock(int origin) const;
+		};
+
 		class CFTree
 		{
 			/*
@@ -186,46 +216,72 @@ namespace otawa
 		be quite natural to represent the WCET of a CFT as an arithmetic expression
 		*/
 
-		/* infeasible paths implement */
+		public:
+			typedef enum { LEAF_NODE, ALT_NODE, COND_ALT_NODE, SEQ_NODE, LOOP_NODE } kind_t;
+
 		private:
-			std::map<PseudoPath, CFTree*> pseudoTrees;
-			std::set<Constraint>* constraints = new std::set<Constraint>();
-			std::set<PseudoPath> ppaths;
-			std::mutex mtx;
+			kind_t kind;
+			/* infeasible paths implement: the pseudo trees, constraints and
+			   pseudo paths of the node are in side tables keyed by id */
+			unsigned id;
+
+			// export of one node, the exports of its children being pushed to jobs
+			struct ExportJob;
+			void exportNode(formula_t *, struct param_func *, AWCETExport &, bool loopexit, bool lastBlock, std::vector<ExportJob> &jobs);
 
 		protected:
 			CFTree* parent = nullptr;
+			explicit CFTree(kind_t k);
 
 		public:
-			virtual CFTreeLeaf *toLeaf() = 0; /* abstract */
-			virtual CFTreeAlt *toAlt() = 0;	  /* abstract */
-			virtual CFTreeLoop *toLoop() = 0; /* abstract */
-			virtual CFTreeSeq *toSeq() = 0;	  /* abstract */
-			virtual CFTreeConditionalAlt* toConditionalAlt() = 0; /* abstract */
+			// does not delete the children, which may be shared (see CFTCacheMutator::release)
+			virtual ~CFTree();
+
+			kind_t getKind() const { return kind; }
+			unsigned getId() const { return id; }
+
+			// type tests on the kind tag, defined after the subclasses
+			CFTreeLeaf *toLeaf();
+			CFTreeAlt *toAlt();
+			CFTreeLoop *toLoop();
+			CFTreeSeq *toSeq();
+			CFTreeConditionalAlt* toConditionalAlt();
 
 			virtual void replace(CFTree* oldTree, CFTree* newTree) = 0; /* abstract, infeasible paths implement */
 
 			void exportToDot(const elm::string &);
 			/**
 			 * Enables to export the WCET as a parametric formula
+			 * @param ex state of the export, the origins of the nodes are registered in it
 			 * @param loopexit tell if we are in a loop exit tree, this is used to tighten the WCET when using the pipeline during the analysis
 			 * @param lastBlock tell if we are in the last block (usefull for alternatives)
 			 */
-			void exportToAWCET(formula_t *, struct param_func *, bool loopexit = false, bool lastBlock = false);
+			void exportToAWCET(formula_t *, struct param_func *, AWCETExport &ex, bool loopexit = false, bool lastBlock = false);
+			/**
+			 * Releases a formula built by exportToAWCET(), whose call sites may
+			 * share the formula of their callee, and the shared formulas of ex
+			 */
+			static void releaseAWCET(formula_t *, AWCETExport &ex);
+			/**
+			 * Releases a node removed from a formula built by exportToAWCET(),
+			 * keeping the shared formulas it refers to, ex being the AWCETExport
+			 * (a release function of formula_prune_alt())
+			 */
+			static void releasePruned(formula_t *, void *ex);
 			void exportToC(io::Output &);
 
 			/* infeasible paths implement */
 			void putPPath(PseudoPath pseudoPath, CFTree* pseudoTree);
-			std::map<PseudoPath, CFTree*> getPPaths();
-			void exportToFeasibleWCET(formula_t *, struct param_func *);
+			const std::map<PseudoPath, CFTree*> &getPPaths();
+			void exportToFeasibleWCET(formula_t *, struct param_func *, AWCETExport &);
 
-			std::set<Constraint>* getConstraints() {return constraints;};
-			void putConstraint(Constraint c){constraints->insert(c);};
+			std::set<Constraint>* getConstraints();
+			void putConstraint(Constraint c){getConstraints()->insert(c);};
 
 			CFTree* getParent();
 			void setParent(CFTree* parent);
 
-			std::set<PseudoPath> getPseudoPaths();
+			const std::set<PseudoPath> &getPseudoPaths();
 			void setPseudoPaths(std::set<PseudoPath> ppaths);
 
 		};
@@ -233,27 +289,21 @@ namespace otawa
 		class CFTreeLeaf : public CFTree
 		{
 
-			CFTreeLeaf* original;
-			std::vector<CFTreeLeaf*> avatars;
 			Block *block;
 
 		public:
-			// implements abstrat
-			CFTreeLeaf *toLeaf();
-			CFTreeAlt *toAlt();
-			CFTreeLoop *toLoop();
-			CFTreeSeq *toSeq();
-			CFTreeConditionalAlt* toConditionalAlt(); /* conditional alts management */
 			void replace(CFTree* oldTree, CFTree* newTree); /* abstract, infeasible paths implement */
 
 			CFTreeLeaf(Block *b);
 			Block *getBlock();
 			int getBlockId() const;
-			void addAvatar(CFTreeLeaf* avatar){ avatars.push_back(avatar); }
-			std::vector<CFTreeLeaf*> getAvatars(){ return avatars; }
-			void freeAvatars(){ avatars.clear(); }
-			void setOriginal(CFTreeLeaf* leaf){ original = leaf; }
-			CFTreeLeaf* getOriginal(){ return original; }
+
+			/* infeasible paths implement, in side tables */
+			void addAvatar(CFTreeLeaf* avatar);
+			const std::vector<CFTreeLeaf*> &getAvatars();
+			void freeAvatars();
+			void setOriginal(CFTreeLeaf* leaf);
+			CFTreeLeaf* getOriginal();
 		};
 
 		class CFTreeAlt : public CFTree
@@ -262,12 +312,6 @@ namespace otawa
 			std::vector<CFTree *> alts;
 
 		public:
-			// implements abstract
-			CFTreeLeaf *toLeaf();
-			CFTreeAlt *toAlt();
-			CFTreeLoop *toLoop();
-			CFTreeSeq *toSeq();
-			CFTreeConditionalAlt* toConditionalAlt(); /* conditional alts management */
 			void replace(CFTree* oldTree, CFTree* newTree); /* abstract, infeasible paths implement */
 
 			CFTreeAlt(std::vector<CFTree *> new_alts);
@@ -287,12 +331,6 @@ namespace otawa
 				std::vector<CFTree*> alts; //< The children nodes of the alt
 				std::map<int,std::string> conditions; //< Map the index of the children vector with the condition associated with the tree
 			public:
-				// implements abstract
-				CFTreeLeaf* toLeaf();
-				CFTreeAlt* toAlt();
-				CFTreeLoop* toLoop();
-				CFTreeSeq* toSeq();
-				CFTreeConditionalAlt* toConditionalAlt();
 				void replace(CFTree* oldTree, CFTree* newTree); /* abstract, infeasible paths implement */
 
 				/**
@@ -313,13 +351,20 @@ namespace otawa
 				 * Children accessor
 				 * @return the children of the nodes
 				 */
-				std::vector<CFTree*> getChildren();
+				const std::vector<CFTree*> &getChildren();
 
 				/**
 				 * Conditions accessor
 				 * @return the conditions associated to the children
 				 */
-				std::map<int,std::string> getConditions();
+				const std::map<int,std::string> &getConditions();
+
+				/**
+				 * Condition of a child
+				 * @param i the index of the child
+				 * @return its condition, empty if it has none
+				 */
+				std::string getCondition(size_t i);
 
 		};
 
@@ -330,12 +375,6 @@ namespace otawa
 			std::vector<CFTree *> unconstrained_childs;
 
 		public:
-			// implements abstrat
-			CFTreeLeaf *toLeaf();
-			CFTreeAlt *toAlt();
-			CFTreeLoop *toLoop();
-			CFTreeSeq *toSeq();
-			CFTreeConditionalAlt* toConditionalAlt(); /* conditional alts management */
 			void replace(CFTree* oldTree, CFTree* newTree); /* abstract, infeasible paths implement */
 
 			CFTreeSeq(std::vector<CFTree *> new_childs);
@@ -345,10 +384,10 @@ namespace otawa
 			CFTree *getI(size_t ind);
 			size_t size() { return childs.size(); }
 
-			std::vector<CFTree*> getChilds(){return childs;}
+			const std::vector<CFTree*> &getChilds(){return childs;}
 			void setChilds(std::vector<CFTree*> new_childs){childs = new_childs;}
 
-			std::vector<CFTree*> getUnconstrainedChilds(){return unconstrained_childs;}
+			const std::vector<CFTree*> &getUnconstrainedChilds(){return unconstrained_childs;}
 			void setUnconstrainedChilds(std::vector<CFTree*> new_childs){unconstrained_childs = new_childs;}
 		};
 
@@ -364,12 +403,6 @@ namespace otawa
 			std::string expression; // parametric loop bound
 
 		public:
-			// implements abstrat
-			CFTreeLeaf *toLeaf();
-			CFTreeAlt *toAlt();
-			CFTreeLoop *toLoop();
-			CFTreeSeq *toSeq();
-			CFTreeConditionalAlt* toConditionalAlt(); /* conditional alts management */
 			void replace(CFTree* oldTree, CFTree* newTree); /* abstract, infeasible paths implement */
 
 			CFTreeLoop(BasicBlock *h, int bound, CFTree *n_bd, CFTree *n_ex);
@@ -400,12 +433,56 @@ namespace otawa
 			std::string getParametricBound();
 		};
 
+		inline CFTreeLeaf *CFTree::toLeaf() { return kind == LEAF_NODE ? static_cast<CFTreeLeaf *>(this) : nullptr; }
+		inline CFTreeAlt *CFTree::toAlt() { return kind == ALT_NODE ? static_cast<CFTreeAlt *>(this) : nullptr; }
+		inline CFTreeLoop *CFTree::toLoop() { return kind == LOOP_NODE ? static_cast<CFTreeLoop *>(this) : nullptr; }
+		inline CFTreeSeq *CFTree::toSeq() { return kind == SEQ_NODE ? static_cast<CFTreeSeq *>(this) : nullptr; }
+		inline CFTreeConditionalAlt *CFTree::toConditionalAlt() { return kind == COND_ALT_NODE ? static_cast<CFTreeConditionalAlt *>(this) : nullptr; }
+
+		class CFTreeVisitor
+		{
+			/*
+		Depth-first traversal of a CFTree with an explicit stack, so that the
+		depth of the tree is not limited by the call stack. For each node t,
+		enter(t) is called first, then for each child i before(t, i), which
+		returns false to skip the child, the traversal of the child and
+		after(t, i), and finally leave(t). The children of a loop are its body
+		then its exit.
+		*/
+		public:
+			virtual ~CFTreeVisitor() {}
+			void visit(CFTree *root);
+
+			static size_t childCount(CFTree *t);
+			static CFTree *child(CFTree *t, size_t i);
+
+		protected:
+			virtual void enter(CFTree *) {}
+			virtual bool before(CFTree *, size_t) { return true; }
+			virtual void after(CFTree *, size_t) {}
+			virtual void leave(CFTree *) {}
+		};
+
 		class DAGNode
 		{
 		private:
 			std::vector<DAGNode *> pred; // les noeuds précédents du sommet
 			std::vector<DAGNode *> succ; // les noeuds suivants du sommet
 
+			// once the DAG is packed, the successors then the predecessors in
+			// the edge array of the DAG (compressed sparse rows)
+			DAGNode **edges = nullptr;
+			unsigned n_succ = 0;
+			unsigned n_pred = 0;
+
+			// DAG the node was added to
+			DAG *owner = nullptr;
+
+			// position in the dominator tree of the DAG, set by DAG::getIdom
+			DAGNode *idom = nullptr;
+			int dom_depth = -1;
+			friend class DAG;
+
 		public:
 			// abstract
 			virtual DAGVNode *toVNode() = 0;
@@ -418,14 +495,20 @@ namespace otawa
 			void addPred(DAGNode *s);
 
 			// Iterator for successor and predecessor
-			std::vector<DAGNode *>::const_iterator succIter();
-			std::vector<DAGNode *>::const_iterator predIter();
-			std::vector<DAGNode *>::const_iterator succEnd();
-			std::vector<DAGNode *>::const_iterator predEnd();
+			typedef DAGNode *const *iterator;
+			iterator succIter();
+			iterator predIter();
+			iterator succEnd();
+			iterator predEnd();
+			std::size_t succCount();
+			std::size_t predCount();
 
 			// Getter for successor and predecessor
 			std::vector<DAGNode *> getSucc();
 			std::vector<DAGNode *> getPred();
+
+			// DAG containing the node
+			DAG *getOwner();
 		};
 
 		class DAGHNode : public DAGNode
@@ -435,10 +518,11 @@ namespace otawa
 		*/
 		private:
 			BasicBlock *header;
-			DAG *sub_dag;
+			DAG *sub_dag = nullptr;
 
 		public:
-			virtual ~DAGHNode(){};
+			// deletes the sub-DAG too
+			virtual ~DAGHNode();
 
 			// implements abstrat
 			DAGHNode *toHNode();
@@ -482,7 +566,7 @@ namespace otawa
 
 		public:
 			// implements abstrat
-			virtual ~DAGBNode(){};
+			virtual ~DAGBNode();
 			DAGHNode *toHNode();
 			DAGVNode *toVNode();
 			DAGBNode *toBNode();
@@ -518,6 +602,13 @@ namespace otawa
 			DAGNode *n_virt_next;
 			DAGNode *n_virt_exit;
 
+			// Edges of the nodes once packed
+			std::vector<DAGNode *> adjacency;
+
+			// Dominator tree, computed once on first use
+			bool dominators = false;
+			void computeDominators();
+
 		public:
 			// Iterator for nodes in DAG
 			std::vector<DAGNode *>::const_iterator iter();
@@ -525,6 +616,10 @@ namespace otawa
 
 			void visit(std::function<void(DAGNode *)> &, bool recursive = false);
 
+			// Moves the edges of the nodes, sub-DAGs included, to one array
+			// per DAG; no edge can be added afterwards
+			void pack();
+
 			// Getter and setter nodes
 			void addNode(DAGNode *s);
 			void setStart(DAGNode *s);
@@ -539,6 +634,11 @@ namespace otawa
 			void setVirtNext(DAGNode *s);
 			void setVirtExit(DAGNode *s);
 
+			// Dominator tree of the DAG, virtual nodes included: immediate
+			// dominator of n (nullptr for the start node and unreachable nodes)
+			DAGNode *getIdom(DAGNode *n);
+			bool dominates(DAGNode *a, DAGNode *b);
+
 			// Iterator for nodes with an exit edge
 			std::vector<DAGNode *>::const_iterator iter_e();
 			std::vector<DAGNode *>::const_iterator end_e();
@@ -574,6 +674,10 @@ namespace otawa
 		private:
 			CFTree *processCFG(CFG *cfg);
 			DAG *toDAG(CFG *cfg, BasicBlock *l_h);
+
+			// basic and synthetic blocks directly in each loop (nullptr for the
+			// CFG body), headers included, in CFG order
+			std::map<Block *, std::vector<Block *>> loop_blocks;
 		};
 
 		extern p::feature EXTRACTED_CFTREE_FEATURE;
@@ -585,6 +689,12 @@ namespace otawa
 		extern Identifier<int> ANN_TIME;
 		extern Identifier<int> ANN_COUNT;
 
+		/**
+		 * Configuration of CFTreeExtractor: the CFGs are not virtualized, each
+		 * function has one CFTree whose formula is shared by all its calls
+		 */
+		extern Identifier<bool> FUNCTION_SUMMARIES;
+
 
 		/// ******************************
 		/// CACHE MUTATOR CLASS
@@ -595,6 +705,8 @@ namespace otawa
 		public:
 			CFTCacheMutator();
 			CFTree *transform(CFTree *tree);
+			// Deletes the inner nodes of a tree given to transform(), whose leaves now belong to the new tree
+			void release(CFTree *tree);
 
 		private:
 			CFTreeSeq *transformLeaf(CFTreeLeaf *leaf);
@@ -964,6 +1076,43 @@ namespace otawa
 			public:
 				bool isParam(Block* b);
 		};
+
+		/**
+		 * Dense copy of the block properties read by the DAG construction and
+		 * the formula export, indexed by CFG and block id, the boolean ones
+		 * being stored as bitsets. The properties remain the reference: the
+		 * setters write through, and the blocks of no loaded CFG (blocks made
+		 * for the cache or the pipeline) are read from their properties.
+		 */
+		class BlockTable {
+			public:
+				typedef enum { AFTER_ALT, LAST_IN_ALT, PIPELINE_EDGE, AA_LOOPEXIT, FLAG_COUNT } flag_t;
+
+				/**
+				 * Copies the properties of the blocks of the CFGs, replacing the
+				 * previous copy
+				 */
+				static void load(const CFGCollection *coll);
+
+				/**
+				 * Drops the copy, the properties are read again
+				 */
+				static void clear();
+
+				static DAGBNode *bnode(Block *b);
+				static void setBNode(Block *b, DAGBNode *n);
+				static DAGHNode *hnode(Block *b);
+				static void setHNode(Block *b, DAGHNode *n);
+				static BranchCondition *condition(Block *b);
+				static LoopBound loopBound(Block *b);
+				static ot::time blockTime(Block *b);
+				static int annCount(Block *b);
+				static int annTime(Block *b);
+				static Edge *edgeAlias(Block *b);
+				static void setEdgeAlias(Block *b, Edge *e);
+				static bool flag(Block *b, flag_t f);
+				static void setFlag(Block *b, flag_t f);
+		};
 	} // namespace cftree
 } // namespace otawa
 
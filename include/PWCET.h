@@ -26,6 +26,7 @@
 #define ANN_OUTER 1
 #define ANN_CONFLICT_PRIORITY ANN_INNER
 #define ALT_MAX 1024
+#define SEQ_CURSORS 64
 
 #include <stdio.h>
 
@@ -43,15 +44,52 @@ struct param_func {
 	int param_id;
 };
 
+/*
+ * Explicit stack for the depth-first traversals of formulas, whose depth is
+ * then not limited by the C stack. A frame holds a node, the index of its
+ * next child to visit and the state of the traversal for this node, cleared
+ * by walk_push(). The first frames are in the walker itself, the stack moves
+ * to the heap only for deeper formulas: frames move when the stack grows.
+ */
+#define WALK_FRAMES 64
+
+typedef struct walk_frame_s {
+	formula_t *f;
+	int next;
+	int flags;
+	long long value[2];
+	double share;
+	void *data;
+} walk_frame_t;
+
+typedef struct walk_s {
+	walk_frame_t *frames;
+	int size;
+	int capacity;
+	walk_frame_t local[WALK_FRAMES];
+} walk_t;
+
+void walk_init(walk_t *w, formula_t *root);
+/* Frame of the new top node, valid until the next walk_push() */
+walk_frame_t *walk_push(walk_t *w, formula_t *f);
+/* Frame of the current node, NULL once the traversal is over */
+walk_frame_t *walk_top(walk_t *w);
+void walk_pop(walk_t *w);
+void walk_release(walk_t *w);
+
+void compute_node(evalctx_t * ctx, formula_t * f);
+void compute_combine(evalctx_t * ctx, formula_t * f);
 void awcet_seq(evalctx_t * ctx, int source_count, formula_t * source,
-                           awcet_t * dest);
+                           awcet_t * dest, int limit);
 void awcet_alt(evalctx_t * ctx, int source_count, formula_t * source,
-                           awcet_t * dest);
+                           awcet_t * dest, int limit);
 void awcet_loop(evalctx_t * ctx, awcet_t * source, formula_t * dest);
 void awcet_ann(evalctx_t * ctx, awcet_t * source, formula_t * dest);
 void awcet_intmult(evalctx_t * ctx, awcet_t * source, formula_t * dest);
 void awcet_boolmult(evalctx_t* ctx, formula_t* source, awcet_t* dest);
 void awcet_paramloop(evalctx_t* ctx, awcet_t* source, formula_t* dest);
+int awcet_length(awcet_t * aw);
+int awcet_is_equal(awcet_t * s1, awcet_t * s2);
 
 int check_condition(evalctx_t* ctx, condition_t* cdts, int condition_size);
 int compute_loop_bound(evalctx_t* ctx, condition_t* cdt);
@@ -59,5 +97,28 @@ int compute_loop_bound(evalctx_t* ctx, condition_t* cdt);
 void writeC(formula_t *f, FILE *out, int indent);
 void writePWF(formula_t *f, FILE *out, long long *bounds);
 void compute_eta_count(formula_t *f);
+int formula_child_count(formula_t *f);
+formula_t *formula_clone(formula_t *f);
+void formula_free(formula_t *f);
+void formula_release_buffers(formula_t *f);
+
+/**
+ * Same as formula_clone(), the nodes evaluated often being placed first
+ * @param hits number of evaluations of each node, indexed in pre-order, from
+ * formula_profile(), or NULL to only move the subtrees guarded by BOOLMULT nodes
+ * @param min_hits nodes evaluated fewer times are placed after the others
+ * @return the copy, to be released like that of formula_clone()
+ */
+formula_t *formula_layout(formula_t *f, const unsigned *hits, unsigned min_hits);
+
+/**
+ * Count the nodes evaluated by evaluate() for one valuation of the parameters
+ * @param hits formula_node_count(f) counters, indexed in pre-order, incremented
+ * for each node evaluated
+ */
+void formula_profile(formula_t *f, loopinfo_t *li, param_valuation_t pv, bparam_valuation_t bpv, void *data, unsigned *hits);
+int formula_node_count(formula_t *f);
+int formula_prune_alt(formula_t *f, long long *bounds, void (*release)(formula_t *, void *), void *data);
+int formula_value_range(formula_t *f, long long *bounds, long long max_param, long long *lo, long long *hi);
 
 #endif
@@ -0,0 +1,85 @@
+/* ----------------------------------------------------------------------------
+   Copyright (C) 2020, Université de Lille, Lille, FRANCE
+
+   This file is part of WSymb.
+
+   WSymb is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation ; either version 2 of
+   the License, or (at your option) any later version.
+
+   WSymb is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY ; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program ; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+   ---------------------------------------------------------------------------- */
+
+#ifndef PWCET_CLOSED_H
+#define PWCET_CLOSED_H 1
+
+#include <stdio.h>
+
+#include "pwcet-runtime.h"
+
+/*
+ * Closed form of the WCET in one loop bound parameter
+ *
+ * With the other parameters fixed, the WCET is a piecewise linear function of
+ * a parametric loop bound p as long as no loop bounded by p contains another
+ * use of p. The formula is evaluated once symbolically, every value of the
+ * abstract WCETs being a + b * p over intervals of p, and the result is a
+ * table of segments: the WCET for a value of p is then found by a binary
+ * search, without the formula.
+ *
+ * The WCET does not decrease when a loop bound grows, so for parameters only
+ * known by a range, the valuation functions should return their greatest
+ * value.
+ */
+
+/* WCET a + b * p for p >= lo, up to the lo of the next segment */
+struct pwcet_segment_s {
+	long long lo;
+	long long a;
+	long long b;
+};
+typedef struct pwcet_segment_s pwcet_segment_t;
+
+struct pwcet_closed_s {
+	int param_id;
+	long long lo;				/* range of p */
+	long long hi;
+	int count;				/* number of segments */
+	pwcet_segment_t *segments;
+};
+typedef struct pwcet_closed_s pwcet_closed_t;
+
+/**
+ * Compute the WCET of f as a function of the loop bound parameter param_id
+ * pv and bpv give the values of the other parameters, as for evaluate().
+ * @param lo smallest value of the parameter, at least 0
+ * @param hi greatest value of the parameter
+ * @return 0, or -1 if the WCET is not piecewise linear in the parameter
+ */
+int pwcet_closed_form(pwcet_closed_t *c, formula_t *f, loopinfo_t *li, param_valuation_t pv, bparam_valuation_t bpv, void *data, int param_id, long long lo, long long hi);
+
+/**
+ * @return the WCET for the parameter value p, -1 if p is out of range
+ */
+long long pwcet_closed_wcet(const pwcet_closed_t *c, long long p);
+
+/**
+ * Write the C function "long long name(long long p)" returning the WCET
+ */
+void pwcet_closed_writeC(const pwcet_closed_t *c, FILE *out, const char *name);
+
+/**
+ * Release the segments of c
+ */
+void pwcet_closed_free(pwcet_closed_t *c);
+
+#endif
@@ -0,0 +1,255 @@
+/* ----------------------------------------------------------------------------
+   Copyright (C) 2020, Université de Lille, Lille, FRANCE
+
+   This file is part of WSymb.
+
+   WSymb is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation ; either version 2 of
+   the License, or (at your option) any later version.
+
+   WSymb is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY ; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program ; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+   ---------------------------------------------------------------------------- */
+
+#ifndef PWCET_CONSTEXPR_HPP
+#define PWCET_CONSTEXPR_HPP 1
+
+/*
+ * Compile-time evaluation (C++17)
+ *
+ * Same operators as the C runtime, on fixed-size abstract WCETs, usable in
+ * constant expressions. "swymplify -x" turns a formula into a call tree of
+ * these operators: with constant parameters the WCET is a constant
+ * expression, so it can be checked with static_assert; otherwise the
+ * compiler specializes the code for the parameters known at compile time.
+ *
+ * Large formulas may need a higher constant evaluation limit
+ * (-fconstexpr-ops-limit with GCC, -fconstexpr-steps with Clang).
+ */
+
+#include <cstdlib>
+#include <initializer_list>
+
+/* Maximal number of eta values of a parametric abstract WCET */
+#ifndef PWCET_PARAM_SIZE
+#define PWCET_PARAM_SIZE 64
+#endif
+
+namespace pwcet {
+
+/* Same as awcet_value_t: overflows make the constant evaluation fail */
+#ifdef PWCET_VALUE_32
+typedef int value_t;
+#else
+typedef long long value_t;
+#endif
+
+constexpr int loop_top = -1;
+constexpr int alt_max = 1024;		/* same as ALT_MAX, checked by swymplify -x */
+
+/* Not constexpr: reaching it makes the constant evaluation fail */
+inline void capacity_exceeded() { std::abort(); }
+inline void missing_parameter() { std::abort(); }
+inline void negative_bound() { std::abort(); }
+
+/* Abstract WCET with room for N eta values */
+template <int N>
+struct awcet {
+	int loop_id = loop_top;
+	int count = 0;
+	value_t eta[N > 0 ? N : 1] = {};
+	value_t others = 0;
+
+	constexpr value_t wcet() const { return (count == 0) ? others : eta[0]; }
+
+	constexpr void push(value_t value) {
+		if (count == N)
+			capacity_exceeded();
+		eta[count++] = value;
+	}
+};
+
+/* Operand of an operator, whatever its size */
+struct view {
+	int loop_id;
+	int count;
+	const value_t *eta;
+	value_t others;
+
+	template <int N>
+	constexpr view(const awcet<N> &aw) : loop_id(aw.loop_id), count(aw.count), eta(aw.eta), others(aw.others) {}
+	constexpr view(int loop_id, int count, const value_t *eta, value_t others)
+		: loop_id(loop_id), count(count), eta(eta), others(others) {}
+
+	constexpr value_t at(int i) const { return (i < count) ? eta[i] : others; }
+};
+
+template <int N>
+constexpr awcet<N> copy(view source)
+{
+	awcet<N> dest;
+	if (source.count > N)
+		capacity_exceeded();
+	dest.loop_id = source.loop_id;
+	dest.count = source.count;
+	for (int i = 0; i < source.count; i++)
+		dest.eta[i] = source.eta[i];
+	dest.others = source.others;
+	return dest;
+}
+
+/* Loops must provide static constexpr int hierarchy(int inner, int outer) */
+template <class Loops>
+constexpr bool loop_inner(int inner_id, int outer_id)
+{
+	if ((inner_id == outer_id) || (inner_id == loop_top))
+		return false;
+	if (outer_id == loop_top)
+		return true;
+	return Loops::hierarchy(inner_id, outer_id) != 0;
+}
+
+template <int N, class Loops>
+constexpr awcet<N> seq(std::initializer_list<view> source)
+{
+	awcet<N> dest;
+	int length = 0;
+	for (const view &s : source) {
+		if ((dest.loop_id == loop_top) || loop_inner<Loops>(s.loop_id, dest.loop_id))
+			dest.loop_id = s.loop_id;
+		dest.others += s.others;
+		if (s.count > length)
+			length = s.count;
+	}
+	for (int i = 0; i < length; i++) {
+		value_t value = 0;
+		for (const view &s : source)
+			value += s.at(i);
+		dest.push(value);
+	}
+	return dest;
+}
+
+template <int N, class Loops>
+constexpr awcet<N> alt(std::initializer_list<view> source)
+{
+	if (source.size() > alt_max)
+		capacity_exceeded();
+
+	awcet<N> dest;
+	/* next value of each operand, source.size() <= alt_max */
+	int next[alt_max] = {};
+	int i = 0;
+
+	dest.others = -1;
+	for (const view &s : source) {
+		if ((dest.loop_id == loop_top) || loop_inner<Loops>(s.loop_id, dest.loop_id))
+			dest.loop_id = s.loop_id;
+		if (dest.others < s.others)
+			dest.others = s.others;
+	}
+	/* merge the values above others, greatest first */
+	for (;;) {
+		value_t max = -1;
+		int max_source = 0;
+		i = 0;
+		for (const view &s : source) {
+			if ((next[i] < s.count) && (s.eta[next[i]] > dest.others) && (s.eta[next[i]] > max)) {
+				max = s.eta[next[i]];
+				max_source = i;
+			}
+			i++;
+		}
+		if (max == -1)
+			break;
+		dest.push(max);
+		next[max_source]++;
+	}
+	return dest;
+}
+
+/*
+ * Loop iterated bound times, the bound being a constant or a parameter
+ * A negative bound, which the C runtime does not define either, fails (the
+ * bounds of parametric loops go through loop_bound() first)
+ */
+template <int N>
+constexpr awcet<N> loop(view source, int loop_id, int bound)
+{
+	awcet<N> dest;
+	if (bound < 0)
+		negative_bound();
+	if (bound == 0)
+		return dest;
+	if (source.loop_id == loop_id) {
+		/* sum of the bound greatest values */
+		for (int i = 0; i < bound; i++)
+			dest.others += source.at(i);
+		return dest;
+	}
+	/* values are summed by groups of bound */
+	dest.loop_id = source.loop_id;
+	dest.others = source.others * bound;
+	for (int i = 0; i < source.count; i += bound) {
+		value_t value = 0;
+		for (int j = i; j < i + bound; j++)
+			value += source.at(j);
+		dest.push(value);
+	}
+	return dest;
+}
+
+/* Bound of a parametric loop, a negative expression means no iteration */
+constexpr int loop_bound(int bound)
+{
+	return (bound < 0) ? 0 : bound;
+}
+
+template <int N, class Loops>
+constexpr awcet<N> ann(view source, int loop_id, int count)
+{
+	awcet<N> dest;
+	bool takeover = false;
+
+	if ((count == -1) || ((source.count != 0) && loop_inner<Loops>(loop_id, source.loop_id) && (count >= source.count))) {
+		/* the annotation does not apply */
+		return copy<N>(source);
+	}
+	if ((source.count != 0) && loop_inner<Loops>(loop_id, source.loop_id))
+		takeover = true;
+	/* the count first values of source, padded with source.others */
+	for (int i = 0; i < count; i++)
+		dest.push(source.at(i));
+	dest.loop_id = ((source.count == 0) || takeover) ? loop_id : source.loop_id;
+	return dest;
+}
+
+/* Like the C runtime, the result is not attached to a loop */
+template <int N>
+constexpr awcet<N> intmult(view source, int coef)
+{
+	awcet<N> dest;
+	for (int i = 0; i < source.count; i++)
+		dest.push(source.eta[i] * coef);
+	dest.others = source.others * coef;
+	return dest;
+}
+
+/* Parameters of a formula without parameters */
+struct no_params {
+	int bound(int) const { missing_parameter(); return 0; }
+	int bparam(int) const { missing_parameter(); return 0; }
+	view awcet(int) const { missing_parameter(); return view(loop_top, 0, nullptr, 0); }
+};
+
+}
+
+#endif
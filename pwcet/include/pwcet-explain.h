@@ -0,0 +1,71 @@
+/* ----------------------------------------------------------------------------
+   Copyright (C) 2020, Université de Lille, Lille, FRANCE
+
+   This file is part of WSymb.
+
+   WSymb is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation ; either version 2 of
+   the License, or (at your option) any later version.
+
+   WSymb is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY ; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program ; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+   ---------------------------------------------------------------------------- */
+
+#ifndef PWCET_EXPLAIN_H
+#define PWCET_EXPLAIN_H 1
+
+#include <stdio.h>
+
+#include "pwcet-runtime.h"
+
+/*
+ * Explanation of a WCET
+ *
+ * After the evaluation, the WCET is split among the nodes of the formula,
+ * from the root down: an ALT gives its share to the child with the greatest
+ * WCET (the first one on ties), a SEQ splits it among its children in
+ * proportion to their WCETs (evenly when they are all 0), and the other
+ * operators pass it to their child.
+ * Inside loops the WCET of a node is the first value of its abstract WCET, so
+ * the split is an approximation; the shares of the leaves always sum to the
+ * WCET.
+ *
+ * Nodes are numbered in pre-order, as in the .map file written by dumpcft
+ * next to the .pwf file, which gives the function, block, addresses and loop
+ * of each node, along with its origin. Formulas simplified by swymplify have
+ * other nodes and no origin, only the loop identifiers are preserved.
+ */
+
+struct pwcet_explain_s {
+	int node;				/* pre-order index */
+	int kind;
+	int loop_id;				/* loop of the abstract WCET of the node */
+	int param_id;
+	int origin;				/* origin of the node in dumpcft, 0 if unknown */
+	int alt_child;				/* child on the critical path of an ALT, -1 otherwise */
+	long long wcet;				/* WCET of the node */
+	double contribution;			/* share of the WCET of the formula */
+};
+typedef struct pwcet_explain_s pwcet_explain_t;
+
+/**
+ * Same as evaluate(), also listing the nodes on the critical path
+ * @param report set to the nodes with a positive contribution, by decreasing contribution, to be released with free()
+ * @param count set to the number of entries of report
+ */
+long long evaluate_explain(formula_t *f, loopinfo_t *li, param_valuation_t pv, bparam_valuation_t bpv, void *data, pwcet_explain_t **report, int *count);
+
+/**
+ * Print the max first entries of a report, all of them if max <= 0
+ */
+void pwcet_explain_print(const pwcet_explain_t *report, int count, int max, FILE *out);
+
+#endif
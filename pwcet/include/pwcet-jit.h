@@ -0,0 +1,81 @@
+/* ----------------------------------------------------------------------------
+   Copyright (C) 2020, Université de Lille, Lille, FRANCE
+
+   This file is part of WSymb.
+
+   WSymb is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation ; either version 2 of
+   the License, or (at your option) any later version.
+
+   WSymb is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY ; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program ; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+   ---------------------------------------------------------------------------- */
+
+#ifndef PWCET_JIT_H
+#define PWCET_JIT_H 1
+
+#include "pwcet-runtime.h"
+
+/*
+ * Native evaluation of formulas loaded at runtime
+ *
+ * A formula is translated into straight-line C, compiled by the system
+ * compiler ($PWCET_CC, cc by default) into a shared object and loaded with
+ * dlopen(). Compilation runs in the background: until it completes, or if it
+ * fails, formulas are evaluated by evaluate(). Shared objects are kept in a
+ * cache directory, named after a hash of the generated code, so a formula is
+ * only compiled once. The directory, and the objects loaded from it, must be
+ * owned by the effective user and writable by nobody else.
+ *
+ * Formulas with KIND_AWCET leaves or parametric annotations are always
+ * interpreted.
+ */
+typedef struct pwcet_jit_s pwcet_jit_t;
+typedef struct pwcet_native_s pwcet_native_t;
+
+/**
+ * @param cache_dir directory of the compiled formulas, $TMPDIR/pwcet-<uid>
+ * (or /tmp/pwcet-<uid>) if NULL; it is created with mode 0700 if needed
+ * @return the compiler, or NULL if out of memory or the directory is not private
+ */
+pwcet_jit_t *pwcet_jit_new(const char *cache_dir);
+
+/**
+ * Release the compiler, after every formula it loaded
+ */
+void pwcet_jit_free(pwcet_jit_t *jit);
+
+/**
+ * Start the compilation of f, which must stay valid until pwcet_native_free()
+ * @return the handle used to evaluate f, or NULL if out of memory
+ */
+pwcet_native_t *pwcet_jit_load(pwcet_jit_t *jit, formula_t *f);
+
+/**
+ * Same as evaluate(), with the native code once it is available
+ * Until pwcet_native_ready() returns 1, f is interpreted and, as with
+ * evaluate(), the handle must not be used by several threads at once; the
+ * native code can then be called from any number of threads.
+ */
+long long pwcet_native_evaluate(pwcet_native_t *n, loopinfo_t *li, param_valuation_t pv, bparam_valuation_t bpv, void *data);
+
+/**
+ * @param wait if non zero, wait for the end of the compilation
+ * @return 1 if evaluations use the native code, 0 otherwise
+ */
+int pwcet_native_ready(pwcet_native_t *n, int wait);
+
+/**
+ * Release the handle, the shared object stays in the cache
+ */
+void pwcet_native_free(pwcet_native_t *n);
+
+#endif
@@ -0,0 +1,91 @@
+/* ----------------------------------------------------------------------------
+   Copyright (C) 2020, Université de Lille, Lille, FRANCE
+
+   This file is part of WSymb.
+
+   WSymb is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation ; either version 2 of
+   the License, or (at your option) any later version.
+
+   WSymb is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY ; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program ; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+   ---------------------------------------------------------------------------- */
+
+#ifndef PWCET_ONLINE_H
+#define PWCET_ONLINE_H 1
+
+#include "pwcet-runtime.h"
+
+/*
+ * Online evaluation
+ *
+ * A dedicated evaluator thread owns a formula and the values of its integer
+ * parameters (parametric loop bounds and boolean parameters). Any thread can
+ * post a new parameter value through a lock-free bounded queue. The evaluator
+ * applies every pending update and, if a value the formula depends on has
+ * changed, computes again the operators using it and their ancestors only:
+ * the other operators keep their result from the previous evaluation. The
+ * WCET is published through a seqlock: readers never block nor enter the
+ * kernel.
+ *
+ * Parametric annotations and KIND_AWCET leaves are handed to the fallback
+ * valuation function, from the evaluator thread; their values are assumed not
+ * to change.
+ */
+typedef struct pwcet_online_s pwcet_online_t;
+
+/* Snapshot published by the evaluator */
+struct pwcet_online_result_s {
+	long long wcet;
+	unsigned long version;			/* number of evaluations so far */
+	unsigned long long applied;		/* ticket of the last update taken into account */
+};
+typedef struct pwcet_online_result_s pwcet_online_result_t;
+
+/**
+ * Create an online evaluator, parameters are initially 0
+ * The formula must not be used by other threads until pwcet_online_free(),
+ * and must not be used as a sub-formula afterwards: its operators are limited
+ * to the eta values their parent observes (see compute_eta_demand()), loop
+ * bounds being read from li once.
+ * @param max_param the greatest parameter identifier that can be updated
+ * @param queue_size capacity of the update queue, rounded up to a power of 2
+ * @param pv fallback valuation function, may be NULL if f has no other parameter
+ * @return the evaluator, or NULL if out of memory
+ */
+pwcet_online_t *pwcet_online_new(formula_t *f, loopinfo_t *li, int max_param, int queue_size, param_valuation_t pv, void *data);
+
+/**
+ * Start the evaluator thread, which publishes a first result before any update
+ * @param cpu the processor the thread is pinned to, -1 to leave it unpinned
+ * @return 0 on success, -1 if the thread cannot be created
+ */
+int pwcet_online_start(pwcet_online_t *o, int cpu);
+
+/**
+ * Stop the evaluator thread and release the evaluator
+ */
+void pwcet_online_free(pwcet_online_t *o);
+
+/**
+ * Post a new parameter value, never blocks
+ * @param ticket if not NULL, receives a ticket: the update is reflected in
+ * every result whose applied field is greater or equal
+ * @return 0 on success, -1 if param_id is out of range or the queue is full
+ */
+int pwcet_online_set(pwcet_online_t *o, int param_id, int value, unsigned long long *ticket);
+
+/**
+ * Read the latest published result, never blocks
+ */
+void pwcet_online_read(pwcet_online_t *o, pwcet_online_result_t *res);
+
+#endif
@@ -0,0 +1,62 @@
+/* ----------------------------------------------------------------------------
+   Copyright (C) 2020, Université de Lille, Lille, FRANCE
+
+   This file is part of WSymb.
+
+   WSymb is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation ; either version 2 of
+   the License, or (at your option) any later version.
+
+   WSymb is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY ; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program ; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+   ---------------------------------------------------------------------------- */
+
+#ifndef PWCET_PARALLEL_H
+#define PWCET_PARALLEL_H 1
+
+#include "pwcet-runtime.h"
+
+/*
+ * Parallel evaluation
+ *
+ * The children of SEQ and ALT nodes are independent: subtrees larger than a
+ * threshold are evaluated as tasks on a pool of worker threads, each with its
+ * own task deque, idle workers stealing from the others. A node waits for its
+ * children, running other tasks meanwhile, then applies the same operator as
+ * evaluate(), so both evaluators give the same result.
+ *
+ * The valuation functions are called from several threads at once.
+ */
+typedef struct pwcet_pool_s pwcet_pool_t;
+
+/* Default minimal number of nodes of a subtree evaluated as a separate task */
+#define PWCET_PARALLEL_THRESHOLD 256
+
+/**
+ * Start a pool of worker threads
+ * @param nthreads number of workers, in addition to the thread calling evaluate_parallel()
+ * @return the pool, or NULL if the threads cannot be created
+ */
+pwcet_pool_t *pwcet_pool_new(int nthreads);
+
+/**
+ * Stop the workers and release the pool
+ */
+void pwcet_pool_free(pwcet_pool_t *pool);
+
+/**
+ * Same as evaluate(), the work being shared with the workers of pool
+ * A pool evaluates one formula at a time, concurrent calls are serialized.
+ * @param threshold minimal size of a task in nodes, PWCET_PARALLEL_THRESHOLD if <= 0
+ */
+long long evaluate_parallel(pwcet_pool_t *pool, formula_t *f, loopinfo_t *li, param_valuation_t pv, bparam_valuation_t bpv, void *data, int threshold);
+
+#endif
@@ -0,0 +1,103 @@
+/* ----------------------------------------------------------------------------
+   Copyright (C) 2020, Université de Lille, Lille, FRANCE
+
+   This file is part of WSymb.
+
+   WSymb is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation ; either version 2 of
+   the License, or (at your option) any later version.
+
+   WSymb is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY ; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program ; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+   ---------------------------------------------------------------------------- */
+
+#ifndef PWCET_REGISTRY_H
+#define PWCET_REGISTRY_H 1
+
+#include "pwcet-runtime.h"
+
+/*
+ * Live formula registry
+ *
+ * The registry binds a formula to an identifier, which is the param_id of the
+ * KIND_AWCET leaves standing for this formula (typically the identifier given
+ * to a function in the .pfl file). A binding can be replaced at any time while
+ * other threads keep evaluating: writers publish a private copy of the new
+ * formula and old copies are reclaimed once every reader has left the epoch in
+ * which it could still see them (epoch-based reclamation).
+ *
+ * Each reader thread owns a pwcet_reader_t. Readers never take a lock: they
+ * evaluate private copies of the published formulas and cache the abstract
+ * WCET of every identifier they evaluate. A cached result is dropped when the
+ * binding of its identifier, or of any identifier it depends on, is replaced,
+ * or when pwcet_reader_invalidate() is called after a parameter change.
+ *
+ * Registry identifiers must not collide with loop bound or annotation
+ * parameter identifiers: those are forwarded to the user valuation function.
+ */
+typedef struct pwcet_registry_s pwcet_registry_t;
+typedef struct pwcet_reader_s pwcet_reader_t;
+
+/**
+ * Create a registry
+ * @param max_id the greatest identifier that can be bound
+ * @return the registry, or NULL if out of memory
+ */
+pwcet_registry_t *pwcet_registry_new(int max_id);
+
+/**
+ * Destroy a registry, all its readers must have been freed before
+ */
+void pwcet_registry_free(pwcet_registry_t *reg);
+
+/**
+ * Publish (or replace) the formula bound to an identifier
+ * The formula is copied, the caller keeps ownership of f. The copy is made
+ * with formula_clone(), whose eta buffers are sized by the current eta_count
+ * of each node: f must not have been evaluated.
+ * @param id the identifier to bind
+ * @param f the new formula, NULL to remove the binding
+ * @return 0 on success, -1 if id is out of range or memory is exhausted
+ */
+int pwcet_registry_bind(pwcet_registry_t *reg, int id, formula_t *f);
+
+/**
+ * Wait until every replaced formula has been reclaimed
+ * Must not be called from a thread that is inside pwcet_reader_evaluate().
+ */
+void pwcet_registry_synchronize(pwcet_registry_t *reg);
+
+/**
+ * Register a new reader, to be used by a single thread
+ */
+pwcet_reader_t *pwcet_reader_new(pwcet_registry_t *reg);
+
+/**
+ * Unregister a reader and release its private copies
+ */
+void pwcet_reader_free(pwcet_reader_t *r);
+
+/**
+ * Drop every cached result of the reader, to be called when the values
+ * returned by the valuation functions change
+ */
+void pwcet_reader_invalidate(pwcet_reader_t *r);
+
+/**
+ * Evaluate the formula bound to an identifier
+ * KIND_AWCET leaves whose identifier is bound are evaluated recursively through
+ * the registry, every other parameter is handed to pv.
+ * @param id the identifier of the formula to evaluate
+ * @return the WCET, or -1 if id is not bound
+ */
+long long pwcet_reader_evaluate(pwcet_reader_t *r, int id, loopinfo_t *li, param_valuation_t pv, bparam_valuation_t bpv, void *data);
+
+#endif
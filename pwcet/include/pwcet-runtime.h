@@ -23,6 +23,22 @@
 #define PWCET_RUNTIME_H 1
 #define PARAM_FLAG 0x40000000
 
+/*
+ * Type of the values of abstract WCETs: 64 bits by default, 32 bits when
+ * PWCET_VALUE_32 is defined, which halves the memory used by the eta values.
+ * The runtime and the formulas compiled with it must agree on this choice;
+ * formula_check_range() tells whether a formula fits.
+ */
+#ifdef PWCET_VALUE_32
+typedef int awcet_value_t;
+#define AWCET_VALUE_MAX 2147483647
+#define AWCET_VALUE_MIN (-AWCET_VALUE_MAX - 1)
+#else
+typedef long long awcet_value_t;
+#define AWCET_VALUE_MAX 9223372036854775807LL
+#define AWCET_VALUE_MIN (-AWCET_VALUE_MAX - 1)
+#endif
+
 typedef int (loophierarchy_t) (int l1, int l2);
 typedef int (loopbounds_t) (int l1);
 struct loopinfo_s {
@@ -36,8 +52,15 @@ struct awcet_s {
 #define LOOP_TOP 	-1
 	int loop_id;
 	int eta_count;
-	long long *eta;
-	long long others;
+	awcet_value_t *eta;
+	awcet_value_t others;
+	/*
+	 * Run lengths of eta, NULL when every value appears once. Otherwise
+	 * eta[i] stands for eta_mult[i] consecutive equal values and eta_count
+	 * is the number of runs, which keeps long repeated sequences (large
+	 * annotation counts, loop bounds) cheap to evaluate.
+	 */
+	int *eta_mult;
 };
 typedef struct awcet_s awcet_t;
 
@@ -112,6 +135,12 @@ struct formula_s {
 	struct formula_s *children;
 	struct condition_s *condition;
 	char bool_expr[1000];
+	/* Greatest number of eta values observed by the parent, 0 if unlimited (see compute_eta_demand()) */
+	int eta_limit;
+	/* Block the node comes from, an index in the tables of dumpcft, 0 if unknown */
+	int origin;
+	/* Size of the eta buffers allocated by the evaluation (PARAM_LOOP), 0 if none */
+	int eta_capacity;
 };
 typedef struct formula_s formula_t;
 union param_value_u {
@@ -128,4 +157,32 @@ typedef bparam_value_t (bparam_valuation_t) (int bparam_id);
 
 long long evaluate(formula_t *f, loopinfo_t *li, param_valuation_t pv, bparam_valuation_t bpv, void *data);
 
+/*
+ * Check whether the WCET of f exceeds budget, assuming non-negative WCETs
+ * The traversal stops as soon as a partial result proves that the budget is
+ * exceeded, in which case the intermediate results stored in f are incomplete.
+ * Same arguments as evaluate().
+ * @return 1 if evaluate() would return a value greater than budget, 0 otherwise
+ */
+int wcet_exceeds(formula_t *f, loopinfo_t *li, param_valuation_t pv, bparam_valuation_t bpv, void *data, long long budget);
+
+/*
+ * Limit every node of f to the eta values its parent can observe
+ * Only the WCET returned by evaluate() is preserved: the abstract WCET left in
+ * f->aw is truncated, so f must not be used as a sub-formula afterwards.
+ * Loop bounds are read from li once: call it again if they change. Parametric
+ * loop bounds and annotations are not limited.
+ */
+void compute_eta_demand(formula_t *f, loopinfo_t *li);
+
+/*
+ * Check that no value computed by evaluate() on f can overflow awcet_value_t
+ * The check is conservative: it may reject formulas that never overflow in
+ * practice, never the reverse. Loop bounds are read from li.
+ * @param max_param greatest value of the parameters (loop bounds, boolean
+ * parameters and values of parametric abstract WCETs), negative if unknown
+ * @return 1 if every value fits, 0 otherwise
+ */
+int formula_check_range(formula_t *f, loopinfo_t *li, long long max_param);
+
 #endif
@@ -0,0 +1,84 @@
+/* ----------------------------------------------------------------------------
+   Copyright (C) 2020, Université de Lille, Lille, FRANCE
+
+   This file is part of WSymb.
+
+   WSymb is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation ; either version 2 of
+   the License, or (at your option) any later version.
+
+   WSymb is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY ; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program ; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+   ---------------------------------------------------------------------------- */
+
+
+/*
+ * Budget check: wcet_exceeds() stops as soon as the WCET is known to exceed
+ * the budget, and must agree with evaluate() on both sides of the WCET
+ */
+
+#include "test.h"
+
+/* SEQ of {5, 4, 1*} and {3, 2*}, on loop 1: 8 */
+static formula_t seq = {KIND_SEQ, 0, {2}, {-1, 2, (awcet_value_t[2]) {0}, 0, NULL}, (formula_t[2]) {
+	{KIND_CONST, 0, {0}, {1, 2, (awcet_value_t[2]) {5, 4}, 1, NULL}, NULL, NULL, "", 0, 0, 0},
+	{KIND_CONST, 0, {0}, {1, 1, (awcet_value_t[1]) {3}, 2, NULL}, NULL, NULL, "", 0, 0, 0}},
+	NULL, "", 0, 0, 0};
+
+/* 3 times {7, 2, 1*}: 21 */
+static formula_t intmult = {KIND_INTMULT, 0, {3}, {-1, 2, (awcet_value_t[2]) {0}, 0, NULL}, (formula_t[1]) {
+	{KIND_CONST, 0, {0}, {1, 2, (awcet_value_t[2]) {7, 2}, 1, NULL}, NULL, NULL, "", 0, 0, 0}},
+	NULL, "", 0, 0, 0};
+
+/* loop 1 of {5, 4, 1*}, iterated 10 times: 17 */
+static formula_t loop = {KIND_LOOP, 0, {1}, {-1, 1, (awcet_value_t[1]) {0}, 0, NULL}, (formula_t[1]) {
+	{KIND_CONST, 0, {0}, {1, 2, (awcet_value_t[2]) {5, 4}, 1, NULL}, NULL, NULL, "", 0, 0, 0}},
+	NULL, "", 0, 0, 0};
+
+/* loop 1 of the 2 first values of {9, 8, 7, 6*}: 17 */
+static formula_t ann = {KIND_LOOP, 0, {1}, {-1, 1, (awcet_value_t[1]) {0}, 0, NULL}, (formula_t[1]) {
+	{KIND_ANN, 0, {.ann = {1, 2}}, {-1, 2, (awcet_value_t[2]) {0}, 0, NULL}, (formula_t[1]) {
+		{KIND_CONST, 0, {0}, {1, 3, (awcet_value_t[3]) {9, 8, 7}, 6, NULL}, NULL, NULL, "", 0, 0, 0}}, NULL, "", 0, 0, 0}},
+	NULL, "", 0, 0, 0};
+
+/* SEQ of 2 times the loop and of ALT(4, 30): 64 */
+static formula_t nested = {KIND_SEQ, 0, {2}, {-1, 1, (awcet_value_t[1]) {0}, 0, NULL}, (formula_t[2]) {
+	{KIND_INTMULT, 0, {2}, {-1, 1, (awcet_value_t[1]) {0}, 0, NULL}, (formula_t[1]) {
+		{KIND_LOOP, 0, {1}, {-1, 1, (awcet_value_t[1]) {0}, 0, NULL}, (formula_t[1]) {
+			{KIND_CONST, 0, {0}, {1, 2, (awcet_value_t[2]) {5, 4}, 1, NULL}, NULL, NULL, "", 0, 0, 0}}, NULL, "", 0, 0, 0}},
+		NULL, "", 0, 0, 0},
+	{KIND_ALT, 0, {2}, {-1, 1, (awcet_value_t[1]) {0}, 0, NULL}, (formula_t[2]) {
+		{KIND_CONST, 0, {0}, {-1, 0, NULL, 4, NULL}, NULL, NULL, "", 0, 0, 0},
+		{KIND_CONST, 0, {0}, {-1, 0, NULL, 30, NULL}, NULL, NULL, "", 0, 0, 0}}, NULL, "", 0, 0, 0}},
+	NULL, "", 0, 0, 0};
+
+static void check(formula_t *f, long long expected)
+{
+	long long w = evaluate(f, &test_li, NULL, NULL, NULL);
+
+	CHECK(w == expected);
+	CHECK(wcet_exceeds(f, &test_li, NULL, NULL, NULL, w - 1) == 1);
+	CHECK(wcet_exceeds(f, &test_li, NULL, NULL, NULL, w) == 0);
+	CHECK(wcet_exceeds(f, &test_li, NULL, NULL, NULL, w + 1) == 0);
+	CHECK(wcet_exceeds(f, &test_li, NULL, NULL, NULL, 0) == 1);
+	/* stopping early leaves the formula ready for the next evaluation */
+	CHECK(evaluate(f, &test_li, NULL, NULL, NULL) == w);
+}
+
+int main(void)
+{
+	check(&seq, 8);
+	check(&intmult, 21);
+	check(&loop, 17);
+	check(&ann, 17);
+	check(&nested, 64);
+	return 0;
+}
@@ -0,0 +1,115 @@
+/* ----------------------------------------------------------------------------
+   Copyright (C) 2020, Université de Lille, Lille, FRANCE
+
+   This file is part of WSymb.
+
+   WSymb is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation ; either version 2 of
+   the License, or (at your option) any later version.
+
+   WSymb is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY ; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program ; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+   ---------------------------------------------------------------------------- */
+
+
+/*
+ * Closed form in a loop bound parameter: the table of segments, and the C
+ * function written from it, must give the WCET of evaluate() for every value
+ * of the parameter
+ */
+
+#include <string.h>
+#include <unistd.h>
+
+#include "../include/pwcet-closed.h"
+#include "test.h"
+
+#define P 1				/* the loop bound parameter */
+
+static int p;
+
+static void test_pv(int param_id, param_value_t *pv, void *data)
+{
+	(void) param_id;
+	(void) data;
+	pv->bound = p;
+}
+
+/* max(3p, 20, p + 9): the branches cross at p = 5, 7 and 11 */
+static formula_t alt = {KIND_ALT, 0, {3}, {-1, 2, (awcet_value_t[2]) {0}, 0, NULL}, (formula_t[3]) {
+	{KIND_LOOP, P, {1}, {-1, 1, (awcet_value_t[1]) {0}, 0, NULL}, (formula_t[1]) {
+		{KIND_CONST, 0, {0}, {1, 0, NULL, 3, NULL}, NULL, NULL, "", 0, 0, 0}}, NULL, "", 0, 0, 0},
+	{KIND_CONST, 0, {0}, {-1, 0, NULL, 20, NULL}, NULL, NULL, "", 0, 0, 0},
+	{KIND_LOOP, P, {1}, {-1, 1, (awcet_value_t[1]) {0}, 0, NULL}, (formula_t[1]) {
+		{KIND_CONST, 0, {0}, {1, 1, (awcet_value_t[1]) {10}, 1, NULL}, NULL, NULL, "", 0, 0, 0}}, NULL, "", 0, 0, 0}},
+	NULL, "", 0, 0, 0};
+
+/* loop 2, iterated 10 times, of a loop 1 bounded by p: groups of p values of {7, 5, 3, 2*} */
+static formula_t nested = {KIND_LOOP, 0, {2}, {-1, 3, (awcet_value_t[3]) {0}, 0, NULL}, (formula_t[1]) {
+	{KIND_LOOP, P, {1}, {-1, 3, (awcet_value_t[3]) {0}, 0, NULL}, (formula_t[1]) {
+		{KIND_CONST, 0, {0}, {2, 3, (awcet_value_t[3]) {7, 5, 3}, 2, NULL}, NULL, NULL, "", 0, 0, 0}}, NULL, "", 0, 0, 0}},
+	NULL, "", 0, 0, 0};
+
+/* loop 1 bounded by p of the 4 first values of {9, 8, 7, 6, 5, 2*}: constant once p >= 4 */
+static formula_t ann = {KIND_LOOP, P, {1}, {-1, 1, (awcet_value_t[1]) {0}, 0, NULL}, (formula_t[1]) {
+	{KIND_ANN, 0, {.ann = {1, 4}}, {-1, 4, (awcet_value_t[4]) {0}, 0, NULL}, (formula_t[1]) {
+		{KIND_CONST, 0, {0}, {1, 5, (awcet_value_t[5]) {9, 8, 7, 6, 5}, 2, NULL}, NULL, NULL, "", 0, 0, 0}}, NULL, "", 0, 0, 0}},
+	NULL, "", 0, 0, 0};
+
+/* Compile the C function of c with a main printing it for every p, and compare with evaluate() */
+static void check_writeC(const pwcet_closed_t *c, formula_t *f, long long lo, long long hi)
+{
+	char dir[] = "/tmp/pwcet-test-XXXXXX", path[64], cmd[256];
+	long long wcet;
+	FILE *out;
+
+	CHECK(mkdtemp(dir) != NULL);
+	snprintf(path, sizeof(path), "%s/wcet.c", dir);
+	out = fopen(path, "w");
+	CHECK(out != NULL);
+	fprintf(out, "#include <stdio.h>\n\n");
+	pwcet_closed_writeC(c, out, "wcet");
+	fprintf(out, "\nint main(void)\n{\n\tlong long p;\n");
+	fprintf(out, "\tfor (p = %lld; p <= %lld; p++)\n\t\tprintf(\"%%lld\\n\", wcet(p));\n\treturn 0;\n}\n", lo, hi);
+	fclose(out);
+	snprintf(cmd, sizeof(cmd), "cc -o %s/wcet %s && %s/wcet", dir, path, dir);
+	out = popen(cmd, "r");
+	CHECK(out != NULL);
+	for (p = lo; p <= hi; p++) {
+		CHECK(fscanf(out, "%lld", &wcet) == 1);
+		CHECK(wcet == evaluate(f, &test_li, test_pv, NULL, NULL));
+	}
+	CHECK(pclose(out) == 0);
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+	CHECK(system(cmd) == 0);
+}
+
+static void check(formula_t *f, long long lo, long long hi)
+{
+	pwcet_closed_t c;
+
+	CHECK(pwcet_closed_form(&c, f, &test_li, test_pv, NULL, NULL, P, lo, hi) == 0);
+	CHECK(c.count > 0);
+	for (p = lo; p <= hi; p++)
+		CHECK(pwcet_closed_wcet(&c, p) == evaluate(f, &test_li, test_pv, NULL, NULL));
+	CHECK(pwcet_closed_wcet(&c, hi + 1) == -1);
+	check_writeC(&c, f, lo, hi);
+	pwcet_closed_free(&c);
+}
+
+int main(void)
+{
+	check(&alt, 0, 15);
+	check(&nested, 0, 12);
+	check(&ann, 0, 10);
+	check(&ann, 6, 6);
+	return 0;
+}
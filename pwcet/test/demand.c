@@ -0,0 +1,211 @@
+/* ----------------------------------------------------------------------------
+   Copyright (C) 2020, Université de Lille, Lille, FRANCE
+
+   This file is part of WSymb.
+
+   WSymb is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation ; either version 2 of
+   the License, or (at your option) any later version.
+
+   WSymb is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY ; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program ; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+   ---------------------------------------------------------------------------- */
+
+/*
+ * Eta demand: compute_eta_demand() only lets the operators stop once their
+ * parent has all the values it observes, so the WCET must be that of the full
+ * evaluation. Formulas are drawn at random over loops 1 in 2 in 3, and a few
+ * are written by hand around the limits of the demand.
+ */
+
+#include <string.h>
+
+#include "../../include/PWCET.h"
+#include "test.h"
+
+#define FORMULAS 2000
+#define DEPTH 5
+#define SIZE 256
+
+/* Loop 1 is nested in loop 2, itself nested in loop 3, set in test_li by main() */
+static int demand_hierarchy(int inner, int outer)
+{
+	return inner < outer;
+}
+
+static int demand_bounds(int loop_id)
+{
+	static const int bounds[] = {0, 3, 2, 4};
+	return bounds[loop_id];
+}
+
+/* Every buffer, freed at the end: an annotation may pass the buffers of its child through */
+static void *buffers[1 << 16];
+static int buffer_count;
+
+static void *buffer_new(size_t size)
+{
+	void *b = calloc(1, size);
+	CHECK((b != NULL) && (buffer_count < (int) (sizeof(buffers) / sizeof(buffers[0]))));
+	buffers[buffer_count++] = b;
+	return b;
+}
+
+static void buffers_free(void)
+{
+	while (buffer_count > 0)
+		free(buffers[--buffer_count]);
+}
+
+static formula_t *node_new(formula_t *f, int kind, int children_count)
+{
+	memset(f, 0, sizeof(formula_t));
+	f->kind = kind;
+	f->aw.loop_id = LOOP_TOP;
+	f->aw.eta = (awcet_value_t *) buffer_new(SIZE * sizeof(awcet_value_t));
+	f->aw.eta_mult = (int *) buffer_new(SIZE * sizeof(int));
+	f->children = (formula_t *) buffer_new(children_count * sizeof(formula_t));
+	return f->children;
+}
+
+/* Decreasing values on loop_id, run-length encoded one time out of two */
+static void const_new(formula_t *f, int loop_id)
+{
+	int i, n = rand() % 6;
+	awcet_value_t value = 20 + rand() % 20;
+
+	memset(f, 0, sizeof(formula_t));
+	f->kind = KIND_CONST;
+	f->aw.loop_id = (n > 0) ? loop_id : LOOP_TOP;
+	f->aw.eta_count = n;
+	f->aw.eta = (awcet_value_t *) buffer_new((n + 1) * sizeof(awcet_value_t));
+	if (rand() % 2)
+		f->aw.eta_mult = (int *) buffer_new((n + 1) * sizeof(int));
+	for (i = 0; i < n; i++) {
+		f->aw.eta[i] = value;
+		value -= 1 + rand() % 4;
+		if (f->aw.eta_mult != NULL)
+			f->aw.eta_mult[i] = 1 + rand() % 3;
+	}
+	f->aw.others = (value > 0) ? rand() % (value + 1) : 0;
+}
+
+/*
+ * A node under the loops inner..3 (none when inner is 4): values may be on any
+ * of these loops, so a loop of the body may be an outer one
+ */
+static void random_new(formula_t *f, int depth, int inner)
+{
+	formula_t *c;
+	int i, n;
+
+	switch ((depth > 0) ? rand() % 7 : 6) {
+		case 0:
+		case 1:
+			n = 2 + rand() % 2;
+			c = node_new(f, (rand() % 2) ? KIND_SEQ : KIND_ALT, n);
+			f->opdata.children_count = n;
+			for (i = 0; i < n; i++)
+				random_new(&c[i], depth - 1, inner);
+			return;
+		case 2:
+		case 3:
+			if (inner > 1) {
+				c = node_new(f, KIND_LOOP, 1);
+				f->opdata.loop_id = 1 + rand() % (inner - 1);
+				random_new(c, depth - 1, f->opdata.loop_id);
+				return;
+			}
+			break;
+		case 4:
+			if (inner < 4) {
+				c = node_new(f, KIND_ANN, 1);
+				f->opdata.ann.loop_id = inner + rand() % (4 - inner);
+				f->opdata.ann.count = rand() % 6;
+				random_new(c, depth - 1, inner);
+				return;
+			}
+			break;
+		case 5:
+			c = node_new(f, KIND_INTMULT, 1);
+			f->opdata.coef = rand() % 3;
+			random_new(c, depth - 1, inner);
+			return;
+	}
+	const_new(f, (inner < 4) ? inner + rand() % (4 - inner) : LOOP_TOP);
+}
+
+static void check(formula_t *f)
+{
+	long long w = evaluate(f, &test_li, NULL, NULL, NULL);
+
+	compute_eta_demand(f, &test_li);
+	CHECK(evaluate(f, &test_li, NULL, NULL, NULL) == w);
+	/* and the demand does not change what a second evaluation gives */
+	CHECK(evaluate(f, &test_li, NULL, NULL, NULL) == w);
+}
+
+#define CONST(loop, n, ...) {KIND_CONST, 0, {0}, {loop, n, (awcet_value_t[]) {__VA_ARGS__}, 0, NULL}, NULL, NULL, "", 0, 0, 0}
+#define BUFFER(loop) {loop, 0, (awcet_value_t[SIZE]) {0}, 0, (int[SIZE]) {0}}
+
+/* ALT of a CONST and of {1}, an operator whose values the demand may cut */
+#define ALT(...) {KIND_ALT, 0, {2}, BUFFER(LOOP_TOP), (formula_t[2]) {__VA_ARGS__, CONST(LOOP_TOP, 1, 1)}, NULL, "", 0, 0, 0}
+
+/* loop 2 of loop 1 of {9, 8, ..., 1} on loop 1: 3 values of the same loop, twice */
+static formula_t same = {KIND_LOOP, 0, {2}, BUFFER(LOOP_TOP), (formula_t[1]) {
+	{KIND_LOOP, 0, {1}, BUFFER(LOOP_TOP), (formula_t[1]) {ALT(CONST(1, 9, 9, 8, 7, 6, 5, 4, 3, 2, 1))},
+		NULL, "", 0, 0, 0}},
+	NULL, "", 0, 0, 0};
+
+/* loop 3 of loop 2 of loop 1 of {20, 10, 9, ...} on loop 3: groups of 3 and 6 values of the outer loop */
+static formula_t outer = {KIND_LOOP, 0, {3}, BUFFER(LOOP_TOP), (formula_t[1]) {
+	{KIND_LOOP, 0, {2}, BUFFER(LOOP_TOP), (formula_t[1]) {
+		{KIND_LOOP, 0, {1}, BUFFER(LOOP_TOP), (formula_t[1]) {
+			ALT(CONST(3, 32, 20, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 20, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1,
+				20, 10, 9, 8, 7, 6, 5, 4, 3, 2))},
+			NULL, "", 0, 0, 0}},
+		NULL, "", 0, 0, 0}},
+	NULL, "", 0, 0, 0};
+
+/*
+ * loop 2 of loop 1 of the count first values of ALT({9, 8, ..., 2}, {1}) on
+ * loop 2: the annotation takes over when count is below the length of its
+ * source, and loop 2 observes 2 groups of 3 values, 6 values of the annotation
+ */
+#define ANN(count) {KIND_LOOP, 0, {2}, BUFFER(LOOP_TOP), (formula_t[1]) { \
+	{KIND_LOOP, 0, {1}, BUFFER(LOOP_TOP), (formula_t[1]) { \
+		{KIND_ANN, 0, {.ann = {1, count}}, BUFFER(LOOP_TOP), (formula_t[1]) {ALT(CONST(2, 8, 9, 8, 7, 6, 5, 4, 3, 2))}, \
+			NULL, "", 0, 0, 0}}, \
+		NULL, "", 0, 0, 0}}, \
+	NULL, "", 0, 0, 0}
+
+static formula_t ann[] = {ANN(0), ANN(4), ANN(5), ANN(6), ANN(7), ANN(8), ANN(9)};
+
+int main(void)
+{
+	formula_t f;
+	int i;
+
+	test_li.hier = demand_hierarchy;
+	test_li.bnd = demand_bounds;
+	check(&same);
+	check(&outer);
+	for (i = 0; i < (int) (sizeof(ann) / sizeof(ann[0])); i++)
+		check(&ann[i]);
+
+	srand(1);
+	for (i = 0; i < FORMULAS; i++) {
+		random_new(&f, DEPTH, 4);
+		check(&f);
+		buffers_free();
+	}
+	return 0;
+}
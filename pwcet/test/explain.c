@@ -0,0 +1,93 @@
+/* ----------------------------------------------------------------------------
+   Copyright (C) 2020, Université de Lille, Lille, FRANCE
+
+   This file is part of WSymb.
+
+   WSymb is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation ; either version 2 of
+   the License, or (at your option) any later version.
+
+   WSymb is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY ; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program ; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+   ---------------------------------------------------------------------------- */
+
+/*
+ * Explanation of a WCET: evaluate_explain() returns the WCET of evaluate(),
+ * the child chosen by each ALT and the origin of each node, and the shares of
+ * the leaves sum to the WCET
+ */
+
+#include <math.h>
+
+#include "../include/pwcet-explain.h"
+#include "test.h"
+
+/*
+ * SEQ(ALT(5, 12, 12), loop 1 of {3, 2, 1*}, 2 x 4, loop 1 of SEQ({0, 4, 4, 1*}, 0))
+ * 12 + 13 + 8 + 15 = 48; the first value of the last SEQ is 0, so is that of
+ * its children, which get half of its share. Origins are the pre-order
+ * indices plus 1.
+ */
+static formula_t f = {KIND_SEQ, 0, {4}, {-1, 1, (awcet_value_t[1]) {0}, 0, NULL}, (formula_t[4]) {
+	{KIND_ALT, 0, {3}, {-1, 1, (awcet_value_t[1]) {0}, 0, NULL}, (formula_t[3]) {
+		{KIND_CONST, 0, {0}, {-1, 0, NULL, 5, NULL}, NULL, NULL, "", 0, 3, 0},
+		{KIND_CONST, 0, {0}, {-1, 0, NULL, 12, NULL}, NULL, NULL, "", 0, 4, 0},
+		{KIND_CONST, 0, {0}, {-1, 0, NULL, 12, NULL}, NULL, NULL, "", 0, 5, 0}}, NULL, "", 0, 2, 0},
+	{KIND_LOOP, 0, {1}, {-1, 1, (awcet_value_t[1]) {0}, 0, NULL}, (formula_t[1]) {
+		{KIND_CONST, 0, {0}, {1, 2, (awcet_value_t[2]) {3, 2}, 1, NULL}, NULL, NULL, "", 0, 7, 0}}, NULL, "", 0, 6, 0},
+	{KIND_INTMULT, 0, {2}, {-1, 1, (awcet_value_t[1]) {0}, 0, NULL}, (formula_t[1]) {
+		{KIND_CONST, 0, {0}, {-1, 0, NULL, 4, NULL}, NULL, NULL, "", 0, 9, 0}}, NULL, "", 0, 8, 0},
+	{KIND_LOOP, 0, {1}, {-1, 1, (awcet_value_t[1]) {0}, 0, NULL}, (formula_t[1]) {
+		{KIND_SEQ, 0, {2}, {-1, 3, (awcet_value_t[3]) {0}, 0, NULL}, (formula_t[2]) {
+			{KIND_CONST, 0, {0}, {1, 3, (awcet_value_t[3]) {0, 4, 4}, 1, NULL}, NULL, NULL, "", 0, 12, 0},
+			{KIND_CONST, 0, {0}, {-1, 0, NULL, 0, NULL}, NULL, NULL, "", 0, 13, 0}}, NULL, "", 0, 11, 0}},
+		NULL, "", 0, 10, 0}},
+	NULL, "", 0, 1, 0};
+
+int main(void)
+{
+	pwcet_explain_t *report;
+	double leaves = 0;
+	FILE *out;
+	int count, i, alts = 0;
+
+	CHECK(evaluate_explain(&f, &test_li, NULL, NULL, NULL, &report, &count) == 48);
+	CHECK(evaluate(&f, &test_li, NULL, NULL, NULL) == 48);
+	CHECK(count > 0);
+	/* by decreasing contribution: the root first */
+	CHECK((report[0].node == 0) && (report[0].contribution == 48) && (report[0].wcet == 48));
+	for (i = 0; i < count; i++) {
+		CHECK(report[i].origin == report[i].node + 1);
+		CHECK(report[i].contribution > 0);
+		if ((i > 0) && (report[i].contribution == report[i - 1].contribution))
+			CHECK(report[i].node > report[i - 1].node);
+		if (report[i].kind == KIND_ALT) {
+			CHECK(report[i].alt_child == 1);
+			CHECK(report[i].wcet == 12);
+			alts++;
+		} else
+			CHECK(report[i].alt_child == -1);
+		if (report[i].kind == KIND_CONST)
+			leaves += report[i].contribution;
+		/* the leaves of the last SEQ */
+		if ((report[i].node == 11) || (report[i].node == 12))
+			CHECK(fabs(report[i].contribution - 7.5) < 1e-9);
+	}
+	CHECK(alts == 1);
+	CHECK(fabs(leaves - 48) < 1e-9);
+	out = tmpfile();
+	CHECK(out != NULL);
+	pwcet_explain_print(report, count, 0, out);
+	CHECK(ftell(out) > 0);
+	fclose(out);
+	free(report);
+	return 0;
+}
@@ -0,0 +1,126 @@
+/* ----------------------------------------------------------------------------
+   Copyright (C) 2020, Université de Lille, Lille, FRANCE
+
+   This file is part of WSymb.
+
+   WSymb is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation ; either version 2 of
+   the License, or (at your option) any later version.
+
+   WSymb is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY ; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program ; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+   ---------------------------------------------------------------------------- */
+
+/*
+ * Native code: first load compiles the formula, the second one finds it in
+ * the cache, and an object other users could modify is not loaded
+ */
+
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../include/pwcet-jit.h"
+#include "test.h"
+
+/* loop 1 of the body eta = {5, 4}, others = 1, iterated 10 times: 5 + 4 + 8 * 1 */
+static formula_t f = {KIND_LOOP, 0, {1}, {-1, 1, (awcet_value_t[1]) {0}, 0, NULL}, (formula_t[1]) {
+	{KIND_CONST, 0, {0}, {1, 2, (awcet_value_t[2]) {5, 4}, 1, NULL}, NULL, NULL, "", 0, 0, 0}}, NULL, "", 0, 0, 0};
+
+/*
+ * ALT(loop 1 of ALT({9, 7, 5, 1*}, {8, 6}), {12, 11, 10}, ALT()): 9 + 8 + 7 + 6
+ * + 5 + 5 * 1 = 40. Once compute_eta_demand() is called, the inner ALT stops
+ * after 10 values and the outer one after 1, and the empty ALT has no source.
+ */
+static formula_t alts = {KIND_ALT, 0, {3}, {-1, 8, (awcet_value_t[8]) {0}, 0, NULL}, (formula_t[3]) {
+	{KIND_LOOP, 0, {1}, {-1, 5, (awcet_value_t[5]) {0}, 0, NULL}, (formula_t[1]) {
+		{KIND_ALT, 0, {2}, {-1, 5, (awcet_value_t[5]) {0}, 0, NULL}, (formula_t[2]) {
+			{KIND_CONST, 0, {0}, {1, 3, (awcet_value_t[3]) {9, 7, 5}, 1, NULL}, NULL, NULL, "", 0, 0, 0},
+			{KIND_CONST, 0, {0}, {1, 2, (awcet_value_t[2]) {8, 6}, 0, NULL}, NULL, NULL, "", 0, 0, 0}},
+			NULL, "", 0, 0, 0}},
+		NULL, "", 0, 0, 0},
+	{KIND_CONST, 0, {0}, {1, 3, (awcet_value_t[3]) {12, 11, 10}, 0, NULL}, NULL, NULL, "", 0, 0, 0},
+	{KIND_ALT, 0, {0}, {-1, 0, NULL, 0, NULL}, NULL, NULL, "", 0, 0, 0}},
+	NULL, "", 0, 0, 0};
+
+static long long native(pwcet_jit_t *jit, formula_t *f, int *ready)
+{
+	pwcet_native_t *n = pwcet_jit_load(jit, f);
+	long long wcet;
+	CHECK(n != NULL);
+	*ready = pwcet_native_ready(n, 1);
+	wcet = pwcet_native_evaluate(n, &test_li, NULL, NULL, NULL);
+	pwcet_native_free(n);
+	return wcet;
+}
+
+static int objects(const char *dir, char *object, size_t size)
+{
+	char cmd[256];
+	FILE *ls;
+	int count = 0;
+	snprintf(cmd, sizeof(cmd), "ls %s/pwcet-*.so 2>/dev/null", dir);
+	ls = popen(cmd, "r");
+	CHECK(ls != NULL);
+	while (fgets(object, size, ls) != NULL)
+		count++;
+	pclose(ls);
+	object[strcspn(object, "\n")] = '\0';
+	return count;
+}
+
+int main(void)
+{
+	char dir[] = "/tmp/pwcet-test-XXXXXX", object[256], cmd[300];
+	pwcet_jit_t *jit;
+	struct stat st, hit;
+	int ready;
+
+	CHECK(mkdtemp(dir) != NULL);
+	jit = pwcet_jit_new(dir);
+	CHECK(jit != NULL);
+
+	/* miss: compiled, then evaluated natively */
+	CHECK(native(jit, &f, &ready) == 17);
+	CHECK(ready);
+	CHECK(objects(dir, object, sizeof(object)) == 1);
+	CHECK(stat(object, &st) == 0);
+
+	/* hit: the object is not rebuilt */
+	CHECK(native(jit, &f, &ready) == 17);
+	CHECK(ready);
+	CHECK(objects(dir, object, sizeof(object)) == 1);
+	CHECK(stat(object, &hit) == 0);
+	CHECK(hit.st_ino == st.st_ino);
+
+	/* writable by others: interpreted */
+	CHECK(chmod(object, 0666) == 0);
+	CHECK(native(jit, &f, &ready) == 17);
+	CHECK(!ready);
+
+	/* operators that stop at the eta demand of their parent */
+	CHECK(native(jit, &alts, &ready) == 40);
+	CHECK(ready);
+	compute_eta_demand(&alts, &test_li);
+	CHECK(native(jit, &alts, &ready) == 40);
+	CHECK(ready);
+	CHECK(evaluate(&alts, &test_li, NULL, NULL, NULL) == 40);
+	CHECK(objects(dir, object, sizeof(object)) == 3);
+	pwcet_jit_free(jit);
+
+	/* a directory others can write is refused */
+	CHECK(chmod(dir, 0777) == 0);
+	CHECK(pwcet_jit_new(dir) == NULL);
+
+	snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+	CHECK(system(cmd) == 0);
+	return 0;
+}
@@ -0,0 +1,213 @@
+/* ----------------------------------------------------------------------------
+   Copyright (C) 2020, Université de Lille, Lille, FRANCE
+
+   This file is part of WSymb.
+
+   WSymb is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation ; either version 2 of
+   the License, or (at your option) any later version.
+
+   WSymb is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY ; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program ; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+   ---------------------------------------------------------------------------- */
+
+/*
+ * Hot/cold layout: copies from formula_layout() give the WCET of the formula
+ * for every valuation, and the data of the hot nodes comes before that of the
+ * cold ones
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "../../include/PWCET.h"
+#include "test.h"
+
+#define BRANCHES 4
+
+static int values[BRANCHES + 1];
+
+static int bparam(int bparam_id)
+{
+	return values[bparam_id];
+}
+
+/* Operators get buffers of size values, like the headers of swymplify -c */
+static formula_t *node_new(formula_t *f, int kind, int children_count, int size)
+{
+	memset(f, 0, sizeof(formula_t));
+	f->kind = kind;
+	f->aw.loop_id = LOOP_TOP;
+	f->aw.eta_count = size;
+	if (size > 0) {
+		f->aw.eta = (awcet_value_t *) calloc(size, sizeof(awcet_value_t));
+		f->aw.eta_mult = (int *) calloc(size, sizeof(int));
+		CHECK((f->aw.eta != NULL) && (f->aw.eta_mult != NULL));
+	}
+	f->opdata.children_count = children_count;
+	f->children = (formula_t *) calloc(children_count, sizeof(formula_t));
+	CHECK(f->children != NULL);
+	return f->children;
+}
+
+static void const_new(formula_t *f, int loop_id, awcet_value_t a, awcet_value_t b, awcet_value_t others)
+{
+	memset(f, 0, sizeof(formula_t));
+	f->kind = KIND_CONST;
+	f->aw.loop_id = loop_id;
+	f->aw.eta_count = 2;
+	f->aw.eta = (awcet_value_t *) malloc(sizeof(awcet_value_t) * 2);
+	CHECK(f->aw.eta != NULL);
+	f->aw.eta[0] = a;
+	f->aw.eta[1] = b;
+	f->aw.others = others;
+}
+
+/* bparam == 1 */
+static void condition_new(formula_t *f, int bparam)
+{
+	memset(f, 0, sizeof(formula_t));
+	f->kind = BOOL_CONDITIONS;
+	f->opdata.children_count = 1;
+	f->condition = (condition_t *) calloc(1, sizeof(condition_t));
+	CHECK(f->condition != NULL);
+	f->condition->kind = BOOL_EQ;
+	f->condition->int_value = 1;
+	f->condition->terms_number = 1;
+	f->condition->terms = (term_t *) malloc(sizeof(term_t));
+	CHECK(f->condition->terms != NULL);
+	f->condition->terms->kind = BOOL_PARAM;
+	f->condition->terms->coef = 1;
+	f->condition->terms->value = bparam;
+}
+
+/* SEQ of BRANCHES x ALT(CONST, BOOLMULT(bparam i == 1, LOOP(SEQ(CONST, CONST)))) */
+static void formula_new(formula_t *f)
+{
+	formula_t *alts, *c, *guarded, *body;
+	int i;
+
+	alts = node_new(f, KIND_SEQ, BRANCHES, 2);
+	for (i = 0; i < BRANCHES; i++) {
+		c = node_new(&alts[i], KIND_ALT, 2, 2);
+		const_new(&c[0], LOOP_TOP, 10 + i, 0, 0);
+		guarded = node_new(&c[1], KIND_BOOLMULT, 2, 0);
+		condition_new(&guarded[0], 1 + i);
+		body = node_new(&guarded[1], KIND_LOOP, 1, 2);
+		guarded[1].opdata.loop_id = 1;
+		body = node_new(body, KIND_SEQ, 2, 2);
+		const_new(&body[0], 1, 5 + i, 3, 1);
+		const_new(&body[1], LOOP_TOP, 1, 0, 0);
+	}
+}
+
+struct bounds_s {
+	uintptr_t hot;				/* end of the last hot data */
+	uintptr_t cold;				/* start of the first cold data */
+	int node;				/* pre-order index of the next node */
+};
+
+static void bounds_add(struct bounds_s *b, int hot, const void *p)
+{
+	uintptr_t a = (uintptr_t) p;
+	if (p == NULL)
+		return;
+	if (hot && (a + 1 > b->hot))
+		b->hot = a + 1;
+	if (!hot && (a < b->cold))
+		b->cold = a;
+}
+
+/*
+ * Record the data of the subtree f of the copy: a node is hot when its parent
+ * is and, without hits, when it is not guarded by a BOOLMULT, with hits, when
+ * it was evaluated at least min_hits times
+ */
+static void bounds_walk(struct bounds_s *b, formula_t *f, int hot, const unsigned *hits, unsigned min_hits)
+{
+	int i;
+
+	if ((hits != NULL) && (hits[b->node] < min_hits))
+		hot = 0;
+	b->node++;
+	bounds_add(b, hot, f->children);
+	bounds_add(b, hot, f->condition);
+	if (f->kind != BOOL_CONDITIONS) {
+		bounds_add(b, hot, f->aw.eta);
+		bounds_add(b, hot, f->aw.eta_mult);
+	}
+	if (f->kind == BOOL_CONDITIONS) {
+		for (i = 0; i < f->opdata.children_count; i++)
+			bounds_add(b, hot, f->condition[i].terms);
+	}
+	for (i = 0; i < formula_child_count(f); i++)
+		bounds_walk(b, &f->children[i], hot && ((hits != NULL) || (f->kind != KIND_BOOLMULT) || (i == 0)),
+			hits, min_hits);
+}
+
+/* The hot data of copy comes first, and there is some cold data */
+static void check_layout(formula_t *copy, const unsigned *hits, unsigned min_hits)
+{
+	struct bounds_s b = { 0, UINTPTR_MAX, 0 };
+
+	bounds_walk(&b, copy, 1, hits, min_hits);
+	CHECK(b.cold != UINTPTR_MAX);
+	CHECK(b.hot <= b.cold);
+}
+
+/* Same WCET as f for every valuation of the boolean parameters */
+static void check_wcet(formula_t *f, formula_t *copy)
+{
+	int v, i;
+
+	for (v = 0; v < (1 << BRANCHES); v++) {
+		for (i = 0; i < BRANCHES; i++)
+			values[1 + i] = (v >> i) & 1;
+		CHECK(evaluate(copy, &test_li, NULL, bparam, NULL) == evaluate(f, &test_li, NULL, bparam, NULL));
+	}
+}
+
+int main(void)
+{
+	formula_t f;
+	formula_t *copy, *profiled;
+	unsigned *hits;
+	int n;
+
+	formula_new(&f);
+	n = formula_node_count(&f);
+	CHECK(n == 1 + BRANCHES * 8);
+
+	/* the guarded subtrees of branch 0 run twice, that of branch 1 once */
+	hits = (unsigned *) calloc(n, sizeof(unsigned));
+	CHECK(hits != NULL);
+	values[1] = 1;
+	formula_profile(&f, &test_li, NULL, bparam, NULL, hits);
+	values[2] = 1;
+	formula_profile(&f, &test_li, NULL, bparam, NULL, hits);
+	CHECK(hits[0] == 2);
+
+	/* copies are sized by the eta_count of f, so they are made before evaluating it */
+	copy = formula_layout(&f, NULL, 0);
+	profiled = formula_layout(&f, hits, 2);
+	CHECK((copy != NULL) && (profiled != NULL));
+
+	check_layout(copy, NULL, 0);
+	check_layout(profiled, hits, 2);
+	check_wcet(&f, copy);
+	check_wcet(&f, profiled);
+
+	free(copy);
+	free(profiled);
+	free(hits);
+	formula_free(&f);
+	return 0;
+}
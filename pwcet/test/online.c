@@ -0,0 +1,124 @@
+/* ----------------------------------------------------------------------------
+   Copyright (C) 2020, Université de Lille, Lille, FRANCE
+
+   This file is part of WSymb.
+
+   WSymb is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation ; either version 2 of
+   the License, or (at your option) any later version.
+
+   WSymb is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY ; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program ; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+   ---------------------------------------------------------------------------- */
+
+/*
+ * Online evaluation: updates wake the evaluator up, and the operators
+ * computed again give the same WCET as a full evaluation
+ */
+
+#include <sched.h>
+#include <string.h>
+
+#include "../include/pwcet-online.h"
+#include "test.h"
+
+#define BOUND 1
+#define FLAG 2
+
+/*
+ * SEQ(LOOP_BOUND(body 3), LOOP(body 2, 10), BOOLMULT(FLAG == 1, 100))
+ * The second loop does not depend on any parameter.
+ */
+static formula_t f = {KIND_SEQ, 0, {3}, {-1, 0, NULL, 0, NULL}, (formula_t[3]) {
+	{KIND_LOOP, BOUND, {1}, {-1, 0, NULL, 0, NULL}, (formula_t[1]) {
+		{KIND_CONST, 0, {0}, {1, 0, NULL, 3, NULL}, NULL, NULL, "", 0, 0, 0}}, NULL, "", 0, 0, 0},
+	{KIND_LOOP, 0, {2}, {-1, 0, NULL, 0, NULL}, (formula_t[1]) {
+		{KIND_CONST, 0, {0}, {2, 0, NULL, 2, NULL}, NULL, NULL, "", 0, 0, 0}}, NULL, "", 0, 0, 0},
+	{KIND_BOOLMULT, 0, {0}, {-1, 0, NULL, 0, NULL}, (formula_t[2]) {
+		{BOOL_CONDITIONS, 0, {1}, {-1, 0, NULL, 0, NULL}, NULL, (condition_t[1]) {
+			{BOOL_EQ, 1, 1, (term_t[1]) {{BOOL_PARAM, 1, FLAG}}}}, "", 0, 0, 0},
+		{KIND_CONST, 0, {0}, {-1, 0, NULL, 100, NULL}, NULL, NULL, "", 0, 0, 0}}, NULL, "", 0, 0, 0}}, NULL, "", 0, 0, 0};
+
+static int values[FLAG + 1];
+
+static void valuation(int param_id, param_value_t *param_val, void *data)
+{
+	(void) data;
+	memset(param_val, 0, sizeof(param_value_t));
+	param_val->bound = values[param_id];
+}
+
+static int bparam(int bparam_id)
+{
+	return values[bparam_id];
+}
+
+/* Wait for the result of an update */
+static long long wait_for(pwcet_online_t *o, unsigned long long ticket)
+{
+	pwcet_online_result_t res;
+	for (;;) {
+		pwcet_online_read(o, &res);
+		if (res.applied >= ticket)
+			return res.wcet;
+		sched_yield();
+	}
+}
+
+static long long update(pwcet_online_t *o, int param_id, int value)
+{
+	unsigned long long ticket;
+	values[param_id] = value;
+	CHECK(pwcet_online_set(o, param_id, value, &ticket) == 0);
+	return wait_for(o, ticket);
+}
+
+int main(void)
+{
+	static const int bounds[] = {4, 4, 0, 7, 1000, 3};
+	pwcet_online_result_t res;
+	pwcet_online_t *o;
+	unsigned long long ticket = 0;
+	unsigned i;
+
+	o = pwcet_online_new(&f, &test_li, FLAG, 4, NULL, NULL);
+	CHECK(o != NULL);
+	CHECK(pwcet_online_start(o, -1) == 0);
+
+	/* the first result is published without any update: 0 + 20 + 0 */
+	do {
+		sched_yield();
+		pwcet_online_read(o, &res);
+	} while (res.version == 0);
+	CHECK(res.wcet == 20);
+
+	/* one update at a time, the evaluator sleeps in between */
+	for (i = 0; i < sizeof(bounds) / sizeof(bounds[0]); i++) {
+		CHECK(update(o, BOUND, bounds[i]) == 3 * bounds[i] + 20 + 100 * values[FLAG]);
+		CHECK(update(o, FLAG, i & 1) == 3 * bounds[i] + 20 + 100 * (i & 1));
+	}
+
+	/* bursts: the evaluator applies them together */
+	for (i = 0; i < 1000; i++) {
+		values[BOUND] = i % 17;
+		values[FLAG] = i % 3 == 0;
+		while (pwcet_online_set(o, BOUND, values[BOUND], NULL) != 0)
+			sched_yield();
+		while (pwcet_online_set(o, FLAG, values[FLAG], &ticket) != 0)
+			sched_yield();
+	}
+	CHECK(wait_for(o, ticket) == 3 * values[BOUND] + 20 + 100 * values[FLAG]);
+	pwcet_online_free(o);
+
+	/* the same values from scratch */
+	CHECK(evaluate(&f, &test_li, valuation, bparam, NULL) == 3 * values[BOUND] + 20 + 100 * values[FLAG]);
+	return 0;
+}
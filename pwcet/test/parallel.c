@@ -0,0 +1,107 @@
+/* ----------------------------------------------------------------------------
+   Copyright (C) 2020, Université de Lille, Lille, FRANCE
+
+   This file is part of WSymb.
+
+   WSymb is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation ; either version 2 of
+   the License, or (at your option) any later version.
+
+   WSymb is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY ; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program ; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+   ---------------------------------------------------------------------------- */
+
+/*
+ * Parallel evaluation: small thresholds split the formula into many tasks,
+ * which must give the WCET of evaluate() whatever the number of workers
+ */
+
+#include <string.h>
+
+#include "../../include/PWCET.h"
+#include "../include/pwcet-parallel.h"
+#include "test.h"
+
+#define BRANCHES 32
+
+/* Operators get run-length buffers of size values, like the headers of swymplify -c */
+static formula_t *node_new(formula_t *f, int kind, int children_count, int size)
+{
+	memset(f, 0, sizeof(formula_t));
+	f->kind = kind;
+	f->aw.loop_id = -1;
+	f->aw.eta_count = size;
+	f->aw.eta = (awcet_value_t *) calloc(size, sizeof(awcet_value_t));
+	f->aw.eta_mult = (int *) calloc(size, sizeof(int));
+	CHECK((f->aw.eta != NULL) && (f->aw.eta_mult != NULL));
+	f->opdata.children_count = children_count;
+	f->children = (formula_t *) calloc(children_count, sizeof(formula_t));
+	CHECK(f->children != NULL);
+	return f->children;
+}
+
+static void const_new(formula_t *f, int loop_id, awcet_value_t a, awcet_value_t b, awcet_value_t others)
+{
+	memset(f, 0, sizeof(formula_t));
+	f->kind = KIND_CONST;
+	f->aw.loop_id = loop_id;
+	f->aw.eta_count = 2;
+	f->aw.eta = (awcet_value_t *) malloc(sizeof(awcet_value_t) * 2);
+	CHECK(f->aw.eta != NULL);
+	f->aw.eta[0] = a;
+	f->aw.eta[1] = b;
+	f->aw.others = others;
+}
+
+/* SEQ of BRANCHES x ALT(CONST, LOOP(CONST), SEQ(CONST, CONST)) */
+static void formula_new(formula_t *f)
+{
+	formula_t *alts, *c, *body;
+	int i;
+
+	alts = node_new(f, KIND_SEQ, BRANCHES, 6);
+	for (i = 0; i < BRANCHES; i++) {
+		c = node_new(&alts[i], KIND_ALT, 3, 6);
+		const_new(&c[0], LOOP_TOP, 3 * i + 5, i + 2, 1);
+		body = node_new(&c[1], KIND_LOOP, 1, 2);
+		c[1].opdata.loop_id = 1 + i % 3;
+		const_new(&body[0], c[1].opdata.loop_id, i % 7 + 1, 2, 0);
+		body = node_new(&c[2], KIND_SEQ, 2, 2);
+		const_new(&body[0], LOOP_TOP, i, i % 5, 0);
+		const_new(&body[1], LOOP_TOP, 4, 1, 1);
+	}
+}
+
+int main(void)
+{
+	formula_t f;
+	pwcet_pool_t *pool;
+	long long wcet;
+	int threads, threshold, run;
+
+	formula_new(&f);
+	wcet = evaluate(&f, &test_li, NULL, NULL, NULL);
+	CHECK(wcet > 0);
+
+	for (threads = 0; threads <= 4; threads += 2) {
+		pool = pwcet_pool_new(threads);
+		CHECK(pool != NULL);
+		for (threshold = 1; threshold <= 8; threshold *= 2)
+			for (run = 0; run < 10; run++)
+				CHECK(evaluate_parallel(pool, &f, &test_li, NULL, NULL, NULL, threshold) == wcet);
+		/* 225 nodes, below the default threshold: a single task */
+		CHECK(evaluate_parallel(pool, &f, &test_li, NULL, NULL, NULL, 0) == wcet);
+		pwcet_pool_free(pool);
+	}
+
+	formula_free(&f);
+	return 0;
+}
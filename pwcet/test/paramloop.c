@@ -0,0 +1,142 @@
+/* ----------------------------------------------------------------------------
+   Copyright (C) 2020, Université de Lille, Lille, FRANCE
+
+   This file is part of WSymb.
+
+   WSymb is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation ; either version 2 of
+   the License, or (at your option) any later version.
+
+   WSymb is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY ; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program ; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+   ---------------------------------------------------------------------------- */
+
+
+/*
+ * Parametric loops allocate their eta buffers during the evaluation: they are
+ * kept and grown from one evaluation to the next, and released by formula_free()
+ */
+
+#include <string.h>
+
+#include "../../include/PWCET.h"
+#include "test.h"
+
+static int bound;
+
+static bparam_value_t test_bpv(int bparam_id)
+{
+	(void) bparam_id;
+	return bound;
+}
+
+static term_t *term_new(int kind, int coef, int value)
+{
+	term_t *t = (term_t *) malloc(sizeof(term_t));
+	CHECK(t != NULL);
+	t->kind = kind;
+	t->coef = coef;
+	t->value = value;
+	return t;
+}
+
+static condition_t *condition_new(int kind, int int_value, term_t *terms)
+{
+	condition_t *c = (condition_t *) calloc(1, sizeof(condition_t));
+	CHECK(c != NULL);
+	c->kind = kind;
+	c->int_value = int_value;
+	c->terms_number = 1;
+	c->terms = terms;
+	return c;
+}
+
+/* PARAM_LOOP on loop 1, bounded by the boolean parameter 0, of CONST {5, 4, 1*} on loop 5 */
+static void paramloop_new(formula_t *f)
+{
+	memset(f, 0, sizeof(formula_t));
+	f->kind = KIND_PARAM_LOOP;
+	f->param_id = IDENT_NONE;
+	f->opdata.loop_id = 1;
+	f->condition = condition_new(BOOL_BOUND, 0, term_new(BOOL_PARAM, 1, 0));
+	f->children = (formula_t *) calloc(1, sizeof(formula_t));
+	CHECK(f->children != NULL);
+	f->children->kind = KIND_CONST;
+	f->children->param_id = IDENT_NONE;
+	f->children->aw.loop_id = 5;
+	f->children->aw.eta_count = 2;
+	f->children->aw.eta = (awcet_value_t *) malloc(sizeof(awcet_value_t) * 2);
+	CHECK(f->children->aw.eta != NULL);
+	f->children->aw.eta[0] = 5;
+	f->children->aw.eta[1] = 4;
+	f->children->aw.others = 1;
+}
+
+/* BOOLMULT of the loop, guarded by 1 <= parameter 0 */
+static void boolmult_new(formula_t *f)
+{
+	memset(f, 0, sizeof(formula_t));
+	f->kind = KIND_BOOLMULT;
+	f->param_id = IDENT_NONE;
+	f->opdata.children_count = 2;
+	f->children = (formula_t *) calloc(2, sizeof(formula_t));
+	CHECK(f->children != NULL);
+	f->children[0].kind = BOOL_CONDITIONS;
+	f->children[0].opdata.children_count = 1;
+	f->children[0].condition = condition_new(BOOL_LEQ, 1, term_new(BOOL_PARAM, 1, 0));
+	paramloop_new(&f->children[1]);
+}
+
+/* Group sums of bound values of {5, 4, 1*}: the first is the WCET */
+static long long expected(int b)
+{
+	return (b == 0) ? 0 : 5 + ((b > 1) ? 4 : 0) + ((b > 2) ? b - 2 : 0);
+}
+
+static const int bounds[] = { 3, 3, 10, 0, 2, 7 };
+
+int main(void)
+{
+	formula_t loop, guarded, *copy;
+	awcet_value_t *eta;
+	unsigned i;
+
+	paramloop_new(&loop);
+	boolmult_new(&guarded);
+	copy = formula_clone(&guarded);
+	CHECK(copy != NULL);
+	for (i = 0; i < sizeof(bounds) / sizeof(bounds[0]); i++) {
+		bound = bounds[i];
+		eta = loop.aw.eta;
+		CHECK(evaluate(&loop, &test_li, NULL, test_bpv, NULL) == expected(bound));
+		/* the buffer only changes when it grows */
+		if ((i > 0) && (bound <= bounds[i - 1]))
+			CHECK(loop.aw.eta == eta);
+		CHECK((bound == 0) || (loop.eta_capacity >= 2 * 2 + 1));
+		CHECK(evaluate(&guarded, &test_li, NULL, test_bpv, NULL) == expected(bound));
+		CHECK(evaluate(copy, &test_li, NULL, test_bpv, NULL) == expected(bound));
+	}
+	CHECK(loop.aw.eta != NULL);
+
+	/* a copy of an evaluated formula allocates its own buffers */
+	formula_release_buffers(copy);
+	free(copy);
+	copy = formula_clone(&guarded);
+	CHECK(copy != NULL);
+	CHECK(copy->children[1].aw.eta == NULL);
+	CHECK(evaluate(copy, &test_li, NULL, test_bpv, NULL) == expected(bound));
+	formula_release_buffers(copy);
+	free(copy);
+
+	formula_free(&loop);
+	formula_free(&guarded);
+	return 0;
+}
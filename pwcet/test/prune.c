@@ -0,0 +1,130 @@
+/* ----------------------------------------------------------------------------
+   Copyright (C) 2020, Université de Lille, Lille, FRANCE
+
+   This file is part of WSymb.
+
+   WSymb is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation ; either version 2 of
+   the License, or (at your option) any later version.
+
+   WSymb is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY ; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program ; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+   ---------------------------------------------------------------------------- */
+
+/*
+ * Pruning a formula built node by node, as dumpcft does: the removed children
+ * are released, the leak checker of -fsanitize=address reports them otherwise.
+ * Nodes sharing their children, as the calls of a callee shared by dumpcft,
+ * are visited once.
+ */
+
+#include <string.h>
+
+#include "../../include/PWCET.h"
+#include "test.h"
+
+static formula_t *node_new(formula_t *f, int kind, int children_count)
+{
+	memset(f, 0, sizeof(formula_t));
+	f->kind = kind;
+	f->aw.loop_id = -1;
+	f->opdata.children_count = children_count;
+	if (children_count > 0) {
+		f->children = (formula_t *) calloc(children_count, sizeof(formula_t));
+		CHECK(f->children != NULL);
+	}
+	return f->children;
+}
+
+static void const_new(formula_t *f, awcet_value_t eta, awcet_value_t others)
+{
+	node_new(f, KIND_CONST, 0);
+	f->aw.eta_count = 1;
+	f->aw.eta = (awcet_value_t *) malloc(sizeof(awcet_value_t));
+	CHECK(f->aw.eta != NULL);
+	f->aw.eta[0] = eta;
+	f->aw.others = others;
+}
+
+static void release(formula_t *f, void *data)
+{
+	CHECK(data == NULL);
+	formula_free(f);
+}
+
+static void release_count(formula_t *f, void *data)
+{
+	(*(int *) data)++;
+	formula_free(f);
+}
+
+#define LEVELS 40
+
+/*
+ * SEQ of two copies of a SEQ of two copies... of SEQ(ALT(CONST 50, CONST 7)):
+ * 2^LEVELS paths. As in dumpcft, the shared nodes are not ALT nodes, whose
+ * children count changes.
+ */
+static void shared(void)
+{
+	formula_t callee, level, *alt, *copies[LEVELS];
+	long long lo, hi;
+	int i, released = 0;
+
+	alt = node_new(&callee, KIND_SEQ, 1);
+	node_new(alt, KIND_ALT, 2);
+	const_new(&alt->children[0], 50, 40);
+	const_new(&alt->children[1], 7, 7);
+	level = callee;
+	for (i = 0; i < LEVELS; i++) {
+		copies[i] = (formula_t *) malloc(sizeof(formula_t) * 2);
+		CHECK(copies[i] != NULL);
+		copies[i][0] = copies[i][1] = level;
+		node_new(&level, KIND_SEQ, 0);
+		level.opdata.children_count = 2;
+		level.children = copies[i];
+	}
+
+	CHECK(formula_prune_alt(&level, NULL, release_count, &released) == 1);
+	CHECK(released == 1);
+	CHECK(alt->opdata.children_count == 1);
+	CHECK(formula_value_range(&level, NULL, -1, &lo, &hi));
+	CHECK(hi == 50LL << LEVELS);
+
+	for (i = 0; i < LEVELS; i++)
+		free(copies[i]);
+	formula_free(&callee);
+}
+
+int main(void)
+{
+	formula_t alt;
+	formula_t *children, *seq;
+
+	/* ALT(CONST 50, CONST 7, SEQ(CONST 3, CONST 4)): only the first one can win */
+	children = node_new(&alt, KIND_ALT, 3);
+	const_new(&children[0], 50, 40);
+	const_new(&children[1], 7, 7);
+	seq = node_new(&children[2], KIND_SEQ, 2);
+	const_new(&seq[0], 3, 1);
+	const_new(&seq[1], 4, 2);
+
+	CHECK(formula_prune_alt(&alt, NULL, release, NULL) == 2);
+	CHECK(alt.opdata.children_count == 1);
+	CHECK(alt.children[0].kind == KIND_CONST);
+	CHECK(alt.children[0].aw.eta[0] == 50);
+	CHECK(formula_check_range(&alt, &test_li, -1));
+
+	formula_free(&alt);
+
+	shared();
+	return 0;
+}
@@ -0,0 +1,54 @@
+/* ----------------------------------------------------------------------------
+   Copyright (C) 2020, Université de Lille, Lille, FRANCE
+
+   This file is part of WSymb.
+
+   WSymb is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation ; either version 2 of
+   the License, or (at your option) any later version.
+
+   WSymb is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY ; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program ; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+   ---------------------------------------------------------------------------- */
+
+/*
+ * Overflow checks: a loop whose values exceed AWCET_VALUE_MAX once multiplied
+ * by its bound is rejected, so are parameters without a greatest value
+ */
+
+#include "test.h"
+
+#define BIG (AWCET_VALUE_MAX / 4)
+
+/* loop 1 of the body eta = {BIG, 1}, others = 0, iterated 10 times */
+static formula_t big = {KIND_LOOP, 0, {1}, {-1, 2, (awcet_value_t[2]) {0}, 0, NULL}, (formula_t[1]) {
+	{KIND_CONST, 0, {0}, {1, 2, (awcet_value_t[2]) {BIG, 1}, 0, NULL}, NULL, NULL, "", 0, 0, 0}}, NULL, "", 0, 0, 0};
+
+/* same loop, the first value being BIG / 10 */
+static formula_t fits = {KIND_LOOP, 0, {1}, {-1, 2, (awcet_value_t[2]) {0}, 0, NULL}, (formula_t[1]) {
+	{KIND_CONST, 0, {0}, {1, 2, (awcet_value_t[2]) {BIG / 10, 1}, 0, NULL}, NULL, NULL, "", 0, 0, 0}}, NULL, "", 0, 0, 0};
+
+/* SEQ(CONST 5, AWCET 1) */
+static formula_t param = {KIND_SEQ, 0, {2}, {-1, 1, (awcet_value_t[1]) {0}, 0, NULL}, (formula_t[2]) {
+	{KIND_CONST, 0, {0}, {-1, 0, NULL, 5, NULL}, NULL, NULL, "", 0, 0, 0},
+	{KIND_AWCET, 1, {0}, {-1, 1, (awcet_value_t[1]) {0}, 0, NULL}, NULL, NULL, "", 0, 0, 0}}, NULL, "", 0, 0, 0};
+
+int main(void)
+{
+	CHECK(!formula_check_range(&big, &test_li, -1));
+	CHECK(formula_check_range(&fits, &test_li, -1));
+	CHECK(evaluate(&fits, &test_li, NULL, NULL, NULL) == BIG / 10 + 1);
+
+	CHECK(!formula_check_range(&param, &test_li, -1));
+	CHECK(formula_check_range(&param, &test_li, 1000));
+	CHECK(!formula_check_range(&param, &test_li, AWCET_VALUE_MAX));
+	return 0;
+}
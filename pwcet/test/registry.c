@@ -0,0 +1,103 @@
+/* ----------------------------------------------------------------------------
+   Copyright (C) 2020, Université de Lille, Lille, FRANCE
+
+   This file is part of WSymb.
+
+   WSymb is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation ; either version 2 of
+   the License, or (at your option) any later version.
+
+   WSymb is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY ; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program ; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+   ---------------------------------------------------------------------------- */
+
+/*
+ * Rebinding a procedure while the registry evaluates one of its callers
+ */
+
+#include <string.h>
+
+#include "../include/pwcet-registry.h"
+#include "test.h"
+
+#define MAIN 0
+#define LEAF 1
+#define MIDDLE 2
+#define USER 3
+
+static pwcet_registry_t *reg;
+static int rebind;
+
+/* leaf: eta = {7, 5}, others = 1 */
+static formula_t leaf = {KIND_CONST, 0, {0}, {-1, 2, (awcet_value_t[2]) {7, 5}, 1, NULL}, NULL, NULL, "", 0, 0, 0};
+
+/* new leaf: eta = {9}, others = 2 */
+static formula_t new_leaf = {KIND_CONST, 0, {0}, {-1, 1, (awcet_value_t[1]) {9}, 2, NULL}, NULL, NULL, "", 0, 0, 0};
+
+/* middle: USER then LEAF, USER being answered by the valuation function */
+static formula_t middle = {KIND_SEQ, 0, {2}, {-1, 2, (awcet_value_t[2]) {0}, 0, NULL}, (formula_t[2]) {
+	{KIND_AWCET, USER, {0}, {-1, 0, NULL, 0, NULL}, NULL, NULL, "", 0, 0, 0},
+	{KIND_AWCET, LEAF, {0}, {-1, 0, NULL, 0, NULL}, NULL, NULL, "", 0, 0, 0}}, NULL, "", 0, 0, 0};
+
+/* main: LEAF then MIDDLE, so the first leaf is evaluated before the rebinding */
+static formula_t main_f = {KIND_SEQ, 0, {2}, {-1, 2, (awcet_value_t[2]) {0}, 0, NULL}, (formula_t[2]) {
+	{KIND_AWCET, LEAF, {0}, {-1, 0, NULL, 0, NULL}, NULL, NULL, "", 0, 0, 0},
+	{KIND_AWCET, MIDDLE, {0}, {-1, 0, NULL, 0, NULL}, NULL, NULL, "", 0, 0, 0}}, NULL, "", 0, 0, 0};
+
+static void valuation(int param_id, param_value_t *param_val, void *data)
+{
+	(void) data;
+	CHECK((param_id == USER) || (param_id == MIDDLE));
+	memset(param_val, 0, sizeof(param_value_t));
+	param_val->aw.loop_id = -1;
+	/* MIDDLE when it is not bound */
+	if (param_id == MIDDLE)
+		param_val->aw.others = 100;
+	if (rebind) {
+		rebind = 0;
+		CHECK(pwcet_registry_bind(reg, LEAF, &new_leaf) == 0);
+	}
+}
+
+int main(void)
+{
+	pwcet_reader_t *r;
+
+	reg = pwcet_registry_new(USER);
+	CHECK(reg != NULL);
+	CHECK(pwcet_registry_bind(reg, MAIN, &main_f) == 0);
+	CHECK(pwcet_registry_bind(reg, MIDDLE, &middle) == 0);
+	CHECK(pwcet_registry_bind(reg, LEAF, &leaf) == 0);
+	r = pwcet_reader_new(reg);
+	CHECK(r != NULL);
+
+	/* 7 + 7 */
+	CHECK(pwcet_reader_evaluate(r, MAIN, &test_li, valuation, NULL, NULL) == 14);
+	CHECK(pwcet_reader_evaluate(r, MAIN, &test_li, valuation, NULL, NULL) == 14);
+
+	/* the first leaf still sees the old binding: 7 + 9 */
+	pwcet_reader_invalidate(r);
+	rebind = 1;
+	CHECK(pwcet_reader_evaluate(r, MAIN, &test_li, valuation, NULL, NULL) == 16);
+
+	/* the next evaluation only sees the new binding: 9 + 9 */
+	CHECK(pwcet_reader_evaluate(r, MAIN, &test_li, valuation, NULL, NULL) == 18);
+
+	/* removing a dependency invalidates its callers: 9 + 100 */
+	CHECK(pwcet_registry_bind(reg, MIDDLE, NULL) == 0);
+	CHECK(pwcet_reader_evaluate(r, MIDDLE, &test_li, valuation, NULL, NULL) == -1);
+	CHECK(pwcet_reader_evaluate(r, MAIN, &test_li, valuation, NULL, NULL) == 109);
+
+	pwcet_reader_free(r);
+	pwcet_registry_synchronize(reg);
+	pwcet_registry_free(reg);
+	return 0;
+}
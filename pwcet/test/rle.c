@@ -0,0 +1,214 @@
+/* ----------------------------------------------------------------------------
+   Copyright (C) 2020, Université de Lille, Lille, FRANCE
+
+   This file is part of WSymb.
+
+   WSymb is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation ; either version 2 of
+   the License, or (at your option) any later version.
+
+   WSymb is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY ; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program ; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+   ---------------------------------------------------------------------------- */
+
+
+/*
+ * Run-length encoded eta values (eta_mult != NULL) must give the results of
+ * the expanded vectors, computed value by value, whatever the limits and the
+ * loop bounds splitting the runs
+ */
+
+#include <string.h>
+
+#include "../../include/PWCET.h"
+#include "test.h"
+
+#define SOURCES 3
+#define RUNS 6
+#define VALUES (RUNS * 4)
+#define DEST (SOURCES * VALUES)
+
+static unsigned seed = 1;
+
+static int draw(int n)
+{
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 16) % n;
+}
+
+/* Decreasing runs of 1 to 4 equal values on loop 1, others below them */
+static void const_new(formula_t *f, awcet_value_t *eta, int *mult)
+{
+	int i;
+	awcet_value_t value = 100 + draw(50);
+
+	memset(f, 0, sizeof(formula_t));
+	f->kind = KIND_CONST;
+	f->param_id = IDENT_NONE;
+	f->aw.loop_id = 1;
+	f->aw.eta = eta;
+	f->aw.eta_mult = mult;
+	f->aw.eta_count = 1 + draw(RUNS);
+	for (i = 0; i < f->aw.eta_count; i++) {
+		eta[i] = value;
+		mult[i] = 1 + draw(4);
+		value -= 1 + draw(15);
+	}
+	f->aw.others = (value > 0) ? draw(value) : 0;
+}
+
+/* The same values, one per run */
+static void expand(formula_t *dest, formula_t *src, awcet_value_t *eta)
+{
+	int i, j;
+
+	*dest = *src;
+	dest->aw.eta = eta;
+	dest->aw.eta_mult = NULL;
+	dest->aw.eta_count = 0;
+	for (i = 0; i < src->aw.eta_count; i++)
+		for (j = 0; j < src->aw.eta_mult[i]; j++)
+			eta[dest->aw.eta_count++] = src->aw.eta[i];
+}
+
+/* i-th value of an expanded vector */
+static awcet_value_t value(formula_t *f, int i)
+{
+	return (i < f->aw.eta_count) ? f->aw.eta[i] : f->aw.others;
+}
+
+static int room(int limit)
+{
+	return (limit > 0) ? limit : DEST;
+}
+
+/* References computed value by value on the expanded vectors */
+static void seq_ref(formula_t *src, awcet_t *dest, int limit)
+{
+	int i, j;
+
+	dest->loop_id = 1;
+	dest->eta_count = 0;
+	dest->others = 0;
+	for (i = 0; i < SOURCES; i++) {
+		dest->others += src[i].aw.others;
+		if (dest->eta_count < src[i].aw.eta_count)
+			dest->eta_count = src[i].aw.eta_count;
+	}
+	if (dest->eta_count > room(limit))
+		dest->eta_count = room(limit);
+	for (j = 0; j < dest->eta_count; j++)
+		for (dest->eta[j] = 0, i = 0; i < SOURCES; i++)
+			dest->eta[j] += value(&src[i], j);
+}
+
+static void alt_ref(formula_t *src, awcet_t *dest, int limit)
+{
+	int i, j, pos[SOURCES] = { 0 };
+
+	dest->loop_id = 1;
+	dest->eta_count = 0;
+	dest->others = 0;
+	for (i = 0; i < SOURCES; i++)
+		if (dest->others < src[i].aw.others)
+			dest->others = src[i].aw.others;
+	while (dest->eta_count < room(limit)) {
+		for (j = -1, i = 0; i < SOURCES; i++)
+			if ((pos[i] < src[i].aw.eta_count) && (src[i].aw.eta[pos[i]] > dest->others)
+				&& ((j == -1) || (src[i].aw.eta[pos[i]] > src[j].aw.eta[pos[j]])))
+				j = i;
+		if (j == -1)
+			break;
+		dest->eta[dest->eta_count++] = src[j].aw.eta[pos[j]++];
+	}
+}
+
+static int bound;
+
+static void loop_ref(formula_t *src, int loop_id, awcet_t *dest, int limit)
+{
+	int i, g;
+
+	dest->eta_count = 0;
+	if (loop_id == src->aw.loop_id) {
+		dest->loop_id = LOOP_TOP;
+		for (dest->others = 0, i = 0; i < bound; i++)
+			dest->others += value(src, i);
+		return;
+	}
+	dest->loop_id = src->aw.loop_id;
+	dest->others = src->aw.others * bound;
+	for (g = 0; (g * bound < src->aw.eta_count) && (g < room(limit)); g++) {
+		for (dest->eta[g] = 0, i = 0; i < bound; i++)
+			dest->eta[g] += value(src, g * bound + i);
+		dest->eta_count++;
+	}
+}
+
+static void test_pv(int param_id, param_value_t *pv, void *data)
+{
+	(void) param_id;
+	(void) data;
+	pv->bound = bound;
+}
+
+int main(void)
+{
+	awcet_value_t eta[SOURCES][RUNS], flat[SOURCES][VALUES];
+	awcet_value_t out_eta[2][DEST], ref_eta[DEST];
+	int mult[SOURCES][RUNS], out_mult[DEST];
+	formula_t rle[SOURCES], plain[SOURCES], loop[2];
+	awcet_t out[2], ref = { 0, 0, ref_eta, 0, NULL };
+	evalctx_t ctx = { &test_li, test_pv, NULL, NULL };
+	int run, i, k, limit;
+
+	for (run = 0; run < 200; run++) {
+		for (i = 0; i < SOURCES; i++) {
+			const_new(&rle[i], eta[i], mult[i]);
+			expand(&plain[i], &rle[i], flat[i]);
+		}
+		for (limit = 0; limit <= 9; limit += 3) {
+			out[0] = (awcet_t) { 0, 0, out_eta[0], 0, out_mult };
+			out[1] = (awcet_t) { 0, 0, out_eta[1], 0, NULL };
+			awcet_seq(&ctx, SOURCES, rle, &out[0], limit);
+			awcet_seq(&ctx, SOURCES, plain, &out[1], limit);
+			seq_ref(plain, &ref, limit);
+			CHECK(awcet_is_equal(&out[0], &ref));
+			CHECK(awcet_is_equal(&out[1], &ref));
+
+			out[0] = (awcet_t) { 0, 0, out_eta[0], 0, out_mult };
+			out[1] = (awcet_t) { 0, 0, out_eta[1], 0, NULL };
+			awcet_alt(&ctx, SOURCES, rle, &out[0], limit);
+			awcet_alt(&ctx, SOURCES, plain, &out[1], limit);
+			alt_ref(plain, &ref, limit);
+			CHECK(awcet_is_equal(&out[0], &ref));
+			CHECK(awcet_is_equal(&out[1], &ref));
+
+			/* groups of bound values on an outer loop, or the sum on the same loop */
+			for (bound = 1; bound <= 5; bound++)
+				for (k = 1; k <= 2; k++) {
+					memset(loop, 0, sizeof(loop));
+					loop[0].kind = loop[1].kind = KIND_LOOP;
+					loop[0].param_id = loop[1].param_id = 1;
+					loop[0].opdata.loop_id = loop[1].opdata.loop_id = k;
+					loop[0].eta_limit = loop[1].eta_limit = limit;
+					loop[0].aw = (awcet_t) { 0, 0, out_eta[0], 0, out_mult };
+					loop[1].aw = (awcet_t) { 0, 0, out_eta[1], 0, NULL };
+					awcet_loop(&ctx, &rle[0].aw, &loop[0]);
+					awcet_loop(&ctx, &plain[0].aw, &loop[1]);
+					loop_ref(&plain[0], k, &ref, limit);
+					CHECK(awcet_is_equal(&loop[0].aw, &ref));
+					CHECK(awcet_is_equal(&loop[1].aw, &ref));
+				}
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,59 @@
+/* ----------------------------------------------------------------------------
+   Copyright (C) 2020, Université de Lille, Lille, FRANCE
+
+   This file is part of WSymb.
+
+   WSymb is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation ; either version 2 of
+   the License, or (at your option) any later version.
+
+   WSymb is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY ; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this program ; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+   USA
+   ---------------------------------------------------------------------------- */
+
+#ifndef PWCET_TEST_H
+#define PWCET_TEST_H 1
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../include/pwcet-runtime.h"
+
+/*
+ * Tests of the runtime, run by "make test" at the root of the repository
+ * Formulas are written like the headers of swymplify -c: the buffers of the
+ * operators are sized for the values they produce.
+ */
+
+#define CHECK(c) do { \
+	if (!(c)) { \
+		fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #c); \
+		exit(1); \
+	} \
+} while (0)
+
+/* Loops are all at top level and iterated 10 times */
+static inline int test_hierarchy(int inner, int outer)
+{
+	(void) inner;
+	(void) outer;
+	return 0;
+}
+
+static inline int test_bounds(int loop_id)
+{
+	(void) loop_id;
+	return 10;
+}
+
+static loopinfo_t test_li = { test_hierarchy, test_bounds };
+
+#endif
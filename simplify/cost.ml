@@ -0,0 +1,213 @@
+(* ----------------------------------------------------------------------------
+ * Copyright (C) 2020, Université de Lille, Lille, FRANCE
+ *
+ * This file is part of WSymb.
+ *
+ * WSymb is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation ; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * WSymb is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY ; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program ; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *---------------------------------------------------------------------------- *)
+
+(** Static cost model of the instantiation backends. From the shape of
+   a (simplified) formula, estimates the evaluation time and memory of
+   each way of instantiating it, so that swymplify can pick the fastest
+   one. *)
+
+open Symbol
+open Wcet_formula
+open Format
+
+(** Shape of a formula *)
+type stats = {
+    nodes: (string * int) list; (* number of nodes of each kind *)
+    total: int; (* number of nodes *)
+    depth: int;
+    max_size: int; (* Max_size.compute_size, the size of the largest abstract WCET *)
+    root_eta: int; (* values of the root, as counted by compute_eta_count in the runtime *)
+    sum_eta: int; (* values of all the nodes, i.e. the eta buffers of evaluate() *)
+    params: int; (* loop bound and abstract WCET parameters *)
+    bparams: int (* boolean parameters *)
+  }
+
+(** Estimated cost of a backend *)
+type backend = {
+    name: string;
+    option: string; (* swymplify option *)
+    supported: bool; (* the backend can compile the formula *)
+    time: float; (* nanoseconds per evaluation *)
+    memory: int; (* bytes *)
+    steps: int (* steps of the constant evaluation by the C++ compiler, 0 if none *)
+  }
+
+(* Constants of the model. The times per node and per eta value are
+   placeholders, rough orders of magnitude on x86-64 that were not
+   measured: they only rank the backends, and should be calibrated
+   against the evaluation times of a target before the absolute values
+   are used. *)
+let formula_t_size = 1072 (* sizeof(formula_t), most of it the bool_expr buffer *)
+let param_size = 64 (* PWCET_PARAM_SIZE, values of a parametric abstract WCET *)
+let constexpr_steps = 1048576 (* default -fconstexpr-steps of Clang, lower than the limit of GCC *)
+
+let kind_name f =
+  match f with
+  | FConst _ -> "const"
+  | FParam _ -> "param"
+  | FPlus _ -> "seq"
+  | FUnion _ -> "alt"
+  | FPower _ -> "loop"
+  | FPowerParam _ -> "paramloop"
+  | FAnnot _ -> "ann"
+  | FProduct _ -> "intmult"
+  | FBProduct _ -> "boolmult"
+
+let children f =
+  match f with
+  | FConst _ | FParam _ -> []
+  | FPlus fl | FUnion fl -> fl
+  | FPower (fb,fe,_,_) | FPowerParam (fb,fe,_,_) -> [fb;fe]
+  | FAnnot (f',_) | FProduct (_,f') | FBProduct (_,f') -> [f']
+
+let rec fold g acc f =
+  List.fold_left (fold g) (g acc f) (children f)
+
+let rec depth f =
+  1 + List.fold_left (fun d f' -> max d (depth f')) 0 (children f)
+
+(* Parameters, by their kind and identifier *)
+let parameters f =
+  let tbl = Hashtbl.create 17 in
+  let add_terms tl =
+    List.iter (fun t ->
+        match t.value with
+        | BParam p -> Hashtbl.replace tbl ("b", p) ()
+        | BConst _ -> ()) tl
+  in
+  let add () f =
+    match f with
+    | FParam p -> Hashtbl.replace tbl ("p", p) ()
+    | FPower (_,_,_,SParam p) -> Hashtbl.replace tbl ("p", p) ()
+    | FPowerParam (_,_,_,tl) -> add_terms tl
+    | FBProduct (bl,_) ->
+       List.iter (fun b ->
+           match b with
+           | BLeq (_,tl) | BEq (_,tl) -> add_terms tl
+           | BBool _ -> ()) bl
+    | _ -> ()
+  in
+  fold add () f;
+  Hashtbl.fold (fun (k,_) () (p,b) -> if k = "p" then (p+1,b) else (p,b+1)) tbl (0,0)
+
+let stats f =
+  let kinds = ["const";"param";"seq";"alt";"loop";"paramloop";"ann";"intmult";"boolmult"] in
+  let count = Hashtbl.create 11 in
+  let sum_eta =
+    fold (fun s f' ->
+        let k = kind_name f' in
+        Hashtbl.replace count k (1 + (try Hashtbl.find count k with Not_found -> 0));
+        s + multi_wcet_size_bound f' + 1) 0 f
+  in
+  let nodes = List.map (fun k -> (k, (try Hashtbl.find count k with Not_found -> 0))) kinds in
+  let (params, bparams) = parameters f in
+  {nodes = nodes;
+   total = List.fold_left (fun s (_,n) -> s + n) 0 nodes;
+   depth = depth f;
+   max_size = Max_size.compute_size f;
+   root_eta = multi_wcet_size_bound f;
+   sum_eta = sum_eta;
+   params = params;
+   bparams = bparams}
+
+(* Parametric abstract WCETs make compute_size unbounded *)
+let bounded n = if n >= 999999999 then param_size else n
+
+(* Constructs a generator cannot compile *)
+let rec exists p f =
+  p f || List.exists (exists p) (children f)
+
+let py_unsupported f =
+  match f with
+  | FProduct _ | FParam _ | FAnnot _ | FPower (_,_,_,SParam _) -> true
+  | _ -> false
+
+let it_unsupported f =
+  match f with
+  | FProduct _ | FAnnot _ -> true
+  | FBProduct (bl,_) ->
+     (* wcet() only has the arguments b0 to b3 *)
+     List.exists (fun b ->
+         match b with
+         | BLeq (_,tl) | BEq (_,tl) ->
+            List.exists (fun t ->
+                match t.value with
+                | BParam p -> (try int_of_string p > 3 with Failure _ -> true)
+                | BConst _ -> false) tl
+         | BBool _ -> false) bl
+  | _ -> false
+
+(** Cost of each backend, fastest first *)
+let backends f =
+  let s = stats f in
+  let n = float_of_int s.total and v = float_of_int s.sum_eta in
+  let size = bounded s.max_size in
+  let all = [
+      (* formula_t initializer evaluated by evaluate(), one eta buffer per node *)
+      {name = "evaluate"; option = "-c"; supported = true;
+       time = 25. *. n +. 2. *. v;
+       memory = s.total * formula_t_size + 12 * s.sum_eta; steps = 0};
+      (* libpwcet operators, each result allocated on the heap *)
+      {name = "iterative"; option = "-i"; supported = not (exists it_unsupported f);
+       time = 60. *. n +. 2. *. v;
+       memory = s.total * 32 + 8 * s.sum_eta; steps = 0};
+      (* straight-line C produced by compiler/compiler.py *)
+      {name = "compiler.py"; option = "-p"; supported = not (exists py_unsupported f);
+       time = 2. *. n +. 1. *. v;
+       memory = 4 * s.sum_eta; steps = 0};
+      (* constexpr operators, folded by the C++ compiler without parameters:
+         the evaluation then costs a load, and the build the constant
+         evaluation, every operator initializing and walking its result *)
+      {name = "constexpr"; option = "-x"; supported = true;
+       time = (if s.params + s.bparams = 0 then 1. else 5. *. n +. 1. *. float_of_int (s.total * size));
+       memory = (if s.params + s.bparams = 0 then 8 else 8 * size * s.depth);
+       steps = (if s.params + s.bparams = 0 then 4 * s.total * (size + 1) else 0)}
+    ]
+  in
+  List.stable_sort (fun b1 b2 -> compare b1.time b2.time) all
+
+(* The build does not need a higher constant evaluation limit *)
+let buildable b =
+  b.supported && b.steps <= constexpr_steps
+
+(** The fastest backend that can compile [f] with the default options of
+   the compilers *)
+let fastest f =
+  List.find buildable (backends f)
+
+let pp_report out_f f =
+  let s = stats f in
+  fprintf out_f "nodes: %d@." s.total;
+  List.iter (fun (k,n) -> if n > 0 then fprintf out_f "  %-10s %d@." k n) s.nodes;
+  fprintf out_f "depth: %d@." s.depth;
+  if s.max_size >= 999999999 then
+    fprintf out_f "max abstract WCET size: unbounded (parametric)@."
+  else
+    fprintf out_f "max abstract WCET size: %d@." s.max_size;
+  fprintf out_f "eta values: %d at the root, %d in all the nodes@." s.root_eta s.sum_eta;
+  fprintf out_f "parameters: %d, boolean parameters: %d@." s.params s.bparams;
+  fprintf out_f "%-12s %-6s %14s %14s@." "backend" "option" "time (ns)" "memory (B)";
+  List.iter (fun b ->
+      fprintf out_f "%-12s %-6s %14.0f %14d%s@." b.name b.option b.time b.memory
+        (if not b.supported then "  unsupported"
+         else if not (buildable b) then sprintf "  %d constexpr steps" b.steps
+         else ""))
+    (backends f)
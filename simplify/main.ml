@@ -4,14 +4,23 @@ open Simplify
 open Context   
 open Max_size
 
-let compile source_name contexts =
-  if !Options.to_c then
+(* The contexts are simplified once, before the cost model and the backends *)
+let simplify_ctx ctx =
+  new_ctx (simplify ctx.loop_hierarchy ctx.formula) ctx.loop_hierarchy ctx.loop_bounds
+
+(* Emits simplified contexts *)
+let emit source_name contexts =
+  if !Options.to_cpp then
+    if List.length contexts <> 1 then
+      raise (Arg.Bad "Compilation to C++ code applies only to a single formula.")
+    else
+      To_cpp.cpp_context source_name (List.hd contexts)
+  else if !Options.to_c then
     if List.length contexts <> 1 then
       raise (Arg.Bad "Compilation to C code applies only to a single formula.")
     else
-      let ctx = List.hd contexts in
-      let f' = simplify ctx.loop_hierarchy ctx.formula in
-      let ctx' = new_ctx f' ctx.loop_hierarchy ctx.loop_bounds in
+      let ctx' = List.hd contexts in
+      let f' = ctx'.formula in
       (*let _ = Printf.printf "Max WCET size: %d\n" (compute_size f') in*)
       if !Options.to_it then
       	To_it.c_context source_name ctx'
@@ -37,14 +46,35 @@ let compile source_name contexts =
 
     List.iter
       (fun ctx ->
-        let f' = simplify ctx.loop_hierarchy ctx.formula in
-        (*let _ = Printf.printf "Max WCET size: %d\n" (compute_size f') in*)
+        (*let _ = Printf.printf "Max WCET size: %d\n" (compute_size ctx.formula) in*)
 	Format.fprintf out_f "%a %a@."
-          Wcet_formula.pp f'
+          Wcet_formula.pp ctx.formula
           Loops.pp_hier ctx.loop_hierarchy
       )
       contexts
   
+(* Cost report and choice of the backend, see Cost *)
+let compile source_name contexts =
+  if not (!Options.cost || !Options.auto) then
+    emit source_name (List.map simplify_ctx contexts)
+  else if List.length contexts <> 1 then
+    raise (Arg.Bad "The cost model applies only to a single formula.")
+  else
+    let ctx' = simplify_ctx (List.hd contexts) in
+    let f' = ctx'.formula in
+    if !Options.cost then
+      Cost.pp_report Format.std_formatter f';
+    if !Options.auto then
+      begin
+        let b = Cost.fastest f' in
+        Printf.eprintf "%s: using %s (%s)\n" Options.tool_name b.Cost.name b.Cost.option;
+        Options.to_c := (b.Cost.option <> "-x");
+        Options.to_it := (b.Cost.option = "-i");
+        Options.to_py := (b.Cost.option = "-p");
+        Options.to_cpp := (b.Cost.option = "-x");
+        emit source_name [ctx']
+      end
+
 (* Process file named [source_name]. Results is printed on standard output. *)  
 let anonymous source_name =
   if Filename.check_suffix source_name Options.extension then
@@ -29,12 +29,18 @@ let debug = ref false
 let to_c = ref false
 let to_it = ref false
 let to_py = ref false
+let to_cpp = ref false
+let cost = ref false
+let auto = ref false
 let out_name = ref ""
          
 let options = [
     "-p", Arg.Set to_py, "Compile a (single) formula to C code";
     "-c", Arg.Set to_c, "Compile a (single) formula to C code";
+    "-x", Arg.Set to_cpp, "Compile a (single) formula to C++ constexpr code";
     "-i", Arg.Set to_it, "Compile in C with iterative computations (recursive otherwise)";
+    "-cost", Arg.Set cost, "Print the shape of a (single) formula and the estimated cost of each backend";
+    "-auto", Arg.Set auto, "Compile a (single) formula with the fastest backend of the cost model";
     "-debug", Arg.Set debug, "Run in debug mode";
     "-o", Arg.Set_string out_name, "Speficies the output file name";
     "-version", Arg.Unit (fun () -> print_endline version), "Print version"
@@ -7,10 +7,11 @@ for f in `ls test`; do
         IN=test/$f
         OUT=test/$BNAME".out"
         EXPECT=test/$BNAME".expect"
+        FLAGS=test/$BNAME".flags"
 
         if [ -e $EXPECT ]; then
             echo Processing $IN
-            $TOOL $IN > $OUT
+            $TOOL `cat $FLAGS 2>/dev/null` $IN > $OUT
             diff $OUT $EXPECT
         fi
     fi
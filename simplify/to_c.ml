@@ -171,17 +171,22 @@ let c_loopid out_f lid =
   | LTop -> pp_print_string out_f "LOOP_TOP"
   
 let c_wlist out_f (wl, last) =
-  fprintf out_f "%d,@ %a,@ %d" (List.length wl) (c_array pp_print_int "long long") wl last
+  fprintf out_f "%d,@ %a,@ %d" (List.length wl) (c_array pp_print_int "awcet_value_t") wl last
 
 let c_null_wcet out_f () =
   fprintf out_f "@[<hov 2>{-1,@ 0,@ NULL,@ 0}@]"
 
+(* Operators get a run-length buffer, parameters are filled by the
+   valuation function and stay unencoded. *)
 let c_aw_placeholder out_f f =
+  let eta_count = if multi_wcet_size_bound f > 0 then multi_wcet_size_bound f else 1 in
   match f with
   | FConst _ -> Utils.internal_error "c_aw_placeholder" "f should not be const or param"
+  | FParam _ ->
+     fprintf out_f "@[<hov 2>{-1,@ %d,@ (awcet_value_t[%d]){0},@ 0}@]" eta_count eta_count
   | _ ->
-     let eta_count = if multi_wcet_size_bound f > 0 then multi_wcet_size_bound f else 1 in
-     fprintf out_f "@[<hov 2>{-1,@ %d,@ (long long[%d]){0},@ 0}@]" eta_count eta_count
+     fprintf out_f "@[<hov 2>{-1,@ %d,@ (awcet_value_t[%d]){0},@ 0,@ (int[%d]){0}}@]"
+       eta_count eta_count eta_count
   
 let c_awcet out_f (lid, wl) =
   fprintf out_f "@[<hov 2>{%a,@ %a}@]"
@@ -249,6 +254,29 @@ and c_formula_rec out_f f =
 let c_formula out_f f =
   fprintf out_f "@[<hov 2>formula_t f@ =@ %a;@]@ " c_formula_rec f
 
+(* Upper bound to the absolute value of the values computed for [f],
+   parameters excluded (floats do not overflow) *)
+let rec value_bound f =
+  let fmax = List.fold_left (fun m v -> max m (abs_float (float_of_int v))) 0. in
+  match f with
+  | FConst (_, (wl, last)) -> fmax (last::wl)
+  | FParam _ -> 0.
+  | FPlus fl -> List.fold_left (fun s f -> s +. value_bound f) 0. fl
+  | FUnion fl -> List.fold_left (fun m f -> max m (value_bound f)) 0. fl
+  | FPower (fbody, _, _, SInt i) -> float_of_int (max i 1) *. value_bound fbody
+  | FPower (fbody, _, _, _) | FPowerParam (fbody, _, _, _) -> value_bound fbody
+  | FAnnot (f', _) | FBProduct (_, f') -> value_bound f'
+  | FProduct (k, f') -> abs_float (float_of_int k) *. value_bound f'
+
+(* Rejects 32-bit runtimes at compile time when the values cannot fit *)
+let c_value_check out_f f =
+  if value_bound f > 2147483647. then
+    begin
+      fprintf out_f "#ifdef PWCET_VALUE_32@.";
+      fprintf out_f "#error \"WCET values exceed 32 bits, do not define PWCET_VALUE_32\"@.";
+      fprintf out_f "#endif@.@."
+    end
+
 let c_context source_name ctx =
   let basename = Filename.chop_suffix source_name Options.extension in
   let outname =
@@ -258,6 +286,7 @@ let c_context source_name ctx =
   in
   let out_ch = open_out outname in
   let out_f = formatter_of_out_channel out_ch in
+  c_value_check out_f ctx.formula;
   c_loop_bounds out_f ctx.loop_bounds;
   fprintf out_f "@.";
   c_loop_hierarchy out_f ctx.loop_hierarchy;
@@ -0,0 +1,173 @@
+(* ----------------------------------------------------------------------------
+ * Copyright (C) 2020, Université de Lille, Lille, FRANCE
+ *
+ * This file is part of WSymb.
+ *
+ * WSymb is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation ; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * WSymb is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY ; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program ; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *---------------------------------------------------------------------------- *)
+
+(** Compiles a formula to a C++17 constexpr expression, evaluated by
+   the operators of pwcet-constexpr.hpp. Parameters are read from an
+   object [p] providing [bound(id)], [bparam(id)] and [awcet(id)]. *)
+
+open Symbol
+open Loops
+open Wcet_formula
+open Context
+open Format
+
+let cpp_loopid out_f lid =
+  match lid with
+  | LNamed n -> pp_print_int out_f (int_of_string n)
+  | LTop -> pp_print_string out_f "pwcet::loop_top"
+
+(* Upper bound to the number of eta values computed for [f], as [(c, k)]
+   standing for [c + k * PWCET_PARAM_SIZE]. Unlike
+   [multi_wcet_size_bound], it also holds when an annotation does not
+   apply or when a parameter has several values. *)
+let rec size_bound f =
+  let max2 (c1, k1) (c2, k2) = (max c1 c2, max k1 k2) in
+  let add2 (c1, k1) (c2, k2) = (c1 + c2, k1 + k2) in
+  match f with
+  | FConst (_, (wl, _)) -> (List.length wl, 0)
+  | FParam _ -> (0, 1)
+  | FPlus fl -> List.fold_left (fun s f -> max2 s (size_bound f)) (0, 0) fl
+  | FUnion fl -> List.fold_left (fun s f -> add2 s (size_bound f)) (0, 0) fl
+  | FPower (fbody, _, _, _) | FPowerParam (fbody, _, _, _) -> size_bound fbody
+  | FAnnot (f', (_, it)) -> max2 (it, 0) (size_bound f')
+  | FProduct (_, f') | FBProduct (_, f') -> size_bound f'
+
+let cpp_size out_f f =
+  match size_bound f with
+  | (c, 0) -> pp_print_int out_f (max c 1)
+  | (0, 1) -> pp_print_string out_f "PWCET_PARAM_SIZE"
+  | (c, k) -> fprintf out_f "%d + %d * PWCET_PARAM_SIZE" c k
+
+(* Same as pwcet::alt_max, the greatest number of operands of an alternative *)
+let alt_max = 1024
+
+let rec has_params f =
+  match f with
+  | FConst _ -> false
+  | FParam _ -> true
+  | FPlus fl | FUnion fl -> List.exists has_params fl
+  | FPower (_, _, _, SParam _) | FPowerParam _ | FBProduct _ -> true
+  | FPower (f', _, _, _) | FAnnot (f', _) | FProduct (_, f') -> has_params f'
+
+let cpp_term out_f t =
+  match t.value with
+  | BConst c -> fprintf out_f "%d * %d" t.coef c
+  | BParam p -> fprintf out_f "%d * p.bparam(%d)" t.coef (int_of_string p)
+
+let cpp_terms out_f tl =
+  pp_print_list ~pp_sep:(fun out_f () -> fprintf out_f "@ + ") cpp_term out_f tl
+
+let cpp_condition out_f c =
+  match c with
+  | BLeq (cst, tl) -> fprintf out_f "(%d <= %a)" cst cpp_terms tl
+  | BEq (cst, tl) -> fprintf out_f "(%d == %a)" cst cpp_terms tl
+  | BBool b -> pp_print_string out_f (if b then "true" else "false")
+
+let cpp_conditions out_f cl =
+  pp_print_list ~pp_sep:(fun out_f () -> fprintf out_f "@ && ") cpp_condition out_f cl
+
+let cpp_const out_f (lid, (wl, last)) =
+  fprintf out_f "@[<hov 2>pwcet::awcet<%d>{%a,@ %d,@ {%a},@ %d}@]"
+    (if wl = [] then 1 else List.length wl)
+    cpp_loopid lid
+    (List.length wl)
+    (pp_print_list ~pp_sep:(fun out_f () -> fprintf out_f ",@ ") pp_print_int) wl
+    last
+
+let rec cpp_formula out_f f =
+  match f with
+  | FConst aw -> cpp_const out_f aw
+  | FParam p -> fprintf out_f "p.awcet(%d)" (int_of_string p)
+  | FPlus fl -> fprintf out_f "@[<hov 2>pwcet::seq<%a, loops>({%a})@]" cpp_size f cpp_operands fl
+  | FUnion fl ->
+     if List.length fl > alt_max then
+       raise (Arg.Bad (sprintf "An alternative has more than %d operands, increase pwcet::alt_max." alt_max));
+     fprintf out_f "@[<hov 2>pwcet::alt<%a, loops>({%a})@]" cpp_size f cpp_operands fl
+  | FPower (fbody, _, lid, it) ->
+     fprintf out_f "@[<hov 2>pwcet::loop<%a>(%a,@ %a,@ " cpp_size f cpp_formula fbody cpp_loopid lid;
+     begin
+       match it with
+       | SInt i -> pp_print_int out_f i
+       | SParam p -> fprintf out_f "p.bound(%d)" (int_of_string p)
+     end;
+     fprintf out_f ")@]"
+  | FPowerParam (fbody, _, lid, it) ->
+     fprintf out_f "@[<hov 2>pwcet::loop<%a>(%a,@ %a,@ pwcet::loop_bound(%a))@]"
+       cpp_size f cpp_formula fbody cpp_loopid lid cpp_terms it
+  | FAnnot (f', (lid, k)) ->
+     fprintf out_f "@[<hov 2>pwcet::ann<%a, loops>(%a,@ %a,@ %d)@]" cpp_size f cpp_formula f' cpp_loopid lid k
+  | FProduct (k, f') ->
+     fprintf out_f "@[<hov 2>pwcet::intmult<%a>(%a,@ %d)@]" cpp_size f cpp_formula f' k
+  | FBProduct (cl, f') ->
+     (* only computed when the conditions hold, bottom otherwise *)
+     fprintf out_f "@[<hov 2>(%a)@ ? pwcet::copy<%a>(%a)@ : pwcet::awcet<%a>{}@]"
+       cpp_conditions cl cpp_size f cpp_formula f' cpp_size f
+
+and cpp_operands out_f fl =
+  pp_print_list ~pp_sep:(fun out_f () -> fprintf out_f ",@ ") cpp_formula out_f fl
+
+let cpp_loop_inclusion out_f l1 l2 =
+  fprintf out_f "    if ((inner == %d) && (outer == %d)) return 1;@."
+    (int_of_string l1) (int_of_string l2)
+
+let cpp_loops out_f hier =
+  fprintf out_f "struct loops {@.";
+  fprintf out_f "  static constexpr int hierarchy([[maybe_unused]] int inner, [[maybe_unused]] int outer) {@.";
+  Hashtbl.iter (fun (l1,l2) _ -> cpp_loop_inclusion out_f l1 l2) hier;
+  fprintf out_f "    return 0;@.  }@.};@."
+
+(* A C++ identifier from the name of the source file *)
+let cpp_namespace basename =
+  let name = String.map (fun c ->
+      match c with
+      | 'a'..'z' | 'A'..'Z' | '0'..'9' | '_' -> c
+      | _ -> '_') (Filename.basename basename) in
+  match name.[0] with
+  | '0'..'9' -> "pwcet_"^name
+  | _ -> name
+
+let cpp_context source_name ctx =
+  let basename = Filename.chop_suffix source_name Options.extension in
+  let outname =
+    if (!Options.out_name = "") then
+      basename^".hpp"
+    else !Options.out_name
+  in
+  let out_ch = open_out outname in
+  let out_f = formatter_of_out_channel out_ch in
+  let f = ctx.formula in
+  fprintf out_f "#include <pwcet-constexpr.hpp>@.@.";
+  fprintf out_f "namespace %s {@.@." (cpp_namespace basename);
+  cpp_loops out_f ctx.loop_hierarchy;
+  fprintf out_f "@.";
+  fprintf out_f "template <class P>@.";
+  fprintf out_f "constexpr pwcet::awcet<%a> formula([[maybe_unused]] const P &p) {@." cpp_size f;
+  fprintf out_f "  @[<hov 2>return@ pwcet::copy<%a>(%a);@]@.}@.@." cpp_size f cpp_formula f;
+  fprintf out_f "template <class P>@.";
+  fprintf out_f "constexpr pwcet::value_t wcet(const P &p) {@.";
+  fprintf out_f "  return formula(p).wcet();@.}@.@.";
+  if not (has_params f) then
+    begin
+      fprintf out_f "constexpr pwcet::value_t wcet() {@.";
+      fprintf out_f "  return wcet(pwcet::no_params{});@.}@.@."
+    end;
+  fprintf out_f "}@.";
+  close_out out_ch